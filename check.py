@@ -153,11 +153,23 @@ def run_wasm_reduce_tests():
         # convert to wasm
         support.run_command(shared.WASM_AS + [t, '-o', 'a.wasm', '-all'])
         cmd = shared.WASM_OPT[0]
-        support.run_command(shared.WASM_REDUCE + ['a.wasm', f'--command={cmd} b.wasm --fuzz-exec -all ', '-t', 'b.wasm', '-w', 'c.wasm', '--timeout=4'])
         expected = t + '.txt'
+        # Testing several candidates at once must give the same results.
+        for jobs in ['1', '3']:
+            support.run_command(shared.WASM_REDUCE + ['a.wasm', f'--command={cmd} b.wasm --fuzz-exec -all ', '-t', 'b.wasm', '-w', 'c.wasm', '--timeout=4', '--jobs=' + jobs])
+            support.run_command(shared.WASM_DIS + ['c.wasm', '-o', 'a.wat'])
+            with open('a.wat') as seen:
+                shared.fail_if_not_identical_to_file(seen.read(), expected)
+
+    # the in-process oracle, which runs wasm-opt passes in a forked child
+    print('..', 'in-process')
+    t = os.path.join(shared.get_test_dir('reduce'), 'in-process', 'extract.wast')
+    support.run_command(shared.WASM_AS + [t, '-o', 'a.wasm', '-all', '-g'])
+    for jobs in ['1', '3']:
+        support.run_command(shared.WASM_REDUCE + ['a.wasm', '--in-process=-O1 --extract-function=kept', '-t', 'b.wasm', '-w', 'c.wasm', '-g', '--jobs=' + jobs])
         support.run_command(shared.WASM_DIS + ['c.wasm', '-o', 'a.wat'])
         with open('a.wat') as seen:
-            shared.fail_if_not_identical_to_file(seen.read(), expected)
+            shared.fail_if_not_identical_to_file(seen.read(), t + '.txt')
 
     # run on a nontrivial fuzz testcase, for general coverage
     # this is very slow in ThreadSanitizer, so avoid it there
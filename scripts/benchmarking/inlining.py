@@ -0,0 +1,302 @@
+#!/usr/bin/env python3
+
+# Copyright 2026 WebAssembly Community Group participants
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+'''
+Compares inlining modes: for each input, optimizes it with each configuration
+and reports the time wasm-opt took, the size of the output, and how long the
+output takes to run in wasm-shell.
+
+Usage:
+
+  scripts/benchmarking/inlining.py [--binaryen-bin DIR] [--emcc EMCC]
+                                   [--budget PERCENT ...] [INPUT ...]
+
+Inputs are .wat/.wasm files, whose runtime is measured by invoking the export
+given by --invoke (which must have no params), and C/C++ programs, which are
+compiled with emcc and whose runtime is measured by running main(), with the
+arguments in the .args file next to them, if there is one. By default the
+inputs are the C/C++ programs with a main() in test/, which requires emcc (if
+it is not found, they are skipped).
+
+Imports are provided by stubs that do nothing and return zeros, except for
+fd_write, which reports everything as written. Runtime is the time to
+instantiate the module and invoke the export, minus the time to only
+instantiate it.
+'''
+
+import argparse
+import glob
+import json
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+import time
+
+root_dir = os.path.dirname(os.path.dirname(os.path.dirname(
+    os.path.abspath(__file__))))
+
+parser = argparse.ArgumentParser(
+    description='Compare inlining modes on compile time, size and runtime.')
+parser.add_argument('inputs', nargs='*', metavar='INPUT')
+parser.add_argument('--binaryen-bin', default=os.path.join(root_dir, 'bin'),
+                    help='Directory with wasm-opt and wasm-shell')
+parser.add_argument('--emcc', default=shutil.which('emcc'),
+                    help='emcc to compile C/C++ inputs with')
+parser.add_argument('--cflags', default='-O2',
+                    help='Flags to compile C/C++ inputs with')
+parser.add_argument('--opt-flags', default='-O3',
+                    help='wasm-opt flags for all configurations')
+parser.add_argument('--budget', type=int, action='append', default=[],
+                    help='Add a bottom-up configuration with this growth '
+                         'budget, in percent (may be repeated)')
+parser.add_argument('--invoke', help='Export to run in .wat/.wasm inputs')
+parser.add_argument('--repeat', type=int, default=3,
+                    help='Take the best time of this many runs')
+parser.add_argument('--timeout', type=int, default=600,
+                    help='Give up on a wasm-shell run after this many '
+                         'seconds')
+options = parser.parse_args()
+
+WASM_OPT = os.path.join(options.binaryen_bin, 'wasm-opt')
+WASM_SHELL = os.path.join(options.binaryen_bin, 'wasm-shell')
+
+# The exported entry point of compiled C/C++ programs.
+ENTRY = 'benchmark'
+
+
+def get_configs():
+    configs = [('default', []),
+               ('bottom-up', ['--pass-arg=inlining-bottom-up'])]
+    for budget in options.budget:
+        configs.append(('bottom-up@%d' % budget,
+                        ['--pass-arg=inlining-bottom-up',
+                         '--pass-arg=inlining-growth-budget@%d' % budget]))
+    return configs
+
+
+def get_default_inputs():
+    inputs = []
+    for source in sorted(glob.glob(os.path.join(root_dir, 'test', '*.c')) +
+                         glob.glob(os.path.join(root_dir, 'test', '*.cpp'))):
+        text = open(source).read()
+        if re.search(r'\bmain\s*\(', text) and 'emscripten.h' not in text:
+            inputs.append(source)
+    return inputs
+
+
+def is_source(input):
+    return os.path.splitext(input)[1] in ('.c', '.cc', '.cpp')
+
+
+# Compiles a C/C++ program into a module that exports a function that runs
+# main(). The module imports its memory, so that the stub of fd_write can read
+# it.
+def compile_source(source, temp_dir):
+    args = []
+    args_file = os.path.splitext(source)[0] + '.args'
+    if os.path.exists(args_file):
+        args = json.load(open(args_file))
+    text = open(source).read()
+    takes_args = args or not re.search(r'\bmain\s*\(\s*(void)?\s*\)', text)
+    driver = os.path.join(temp_dir, 'driver.c')
+    with open(driver, 'w') as f:
+        if takes_args:
+            argv = ', '.join(json.dumps(arg) for arg in ['program'] + args)
+            f.write('int benchmark_main(int argc, char** argv);\n')
+            f.write('__attribute__((export_name("%s"))) int %s() {\n' %
+                    (ENTRY, ENTRY))
+            f.write('  static char* argv[] = {%s, 0};\n' % argv)
+            f.write('  return benchmark_main(%d, argv);\n' % (len(args) + 1))
+        else:
+            f.write('int benchmark_main(void);\n')
+            f.write('__attribute__((export_name("%s"))) int %s() {\n' %
+                    (ENTRY, ENTRY))
+            f.write('  return benchmark_main();\n')
+        f.write('}\n')
+    objects = []
+    for i, file in enumerate([source, driver]):
+        obj = os.path.join(temp_dir, '%d.o' % i)
+        subprocess.check_call([options.emcc, '-c', file, '-o', obj,
+                               '-Dmain=benchmark_main'] +
+                              options.cflags.split())
+        objects.append(obj)
+    # Link without optimizations, so that emcc does not run wasm-opt on the
+    # result and all the inlining is up to the configurations we compare.
+    wasm = os.path.join(temp_dir, 'input.wasm')
+    subprocess.check_call([options.emcc] + objects +
+                          ['-o', wasm, '-O0', '--no-entry',
+                           '-sSTANDALONE_WASM', '-sIMPORTED_MEMORY'])
+    return wasm
+
+
+def zero(type):
+    if type in ('i32', 'i64', 'f32', 'f64'):
+        return '(%s.const 0)' % type
+    if type == 'v128':
+        return '(v128.const i32x4 0 0 0 0)'
+    match = re.match(r'\(ref null (.*)\)$', type) or \
+        re.match(r'(\w+)ref$', type)
+    if match:
+        return '(ref.null %s)' % match.group(1)
+    raise Exception('cannot stub a value of type ' + type)
+
+
+FD_WRITE = '''(func (export "fd_write")
+    (param $fd i32) (param $iovs i32) (param $len i32) (param $nwritten i32)
+    (result i32)
+    (local $total i32)
+    (block $done
+      (loop $loop
+        (br_if $done (i32.eqz (local.get $len)))
+        (local.set $total
+          (i32.add (local.get $total) (i32.load offset=4 (local.get $iovs))))
+        (local.set $iovs (i32.add (local.get $iovs) (i32.const 8)))
+        (local.set $len (i32.sub (local.get $len) (i32.const 1)))
+        (br $loop)))
+    (i32.store (local.get $nwritten) (local.get $total))
+    (i32.const 0))'''
+
+
+# Returns the commands of a wast script that define and register a module that
+# provides the imports of a module, given its text, or raises an exception if
+# we can't.
+def get_stubs(text):
+    imports = re.findall(
+        r'^ \(import "([^"]*)" "([^"]*)" \((\w+) \S+(.*)\)\)$', text, re.M)
+    has_memory = any(kind == 'memory' for _, _, kind, _ in imports)
+    items = []
+    module_names = set()
+    export_names = set()
+    for module_name, name, kind, rest in imports:
+        if name in export_names:
+            raise Exception('cannot stub import %s twice' % name)
+        module_names.add(module_name)
+        export_names.add(name)
+        rest = re.sub(r' \(type \$?[^)]*\)', '', rest).strip()
+        if kind == 'func' and name == 'fd_write' and has_memory:
+            items.append(FD_WRITE)
+        elif kind == 'func':
+            results = re.findall(r'\(result ([^()]*(?:\([^()]*\))?)\)', rest)
+            body = ' '.join(zero(type) for result in results
+                            for type in result.split())
+            items.append('(func (export "%s") %s %s)' % (name, rest, body))
+        elif kind == 'global':
+            type = re.match(r'\(mut (.*)\)$', rest)
+            value = zero(type.group(1) if type else rest)
+            items.append('(global (export "%s") %s %s)' % (name, rest, value))
+        elif kind in ('memory', 'table'):
+            items.append('(%s (export "%s") %s)' % (kind, name, rest))
+        else:
+            raise Exception('cannot stub import of a ' + kind)
+    if not items:
+        return ''
+    stubs = '(module $stubs\n  %s)\n' % '\n  '.join(items)
+    for module_name in sorted(module_names):
+        stubs += '(register "%s" $stubs)\n' % module_name
+    return stubs
+
+
+def time_command(cmd, timeout=None):
+    best = None
+    for _ in range(options.repeat):
+        start = time.time()
+        subprocess.run(cmd, stdout=subprocess.DEVNULL, stderr=subprocess.PIPE,
+                       timeout=timeout, check=True)
+        elapsed = time.time() - start
+        best = elapsed if best is None else min(best, elapsed)
+    return best
+
+
+def write_script(path, stubs, wasm, invoke):
+    binary = ''.join('\\%02x' % byte for byte in open(wasm, 'rb').read())
+    with open(path, 'w') as f:
+        f.write(stubs)
+        f.write('(module binary "%s")\n' % binary)
+        if invoke:
+            f.write('(invoke "%s")\n' % invoke)
+
+
+# Returns the runtime of |invoke| in |wasm|, or None if we cannot run it.
+def measure_runtime(wasm, invoke, temp_dir):
+    if not invoke:
+        return None
+    text = subprocess.check_output([WASM_OPT, wasm, '-all', '--print'],
+                                   text=True)
+    if not re.search(r'^ \(export "%s" \(func ' % re.escape(invoke), text,
+                     re.M):
+        print('  cannot run %s: no exported function %s' % (wasm, invoke),
+              file=sys.stderr)
+        return None
+    try:
+        stubs = get_stubs(text)
+    except Exception as e:
+        print('  cannot run %s: %s' % (wasm, e), file=sys.stderr)
+        return None
+    init = os.path.join(temp_dir, 'init.wast')
+    run = os.path.join(temp_dir, 'run.wast')
+    write_script(init, stubs, wasm, None)
+    write_script(run, stubs, wasm, invoke)
+    try:
+        init_time = time_command([WASM_SHELL, init], options.timeout)
+        run_time = time_command([WASM_SHELL, run], options.timeout)
+    except subprocess.CalledProcessError as e:
+        print('  cannot run %s: %s' % (wasm, e.stderr.decode()),
+              file=sys.stderr)
+        return None
+    except subprocess.TimeoutExpired as e:
+        print('  cannot run %s: %s' % (wasm, e), file=sys.stderr)
+        return None
+    return max(run_time - init_time, 0)
+
+
+def main():
+    inputs = options.inputs or get_default_inputs()
+    configs = get_configs()
+    rows = []
+    for input in inputs:
+        name = os.path.basename(input)
+        with tempfile.TemporaryDirectory() as temp_dir:
+            invoke = options.invoke
+            if is_source(input):
+                if not options.emcc:
+                    print('skipping %s: emcc not found' % name,
+                          file=sys.stderr)
+                    continue
+                input = compile_source(input, temp_dir)
+                invoke = ENTRY
+            for config_name, config_flags in configs:
+                print('%s: %s' % (name, config_name), file=sys.stderr)
+                output = os.path.join(temp_dir, 'output.wasm')
+                compile_time = time_command(
+                    [WASM_OPT, input, '-all', '-o', output] +
+                    options.opt_flags.split() + config_flags)
+                size = os.path.getsize(output)
+                runtime = measure_runtime(output, invoke, temp_dir)
+                rows.append((name, config_name, compile_time, size, runtime))
+
+    print('%-20s %-16s %12s %10s %12s' %
+          ('input', 'config', 'compile (s)', 'size', 'runtime (s)'))
+    for name, config_name, compile_time, size, runtime in rows:
+        runtime = 'n/a' if runtime is None else '%.3f' % runtime
+        print('%-20s %-16s %12.3f %10d %12s' %
+              (name, config_name, compile_time, size, runtime))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,1306 @@
+/*
+ * Copyright 2026 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cmath>
+#include <cstring>
+#include <optional>
+
+#include "interpreter/bytecode.h"
+#include "interpreter/store.h"
+#include "support/bits.h"
+#include "support/safe_integer.h"
+
+namespace wasm::interpreter {
+
+namespace {
+
+// Calls deeper than this trap, like they would in a VM.
+constexpr size_t maxCallDepth = 10000;
+
+bool isSupportedType(Type type) {
+  return type == Type::i32 || type == Type::i64 || type == Type::f32 ||
+         type == Type::f64;
+}
+
+uint64_t toSlot(const Literal& value) {
+  switch (value.type.getBasic()) {
+    case Type::i32:
+      return uint32_t(value.geti32());
+    case Type::i64:
+      return uint64_t(value.geti64());
+    case Type::f32:
+      return uint32_t(value.reinterpreti32());
+    case Type::f64:
+      return uint64_t(value.reinterpreti64());
+    default:
+      WASM_UNREACHABLE("unexpected type");
+  }
+}
+
+Literal fromSlot(uint64_t slot, Type type) {
+  switch (type.getBasic()) {
+    case Type::i32:
+      return Literal(int32_t(slot));
+    case Type::i64:
+      return Literal(int64_t(slot));
+    case Type::f32:
+      return Literal(int32_t(slot)).castToF32();
+    case Type::f64:
+      return Literal(int64_t(slot)).castToF64();
+    default:
+      WASM_UNREACHABLE("unexpected type");
+  }
+}
+
+uint64_t encodeTypes(Type operand, Type result) {
+  return uint64_t(operand.getBasic()) | (uint64_t(result.getBasic()) << 32);
+}
+
+Type operandType(uint64_t b) { return Type(Type::BasicType(uint32_t(b))); }
+
+Type resultType(uint64_t b) { return Type(Type::BasicType(b >> 32)); }
+
+uint64_t encodeBranch(uint32_t height, uint32_t arity) {
+  return uint64_t(height) | (uint64_t(arity) << 32);
+}
+
+// The float operations and conversions that are not implemented directly on
+// slots.
+Result<uint64_t> doUnary(UnaryOp op, uint64_t b, uint64_t slot) {
+  auto type = operandType(b);
+  auto value = fromSlot(slot, type);
+  switch (op) {
+    case NegFloat32:
+    case NegFloat64:
+      return toSlot(value.neg());
+    case AbsFloat32:
+    case AbsFloat64:
+      return toSlot(value.abs());
+    case CeilFloat32:
+    case CeilFloat64:
+      return toSlot(value.ceil());
+    case FloorFloat32:
+    case FloorFloat64:
+      return toSlot(value.floor());
+    case TruncFloat32:
+    case TruncFloat64:
+      return toSlot(value.trunc());
+    case NearestFloat32:
+    case NearestFloat64:
+      return toSlot(value.nearbyint());
+    case SqrtFloat32:
+    case SqrtFloat64:
+      return toSlot(value.sqrt());
+    case ConvertUInt32ToFloat32:
+    case ConvertUInt64ToFloat32:
+      return toSlot(value.convertUIToF32());
+    case ConvertUInt32ToFloat64:
+    case ConvertUInt64ToFloat64:
+      return toSlot(value.convertUIToF64());
+    case ConvertSInt32ToFloat32:
+    case ConvertSInt64ToFloat32:
+      return toSlot(value.convertSIToF32());
+    case ConvertSInt32ToFloat64:
+    case ConvertSInt64ToFloat64:
+      return toSlot(value.convertSIToF64());
+    case PromoteFloat32:
+      return toSlot(value.extendToF64());
+    case DemoteFloat64:
+      return toSlot(value.demote());
+    case TruncSatSFloat32ToInt32:
+    case TruncSatSFloat64ToInt32:
+      return toSlot(value.truncSatToSI32());
+    case TruncSatSFloat32ToInt64:
+    case TruncSatSFloat64ToInt64:
+      return toSlot(value.truncSatToSI64());
+    case TruncSatUFloat32ToInt32:
+    case TruncSatUFloat64ToInt32:
+      return toSlot(value.truncSatToUI32());
+    case TruncSatUFloat32ToInt64:
+    case TruncSatUFloat64ToInt64:
+      return toSlot(value.truncSatToUI64());
+    case TruncSFloat32ToInt32:
+    case TruncSFloat64ToInt32:
+    case TruncSFloat32ToInt64:
+    case TruncSFloat64ToInt64: {
+      double val = value.getFloat();
+      if (std::isnan(val)) {
+        return Err{"truncSFloat of nan"};
+      }
+      if (resultType(b) == Type::i32) {
+        if (type == Type::f32 ? !isInRangeI32TruncS(int32_t(slot))
+                              : !isInRangeI32TruncS(int64_t(slot))) {
+          return Err{"i32.truncSFloat overflow"};
+        }
+        return uint32_t(int32_t(val));
+      }
+      if (type == Type::f32 ? !isInRangeI64TruncS(int32_t(slot))
+                            : !isInRangeI64TruncS(int64_t(slot))) {
+        return Err{"i64.truncSFloat overflow"};
+      }
+      return uint64_t(int64_t(val));
+    }
+    case TruncUFloat32ToInt32:
+    case TruncUFloat64ToInt32:
+    case TruncUFloat32ToInt64:
+    case TruncUFloat64ToInt64: {
+      double val = value.getFloat();
+      if (std::isnan(val)) {
+        return Err{"truncUFloat of nan"};
+      }
+      if (resultType(b) == Type::i32) {
+        if (type == Type::f32 ? !isInRangeI32TruncU(int32_t(slot))
+                              : !isInRangeI32TruncU(int64_t(slot))) {
+          return Err{"i32.truncUFloat overflow"};
+        }
+        return uint32_t(val);
+      }
+      if (type == Type::f32 ? !isInRangeI64TruncU(int32_t(slot))
+                            : !isInRangeI64TruncU(int64_t(slot))) {
+        return Err{"i64.truncUFloat overflow"};
+      }
+      return uint64_t(val);
+    }
+    default:
+      WASM_UNREACHABLE("unexpected unary op");
+  }
+}
+
+uint64_t doBinary(BinaryOp op, uint64_t b, uint64_t lhs, uint64_t rhs) {
+  auto type = operandType(b);
+  auto left = fromSlot(lhs, type);
+  auto right = fromSlot(rhs, type);
+  switch (op) {
+    case AddFloat32:
+    case AddFloat64:
+      return toSlot(left.add(right));
+    case SubFloat32:
+    case SubFloat64:
+      return toSlot(left.sub(right));
+    case MulFloat32:
+    case MulFloat64:
+      return toSlot(left.mul(right));
+    case DivFloat32:
+    case DivFloat64:
+      return toSlot(left.div(right));
+    case CopySignFloat32:
+    case CopySignFloat64:
+      return toSlot(left.copysign(right));
+    case MinFloat32:
+    case MinFloat64:
+      return toSlot(left.min(right));
+    case MaxFloat32:
+    case MaxFloat64:
+      return toSlot(left.max(right));
+    case EqFloat32:
+    case EqFloat64:
+      return toSlot(left.eq(right));
+    case NeFloat32:
+    case NeFloat64:
+      return toSlot(left.ne(right));
+    case LtFloat32:
+    case LtFloat64:
+      return toSlot(left.lt(right));
+    case LeFloat32:
+    case LeFloat64:
+      return toSlot(left.le(right));
+    case GtFloat32:
+    case GtFloat64:
+      return toSlot(left.gt(right));
+    case GeFloat32:
+    case GeFloat64:
+      return toSlot(left.ge(right));
+    default:
+      WASM_UNREACHABLE("unexpected binary op");
+  }
+}
+
+// Returns the opcode that implements a unary operation directly, or Unary if
+// it must go through Literal. Reinterpretations do not change the bits of a
+// slot, so they map to nothing at all.
+std::optional<Opcode> getUnaryOpcode(UnaryOp op) {
+  switch (op) {
+    case EqZInt32:
+      return Opcode::I32Eqz;
+    case ClzInt32:
+      return Opcode::I32Clz;
+    case CtzInt32:
+      return Opcode::I32Ctz;
+    case PopcntInt32:
+      return Opcode::I32Popcnt;
+    case ExtendS8Int32:
+      return Opcode::I32Extend8S;
+    case ExtendS16Int32:
+      return Opcode::I32Extend16S;
+    case EqZInt64:
+      return Opcode::I64Eqz;
+    case ClzInt64:
+      return Opcode::I64Clz;
+    case CtzInt64:
+      return Opcode::I64Ctz;
+    case PopcntInt64:
+      return Opcode::I64Popcnt;
+    case ExtendS8Int64:
+      return Opcode::I64Extend8S;
+    case ExtendS16Int64:
+      return Opcode::I64Extend16S;
+    case ExtendS32Int64:
+      return Opcode::I64Extend32S;
+    case WrapInt64:
+      return Opcode::I32WrapI64;
+    case ExtendSInt32:
+      return Opcode::I64ExtendI32S;
+    case ExtendUInt32:
+      return Opcode::I64ExtendI32U;
+    case ReinterpretFloat32:
+    case ReinterpretFloat64:
+    case ReinterpretInt32:
+    case ReinterpretInt64:
+      return std::nullopt;
+    default:
+      return Opcode::Unary;
+  }
+}
+
+Opcode getBinaryOpcode(BinaryOp op) {
+  switch (op) {
+    case AddInt32:
+      return Opcode::I32Add;
+    case SubInt32:
+      return Opcode::I32Sub;
+    case MulInt32:
+      return Opcode::I32Mul;
+    case DivSInt32:
+      return Opcode::I32DivS;
+    case DivUInt32:
+      return Opcode::I32DivU;
+    case RemSInt32:
+      return Opcode::I32RemS;
+    case RemUInt32:
+      return Opcode::I32RemU;
+    case AndInt32:
+      return Opcode::I32And;
+    case OrInt32:
+      return Opcode::I32Or;
+    case XorInt32:
+      return Opcode::I32Xor;
+    case ShlInt32:
+      return Opcode::I32Shl;
+    case ShrSInt32:
+      return Opcode::I32ShrS;
+    case ShrUInt32:
+      return Opcode::I32ShrU;
+    case RotLInt32:
+      return Opcode::I32RotL;
+    case RotRInt32:
+      return Opcode::I32RotR;
+    case EqInt32:
+      return Opcode::I32Eq;
+    case NeInt32:
+      return Opcode::I32Ne;
+    case LtSInt32:
+      return Opcode::I32LtS;
+    case LtUInt32:
+      return Opcode::I32LtU;
+    case LeSInt32:
+      return Opcode::I32LeS;
+    case LeUInt32:
+      return Opcode::I32LeU;
+    case GtSInt32:
+      return Opcode::I32GtS;
+    case GtUInt32:
+      return Opcode::I32GtU;
+    case GeSInt32:
+      return Opcode::I32GeS;
+    case GeUInt32:
+      return Opcode::I32GeU;
+    case AddInt64:
+      return Opcode::I64Add;
+    case SubInt64:
+      return Opcode::I64Sub;
+    case MulInt64:
+      return Opcode::I64Mul;
+    case DivSInt64:
+      return Opcode::I64DivS;
+    case DivUInt64:
+      return Opcode::I64DivU;
+    case RemSInt64:
+      return Opcode::I64RemS;
+    case RemUInt64:
+      return Opcode::I64RemU;
+    case AndInt64:
+      return Opcode::I64And;
+    case OrInt64:
+      return Opcode::I64Or;
+    case XorInt64:
+      return Opcode::I64Xor;
+    case ShlInt64:
+      return Opcode::I64Shl;
+    case ShrSInt64:
+      return Opcode::I64ShrS;
+    case ShrUInt64:
+      return Opcode::I64ShrU;
+    case RotLInt64:
+      return Opcode::I64RotL;
+    case RotRInt64:
+      return Opcode::I64RotR;
+    case EqInt64:
+      return Opcode::I64Eq;
+    case NeInt64:
+      return Opcode::I64Ne;
+    case LtSInt64:
+      return Opcode::I64LtS;
+    case LtUInt64:
+      return Opcode::I64LtU;
+    case LeSInt64:
+      return Opcode::I64LeS;
+    case LeUInt64:
+      return Opcode::I64LeU;
+    case GtSInt64:
+      return Opcode::I64GtS;
+    case GtUInt64:
+      return Opcode::I64GtU;
+    case GeSInt64:
+      return Opcode::I64GeS;
+    case GeUInt64:
+      return Opcode::I64GeU;
+    default:
+      return Opcode::Binary;
+  }
+}
+
+Opcode getLoadOpcode(Load* curr) {
+  switch (curr->bytes) {
+    case 1:
+      if (!curr->signed_) {
+        return Opcode::Load8U;
+      }
+      return curr->type == Type::i32 ? Opcode::Load8S32 : Opcode::Load8S64;
+    case 2:
+      if (!curr->signed_) {
+        return Opcode::Load16U;
+      }
+      return curr->type == Type::i32 ? Opcode::Load16S32 : Opcode::Load16S64;
+    case 4:
+      // Unsigned loads zero-extend, which is how all 32-bit values are kept.
+      if (curr->type == Type::i64 && curr->signed_) {
+        return Opcode::Load32S64;
+      }
+      return Opcode::Load32;
+    case 8:
+      return Opcode::Load64;
+  }
+  WASM_UNREACHABLE("unexpected load size");
+}
+
+Opcode getStoreOpcode(Store* curr) {
+  switch (curr->bytes) {
+    case 1:
+      return Opcode::Store8;
+    case 2:
+      return Opcode::Store16;
+    case 4:
+      return Opcode::Store32;
+    case 8:
+      return Opcode::Store64;
+  }
+  WASM_UNREACHABLE("unexpected store size");
+}
+
+struct FunctionCompiler {
+  CompiledFunction& out;
+  Function* func;
+  const std::unordered_map<Name, Index>& functionIndices;
+  const std::unordered_map<Name, Index>& globalIndices;
+  Module& wasm;
+
+  // The current height of the stack, including the locals.
+  uint32_t height = 0;
+
+  // Whether the function accesses the memory.
+  bool usesMemory = false;
+
+  struct Label {
+    Name name;
+    // The height and the number of values that branches to this label leave.
+    uint32_t height;
+    uint32_t arity;
+    // The target of branches, if it is already known (as it is for loops).
+    std::optional<uint32_t> pc;
+    // Instructions and branch table entries whose target is this label.
+    std::vector<size_t> fixups;
+    std::vector<size_t> tableFixups;
+  };
+  std::vector<Label> labels;
+
+  FunctionCompiler(CompiledFunction& out,
+                   Function* func,
+                   const std::unordered_map<Name, Index>& functionIndices,
+                   const std::unordered_map<Name, Index>& globalIndices,
+                   Module& wasm)
+    : out(out), func(func), functionIndices(functionIndices),
+      globalIndices(globalIndices), wasm(wasm) {}
+
+  Result<> compile() {
+    for (auto type : func->getParams()) {
+      if (!isSupportedType(type)) {
+        return Err{"unsupported parameter type"};
+      }
+    }
+    for (auto type : func->vars) {
+      if (!isSupportedType(type)) {
+        return Err{"unsupported local type"};
+      }
+    }
+    auto results = func->getResults();
+    if (results != Type::none && !isSupportedType(results)) {
+      return Err{"unsupported result type"};
+    }
+    out.numParams = func->getNumParams();
+    out.numLocals = func->getNumLocals();
+    out.numResults = results.size();
+    height = out.maxHeight = out.numLocals;
+    CHECK_ERR(emit(func->body));
+    emit(Opcode::Return, out.numResults);
+    return Ok{};
+  }
+
+  void emit(Opcode op, uint32_t a = 0, uint64_t b = 0) {
+    out.code.emplace_back(op, a, b);
+  }
+
+  void push() {
+    ++height;
+    out.maxHeight = std::max(out.maxHeight, Index(height));
+  }
+
+  void pop(uint32_t n = 1) {
+    assert(height >= out.numLocals + n);
+    height -= n;
+  }
+
+  Label& getLabel(Name name) {
+    for (auto it = labels.rbegin(); it != labels.rend(); ++it) {
+      if (it->name == name) {
+        return *it;
+      }
+    }
+    WASM_UNREACHABLE("unknown label");
+  }
+
+  // Emits a branch to a label, which leaves the label's values on top of the
+  // operand stack.
+  void emitBranch(Opcode op, Name name) {
+    auto& label = getLabel(name);
+    if (!label.pc) {
+      label.fixups.push_back(out.code.size());
+    }
+    emit(op, label.pc.value_or(0), encodeBranch(label.height, label.arity));
+  }
+
+  void bindLabel(Label& label) {
+    uint32_t pc = out.code.size();
+    for (auto index : label.fixups) {
+      out.code[index].a = pc;
+    }
+    for (auto index : label.tableFixups) {
+      out.branchTables[index].pc = pc;
+    }
+  }
+
+  Result<> checkType(Type type) {
+    if (type != Type::none && type != Type::unreachable &&
+        !isSupportedType(type)) {
+      return Err{"unsupported type " + type.toString()};
+    }
+    return Ok{};
+  }
+
+  Result<> checkMemory(Name name) {
+    auto* memory = wasm.getMemory(name);
+    if (memory != wasm.memories[0].get() || memory->is64() ||
+        memory->imported()) {
+      return Err{"unsupported memory " + name.toString()};
+    }
+    usesMemory = true;
+    return Ok{};
+  }
+
+  // Emits an expression, which leaves its value, if it has one, on top of the
+  // stack. If an expression is unreachable, nothing after it in its parent is
+  // emitted, as that code can never run, and the height of the stack is then
+  // meaningless.
+  Result<> emit(Expression* curr) {
+    CHECK_ERR(checkType(curr->type));
+
+#define EMIT_CHILD(child)                                                      \
+  CHECK_ERR(emit(child));                                                      \
+  if ((child)->type == Type::unreachable) {                                    \
+    return Ok{};                                                               \
+  }
+
+    switch (curr->_id) {
+      case Expression::BlockId: {
+        auto* block = curr->cast<Block>();
+        auto start = height;
+        auto arity = block->type.isConcrete() ? 1 : 0;
+        if (block->name) {
+          labels.push_back({block->name, start, uint32_t(arity), {}, {}, {}});
+        }
+        for (auto* child : block->list) {
+          CHECK_ERR(emit(child));
+          if (child->type == Type::unreachable) {
+            break;
+          }
+        }
+        if (block->name) {
+          bindLabel(labels.back());
+          labels.pop_back();
+        }
+        height = start;
+        if (arity) {
+          push();
+        }
+        return Ok{};
+      }
+      case Expression::LoopId: {
+        auto* loop = curr->cast<Loop>();
+        auto start = height;
+        if (loop->name) {
+          labels.push_back(
+            {loop->name, start, 0, uint32_t(out.code.size()), {}, {}});
+        }
+        CHECK_ERR(emit(loop->body));
+        if (loop->name) {
+          labels.pop_back();
+        }
+        height = start;
+        if (loop->type.isConcrete()) {
+          push();
+        }
+        return Ok{};
+      }
+      case Expression::IfId: {
+        auto* iff = curr->cast<If>();
+        EMIT_CHILD(iff->condition);
+        pop();
+        auto start = height;
+        auto toElse = out.code.size();
+        emit(Opcode::BrUnless, 0, encodeBranch(start, 0));
+        CHECK_ERR(emit(iff->ifTrue));
+        if (iff->ifFalse) {
+          std::optional<size_t> toEnd;
+          if (iff->ifTrue->type != Type::unreachable) {
+            // Jump over the else arm, keeping the stack as it is.
+            toEnd = out.code.size();
+            emit(Opcode::Br, 0, encodeBranch(height, 0));
+          }
+          out.code[toElse].a = out.code.size();
+          height = start;
+          CHECK_ERR(emit(iff->ifFalse));
+          if (toEnd) {
+            out.code[*toEnd].a = out.code.size();
+          }
+        } else {
+          out.code[toElse].a = out.code.size();
+        }
+        height = start;
+        if (iff->type.isConcrete()) {
+          push();
+        }
+        return Ok{};
+      }
+      case Expression::BreakId: {
+        auto* br = curr->cast<Break>();
+        if (br->value) {
+          EMIT_CHILD(br->value);
+        }
+        if (br->condition) {
+          EMIT_CHILD(br->condition);
+          pop();
+          emitBranch(Opcode::BrIf, br->name);
+        } else {
+          emitBranch(Opcode::Br, br->name);
+        }
+        return Ok{};
+      }
+      case Expression::SwitchId: {
+        auto* sw = curr->cast<Switch>();
+        if (sw->value) {
+          EMIT_CHILD(sw->value);
+        }
+        EMIT_CHILD(sw->condition);
+        pop();
+        uint32_t start = out.branchTables.size();
+        auto addTarget = [&](Name name) {
+          auto& label = getLabel(name);
+          if (!label.pc) {
+            label.tableFixups.push_back(out.branchTables.size());
+          }
+          out.branchTables.push_back(
+            {label.pc.value_or(0), label.height, label.arity});
+        };
+        for (auto name : sw->targets) {
+          addTarget(name);
+        }
+        addTarget(sw->default_);
+        emit(Opcode::BrTable, start, sw->targets.size() + 1);
+        return Ok{};
+      }
+      case Expression::CallId: {
+        auto* call = curr->cast<Call>();
+        auto* target = wasm.getFunction(call->target);
+        if (target->imported()) {
+          return Err{"unsupported call to import " + call->target.toString()};
+        }
+        for (auto* operand : call->operands) {
+          EMIT_CHILD(operand);
+        }
+        if (call->isReturn) {
+          emit(Opcode::ReturnCall, functionIndices.at(call->target));
+          pop(call->operands.size());
+          return Ok{};
+        }
+        emit(Opcode::Call, functionIndices.at(call->target));
+        pop(call->operands.size());
+        if (target->getResults().isConcrete()) {
+          push();
+        }
+        return Ok{};
+      }
+      case Expression::LocalGetId: {
+        emit(Opcode::LocalGet, curr->cast<LocalGet>()->index);
+        push();
+        return Ok{};
+      }
+      case Expression::LocalSetId: {
+        auto* set = curr->cast<LocalSet>();
+        EMIT_CHILD(set->value);
+        if (set->isTee()) {
+          emit(Opcode::LocalTee, set->index);
+        } else {
+          emit(Opcode::LocalSet, set->index);
+          pop();
+        }
+        return Ok{};
+      }
+      case Expression::GlobalGetId: {
+        auto name = curr->cast<GlobalGet>()->name;
+        if (!globalIndices.count(name)) {
+          return Err{"unsupported global " + name.toString()};
+        }
+        emit(Opcode::GlobalGet, globalIndices.at(name));
+        push();
+        return Ok{};
+      }
+      case Expression::GlobalSetId: {
+        auto* set = curr->cast<GlobalSet>();
+        if (!globalIndices.count(set->name)) {
+          return Err{"unsupported global " + set->name.toString()};
+        }
+        EMIT_CHILD(set->value);
+        emit(Opcode::GlobalSet, globalIndices.at(set->name));
+        pop();
+        return Ok{};
+      }
+      case Expression::LoadId: {
+        auto* load = curr->cast<Load>();
+        if (load->isAtomic()) {
+          return Err{"unsupported atomic load"};
+        }
+        CHECK_ERR(checkMemory(load->memory));
+        EMIT_CHILD(load->ptr);
+        emit(getLoadOpcode(load), 0, load->offset);
+        return Ok{};
+      }
+      case Expression::StoreId: {
+        auto* store = curr->cast<Store>();
+        if (store->isAtomic()) {
+          return Err{"unsupported atomic store"};
+        }
+        CHECK_ERR(checkMemory(store->memory));
+        CHECK_ERR(checkType(store->valueType));
+        EMIT_CHILD(store->ptr);
+        EMIT_CHILD(store->value);
+        emit(getStoreOpcode(store), 0, store->offset);
+        pop(2);
+        return Ok{};
+      }
+      case Expression::ConstId: {
+        emit(Opcode::Const, 0, toSlot(curr->cast<Const>()->value));
+        push();
+        return Ok{};
+      }
+      case Expression::UnaryId: {
+        auto* unary = curr->cast<Unary>();
+        CHECK_ERR(checkType(unary->value->type));
+        EMIT_CHILD(unary->value);
+        if (auto op = getUnaryOpcode(unary->op)) {
+          emit(*op, unary->op, encodeTypes(unary->value->type, unary->type));
+        }
+        return Ok{};
+      }
+      case Expression::BinaryId: {
+        auto* binary = curr->cast<Binary>();
+        CHECK_ERR(checkType(binary->left->type));
+        EMIT_CHILD(binary->left);
+        EMIT_CHILD(binary->right);
+        emit(getBinaryOpcode(binary->op),
+             binary->op,
+             encodeTypes(binary->left->type, binary->type));
+        pop();
+        return Ok{};
+      }
+      case Expression::SelectId: {
+        auto* select = curr->cast<Select>();
+        EMIT_CHILD(select->ifTrue);
+        EMIT_CHILD(select->ifFalse);
+        EMIT_CHILD(select->condition);
+        emit(Opcode::Select);
+        pop(2);
+        return Ok{};
+      }
+      case Expression::DropId: {
+        EMIT_CHILD(curr->cast<Drop>()->value);
+        emit(Opcode::Drop);
+        pop();
+        return Ok{};
+      }
+      case Expression::ReturnId: {
+        if (auto* value = curr->cast<Return>()->value) {
+          EMIT_CHILD(value);
+        }
+        emit(Opcode::Return, out.numResults);
+        return Ok{};
+      }
+      case Expression::MemorySizeId: {
+        CHECK_ERR(checkMemory(curr->cast<MemorySize>()->memory));
+        emit(Opcode::MemorySize);
+        push();
+        return Ok{};
+      }
+      case Expression::MemoryGrowId: {
+        auto* grow = curr->cast<MemoryGrow>();
+        CHECK_ERR(checkMemory(grow->memory));
+        EMIT_CHILD(grow->delta);
+        emit(Opcode::MemoryGrow);
+        return Ok{};
+      }
+      case Expression::NopId:
+        return Ok{};
+      case Expression::UnreachableId:
+        emit(Opcode::Unreachable);
+        return Ok{};
+      default:
+        return Err{std::string("unsupported expression ") +
+                   getExpressionName(curr)};
+    }
+
+#undef EMIT_CHILD
+  }
+};
+
+} // anonymous namespace
+
+Result<CompiledModule> compile(Instance& instance) {
+  auto& wasm = *instance.wasm;
+  if (wasm.memories.size() > 1) {
+    return Err{"unsupported multiple memories"};
+  }
+
+  CompiledModule compiled;
+
+  std::unordered_map<Name, Index> globalIndices;
+  for (auto& global : wasm.globals) {
+    if (global->imported() || !isSupportedType(global->type)) {
+      // Code that uses these cannot be compiled.
+      continue;
+    }
+    globalIndices[global->name] = compiled.globals.size();
+    compiled.globals.push_back(
+      {&instance.globalValues[global->name], global->type});
+  }
+
+  std::unordered_map<Name, Index> functionIndices;
+  for (Index i = 0; i < wasm.functions.size(); i++) {
+    functionIndices[wasm.functions[i]->name] = i;
+  }
+
+  compiled.functions.resize(wasm.functions.size());
+  for (Index i = 0; i < wasm.functions.size(); i++) {
+    auto* func = wasm.functions[i].get();
+    if (func->imported()) {
+      continue;
+    }
+    FunctionCompiler compiler(
+      compiled.functions[i], func, functionIndices, globalIndices, wasm);
+    auto result = compiler.compile();
+    if (auto* err = result.getErr()) {
+      return Err{"cannot compile " + func->name.toString() + ": " + err->msg};
+    }
+    compiled.usesMemory |= compiler.usesMemory;
+  }
+  return compiled;
+}
+
+Result<std::vector<Literal>> execute(Instance& instance,
+                                     Index funcIndex,
+                                     const std::vector<Literal>& args) {
+  assert(instance.compiled);
+  auto& compiled = *instance.compiled;
+  auto* func = &compiled.functions[funcIndex];
+  if (args.size() != func->numParams) {
+    return Err{"wrong number of arguments"};
+  }
+
+  // The globals are kept in slots while running and are written back to the
+  // instance when we are done, whether or not we trapped.
+  std::vector<uint64_t> globals;
+  for (auto& [value, type] : compiled.globals) {
+    globals.push_back(toSlot(*value));
+  }
+  auto writeBackGlobals = [&]() {
+    for (Index i = 0; i < globals.size(); i++) {
+      auto& [value, type] = compiled.globals[i];
+      *value = fromSlot(globals[i], type);
+    }
+  };
+
+  // The memory, if the code uses it.
+  std::vector<uint8_t>* memoryData =
+    compiled.usesMemory ? &instance.memories[0] : nullptr;
+  uint8_t* memory = memoryData ? memoryData->data() : nullptr;
+  uint64_t memorySize = memoryData ? memoryData->size() : 0;
+  uint64_t pageSize = 0;
+  uint64_t maxPages = 0;
+  if (!instance.wasm->memories.empty()) {
+    auto& mem = *instance.wasm->memories[0];
+    pageSize = mem.pageSize();
+    maxPages = mem.maxSize32();
+    if (mem.hasMax()) {
+      maxPages = std::min(maxPages, uint64_t(mem.max));
+    }
+  }
+
+  std::vector<uint64_t> stack(std::max<size_t>(1024, func->maxHeight));
+  for (Index i = 0; i < args.size(); i++) {
+    stack[i] = toSlot(args[i]);
+  }
+
+  struct Activation {
+    CompiledFunction* func;
+    const Instruction* pc;
+    size_t fp;
+  };
+  std::vector<Activation> activations;
+
+  uint64_t* fp = stack.data();
+  uint64_t* sp = fp + func->numLocals;
+  std::fill(fp + func->numParams, sp, 0);
+  const Instruction* pc = func->code.data();
+  std::string trapMessage;
+
+  // Bounds-checks an access of |bytes| bytes at the address on top of the
+  // stack, and computes the effective address.
+#define EFFECTIVE_ADDRESS(ptr, bytes)                                          \
+  uint64_t addr = uint64_t(uint32_t(ptr)) + pc->b;                             \
+  if (addr + (bytes) > memorySize) {                                           \
+    trapMessage = "out of bounds memory access";                               \
+    goto trap;                                                                 \
+  }
+
+#define LOAD(type, bytes, convert)                                             \
+  {                                                                            \
+    EFFECTIVE_ADDRESS(sp[-1], bytes);                                          \
+    type value;                                                                \
+    std::memcpy(&value, memory + addr, bytes);                                 \
+    sp[-1] = convert(value);                                                   \
+    ++pc;                                                                      \
+    DISPATCH();                                                                \
+  }
+
+#define STORE(type, bytes)                                                     \
+  {                                                                            \
+    EFFECTIVE_ADDRESS(sp[-2], bytes);                                          \
+    type value = type(sp[-1]);                                                 \
+    std::memcpy(memory + addr, &value, bytes);                                 \
+    sp -= 2;                                                                   \
+    ++pc;                                                                      \
+    DISPATCH();                                                                \
+  }
+
+#define UNARY(type, expr)                                                      \
+  {                                                                            \
+    type x = type(sp[-1]);                                                     \
+    sp[-1] = (expr);                                                           \
+    ++pc;                                                                      \
+    DISPATCH();                                                                \
+  }
+
+#define BINARY(type, expr)                                                     \
+  {                                                                            \
+    type x = type(sp[-2]);                                                     \
+    type y = type(sp[-1]);                                                     \
+    sp[-2] = (expr);                                                           \
+    --sp;                                                                      \
+    ++pc;                                                                      \
+    DISPATCH();                                                                \
+  }
+
+#define TRAP_IF(cond, message)                                                 \
+  if (cond) {                                                                  \
+    trapMessage = message;                                                     \
+    goto trap;                                                                 \
+  }
+
+  // Moves the values a branch keeps down to the target's height, and
+  // continues at the target.
+#define BRANCH(target, height, arity)                                          \
+  {                                                                            \
+    uint64_t* base = fp + (height);                                            \
+    if (arity) {                                                               \
+      base[0] = sp[-1];                                                        \
+    }                                                                          \
+    sp = base + (arity);                                                       \
+    pc = func->code.data() + (target);                                         \
+    DISPATCH();                                                                \
+  }
+
+  // With GCC and Clang we thread the dispatch through a table of label
+  // addresses, which predicts much better than a single switch.
+#ifdef __GNUC__
+  static const void* const dispatchTable[] = {
+#define OPCODE_LABEL(name) &&op_##name,
+    INTERPRETER_OPCODES(OPCODE_LABEL)
+#undef OPCODE_LABEL
+  };
+#define DISPATCH() goto* dispatchTable[size_t(pc->op)]
+#define CASE(name) op_##name
+#else
+#define DISPATCH() goto dispatch
+#define CASE(name) case Opcode::name
+#endif
+
+  DISPATCH();
+
+#ifndef __GNUC__
+dispatch:
+  switch (pc->op) {
+#endif
+
+  CASE(Unreachable) : {
+    trapMessage = "unreachable";
+    goto trap;
+  }
+  CASE(Br) : BRANCH(pc->a, uint32_t(pc->b), uint32_t(pc->b >> 32));
+  CASE(BrIf) : {
+    --sp;
+    if (uint32_t(*sp)) {
+      BRANCH(pc->a, uint32_t(pc->b), uint32_t(pc->b >> 32));
+    }
+    ++pc;
+    DISPATCH();
+  }
+  CASE(BrUnless) : {
+    --sp;
+    if (!uint32_t(*sp)) {
+      BRANCH(pc->a, uint32_t(pc->b), uint32_t(pc->b >> 32));
+    }
+    ++pc;
+    DISPATCH();
+  }
+  CASE(BrTable) : {
+    --sp;
+    uint64_t index = std::min(uint64_t(uint32_t(*sp)), pc->b - 1);
+    auto& target = func->branchTables[pc->a + index];
+    BRANCH(target.pc, target.height, target.arity);
+  }
+  CASE(Return) : {
+    uint32_t arity = pc->a;
+    if (arity) {
+      fp[0] = sp[-1];
+    }
+    sp = fp + arity;
+    if (activations.empty()) {
+      goto done;
+    }
+    auto& caller = activations.back();
+    func = caller.func;
+    pc = caller.pc;
+    fp = stack.data() + caller.fp;
+    activations.pop_back();
+    DISPATCH();
+  }
+  CASE(Call) : {
+    TRAP_IF(activations.size() >= maxCallDepth, "stack limit");
+    auto* callee = &compiled.functions[pc->a];
+    size_t calleeFp = (sp - stack.data()) - callee->numParams;
+    if (calleeFp + callee->maxHeight > stack.size()) {
+      size_t fpOffset = fp - stack.data();
+      stack.resize(std::max(stack.size() * 2, calleeFp + callee->maxHeight));
+      fp = stack.data() + fpOffset;
+    }
+    activations.push_back({func, pc + 1, size_t(fp - stack.data())});
+    func = callee;
+    fp = stack.data() + calleeFp;
+    sp = fp + func->numLocals;
+    std::fill(fp + func->numParams, sp, 0);
+    pc = func->code.data();
+    DISPATCH();
+  }
+  CASE(ReturnCall) : {
+    // Replace the frame of the caller with that of the callee: the arguments
+    // become the first locals of the frame, and the callee returns to where
+    // the caller would have.
+    auto* callee = &compiled.functions[pc->a];
+    std::copy(sp - callee->numParams, sp, fp);
+    size_t fpOffset = fp - stack.data();
+    if (fpOffset + callee->maxHeight > stack.size()) {
+      stack.resize(std::max(stack.size() * 2, fpOffset + callee->maxHeight));
+      fp = stack.data() + fpOffset;
+    }
+    func = callee;
+    sp = fp + func->numLocals;
+    std::fill(fp + func->numParams, sp, 0);
+    pc = func->code.data();
+    DISPATCH();
+  }
+  CASE(Drop) : {
+    --sp;
+    ++pc;
+    DISPATCH();
+  }
+  CASE(Select) : {
+    sp -= 2;
+    if (!uint32_t(sp[1])) {
+      sp[-1] = sp[0];
+    }
+    ++pc;
+    DISPATCH();
+  }
+  CASE(Const) : {
+    *sp++ = pc->b;
+    ++pc;
+    DISPATCH();
+  }
+  CASE(LocalGet) : {
+    *sp++ = fp[pc->a];
+    ++pc;
+    DISPATCH();
+  }
+  CASE(LocalSet) : {
+    fp[pc->a] = *--sp;
+    ++pc;
+    DISPATCH();
+  }
+  CASE(LocalTee) : {
+    fp[pc->a] = sp[-1];
+    ++pc;
+    DISPATCH();
+  }
+  CASE(GlobalGet) : {
+    *sp++ = globals[pc->a];
+    ++pc;
+    DISPATCH();
+  }
+  CASE(GlobalSet) : {
+    globals[pc->a] = *--sp;
+    ++pc;
+    DISPATCH();
+  }
+  CASE(Load8S32) : LOAD(int8_t, 1, uint32_t);
+  CASE(Load8U) : LOAD(uint8_t, 1, uint64_t);
+  CASE(Load16S32) : LOAD(int16_t, 2, uint32_t);
+  CASE(Load16U) : LOAD(uint16_t, 2, uint64_t);
+  CASE(Load32) : LOAD(uint32_t, 4, uint64_t);
+  CASE(Load8S64) : LOAD(int8_t, 1, uint64_t);
+  CASE(Load16S64) : LOAD(int16_t, 2, uint64_t);
+  CASE(Load32S64) : LOAD(int32_t, 4, uint64_t);
+  CASE(Load64) : LOAD(uint64_t, 8, uint64_t);
+  CASE(Store8) : STORE(uint8_t, 1);
+  CASE(Store16) : STORE(uint16_t, 2);
+  CASE(Store32) : STORE(uint32_t, 4);
+  CASE(Store64) : STORE(uint64_t, 8);
+  CASE(MemorySize) : {
+    *sp++ = memorySize / pageSize;
+    ++pc;
+    DISPATCH();
+  }
+  CASE(MemoryGrow) : {
+    uint64_t delta = uint32_t(sp[-1]);
+    uint64_t pages = memorySize / pageSize;
+    if (pages + delta > maxPages) {
+      sp[-1] = uint32_t(-1);
+    } else {
+      memoryData->resize((pages + delta) * pageSize);
+      memory = memoryData->data();
+      memorySize = memoryData->size();
+      sp[-1] = uint32_t(pages);
+    }
+    ++pc;
+    DISPATCH();
+  }
+  CASE(I32Eqz) : UNARY(uint32_t, uint32_t(x == 0));
+  CASE(I32Clz) : UNARY(uint32_t, uint32_t(Bits::countLeadingZeroes(x)));
+  CASE(I32Ctz) : UNARY(uint32_t, uint32_t(Bits::countTrailingZeroes(x)));
+  CASE(I32Popcnt) : UNARY(uint32_t, uint32_t(Bits::popCount(x)));
+  CASE(I32Extend8S) : UNARY(uint32_t, uint32_t(int32_t(int8_t(x))));
+  CASE(I32Extend16S) : UNARY(uint32_t, uint32_t(int32_t(int16_t(x))));
+  CASE(I32Add) : BINARY(uint32_t, uint32_t(x + y));
+  CASE(I32Sub) : BINARY(uint32_t, uint32_t(x - y));
+  CASE(I32Mul) : BINARY(uint32_t, uint32_t(x * y));
+  CASE(I32DivS) : {
+    int32_t x = int32_t(sp[-2]);
+    int32_t y = int32_t(sp[-1]);
+    TRAP_IF(y == 0, "i32.div_s by 0");
+    TRAP_IF(x == std::numeric_limits<int32_t>::min() && y == -1,
+            "i32.div_s overflow");
+    sp[-2] = uint32_t(x / y);
+    --sp;
+    ++pc;
+    DISPATCH();
+  }
+  CASE(I32DivU) : {
+    TRAP_IF(uint32_t(sp[-1]) == 0, "i32.div_u by 0");
+    BINARY(uint32_t, x / y);
+  }
+  CASE(I32RemS) : {
+    TRAP_IF(uint32_t(sp[-1]) == 0, "i32.rem_s by 0");
+    BINARY(int32_t, y == -1 ? 0 : uint32_t(x % y));
+  }
+  CASE(I32RemU) : {
+    TRAP_IF(uint32_t(sp[-1]) == 0, "i32.rem_u by 0");
+    BINARY(uint32_t, x % y);
+  }
+  CASE(I32And) : BINARY(uint32_t, x & y);
+  CASE(I32Or) : BINARY(uint32_t, x | y);
+  CASE(I32Xor) : BINARY(uint32_t, x ^ y);
+  CASE(I32Shl) : BINARY(uint32_t, uint32_t(x << (y & 31)));
+  CASE(I32ShrS) : BINARY(uint32_t, uint32_t(int32_t(x) >> (y & 31)));
+  CASE(I32ShrU) : BINARY(uint32_t, x >> (y & 31));
+  CASE(I32RotL) : BINARY(uint32_t, Bits::rotateLeft(x, y));
+  CASE(I32RotR) : BINARY(uint32_t, Bits::rotateRight(x, y));
+  CASE(I32Eq) : BINARY(uint32_t, uint32_t(x == y));
+  CASE(I32Ne) : BINARY(uint32_t, uint32_t(x != y));
+  CASE(I32LtS) : BINARY(int32_t, uint32_t(x < y));
+  CASE(I32LtU) : BINARY(uint32_t, uint32_t(x < y));
+  CASE(I32LeS) : BINARY(int32_t, uint32_t(x <= y));
+  CASE(I32LeU) : BINARY(uint32_t, uint32_t(x <= y));
+  CASE(I32GtS) : BINARY(int32_t, uint32_t(x > y));
+  CASE(I32GtU) : BINARY(uint32_t, uint32_t(x > y));
+  CASE(I32GeS) : BINARY(int32_t, uint32_t(x >= y));
+  CASE(I32GeU) : BINARY(uint32_t, uint32_t(x >= y));
+  CASE(I64Eqz) : UNARY(uint64_t, uint64_t(x == 0));
+  CASE(I64Clz) : UNARY(uint64_t, uint64_t(Bits::countLeadingZeroes(x)));
+  CASE(I64Ctz) : UNARY(uint64_t, uint64_t(Bits::countTrailingZeroes(x)));
+  CASE(I64Popcnt) : UNARY(uint64_t, uint64_t(Bits::popCount(x)));
+  CASE(I64Extend8S) : UNARY(uint64_t, uint64_t(int64_t(int8_t(x))));
+  CASE(I64Extend16S) : UNARY(uint64_t, uint64_t(int64_t(int16_t(x))));
+  CASE(I64Extend32S) : UNARY(uint64_t, uint64_t(int64_t(int32_t(x))));
+  CASE(I64Add) : BINARY(uint64_t, x + y);
+  CASE(I64Sub) : BINARY(uint64_t, x - y);
+  CASE(I64Mul) : BINARY(uint64_t, x * y);
+  CASE(I64DivS) : {
+    int64_t x = int64_t(sp[-2]);
+    int64_t y = int64_t(sp[-1]);
+    TRAP_IF(y == 0, "i64.div_s by 0");
+    TRAP_IF(x == std::numeric_limits<int64_t>::min() && y == -1,
+            "i64.div_s overflow");
+    sp[-2] = uint64_t(x / y);
+    --sp;
+    ++pc;
+    DISPATCH();
+  }
+  CASE(I64DivU) : {
+    TRAP_IF(sp[-1] == 0, "i64.div_u by 0");
+    BINARY(uint64_t, x / y);
+  }
+  CASE(I64RemS) : {
+    TRAP_IF(sp[-1] == 0, "i64.rem_s by 0");
+    BINARY(int64_t, y == -1 ? 0 : uint64_t(x % y));
+  }
+  CASE(I64RemU) : {
+    TRAP_IF(sp[-1] == 0, "i64.rem_u by 0");
+    BINARY(uint64_t, x % y);
+  }
+  CASE(I64And) : BINARY(uint64_t, x & y);
+  CASE(I64Or) : BINARY(uint64_t, x | y);
+  CASE(I64Xor) : BINARY(uint64_t, x ^ y);
+  CASE(I64Shl) : BINARY(uint64_t, x << (y & 63));
+  CASE(I64ShrS) : BINARY(uint64_t, uint64_t(int64_t(x) >> (y & 63)));
+  CASE(I64ShrU) : BINARY(uint64_t, x >> (y & 63));
+  CASE(I64RotL) : BINARY(uint64_t, Bits::rotateLeft(x, y));
+  CASE(I64RotR) : BINARY(uint64_t, Bits::rotateRight(x, y));
+  CASE(I64Eq) : BINARY(uint64_t, uint64_t(x == y));
+  CASE(I64Ne) : BINARY(uint64_t, uint64_t(x != y));
+  CASE(I64LtS) : BINARY(int64_t, uint64_t(x < y));
+  CASE(I64LtU) : BINARY(uint64_t, uint64_t(x < y));
+  CASE(I64LeS) : BINARY(int64_t, uint64_t(x <= y));
+  CASE(I64LeU) : BINARY(uint64_t, uint64_t(x <= y));
+  CASE(I64GtS) : BINARY(int64_t, uint64_t(x > y));
+  CASE(I64GtU) : BINARY(uint64_t, uint64_t(x > y));
+  CASE(I64GeS) : BINARY(int64_t, uint64_t(x >= y));
+  CASE(I64GeU) : BINARY(uint64_t, uint64_t(x >= y));
+  CASE(I32WrapI64) : UNARY(uint64_t, uint64_t(uint32_t(x)));
+  CASE(I64ExtendI32S) : UNARY(uint64_t, uint64_t(int64_t(int32_t(x))));
+  CASE(I64ExtendI32U) : UNARY(uint64_t, uint64_t(uint32_t(x)));
+  CASE(Unary) : {
+    auto result = doUnary(UnaryOp(pc->a), pc->b, sp[-1]);
+    if (auto* err = result.getErr()) {
+      trapMessage = err->msg;
+      goto trap;
+    }
+    sp[-1] = *result;
+    ++pc;
+    DISPATCH();
+  }
+  CASE(Binary) : {
+    sp[-2] = doBinary(BinaryOp(pc->a), pc->b, sp[-2], sp[-1]);
+    --sp;
+    ++pc;
+    DISPATCH();
+  }
+
+#ifndef __GNUC__
+  }
+  WASM_UNREACHABLE("unexpected opcode");
+#endif
+
+#undef CASE
+#undef DISPATCH
+#undef BRANCH
+#undef TRAP_IF
+#undef BINARY
+#undef UNARY
+#undef STORE
+#undef LOAD
+#undef EFFECTIVE_ADDRESS
+
+trap:
+  writeBackGlobals();
+  return Err{trapMessage};
+
+done:
+  writeBackGlobals();
+  std::vector<Literal> results;
+  auto type = instance.wasm->functions[funcIndex]->getResults();
+  if (type.isConcrete()) {
+    results.push_back(fromSlot(stack[0], type));
+  }
+  return results;
+}
+
+} // namespace wasm::interpreter
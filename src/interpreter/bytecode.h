@@ -0,0 +1,217 @@
+/*
+ * Copyright 2026 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef interpreter_bytecode_h
+#define interpreter_bytecode_h
+
+#include <cstdint>
+#include <vector>
+
+#include "literal.h"
+#include "support/result.h"
+#include "wasm.h"
+
+namespace wasm::interpreter {
+
+struct Instance;
+
+// A compact, linear form of function bodies that is much faster to run than
+// walking the structured IR. Instructions operate on a stack of untyped 64-bit
+// slots, as the types are all known statically: i32 and f32 values are kept in
+// the low 32 bits and i64 and f64 values use all of them. The locals of a
+// function are the first slots of its frame, and its operands go on top of
+// them. Branches are resolved ahead of time to the index of the instruction to
+// continue at, the stack height to unwind to and the number of values to keep.
+//
+// Integer arithmetic, locals, globals, direct calls and accesses to the memory
+// are implemented directly on slots. Tail calls replace the frame of the caller
+// with that of the callee, so they do not count towards the call depth limit.
+// Float operations and conversions go through Literal, so that their semantics
+// (like the handling of NaNs) are the same as in the rest of Binaryen.
+//
+// Only functions that use scalar numeric types and at most a single 32-bit
+// memory can be compiled for now.
+
+#define INTERPRETER_OPCODES(X)                                                 \
+  X(Unreachable)                                                               \
+  X(Br)                                                                        \
+  X(BrIf)                                                                      \
+  X(BrUnless)                                                                  \
+  X(BrTable)                                                                   \
+  X(Return)                                                                    \
+  X(Call)                                                                      \
+  X(ReturnCall)                                                                \
+  X(Drop)                                                                      \
+  X(Select)                                                                    \
+  X(Const)                                                                     \
+  X(LocalGet)                                                                  \
+  X(LocalSet)                                                                  \
+  X(LocalTee)                                                                  \
+  X(GlobalGet)                                                                 \
+  X(GlobalSet)                                                                 \
+  X(Load8S32)                                                                  \
+  X(Load8U)                                                                    \
+  X(Load16S32)                                                                 \
+  X(Load16U)                                                                   \
+  X(Load32)                                                                    \
+  X(Load8S64)                                                                  \
+  X(Load16S64)                                                                 \
+  X(Load32S64)                                                                 \
+  X(Load64)                                                                    \
+  X(Store8)                                                                    \
+  X(Store16)                                                                   \
+  X(Store32)                                                                   \
+  X(Store64)                                                                   \
+  X(MemorySize)                                                                \
+  X(MemoryGrow)                                                                \
+  X(I32Eqz)                                                                    \
+  X(I32Clz)                                                                    \
+  X(I32Ctz)                                                                    \
+  X(I32Popcnt)                                                                 \
+  X(I32Extend8S)                                                               \
+  X(I32Extend16S)                                                              \
+  X(I32Add)                                                                    \
+  X(I32Sub)                                                                    \
+  X(I32Mul)                                                                    \
+  X(I32DivS)                                                                   \
+  X(I32DivU)                                                                   \
+  X(I32RemS)                                                                   \
+  X(I32RemU)                                                                   \
+  X(I32And)                                                                    \
+  X(I32Or)                                                                     \
+  X(I32Xor)                                                                    \
+  X(I32Shl)                                                                    \
+  X(I32ShrS)                                                                   \
+  X(I32ShrU)                                                                   \
+  X(I32RotL)                                                                   \
+  X(I32RotR)                                                                   \
+  X(I32Eq)                                                                     \
+  X(I32Ne)                                                                     \
+  X(I32LtS)                                                                    \
+  X(I32LtU)                                                                    \
+  X(I32LeS)                                                                    \
+  X(I32LeU)                                                                    \
+  X(I32GtS)                                                                    \
+  X(I32GtU)                                                                    \
+  X(I32GeS)                                                                    \
+  X(I32GeU)                                                                    \
+  X(I64Eqz)                                                                    \
+  X(I64Clz)                                                                    \
+  X(I64Ctz)                                                                    \
+  X(I64Popcnt)                                                                 \
+  X(I64Extend8S)                                                               \
+  X(I64Extend16S)                                                              \
+  X(I64Extend32S)                                                              \
+  X(I64Add)                                                                    \
+  X(I64Sub)                                                                    \
+  X(I64Mul)                                                                    \
+  X(I64DivS)                                                                   \
+  X(I64DivU)                                                                   \
+  X(I64RemS)                                                                   \
+  X(I64RemU)                                                                   \
+  X(I64And)                                                                    \
+  X(I64Or)                                                                     \
+  X(I64Xor)                                                                    \
+  X(I64Shl)                                                                    \
+  X(I64ShrS)                                                                   \
+  X(I64ShrU)                                                                   \
+  X(I64RotL)                                                                   \
+  X(I64RotR)                                                                   \
+  X(I64Eq)                                                                     \
+  X(I64Ne)                                                                     \
+  X(I64LtS)                                                                    \
+  X(I64LtU)                                                                    \
+  X(I64LeS)                                                                    \
+  X(I64LeU)                                                                    \
+  X(I64GtS)                                                                    \
+  X(I64GtU)                                                                    \
+  X(I64GeS)                                                                    \
+  X(I64GeU)                                                                    \
+  X(I32WrapI64)                                                                \
+  X(I64ExtendI32S)                                                             \
+  X(I64ExtendI32U)                                                             \
+  X(Unary)                                                                     \
+  X(Binary)
+
+enum class Opcode : uint32_t {
+#define DEFINE_OPCODE(name) name,
+  INTERPRETER_OPCODES(DEFINE_OPCODE)
+#undef DEFINE_OPCODE
+};
+
+struct Instruction {
+  Opcode op;
+  // The meaning of the immediates depends on the opcode:
+  //
+  //  * Branches have the target instruction in |a|, and the stack height to
+  //    unwind to and the number of values to keep (0 or 1) in the low and high
+  //    halves of |b|. BrTable has the first of its targets (the last of which
+  //    is the default) in |a| and their number in |b|.
+  //  * Return has the number of results in |a|.
+  //  * Call and ReturnCall have the index of the function in |a|.
+  //  * Const has the value in |b|.
+  //  * Locals and globals have their index in |a|.
+  //  * Memory accesses have their offset in |b|.
+  //  * Unary and Binary have the operation in |a|, and the types of the
+  //    operands and of the result in the low and high halves of |b|.
+  uint32_t a = 0;
+  uint64_t b = 0;
+
+  Instruction(Opcode op, uint32_t a = 0, uint64_t b = 0) : op(op), a(a), b(b) {}
+};
+
+struct BranchTarget {
+  uint32_t pc;
+  uint32_t height;
+  uint32_t arity;
+};
+
+struct CompiledFunction {
+  std::vector<Instruction> code;
+  // The targets of the BrTables in the code.
+  std::vector<BranchTarget> branchTables;
+  Index numParams = 0;
+  Index numLocals = 0;
+  Index numResults = 0;
+  // The greatest number of slots that the function uses, including its locals.
+  Index maxHeight = 0;
+};
+
+struct CompiledModule {
+  // Indexed like the functions of the module. Imported functions are left
+  // empty.
+  std::vector<CompiledFunction> functions;
+  // The values of the globals that the code uses, which are stored in the
+  // instance, and their types.
+  std::vector<std::pair<Literal*, Type>> globals;
+  // Whether the code uses the memory, which must then be allocated before it
+  // runs.
+  bool usesMemory = false;
+};
+
+// Compiles the defined functions of an instance. Returns an error if any of
+// them uses something that the bytecode does not support.
+Result<CompiledModule> compile(Instance& instance);
+
+// Calls a function of an instance, which must have been compiled. Returns an
+// error if the execution traps.
+Result<std::vector<Literal>> execute(Instance& instance,
+                                     Index func,
+                                     const std::vector<Literal>& args);
+
+} // namespace wasm::interpreter
+
+#endif // interpreter_bytecode_h
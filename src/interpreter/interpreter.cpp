@@ -14,7 +14,10 @@
  * limitations under the License.
  */
 
+#include <limits>
+
 #include "interpreter/interpreter.h"
+#include "interpreter/bytecode.h"
 #include "interpreter/expression-iterator.h"
 #include "interpreter/store.h"
 #include "wasm-traversal.h"
@@ -298,6 +301,16 @@ Result<> Interpreter::addInstance(std::shared_ptr<Module> wasm) {
   return instantiate(store.instances.emplace_back(wasm));
 }
 
+// The initial size of a memory in bytes, or the largest 64-bit value if it is
+// at least that large.
+static uint64_t getInitialBytes(const Memory& memory) {
+  uint64_t pages = memory.initial;
+  if (pages > std::numeric_limits<uint64_t>::max() >> memory.pageSizeLog2) {
+    return std::numeric_limits<uint64_t>::max();
+  }
+  return pages << memory.pageSizeLog2;
+}
+
 Result<> Interpreter::instantiate(Instance& instance) {
   for (auto& global : instance.wasm->globals) {
     if (global->imported()) {
@@ -308,9 +321,52 @@ Result<> Interpreter::instantiate(Instance& instance) {
     assert(results.size() == 1);
     instance.globalValues[global->name] = results[0];
   }
+  for (auto& segment : instance.wasm->dataSegments) {
+    if (segment->isPassive()) {
+      continue;
+    }
+    auto* memory = instance.wasm->getMemory(segment->memory);
+    if (memory->imported()) {
+      return Err{"unsupported data segment in imported memory"};
+    }
+    store.callStack.emplace_back(instance,
+                                 ExpressionIterator(segment->offset));
+    auto results = run();
+    assert(results.size() == 1);
+    uint64_t offset = results[0].getUnsigned();
+    uint64_t memorySize = getInitialBytes(*memory);
+    if (offset > memorySize || segment->data.size() > memorySize - offset) {
+      return Err{"data segment does not fit in memory"};
+    }
+    instance.activeSegments.push_back({segment.get(), offset});
+  }
   return Ok{};
 }
 
+// Allocates the defined memories of an instance and writes the active data
+// segments to them, if that has not been done yet.
+static void allocateMemories(Instance& instance) {
+  if (instance.memoriesAllocated) {
+    return;
+  }
+  instance.memoriesAllocated = true;
+  auto& wasm = *instance.wasm;
+  std::unordered_map<Name, Index> memoryIndices;
+  instance.memories.resize(wasm.memories.size());
+  for (Index i = 0; i < wasm.memories.size(); i++) {
+    auto& memory = *wasm.memories[i];
+    memoryIndices[memory.name] = i;
+    if (!memory.imported()) {
+      instance.memories[i].resize(getInitialBytes(memory));
+    }
+  }
+  for (auto& [segment, offset] : instance.activeSegments) {
+    auto& memory = instance.memories[memoryIndices[segment->memory]];
+    std::copy(
+      segment->data.begin(), segment->data.end(), memory.begin() + offset);
+  }
+}
+
 // This is a temporary convenience while stil using gTests to validate this
 // interpreter. Once spec tests can run, this shall be deleted.
 std::vector<Literal> Interpreter::runTest(Expression* root) {
@@ -323,6 +379,36 @@ std::vector<Literal> Interpreter::runTest(Expression* root) {
   return run();
 }
 
+Result<std::vector<Literal>>
+Interpreter::invoke(Name exportName, const std::vector<Literal>& args) {
+  assert(!store.instances.empty());
+  auto& instance = store.instances.back();
+  auto* export_ = instance.wasm->getExportOrNull(exportName);
+  if (!export_ || export_->kind != ExternalKind::Function) {
+    return Err{"no exported function " + exportName.toString()};
+  }
+  if (!instance.compiled) {
+    auto compiled = compile(instance);
+    if (auto* err = compiled.getErr()) {
+      return std::move(*err);
+    }
+    instance.compiled = std::make_unique<CompiledModule>(std::move(*compiled));
+  }
+  if (instance.compiled->usesMemory) {
+    allocateMemories(instance);
+  }
+  auto& functions = instance.wasm->functions;
+  for (Index i = 0; i < functions.size(); i++) {
+    if (functions[i]->name == *export_->getInternalName()) {
+      if (functions[i]->imported()) {
+        return Err{"unsupported call to import " + exportName.toString()};
+      }
+      return execute(instance, i, args);
+    }
+  }
+  WASM_UNREACHABLE("missing exported function");
+}
+
 std::vector<Literal> Interpreter::run() {
   ExpressionInterpreter interpreter(*this);
   while (auto& it = store.callStack.back().exprs) {
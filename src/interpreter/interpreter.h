@@ -31,6 +31,12 @@ public:
   std::vector<Literal> runTest(Expression* root);
   std::vector<Literal> run();
 
+  // Calls an export of the most recently added instance, using the bytecode
+  // form of its functions. Returns an error if the function cannot be compiled
+  // or if it traps.
+  Result<std::vector<Literal>> invoke(Name exportName,
+                                      const std::vector<Literal>& args);
+
 private:
   interpreter::WasmStore store;
   friend class InterpreterImpl;
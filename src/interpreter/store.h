@@ -21,6 +21,7 @@
 #include <deque>
 #include <vector>
 
+#include "bytecode.h"
 #include "expression-iterator.h"
 #include "literal.h"
 #include "support/result.h"
@@ -31,6 +32,16 @@ namespace wasm::interpreter {
 struct Instance {
   std::shared_ptr<Module> wasm;
   std::unordered_map<Name, Literal> globalValues;
+  // The contents of the module's defined memories, indexed like its memories.
+  // Memories can be large, so they are only allocated, and the active data
+  // segments written to them, when code that uses them first runs.
+  std::vector<std::vector<uint8_t>> memories;
+  bool memoriesAllocated = false;
+  // The active data segments and their offsets, which are computed when the
+  // instance is created.
+  std::vector<std::pair<DataSegment*, uint64_t>> activeSegments;
+  // The functions of the module in bytecode form, compiled on first use.
+  std::unique_ptr<CompiledModule> compiled;
 
   Instance(std::shared_ptr<Module> wasm) : wasm(std::move(wasm)) {};
 };
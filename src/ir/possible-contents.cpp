@@ -14,6 +14,8 @@
  * limitations under the License.
  */
 
+#include <deque>
+#include <numeric>
 #include <optional>
 #include <variant>
 
@@ -26,7 +28,9 @@
 #include "ir/local-graph.h"
 #include "ir/module-utils.h"
 #include "ir/possible-contents.h"
+#include "support/disjoint_sets.h"
 #include "support/insert_ordered.h"
+#include "support/threads.h"
 
 #ifndef POSSIBLE_CONTENTS_DEBUG
 #define POSSIBLE_CONTENTS_DEBUG 0
@@ -397,6 +401,42 @@ namespace {
 // on.
 using LocationIndex = uint32_t;
 
+// Likewise, the contents of locations are referred to using indexes in a table
+// of all the distinct contents that we have seen. There are typically far fewer
+// of those than locations, as most locations end up with one of a few common
+// values (like nothing, or the cone of their type), and an index is much
+// smaller than the contents themselves.
+using ContentsIndex = uint32_t;
+
+struct ContentsTable {
+  // The empty contents always have index 0.
+  ContentsTable() { insert(PossibleContents::none()); }
+
+  ContentsIndex insert(const PossibleContents& value) {
+    auto [iter, inserted] = indexes.insert({value, 0});
+    if (inserted) {
+      if (contents.size() >= std::numeric_limits<ContentsIndex>::max()) {
+        Fatal() << "Too many possible contents for 32 bits";
+      }
+      iter->second = contents.size();
+      contents.push_back(value);
+    }
+    return iter->second;
+  }
+
+  const PossibleContents& operator[](ContentsIndex index) const {
+    assert(index < contents.size());
+    return contents[index];
+  }
+
+  size_t size() const { return contents.size(); }
+
+private:
+  // A deque keeps references to contents valid while more are added.
+  std::deque<PossibleContents> contents;
+  std::unordered_map<PossibleContents, ContentsIndex> indexes;
+};
+
 #ifndef NDEBUG
 // Assert on not having duplicates in a vector.
 template<typename T> void disallowDuplicates(const T& targets) {
@@ -2092,7 +2132,9 @@ struct Flower {
   Module& wasm;
   const PassOptions& options;
 
-  Flower(Module& wasm, const PassOptions& options);
+  Flower(Module& wasm,
+         const PassOptions& options,
+         ContentOracle::FlowMode mode = ContentOracle::FlowMode::Default);
 
   // Each LocationIndex will have one LocationInfo that contains the relevant
   // information we need for each location.
@@ -2100,31 +2142,51 @@ struct Flower {
     // The location at this index.
     Location location;
 
-    // The possible contents in that location.
-    PossibleContents contents;
+    // The possible contents in that location, as an index in |contentsTable|.
+    ContentsIndex contents = 0;
 
-    // A list of the target locations to which this location sends content.
-    // TODO: benchmark SmallVector<1> here, as commonly there may be a single
-    //       target (an expression has one parent)
-    std::vector<LocationIndex> targets;
+    // The target locations to which this location sends content are the
+    // |numTargets| items in |targets| starting at |firstTarget|, followed by
+    // the targets added during the flow, which are in |extraTargets| at index
+    // |extraTargetsIndex| if there are any.
+    uint32_t firstTarget = 0;
+    uint32_t numTargets = 0;
+    Index extraTargetsIndex = NoExtraTargets;
 
     LocationInfo(Location location) : location(location) {}
   };
 
+  static constexpr Index NoExtraTargets = -1;
+
   // Maps location indexes to the info stored there, as just described above.
   std::vector<LocationInfo> locations;
 
-  // Reverse mapping of locations to their indexes.
+  // Reverse mapping of locations to their indexes. Once the flow begins, this
+  // only contains the locations that are looked up during the flow, see
+  // prepareForFlow().
   std::unordered_map<Location, LocationIndex> locationIndexes;
 
+  ContentsTable contentsTable;
+
+  // The targets of all the locations, in consecutive ranges for each, see
+  // LocationInfo.
+  std::vector<LocationIndex> targets;
+
+  std::vector<std::vector<LocationIndex>> extraTargets;
+
   const Location& getLocation(LocationIndex index) {
     assert(index < locations.size());
     return locations[index].location;
   }
 
-  PossibleContents& getContents(LocationIndex index) {
+  const PossibleContents& getContents(LocationIndex index) {
+    assert(index < locations.size());
+    return contentsTable[locations[index].contents];
+  }
+
+  void setContents(LocationIndex index, const PossibleContents& contents) {
     assert(index < locations.size());
-    return locations[index].contents;
+    locations[index].contents = contentsTable.insert(contents);
   }
 
   // Check what we know about the type of an expression, using static
@@ -2138,12 +2200,33 @@ struct Flower {
   }
 
 private:
-  std::unique_ptr<TNHOracle> tnhOracle;
+  // Creates an empty flower for a part of the graph of |whole|, see
+  // flowInParallel(). The parts share the information that does not change
+  // during the flow.
+  explicit Flower(const Flower* whole)
+    : wasm(whole->wasm), options(whole->options), flowing(true),
+      tnhOracle(whole->tnhOracle), subTypes(whole->subTypes),
+      maxDepths(whole->maxDepths) {}
+
+  // Whether the flow has begun, see prepareForFlow().
+  bool flowing = false;
 
-  std::vector<LocationIndex>& getTargets(LocationIndex index) {
+  std::shared_ptr<TNHOracle> tnhOracle;
+
+#ifndef NDEBUG
+  std::vector<LocationIndex> getTargets(LocationIndex index) {
     assert(index < locations.size());
-    return locations[index].targets;
+    auto& info = locations[index];
+    std::vector<LocationIndex> ret(targets.begin() + info.firstTarget,
+                                   targets.begin() + info.firstTarget +
+                                     info.numTargets);
+    if (info.extraTargetsIndex != NoExtraTargets) {
+      auto& extra = extraTargets[info.extraTargetsIndex];
+      ret.insert(ret.end(), extra.begin(), extra.end());
+    }
+    return ret;
   }
+#endif
 
   // Convert the data into the efficient LocationIndex form we will use during
   // the flow analysis. This method returns the index of a location, allocating
@@ -2165,6 +2248,11 @@ private:
       // in the binary, and we don't have 4GB wasm binaries yet... do we?
       Fatal() << "Too many locations for 32 bits";
     }
+    // During the flow, only the reads and writes of GC data create locations.
+    // Anything else is missing from |locationIndexes| by then, and would end up
+    // with a second index.
+    assert(!flowing || std::get_if<DataLocation>(&location) ||
+           std::get_if<ConeReadLocation>(&location));
     locations.emplace_back(location);
     locationIndexes[location] = index;
 
@@ -2237,11 +2325,37 @@ private:
   // flowToTargetsAfterUpdate), and also handles special cases of flow after.
   void flowAfterUpdate(LocationIndex locationIndex);
 
+  // Set up the targets of each location from |links|, and drop the parts of
+  // the graph that are not needed during the flow.
+  void prepareForFlow();
+
+  // Flow until the work queue is empty.
+  void flow();
+
+  // Flow the parts of the graph that can never send content to each other
+  // separately, and in parallel. The work done in each part happens in the same
+  // order as when flowing the entire graph at once, and so the results are
+  // identical.
+  void flowInParallel();
+
+  // The read or write of GC data that a parent in |childParents| does.
+  struct DataAccess {
+    // The reference and the index of the field that is accessed.
+    Expression* ref;
+    Index index;
+    bool isRead;
+    // For a write, the value that is written. When we do not model the value
+    // (for example, in an atomic RMW), this is null and anything of |valueType|
+    // may be written.
+    Expression* value = nullptr;
+    Type valueType = Type::none;
+  };
+  static DataAccess getDataAccess(Expression* parent);
+
   // Internal part of flowAfterUpdate that handles sending new values to the
   // given location index's normal targets (that is, the ones listed in the
   // |targets| vector).
-  void flowToTargetsAfterUpdate(LocationIndex locationIndex,
-                                const PossibleContents& contents);
+  void flowToTargetsAfterUpdate(LocationIndex locationIndex);
 
   // Add a new connection while the flow is happening. If the link already
   // exists it is not added.
@@ -2280,12 +2394,12 @@ private:
                    Index fieldIndex);
 
   // We will need subtypes during the flow, so compute them once ahead of time.
-  std::unique_ptr<SubTypes> subTypes;
+  std::shared_ptr<SubTypes> subTypes;
 
   // The depth of children for each type. This is 0 if the type has no
   // subtypes, 1 if it has subtypes but none of those have subtypes themselves,
   // and so forth.
-  std::unordered_map<HeapType, Index> maxDepths;
+  std::shared_ptr<std::unordered_map<HeapType, Index>> maxDepths;
 
   // Given a ConeType, return the normalized depth, that is, the canonical depth
   // given the actual children it has. If this is a full cone, then we can
@@ -2293,10 +2407,10 @@ private:
   // For a non-full cone, we also reduce the depth as much as possible, so it is
   // equal to the maximum depth of an existing subtype.
   Index getNormalizedConeDepth(Type type, Index depth) {
-    auto iter = maxDepths.find(type.getHeapType());
+    auto iter = maxDepths->find(type.getHeapType());
     // A max depth must be in the map (otherwise we would use the default 0,
     // making it exact, almost certainly incorrectly).
-    assert(iter != maxDepths.end());
+    assert(iter != maxDepths->end());
     return std::min(depth, iter->second);
   }
 
@@ -2316,7 +2430,9 @@ private:
 #endif
 };
 
-Flower::Flower(Module& wasm, const PassOptions& options)
+Flower::Flower(Module& wasm,
+               const PassOptions& options,
+               ContentOracle::FlowMode mode)
   : wasm(wasm), options(options) {
 
   // If traps never happen, create a TNH oracle.
@@ -2327,7 +2443,7 @@ Flower::Flower(Module& wasm, const PassOptions& options)
     std::cout << "tnh phase\n";
     Timer timer;
 #endif
-    tnhOracle = std::make_unique<TNHOracle>(wasm, options);
+    tnhOracle = std::make_shared<TNHOracle>(wasm, options);
 #if POSSIBLE_CONTENTS_DEBUG
     std::cout << "... " << timer.lastElapsed() << "\n";
 #endif
@@ -2338,8 +2454,9 @@ Flower::Flower(Module& wasm, const PassOptions& options)
   Timer timer;
 #endif
 
-  subTypes = std::make_unique<SubTypes>(wasm);
-  maxDepths = subTypes->getMaxDepths();
+  subTypes = std::make_shared<SubTypes>(wasm);
+  maxDepths = std::make_shared<std::unordered_map<HeapType, Index>>(
+    subTypes->getMaxDepths());
 
 #if POSSIBLE_CONTENTS_DEBUG
   std::cout << "... " << timer.lastElapsed() << "\n";
@@ -2456,6 +2573,10 @@ Flower::Flower(Module& wasm, const PassOptions& options)
     for (auto func : info.calledFromOutside) {
       calledFromOutside.insert(func);
     }
+
+    // Free the function's info as we go, so that it does not stay alive next
+    // to the merged data, which would raise the peak memory usage.
+    info = CollectedFuncInfo();
   }
 
   // We no longer need the function-level info.
@@ -2596,19 +2717,7 @@ Flower::Flower(Module& wasm, const PassOptions& options)
   std::cout << "Link-targets phase\n";
 #endif
 
-  // Add all links to the targets vectors of the source locations, which we will
-  // use during the flow.
-  for (auto& link : links) {
-    getTargets(link.from).push_back(link.to);
-  }
-
-#ifndef NDEBUG
-  // Each vector of targets (which is a vector for efficiency) must have no
-  // duplicates.
-  for (auto& info : locations) {
-    disallowDuplicates(info.targets);
-  }
-#endif
+  prepareForFlow();
 
 #if POSSIBLE_CONTENTS_DEBUG
   std::cout << "... " << timer.lastElapsed() << "\n";
@@ -2631,23 +2740,15 @@ Flower::Flower(Module& wasm, const PassOptions& options)
 #if POSSIBLE_CONTENTS_DEBUG
   std::cout << "... " << timer.lastElapsed() << "\n";
   std::cout << "flow phase\n";
-  size_t iters = 0;
-#endif
-
-  // Flow the data while there is still stuff flowing.
-  while (!workQueue.empty()) {
-#if POSSIBLE_CONTENTS_DEBUG
-    iters++;
-    if ((iters & 255) == 0) {
-      std::cout << iters++ << " iters, work left: " << workQueue.size() << '\n';
-    }
 #endif
 
-    auto iter = workQueue.begin();
-    auto locationIndex = *iter;
-    workQueue.erase(iter);
-
-    flowAfterUpdate(locationIndex);
+  bool parallel = mode == ContentOracle::FlowMode::Default
+                    ? ThreadPool::get()->size() > 1
+                    : mode == ContentOracle::FlowMode::Parallel;
+  if (parallel) {
+    flowInParallel();
+  } else {
+    flow();
   }
 
 #if POSSIBLE_CONTENTS_DEBUG
@@ -2660,8 +2761,8 @@ Flower::Flower(Module& wasm, const PassOptions& options)
 
 bool Flower::updateContents(LocationIndex locationIndex,
                             PossibleContents newContents) {
-  auto& contents = getContents(locationIndex);
-  auto oldContents = contents;
+  const auto& oldContents = getContents(locationIndex);
+  auto contents = oldContents;
 
 #if defined(POSSIBLE_CONTENTS_DEBUG) && POSSIBLE_CONTENTS_DEBUG >= 2
   std::cout << "\nupdateContents\n";
@@ -2817,6 +2918,8 @@ bool Flower::updateContents(LocationIndex locationIndex,
   // - in the worst case, we can have the type declared in the wasm.
   assert(!contents.isMany());
 
+  setContents(locationIndex, contents);
+
   // Add a work item if there isn't already.
   workQueue.insert(locationIndex);
 
@@ -2825,23 +2928,22 @@ bool Flower::updateContents(LocationIndex locationIndex,
 
 void Flower::flowAfterUpdate(LocationIndex locationIndex) {
   const auto location = getLocation(locationIndex);
-  auto& contents = getContents(locationIndex);
 
   // We are called after a change at a location. A change means that some
   // content has arrived, since we never send empty values around. Assert on
   // that.
-  assert(!contents.isNone());
+  assert(!getContents(locationIndex).isNone());
 
 #if defined(POSSIBLE_CONTENTS_DEBUG) && POSSIBLE_CONTENTS_DEBUG >= 2
   std::cout << "\nflowAfterUpdate to:\n";
   dump(location);
   std::cout << "  arriving:\n";
-  contents.dump(std::cout, &wasm);
+  getContents(locationIndex).dump(std::cout, &wasm);
   std::cout << '\n';
 #endif
 
   // Flow the contents to the normal targets of this location.
-  flowToTargetsAfterUpdate(locationIndex, contents);
+  flowToTargetsAfterUpdate(locationIndex);
 
   // We are mostly done, except for handling interesting/special cases in the
   // flow, additional operations that we need to do aside from sending the new
@@ -2860,92 +2962,344 @@ void Flower::flowAfterUpdate(LocationIndex locationIndex) {
     auto parentIndex = iter->second;
     auto* parent = std::get<ExpressionLocation>(getLocation(parentIndex)).expr;
 
+    // Sending to the targets may have changed our own contents, if we are one
+    // of them, so get the contents only now.
+    const auto& contents = getContents(locationIndex);
+
 #if defined(POSSIBLE_CONTENTS_DEBUG) && POSSIBLE_CONTENTS_DEBUG >= 2
     std::cout << "  special, parent:\n" << *parent << '\n';
 #endif
 
-    if (auto* get = parent->dynCast<StructGet>()) {
-      // |child| is the reference child of a struct.get.
-      assert(get->ref == child);
-      readFromData(get->ref->type, get->index, contents, get);
-    } else if (auto* set = parent->dynCast<StructSet>()) {
-      // |child| is either the reference or the value child of a struct.set.
-      assert(set->ref == child || set->value == child);
-      writeToData(set->ref, set->value, set->index);
-    } else if (auto* set = parent->dynCast<StructRMW>()) {
-      assert(set->ref == child || set->value == child);
-      // TODO: model the stored value, depending on the actual operation.
-      writeToData(
-        set->ref, PossibleContents::fromType(set->value->type), set->index);
-    } else if (auto* set = parent->dynCast<StructCmpxchg>()) {
-      assert(set->ref == child || set->expected == child ||
-             set->replacement == child);
-      // TODO: model the stored value, depending on the actual operation.
-      writeToData(set->ref,
-                  PossibleContents::fromType(set->replacement->type),
-                  set->index);
-    } else if (auto* get = parent->dynCast<ArrayGet>()) {
-      assert(get->ref == child);
-      readFromData(get->ref->type, 0, contents, get);
-    } else if (auto* set = parent->dynCast<ArraySet>()) {
-      assert(set->ref == child || set->value == child);
-      writeToData(set->ref, set->value, 0);
-    } else if (auto* load = parent->dynCast<ArrayLoad>()) {
-      assert(load->ref == child);
-      readFromData(load->ref->type, 0, contents, load);
-    } else if (auto* store = parent->dynCast<ArrayStore>()) {
-      assert(store->ref == child || store->value == child);
-      // TODO: model the stored value, and handle different but equal values in
-      //       type, e.g. writing i16 0x1212 is the same as i8 0x12.
-      writeToData(
-        store->ref, PossibleContents::fromType(store->value->type), 0);
-    } else if (auto* set = parent->dynCast<ArrayRMW>()) {
-      assert(set->ref == child || set->value == child);
-      // TODO: model the stored value, depending on the actual operation.
-      writeToData(set->ref, PossibleContents::fromType(set->value->type), 0);
-    } else if (auto* set = parent->dynCast<ArrayCmpxchg>()) {
-      assert(set->ref == child || set->expected == child ||
-             set->replacement == child);
-      // TODO: model the stored value, depending on the actual operation.
-      writeToData(
-        set->ref, PossibleContents::fromType(set->replacement->type), 0);
-    } else if (auto* get = parent->dynCast<RefGetDesc>()) {
-      assert(get->ref == child);
-      readFromData(
-        get->ref->type, DataLocation::DescriptorIndex, contents, get);
+    auto access = getDataAccess(parent);
+    if (access.isRead) {
+      // |child| is the reference child of the read.
+      assert(access.ref == child);
+      readFromData(access.ref->type, access.index, contents, parent);
+    } else if (access.value) {
+      // |child| is either the reference or the value child of the write.
+      assert(access.ref == child || access.value == child);
+      writeToData(access.ref, access.value, access.index);
     } else {
-      // TODO: ref.test and all other casts can be optimized (see the cast
-      //       helper code used in OptimizeInstructions and RemoveUnusedBrs)
-      WASM_UNREACHABLE("bad childParents content");
+      writeToData(access.ref,
+                  PossibleContents::fromType(access.valueType),
+                  access.index);
+    }
+  }
+}
+
+void Flower::prepareForFlow() {
+  // Add all links to the targets of the source locations, which we will use
+  // during the flow. First count the targets of each location, then put them in
+  // place, in the order of |links|.
+  for (auto& link : links) {
+    locations[link.from].numTargets++;
+  }
+  size_t numTargets = 0;
+  for (auto& info : locations) {
+    info.firstTarget = numTargets;
+    numTargets += info.numTargets;
+    info.numTargets = 0;
+  }
+  if (numTargets >= std::numeric_limits<uint32_t>::max()) {
+    Fatal() << "Too many links for 32 bits";
+  }
+  targets.resize(numTargets);
+  for (auto& link : links) {
+    auto& info = locations[link.from];
+    targets[info.firstTarget + info.numTargets++] = link.to;
+  }
+
+#ifndef NDEBUG
+  // Each location's targets must have no duplicates.
+  for (LocationIndex i = 0; i < locations.size(); i++) {
+    disallowDuplicates(getTargets(i));
+  }
+#endif
+
+  // From here on we only need |links| to avoid adding a link again during the
+  // flow, in connectDuringFlow(), and all those links start at a DataLocation
+  // (or at a ConeReadLocation, but those are only created during the flow).
+  std::erase_if(links, [&](const IndexLink& link) {
+    return !std::get_if<DataLocation>(&getLocation(link.from));
+  });
+
+  // Likewise, the only locations that we look up during the flow are the
+  // DataLocations and the children and parents in |childParents|, whose reads
+  // and writes of GC data need them.
+  std::unordered_map<Location, LocationIndex> lookedUp;
+  for (LocationIndex i = 0; i < locations.size(); i++) {
+    if (std::get_if<DataLocation>(&getLocation(i))) {
+      lookedUp[getLocation(i)] = i;
+    }
+  }
+  for (auto [child, parent] : childParents) {
+    lookedUp[getLocation(child)] = child;
+    lookedUp[getLocation(parent)] = parent;
+  }
+  locationIndexes = std::move(lookedUp);
+
+  flowing = true;
+}
+
+void Flower::flow() {
+#if POSSIBLE_CONTENTS_DEBUG
+  size_t iters = 0;
+#endif
+
+  // Flow the data while there is still stuff flowing.
+  while (!workQueue.empty()) {
+#if POSSIBLE_CONTENTS_DEBUG
+    iters++;
+    if ((iters & 255) == 0) {
+      std::cout << iters++ << " iters, work left: " << workQueue.size() << '\n';
+    }
+#endif
+
+    auto iter = workQueue.begin();
+    auto locationIndex = *iter;
+    workQueue.erase(iter);
+
+    flowAfterUpdate(locationIndex);
+  }
+}
+
+Flower::DataAccess Flower::getDataAccess(Expression* parent) {
+  if (auto* get = parent->dynCast<StructGet>()) {
+    return {get->ref, get->index, true};
+  } else if (auto* set = parent->dynCast<StructSet>()) {
+    return {set->ref, set->index, false, set->value};
+  } else if (auto* set = parent->dynCast<StructRMW>()) {
+    // TODO: model the stored value, depending on the actual operation.
+    return {set->ref, set->index, false, nullptr, set->value->type};
+  } else if (auto* set = parent->dynCast<StructCmpxchg>()) {
+    // TODO: model the stored value, depending on the actual operation.
+    return {set->ref, set->index, false, nullptr, set->replacement->type};
+  } else if (auto* get = parent->dynCast<ArrayGet>()) {
+    return {get->ref, 0, true};
+  } else if (auto* set = parent->dynCast<ArraySet>()) {
+    return {set->ref, 0, false, set->value};
+  } else if (auto* load = parent->dynCast<ArrayLoad>()) {
+    return {load->ref, 0, true};
+  } else if (auto* store = parent->dynCast<ArrayStore>()) {
+    // TODO: model the stored value, and handle different but equal values in
+    //       type, e.g. writing i16 0x1212 is the same as i8 0x12.
+    return {store->ref, 0, false, nullptr, store->value->type};
+  } else if (auto* set = parent->dynCast<ArrayRMW>()) {
+    // TODO: model the stored value, depending on the actual operation.
+    return {set->ref, 0, false, nullptr, set->value->type};
+  } else if (auto* set = parent->dynCast<ArrayCmpxchg>()) {
+    // TODO: model the stored value, depending on the actual operation.
+    return {set->ref, 0, false, nullptr, set->replacement->type};
+  } else if (auto* get = parent->dynCast<RefGetDesc>()) {
+    return {get->ref, DataLocation::DescriptorIndex, true};
+  }
+  // TODO: ref.test and all other casts can be optimized (see the cast
+  //       helper code used in OptimizeInstructions and RemoveUnusedBrs)
+  WASM_UNREACHABLE("bad childParents content");
+}
+
+void Flower::flowInParallel() {
+  // Find the sets of locations that may send content to each other. Content
+  // moves from locations to their targets, from children to their parents in
+  // |childParents|, and to targets that are added during the flow. The latter
+  // connect a read of a field to the DataLocations of that field in subtypes of
+  // the type that is read, and a write sends content directly to such
+  // DataLocations. All of those types are in the same tree of subtypes, so we
+  // join all the reads, writes and DataLocations of a field in a tree of
+  // subtypes using an extra element for it.
+  DisjointSets sets;
+  sets.reserve(locations.size());
+  for (Index i = 0; i < locations.size(); i++) {
+    sets.addSet();
+  }
+  std::unordered_map<std::pair<HeapType, Index>, size_t> fieldSets;
+  auto getFieldSet = [&](HeapType type, Index index) {
+    while (auto super = type.getDeclaredSuperType()) {
+      type = *super;
+    }
+    auto [iter, inserted] = fieldSets.insert({{type, index}, 0});
+    if (inserted) {
+      iter->second = sets.addSet();
+    }
+    return iter->second;
+  };
+  for (LocationIndex i = 0; i < locations.size(); i++) {
+    auto& info = locations[i];
+    for (Index j = 0; j < info.numTargets; j++) {
+      sets.getUnion(i, targets[info.firstTarget + j]);
+    }
+  }
+  for (auto [child, parent] : childParents) {
+    sets.getUnion(child, parent);
+    auto* expr = std::get<ExpressionLocation>(getLocation(parent)).expr;
+    auto access = getDataAccess(expr);
+    // An unreachable reference never reads or writes anything.
+    if (access.ref->type.isRef()) {
+      sets.getUnion(
+        parent, getFieldSet(access.ref->type.getHeapType(), access.index));
+    }
+  }
+  for (Index i = 0; i < locations.size(); i++) {
+    if (auto* dataLoc = std::get_if<DataLocation>(&getLocation(i))) {
+      sets.getUnion(i, getFieldSet(dataLoc->type, dataLoc->index));
+    }
+  }
+
+  // Number the sets in the order of their first locations.
+  std::vector<Index> rootSets(sets.info.size(), Index(-1));
+  std::vector<Index> setSizes;
+  std::vector<Index> locationSets(locations.size());
+  for (Index i = 0; i < locations.size(); i++) {
+    auto& set = rootSets[sets.getRoot(i)];
+    if (set == Index(-1)) {
+      set = setSizes.size();
+      setSizes.push_back(0);
+    }
+    locationSets[i] = set;
+    setSizes[set]++;
+  }
+  if (setSizes.size() == 1) {
+    // Everything may interact.
+    flow();
+    return;
+  }
+
+  // Divide the sets into parts of similar sizes, assigning the largest sets
+  // first, each to the part that is currently the smallest. Which sets end up
+  // in which part does not affect the results, as each set is flowed in the
+  // same way no matter what else is in its part.
+  Index numParts = std::min(size_t(ThreadPool::get()->size() * 4),
+                            setSizes.size());
+  std::vector<Index> order(setSizes.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&](Index a, Index b) {
+    return setSizes[a] > setSizes[b];
+  });
+  std::vector<Index> setParts(setSizes.size());
+  std::vector<size_t> partSizes(numParts);
+  for (auto set : order) {
+    auto smallest =
+      std::min_element(partSizes.begin(), partSizes.end()) - partSizes.begin();
+    setParts[set] = smallest;
+    partSizes[smallest] += setSizes[set];
+  }
+
+  // Split the graph. Each location gets a new index in its part, and the
+  // targets keep their order, as that order determines the order of the work.
+  std::vector<std::unique_ptr<Flower>> parts;
+  std::vector<std::vector<LocationIndex>> partLocations(numParts);
+  std::vector<LocationIndex> partIndexes(locations.size());
+  for (Index i = 0; i < numParts; i++) {
+    parts.emplace_back(new Flower(this));
+    partLocations[i].reserve(partSizes[i]);
+  }
+  for (Index i = 0; i < locations.size(); i++) {
+    auto& indexes = partLocations[setParts[locationSets[i]]];
+    partIndexes[i] = indexes.size();
+    indexes.push_back(i);
+  }
+  for (auto& link : links) {
+    auto part = setParts[locationSets[link.from]];
+    parts[part]->links.insert({partIndexes[link.from], partIndexes[link.to]});
+  }
+  for (auto& [location, index] : locationIndexes) {
+    auto part = setParts[locationSets[index]];
+    parts[part]->locationIndexes[location] = partIndexes[index];
+  }
+  for (auto [child, parent] : childParents) {
+    auto part = setParts[locationSets[child]];
+    parts[part]->childParents[partIndexes[child]] = partIndexes[parent];
+  }
+  for (auto index : workQueue) {
+    auto part = setParts[locationSets[index]];
+    parts[part]->workQueue.insert(partIndexes[index]);
+  }
+  // The parts have their own indexes, and any new locations they create are
+  // added to the end of |locations| when we are done, so the mapping here is
+  // no longer needed.
+  links.clear();
+  locationIndexes.clear();
+  childParents.clear();
+  workQueue.clear();
+
+  std::atomic<Index> nextPart = 0;
+  std::vector<std::function<ThreadWorkState()>> doWorkers;
+  for (size_t i = 0; i < ThreadPool::get()->size(); i++) {
+    doWorkers.push_back([&]() {
+      auto index = nextPart.fetch_add(1);
+      if (index >= numParts) {
+        return ThreadWorkState::Finished;
+      }
+      auto& part = *parts[index];
+      auto& indexes = partLocations[index];
+      part.locations.reserve(indexes.size());
+      for (auto i : indexes) {
+        auto& info = locations[i];
+        auto& partInfo = part.locations.emplace_back(info.location);
+        partInfo.contents =
+          part.contentsTable.insert(contentsTable[info.contents]);
+        partInfo.firstTarget = part.targets.size();
+        partInfo.numTargets = info.numTargets;
+        for (Index j = 0; j < info.numTargets; j++) {
+          part.targets.push_back(partIndexes[targets[info.firstTarget + j]]);
+        }
+      }
+      part.flow();
+      return ThreadWorkState::More;
+    });
+  }
+  ThreadPool::get()->work(doWorkers);
+
+  // Gather the results. Only the contents are still needed at this point, and
+  // not the targets.
+  targets.clear();
+  for (Index i = 0; i < numParts; i++) {
+    auto& part = *parts[i];
+    auto& indexes = partLocations[i];
+    for (Index j = 0; j < part.locations.size(); j++) {
+      auto& contents = part.getContents(j);
+      if (j < indexes.size()) {
+        setContents(indexes[j], contents);
+      } else {
+        locations.emplace_back(part.getLocation(j));
+        setContents(locations.size() - 1, contents);
+      }
     }
+    parts[i].reset();
   }
 }
 
-void Flower::flowToTargetsAfterUpdate(LocationIndex locationIndex,
-                                      const PossibleContents& contents) {
+void Flower::flowToTargetsAfterUpdate(LocationIndex locationIndex) {
   // Send the new contents to all the targets of this location. As we do so,
   // prune any targets that we do not need to bother sending content to in the
-  // future, to save space and work later.
-  auto& targets = getTargets(locationIndex);
-  targets.erase(std::remove_if(targets.begin(),
-                               targets.end(),
-                               [&](LocationIndex targetIndex) {
+  // future, to save space and work later. Note that we read the contents for
+  // each target, as they change if we send something to ourselves.
+  auto send = [&](LocationIndex targetIndex) {
 #if defined(POSSIBLE_CONTENTS_DEBUG) && POSSIBLE_CONTENTS_DEBUG >= 2
-                                 std::cout << "  send to target\n";
-                                 dump(getLocation(targetIndex));
+    std::cout << "  send to target\n";
+    dump(getLocation(targetIndex));
 #endif
-                                 return !updateContents(targetIndex, contents);
-                               }),
-                targets.end());
+    return !updateContents(targetIndex, getContents(locationIndex));
+  };
+  auto& info = locations[locationIndex];
+  auto begin = targets.begin() + info.firstTarget;
+  auto end = std::remove_if(begin, begin + info.numTargets, send);
+  info.numTargets = end - begin;
+  if (info.extraTargetsIndex != NoExtraTargets) {
+    auto& extra = extraTargets[info.extraTargetsIndex];
+    extra.erase(std::remove_if(extra.begin(), extra.end(), send), extra.end());
+  }
 
-  if (contents.isMany()) {
+  if (getContents(locationIndex).isMany()) {
     // We contain Many, and just called updateContents on our targets to send
     // that value to them. We'll never need to send anything from here ever
     // again, since we sent the worst case possible already, so we can just
-    // clear our targets vector. But we should have already removed all the
-    // targets in the above remove_if operation, since they should have all
-    // notified us that we do not need to send them any more updates.
-    assert(targets.empty());
+    // clear our targets. But we should have already removed all the targets in
+    // the above remove_if operations, since they should have all notified us
+    // that we do not need to send them any more updates.
+    assert(info.numTargets == 0);
+    assert(info.extraTargetsIndex == NoExtraTargets ||
+           extraTargets[info.extraTargetsIndex].empty());
   }
 }
 
@@ -2956,11 +3310,15 @@ void Flower::connectDuringFlow(Location from, Location to) {
     // This is a new link. Add it to the known links.
     links.insert(newIndexLink);
 
-    // Add it to the |targets| vector.
-    auto& targets = getTargets(newIndexLink.from);
-    targets.push_back(newIndexLink.to);
+    // Add it to the targets.
+    auto& info = locations[newIndexLink.from];
+    if (info.extraTargetsIndex == NoExtraTargets) {
+      info.extraTargetsIndex = extraTargets.size();
+      extraTargets.emplace_back();
+    }
+    extraTargets[info.extraTargetsIndex].push_back(newIndexLink.to);
 #ifndef NDEBUG
-    disallowDuplicates(targets);
+    disallowDuplicates(getTargets(newIndexLink.from));
 #endif
 
     // In addition to adding the link, which will ensure new contents appearing
@@ -3407,9 +3765,20 @@ void Flower::dump(Location location) {
 } // anonymous namespace
 
 void ContentOracle::analyze() {
-  Flower flower(wasm, options);
+  Flower flower(wasm, options, mode);
+  // Map the indexes in the flower's table of contents to ours, which only has
+  // the contents that the locations still refer to.
+  std::vector<Index> indexes(flower.contentsTable.size(), Index(-1));
   for (LocationIndex i = 0; i < flower.locations.size(); i++) {
-    locationContents[flower.getLocation(i)] = flower.getContents(i);
+    auto index = flower.locations[i].contents;
+    if (flower.contentsTable[index].isNone()) {
+      continue;
+    }
+    if (indexes[index] == Index(-1)) {
+      indexes[index] = contents.size();
+      contents.push_back(flower.contentsTable[index]);
+    }
+    locationContents[flower.getLocation(i)] = indexes[index];
   }
 }
 
@@ -716,14 +716,24 @@ namespace wasm {
 // optimization passes work on the types in the IR, so we do not focus on that
 // here.
 class ContentOracle {
+public:
+  // How to flow the graph. By default, the parts of it that can never interact
+  // are flowed separately, in parallel, when there are multiple threads. The
+  // results are the same either way, which tests can check by forcing one.
+  enum class FlowMode { Default, Serial, Parallel };
+
+private:
   Module& wasm;
   const PassOptions& options;
+  FlowMode mode;
 
   void analyze();
 
 public:
-  ContentOracle(Module& wasm, const PassOptions& options)
-    : wasm(wasm), options(options) {
+  ContentOracle(Module& wasm,
+                const PassOptions& options,
+                FlowMode mode = FlowMode::Default)
+    : wasm(wasm), options(options), mode(mode) {
     analyze();
   }
 
@@ -734,7 +744,7 @@ public:
       // We know of no possible contents here.
       return PossibleContents::none();
     }
-    return iter->second;
+    return contents[iter->second];
   }
 
   // Helper for the common case of an expression location that is not a
@@ -744,8 +754,20 @@ public:
     return getContents(ExpressionLocation{curr, 0});
   }
 
+  // Call a function on each location that can contain something, along with
+  // its contents.
+  template<typename T> void iterContents(T func) const {
+    for (auto& [location, index] : locationContents) {
+      func(location, contents[index]);
+    }
+  }
+
 private:
-  std::unordered_map<Location, PossibleContents> locationContents;
+  // The contents of each location, as an index in |contents|. Many locations
+  // have the same contents, so we store each distinct one only once. Locations
+  // that can contain nothing are not stored.
+  std::unordered_map<Location, Index> locationContents;
+  std::vector<PossibleContents> contents;
 };
 
 } // namespace wasm
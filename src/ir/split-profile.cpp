@@ -0,0 +1,121 @@
+/*
+ * Copyright 2026 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ir/split-profile.h"
+#include "support/file.h"
+#include "support/hash.h"
+#include "support/utilities.h"
+#include "wasm-binary.h"
+
+namespace wasm::SplitProfile {
+
+ProfileData read(const std::string& file) {
+  auto profileData = read_file<std::vector<char>>(file, Flags::Binary);
+  size_t i = 0;
+  auto readi32 = [&]() {
+    if (i + 4 > profileData.size()) {
+      Fatal() << "Unexpected end of profile data in " << file;
+    }
+    uint32_t i32 = 0;
+    i32 |= uint32_t(uint8_t(profileData[i++]));
+    i32 |= uint32_t(uint8_t(profileData[i++])) << 8;
+    i32 |= uint32_t(uint8_t(profileData[i++])) << 16;
+    i32 |= uint32_t(uint8_t(profileData[i++])) << 24;
+    return i32;
+  };
+  auto readi64 = [&]() {
+    uint64_t i64 = readi32();
+    i64 |= uint64_t(readi32()) << 32;
+    return i64;
+  };
+
+  ProfileData profile;
+  profile.hash = readi64();
+
+  if (i + 4 > profileData.size() || readi32() != ExtendedMagic) {
+    // The original format, which is just the timestamps.
+    i = 8;
+    while (i < profileData.size()) {
+      profile.timestamps.push_back(readi32());
+    }
+    return profile;
+  }
+
+  uint32_t flags = readi32();
+  profile.hasCallCounts = flags & HasCallCounts;
+  profile.hasCallEdges = flags & HasCallEdges;
+  uint32_t numFuncs = readi32();
+  for (uint32_t f = 0; f < numFuncs; ++f) {
+    profile.timestamps.push_back(readi32());
+  }
+  if (profile.hasCallCounts) {
+    for (uint32_t f = 0; f < numFuncs; ++f) {
+      profile.callCounts.push_back(readi64());
+    }
+  }
+  if (profile.hasCallEdges) {
+    uint32_t numEdges = readi32();
+    for (uint32_t e = 0; e < numEdges; ++e) {
+      uint32_t caller = readi32();
+      uint32_t callee = readi32();
+      uint64_t count = readi64();
+      if (caller >= numFuncs || callee >= numFuncs) {
+        Fatal() << "Invalid call edge in profile data in " << file;
+      }
+      profile.callEdges.push_back({caller, callee, count});
+    }
+  }
+  if (i != profileData.size()) {
+    Fatal() << "Unexpected extra profile data in " << file;
+  }
+  return profile;
+}
+
+void write(const ProfileData& profile, const std::string& file) {
+  BufferWithRandomAccess buffer;
+  buffer << profile.hash;
+  if (profile.hasCallCounts || profile.hasCallEdges) {
+    uint32_t flags = (profile.hasCallCounts ? HasCallCounts : 0) |
+                     (profile.hasCallEdges ? HasCallEdges : 0);
+    buffer << ExtendedMagic << flags << uint32_t(profile.timestamps.size());
+  }
+  for (auto timestamp : profile.timestamps) {
+    buffer << uint32_t(timestamp);
+  }
+  for (auto count : profile.callCounts) {
+    buffer << count;
+  }
+  if (profile.hasCallEdges) {
+    buffer << uint32_t(profile.callEdges.size());
+    for (auto& edge : profile.callEdges) {
+      buffer << edge.caller << edge.callee << edge.count;
+    }
+  }
+  Output out(file, Flags::Binary);
+  buffer.writeTo(out.getStream());
+}
+
+uint64_t hashFile(const std::string& file) {
+  auto contents(read_file<std::vector<char>>(file, Flags::Binary));
+  size_t digest = 0;
+  // Don't use `hash` or `rehash` - they aren't deterministic between executions
+  for (char c : contents) {
+    hash_combine(digest, c);
+  }
+  return uint64_t(digest);
+}
+
+} // namespace wasm::SplitProfile
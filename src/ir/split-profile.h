@@ -0,0 +1,69 @@
+/*
+ * Copyright 2026 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// split-profile.h: Reading and writing the profiles that modules instrumented
+// by `wasm-split --instrument` produce. See "wasm-split profile format" in
+// src/tools/wasm-split/instrumenter.cpp for the format itself.
+
+#ifndef wasm_ir_split_profile_h
+#define wasm_ir_split_profile_h
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace wasm::SplitProfile {
+
+// The 4 bytes after the module hash of a profile in the extended format, which
+// is used when call counts or call edges are recorded.
+constexpr uint32_t ExtendedMagic = 0x31707377; // "wsp1"
+
+// The flags of a profile in the extended format, saying what it contains.
+constexpr uint32_t HasCallCounts = 1 << 0;
+constexpr uint32_t HasCallEdges = 1 << 1;
+
+struct CallEdge {
+  // Indices of defined functions.
+  uint32_t caller;
+  uint32_t callee;
+  uint64_t count;
+};
+
+struct ProfileData {
+  uint64_t hash = 0;
+  // For each defined function, when it was first called, counting from 1, or 0
+  // if it was never called.
+  std::vector<size_t> timestamps;
+  // The number of calls to each function and along each direct call edge, if
+  // the profile recorded them.
+  bool hasCallCounts = false;
+  bool hasCallEdges = false;
+  std::vector<uint64_t> callCounts;
+  std::vector<CallEdge> callEdges;
+};
+
+// Reads a profile, failing with a fatal error if it is malformed.
+ProfileData read(const std::string& file);
+
+void write(const ProfileData& profile, const std::string& file);
+
+// Computes the hash of a module file that is stored in its profiles, which is
+// a hash of the bytes of the file.
+uint64_t hashFile(const std::string& file);
+
+} // namespace wasm::SplitProfile
+
+#endif // wasm_ir_split_profile_h
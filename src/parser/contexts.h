@@ -1690,6 +1690,13 @@ struct ParseDefsCtx : TypeParserCtx<ParseDefsCtx>, AnnotationParserCtx {
   std::unordered_map<std::string_view, Index> debugSymbolNameIndices;
   std::unordered_map<std::string_view, Index> debugFileIndices;
 
+  // Where newly seen debug info symbol and file names are recorded, in the
+  // order of their indices. These are the module's lists, except when a
+  // function is parsed on its own in parallel with others, in which case they
+  // are local to the function and remapped to module indices afterwards.
+  std::vector<std::string>* debugSymbolNames;
+  std::vector<std::string>* debugFileNames;
+
   // The index of the current module element.
   Index index = 0;
 
@@ -1716,7 +1723,9 @@ struct ParseDefsCtx : TypeParserCtx<ParseDefsCtx>, AnnotationParserCtx {
     const IndexMap& typeIndices)
     : TypeParserCtx(typeIndices), in(in), wasm(wasm), builder(wasm),
       types(types), implicitTypes(implicitTypes), typeNames(typeNames),
-      implicitElemIndices(implicitElemIndices), irBuilder(wasm) {}
+      implicitElemIndices(implicitElemIndices),
+      debugSymbolNames(&wasm.debugInfoSymbolNames),
+      debugFileNames(&wasm.debugInfoFileNames), irBuilder(wasm) {}
 
   template<typename T> Result<T> withLoc(Index pos, Result<T> res) {
     if (auto err = res.getErr()) {
@@ -2100,19 +2109,17 @@ struct ParseDefsCtx : TypeParserCtx<ParseDefsCtx>, AnnotationParserCtx {
       auto [it, inserted] = debugSymbolNameIndices.insert(
         {symbolName, debugSymbolNameIndices.size()});
       if (inserted) {
-        assert(wasm.debugInfoSymbolNames.size() == it->second);
-        wasm.debugInfoSymbolNames.push_back(std::string(symbolName));
+        assert(debugSymbolNames->size() == it->second);
+        debugSymbolNames->push_back(std::string(symbolName));
       }
       symbolNameIndex = it->second;
     }
 
-    // TODO: If we ever parallelize the parse, access to
-    // `wasm.debugInfoFileNames` will have to be protected by a lock.
     auto [it, inserted] =
       debugFileIndices.insert({file, debugFileIndices.size()});
     if (inserted) {
-      assert(wasm.debugInfoFileNames.size() == it->second);
-      wasm.debugInfoFileNames.push_back(std::string(file));
+      assert(debugFileNames->size() == it->second);
+      debugFileNames->push_back(std::string(file));
     }
     irBuilder.setDebugLocation(
       Function::DebugLocation({it->second, *line, *col, symbolNameIndex}));
@@ -14,10 +14,99 @@
  * limitations under the License.
  */
 
+#include "support/threads.h"
 #include "wat-parser-internal.h"
 
 namespace wasm::WATParser {
 
+namespace {
+
+Result<> parseFuncDef(ParseDefsCtx& ctx, ParseDeclsCtx& decls, Index i) {
+  ctx.index = i;
+  auto* f = decls.wasm.functions[i].get();
+  WithPosition with(ctx, decls.funcDefs[i].pos);
+  ctx.setSrcLoc(decls.funcDefs[i].annotations);
+  ctx.in.setAnnotations(decls.funcDefs[i].annotations);
+  if (!f->imported()) {
+    CHECK_ERR(ctx.visitFunctionStart(f));
+  }
+  if (decls.funcDefs[i].kind == DefKind::ImportDesc) {
+    auto im = importdesc(ctx, Name{}, Name{}, std::nullopt);
+    assert(!im.getErr());
+    CHECK_ERR(im);
+  } else {
+    auto parsed = func(ctx);
+    assert(parsed);
+    CHECK_ERR(parsed);
+  }
+  if (!f->imported()) {
+    auto end = ctx.irBuilder.visitEnd();
+    if (auto* err = end.getErr()) {
+      return ctx.in.err(decls.funcDefs[i].pos, err->msg);
+    }
+  }
+  return Ok{};
+}
+
+// Debug info symbol and file names get module-wide indices in the order they
+// are first seen, which a parallel parse does not preserve. Instead, each
+// function records the names it uses in a list of its own, and we map those to
+// module indices afterwards, in function order, which assigns them exactly as
+// the sequential parse does.
+struct FuncDebugNames {
+  std::vector<std::string> symbols;
+  std::vector<std::string> files;
+};
+
+void remapDebugNames(Module& wasm, std::vector<FuncDebugNames>& funcNames) {
+  std::unordered_map<std::string, Index> symbolIndices, fileIndices;
+  for (Index i = 0; i < wasm.debugInfoSymbolNames.size(); ++i) {
+    symbolIndices.insert({wasm.debugInfoSymbolNames[i], i});
+  }
+  for (Index i = 0; i < wasm.debugInfoFileNames.size(); ++i) {
+    fileIndices.insert({wasm.debugInfoFileNames[i], i});
+  }
+  auto getIndices = [](std::vector<std::string>& local,
+                       std::vector<std::string>& global,
+                       std::unordered_map<std::string, Index>& indices) {
+    std::vector<Index> mapping;
+    for (auto& name : local) {
+      auto [it, inserted] = indices.insert({name, global.size()});
+      if (inserted) {
+        global.push_back(std::move(name));
+      }
+      mapping.push_back(it->second);
+    }
+    return mapping;
+  };
+  for (Index i = 0; i < funcNames.size(); ++i) {
+    auto symbols = getIndices(
+      funcNames[i].symbols, wasm.debugInfoSymbolNames, symbolIndices);
+    auto files =
+      getIndices(funcNames[i].files, wasm.debugInfoFileNames, fileIndices);
+    if (files.empty()) {
+      // Every location names a file, so there are no locations to update.
+      continue;
+    }
+    auto update = [&](std::optional<Function::DebugLocation>& loc) {
+      if (loc) {
+        loc->fileIndex = files[loc->fileIndex];
+        if (loc->symbolNameIndex) {
+          loc->symbolNameIndex = symbols[*loc->symbolNameIndex];
+        }
+      }
+    };
+    auto* func = wasm.functions[i].get();
+    for (auto& [_, loc] : func->debugLocations) {
+      update(loc);
+    }
+    update(func->prologLocation);
+    update(func->epilogLocation);
+  }
+}
+
+} // anonymous namespace
+
 Result<> parseDefinitions(
   ParseDeclsCtx& decls,
   Lexer& input,
@@ -26,7 +115,6 @@ Result<> parseDefinitions(
   std::unordered_map<Index, HeapType>& implicitTypes,
   std::unordered_map<HeapType, std::unordered_map<Name, Index>>& typeNames) {
   // Parse definitions.
-  // TODO: Parallelize this.
   ParseDefsCtx ctx(input,
                    decls.wasm,
                    types,
@@ -40,30 +128,61 @@ Result<> parseDefinitions(
   CHECK_ERR(parseDefs(ctx, decls.elemDefs, elem));
   CHECK_ERR(parseDefs(ctx, decls.dataDefs, data));
 
-  for (Index i = 0; i < decls.funcDefs.size(); ++i) {
-    ctx.index = i;
-    auto* f = decls.wasm.functions[i].get();
-    WithPosition with(ctx, decls.funcDefs[i].pos);
-    ctx.setSrcLoc(decls.funcDefs[i].annotations);
-    ctx.in.setAnnotations(std::move(decls.funcDefs[i].annotations));
-    if (!f->imported()) {
-      CHECK_ERR(ctx.visitFunctionStart(f));
+  auto numFuncs = decls.funcDefs.size();
+  if (numFuncs > 1 && ThreadPool::get()->size() > 1) {
+    // Parse the functions in parallel. Each one gets a fresh context, so the
+    // parse does not depend on which thread handled which functions before.
+    std::vector<FuncDebugNames> debugNames(numFuncs);
+    std::vector<std::optional<Err>> errors(numFuncs);
+    std::atomic<size_t> nextFunc = 0;
+    std::vector<std::function<ThreadWorkState()>> doWorkers;
+    for (size_t i = 0; i < ThreadPool::get()->size(); ++i) {
+      doWorkers.push_back([&]() {
+        Index index = nextFunc.fetch_add(1);
+        if (index >= numFuncs) {
+          return ThreadWorkState::Finished;
+        }
+        ParseDefsCtx funcCtx(input,
+                             decls.wasm,
+                             types,
+                             implicitTypes,
+                             typeNames,
+                             decls.implicitElemIndices,
+                             typeIndices);
+        funcCtx.debugSymbolNames = &debugNames[index].symbols;
+        funcCtx.debugFileNames = &debugNames[index].files;
+        if (!decls.wasm.functions[index]->imported()) {
+          // A source location on an import that is not followed by another
+          // one is left pending by the sequential parse, and it becomes the
+          // prolog location of the next defined function. Do the same here.
+          Index first = index;
+          while (first > 0 && decls.wasm.functions[first - 1]->imported()) {
+            --first;
+          }
+          for (Index j = first; j < index; ++j) {
+            funcCtx.setSrcLoc(decls.funcDefs[j].annotations);
+          }
+        }
+        auto result = parseFuncDef(funcCtx, decls, index);
+        if (auto* err = result.getErr()) {
+          errors[index] = *err;
+        }
+        return ThreadWorkState::More;
+      });
     }
-    if (decls.funcDefs[i].kind == DefKind::ImportDesc) {
-      auto im = importdesc(ctx, Name{}, Name{}, std::nullopt);
-      assert(!im.getErr());
-      CHECK_ERR(im);
-    } else {
-      auto parsed = func(ctx);
-      assert(parsed);
-      CHECK_ERR(parsed);
-    }
-    if (!f->imported()) {
-      auto end = ctx.irBuilder.visitEnd();
-      if (auto* err = end.getErr()) {
-        return ctx.in.err(decls.funcDefs[i].pos, err->msg);
+    ThreadPool::get()->work(doWorkers);
+
+    // Report the first error in source order.
+    for (auto& err : errors) {
+      if (err) {
+        return std::move(*err);
       }
     }
+    remapDebugNames(decls.wasm, debugNames);
+  } else {
+    for (Index i = 0; i < numFuncs; ++i) {
+      CHECK_ERR(parseFuncDef(ctx, decls, i));
+    }
   }
 
   // Parse exports.
@@ -244,6 +244,18 @@ struct PassOptions {
   std::unordered_map<std::string, std::string> arguments;
   // Passes to skip and not run.
   std::unordered_set<std::string> passesToSkip;
+  // If set, the file to write a profile of the passes that are run to, in the
+  // Chrome trace event format. Only top-level pass runners are profiled.
+  std::string profilePasses;
+  // If set, a directory in which to cache the results of running stacks of
+  // function-parallel passes on functions, keyed by the contents of the
+  // functions before the passes and everything else that the passes depend
+  // on. Functions whose results are in the cache are not optimized again.
+  // Only top-level pass runners use the cache.
+  std::string functionCache;
+  // When using the function cache, run the passes even on functions whose
+  // results are in the cache, and check that the cached results match.
+  bool functionCacheVerify = false;
 
   // -Os is our default
   static constexpr const int DEFAULT_OPTIMIZE_LEVEL = 2;
@@ -382,6 +394,13 @@ struct PassRunner {
   //  3: like 1, and also dumps out byn-* files for each pass as it is run.
   static int getPassDebug();
 
+  // BINARYEN_PASS_STATS logs, for each stack of function-parallel passes that
+  // is run in parallel, how the work was balanced across the threads: the
+  // busiest and average thread time, and how many functions were stolen from
+  // other threads' queues. This is useful to measure load imbalance on large
+  // modules.
+  static bool getPassStats();
+
   // Returns whether a pass by that name will remove debug info.
   static bool passRemovesDebugInfo(const std::string& name);
 
@@ -392,6 +411,10 @@ private:
   // Whether this is a nested pass runner.
   bool isNested = false;
 
+  // Whether we are recording a profile of the passes we run (see
+  // PassOptions::profilePasses).
+  bool profiling = false;
+
   // Whether the passes we have added so far to be run (but not necessarily run
   // yet) have removed DWARF.
   bool addedPassesRemovedDWARF = false;
@@ -399,6 +422,9 @@ private:
   void runPass(Pass* pass);
   void runPassOnFunction(Pass* pass, Function* func);
 
+  // Run a stack of function-parallel passes on all the functions, in parallel.
+  void runFunctionParallelStack(const std::vector<Pass*>& stack);
+
   // After running a pass, handle any changes due to
   // how the pass is defined, such as clearing away any
   // temporary data structures that the pass declares it
@@ -23,6 +23,9 @@
 //     after the number of locals has been somewhat reduced by other passes,
 //     for example by simplify-locals (to remove unneeded uses of locals) and
 //     reorder-locals (to sort them by # of uses and remove all unneeded ones).
+//     Functions with very many locals are handled using lists of interferences
+//     instead of matrices, which is proportional to the number of
+//     interferences (see listThreshold).
 //
 
 #include <algorithm>
@@ -83,6 +86,9 @@ struct CoalesceLocals
   void pickIndicesFromOrder(std::vector<Index>& order,
                             std::vector<Index>& indices,
                             Index& removedCopies);
+  void pickIndicesFromOrderUsingLists(std::vector<Index>& order,
+                                      std::vector<Index>& indices,
+                                      Index& removedCopies);
 
   // returns a vector of oldIndex => newIndex
   virtual void pickIndices(std::vector<Index>& indices);
@@ -91,26 +97,70 @@ struct CoalesceLocals
 
   // interference state
 
+  // Functions with more locals than this keep their interferences and copies
+  // in a list per local rather than in matrices. Picking indices is then
+  // proportional to the number of interferences rather than quadratic in the
+  // number of locals, with identical results; the matrices are just faster
+  // for smaller functions. This can be set with
+  // --pass-arg=coalesce-locals-list-threshold@N
+  Index listThreshold = 1000;
+  bool useLists = false;
+
   // canonicalized - accesses should check (low, high)
   sparse_square_matrix<bool> interferences;
 
+  // When using lists: the sorted locals each local interferes with, and the
+  // other locals each local has copies with.
+  std::vector<std::vector<Index>> interferenceLists;
+  std::vector<std::vector<Index>> copyLists;
+
+  // The size of each interference list when duplicates were last removed from
+  // it. The same interference is often noted many times, so while we find them
+  // we remove duplicates whenever a list has doubled in size since then, which
+  // keeps each list within about twice its final size.
+  std::vector<Index> dedupedSizes;
+
+  void addToInterferenceList(Index i, Index j) {
+    auto& list = interferenceLists[i];
+    if (!list.empty() && list.back() == j) {
+      return;
+    }
+    list.push_back(j);
+    if (list.size() >= 2 * dedupedSizes[i] + 16) {
+      std::sort(list.begin(), list.end());
+      list.erase(std::unique(list.begin(), list.end()), list.end());
+      dedupedSizes[i] = list.size();
+    }
+  }
+
   void interfere(Index i, Index j) {
     if (i == j) {
       return;
     }
-    interferences.set(std::min(i, j), std::max(i, j), true);
+    interfereLowHigh(std::min(i, j), std::max(i, j));
   }
 
   // optimized version where you know that low < high
   void interfereLowHigh(Index low, Index high) {
     assert(low < high);
-    interferences.set(low, high, true);
+    if (useLists) {
+      addToInterferenceList(low, high);
+      addToInterferenceList(high, low);
+    } else {
+      interferences.set(low, high, true);
+    }
   }
 
   bool interferes(Index i, Index j) {
+    if (useLists) {
+      auto& list = interferenceLists[i];
+      return std::binary_search(list.begin(), list.end(), j);
+    }
     return interferences.get(std::min(i, j), std::max(i, j));
   }
 
+  void findCopyLists();
+
 private:
   // In some cases we need to refinalize at the end.
   bool refinalize = false;
@@ -118,10 +168,16 @@ private:
 
 void CoalesceLocals::doWalkFunction(Function* func) {
   Super::doWalkFunction(func);
+  listThreshold = std::stoul(getArgumentOrDefault(
+    "coalesce-locals-list-threshold", std::to_string(listThreshold)));
+  useLists = numLocals > listThreshold;
   // prioritize back edges
   increaseBackEdgePriorities();
   // use liveness to find interference
   calculateInterferences();
+  if (useLists) {
+    findCopyLists();
+  }
   // pick new indices
   std::vector<Index> indices;
   pickIndices(indices);
@@ -162,7 +218,13 @@ void CoalesceLocals::increaseBackEdgePriorities() {
 }
 
 void CoalesceLocals::calculateInterferences() {
-  interferences.recreate(numLocals);
+  if (useLists) {
+    interferenceLists.clear();
+    interferenceLists.resize(numLocals);
+    dedupedSizes.assign(numLocals, 0);
+  } else {
+    interferences.recreate(numLocals);
+  }
 
   // We will track the values in each local, using a numbering where each index
   // represents a unique different value. This array maps a local index to the
@@ -344,6 +406,39 @@ void CoalesceLocals::calculateInterferences() {
       }
     }
   }
+
+  if (useLists) {
+    // Remove the remaining duplicates.
+    dedupedSizes.clear();
+    for (auto& list : interferenceLists) {
+      std::sort(list.begin(), list.end());
+      list.erase(std::unique(list.begin(), list.end()), list.end());
+    }
+  }
+}
+
+void CoalesceLocals::findCopyLists() {
+  // Copies are noted in the walk, in the matrix |copies| which we cannot
+  // iterate on, so find them again the same way.
+  copyLists.clear();
+  copyLists.resize(numLocals);
+  for (auto& curr : basicBlocks) {
+    for (auto& action : curr->contents.actions) {
+      if (action.isSet()) {
+        auto* set = (*action.origin)->cast<LocalSet>();
+        if (auto* get = getCopy(set)) {
+          if (set->index != get->index) {
+            copyLists[set->index].push_back(get->index);
+            copyLists[get->index].push_back(set->index);
+          }
+        }
+      }
+    }
+  }
+  for (auto& list : copyLists) {
+    std::sort(list.begin(), list.end());
+    list.erase(std::unique(list.begin(), list.end()), list.end());
+  }
 }
 
 // Indices decision making
@@ -357,6 +452,10 @@ void CoalesceLocals::pickIndicesFromOrder(std::vector<Index>& order,
 void CoalesceLocals::pickIndicesFromOrder(std::vector<Index>& order,
                                           std::vector<Index>& indices,
                                           Index& removedCopies) {
+  if (useLists) {
+    pickIndicesFromOrderUsingLists(order, indices, removedCopies);
+    return;
+  }
 // mostly-simple greedy coloring
 #if CFG_DEBUG
   std::cerr << "\npickIndicesFromOrder on " << getFunction()->name << '\n';
@@ -461,6 +560,88 @@ void CoalesceLocals::pickIndicesFromOrder(std::vector<Index>& order,
   }
 }
 
+// The same greedy coloring as above, with the same results, but rather than
+// merge the interferences and copies of each local into those of the index it
+// is given, look at the indices given to the locals it interferes and has
+// copies with.
+void CoalesceLocals::pickIndicesFromOrderUsingLists(std::vector<Index>& order,
+                                                    std::vector<Index>& indices,
+                                                    Index& removedCopies) {
+  auto* func = getFunction();
+  auto numParams = func->getNumParams();
+  const Index Unassigned = -1;
+  indices.assign(numLocals, Unassigned);
+  std::vector<Type> types(numLocals);
+  // The new indices of each type, in increasing order.
+  std::unordered_map<Type, std::vector<Index>> indicesOfType;
+  // For each new index, the last iteration at which it interfered (to avoid
+  // clearing this each time), and the copies it has with the current local.
+  std::vector<Index> interferedAt(numLocals, Unassigned);
+  std::vector<uint8_t> newCopies(numLocals);
+  std::vector<Index> withCopies;
+
+  Index nextFree = 0;
+  removedCopies = 0;
+  // we can't reorder parameters, they are fixed in order, and cannot coalesce
+  Index i = 0;
+  for (; i < numParams; i++) {
+    assert(order[i] == i); // order must leave the params in place
+    indices[i] = i;
+    types[i] = func->getLocalType(i);
+    indicesOfType[types[i]].push_back(i);
+    nextFree++;
+  }
+  for (; i < numLocals; i++) {
+    Index actual = order[i];
+    auto type = func->getLocalType(actual);
+    for (auto other : interferenceLists[actual]) {
+      if (indices[other] != Unassigned) {
+        interferedAt[indices[other]] = i;
+      }
+    }
+    withCopies.clear();
+    for (auto other : copyLists[actual]) {
+      if (indices[other] != Unassigned) {
+        // Sum these like the matrix of new copies does.
+        newCopies[indices[other]] += getCopies(actual, other);
+        withCopies.push_back(indices[other]);
+      }
+    }
+    // Start from the lowest index that we can use, and then pick the one
+    // eliminating the most copies, preferring lower ones on ties.
+    Index found = Unassigned;
+    uint8_t foundCopies = 0;
+    for (auto index : indicesOfType[type]) {
+      if (interferedAt[index] != i) {
+        found = index;
+        foundCopies = newCopies[index];
+        break;
+      }
+    }
+    if (found != Unassigned) {
+      for (auto index : withCopies) {
+        if (interferedAt[index] != i && types[index] == type &&
+            (newCopies[index] > foundCopies ||
+             (newCopies[index] == foundCopies && index < found))) {
+          found = index;
+          foundCopies = newCopies[index];
+        }
+      }
+      removedCopies += foundCopies;
+    } else {
+      found = nextFree;
+      types[found] = type;
+      indicesOfType[type].push_back(found);
+      nextFree++;
+      removedCopies += getCopies(found, actual);
+    }
+    for (auto index : withCopies) {
+      newCopies[index] = 0;
+    }
+    indices[actual] = found;
+  }
+}
+
 // given a baseline order, adjust it based on an important order of priorities
 // (higher values are higher priority). The priorities take precedence, unless
 // they are equal and then the original order should be kept.
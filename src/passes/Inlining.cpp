@@ -27,8 +27,15 @@
 // or if you intend to run a full set of optimizations anyhow on
 // everything later.
 //
+// By default we inline in iterations, each of which makes local decisions
+// about individual calls. With --pass-arg=inlining-bottom-up we instead plan
+// the inlining of the whole module at once, see Inlining::runBottomUp.
+//
 
 #include <atomic>
+#include <limits>
+#include <numeric>
+#include <queue>
 
 #include "ir/branch-hints.h"
 #include "ir/branch-utils.h"
@@ -48,6 +55,7 @@
 #include "parsing.h"
 #include "pass.h"
 #include "passes/opt-utils.h"
+#include "support/strongly_connected_components.h"
 #include "wasm-builder.h"
 #include "wasm.h"
 
@@ -323,6 +331,18 @@ struct InliningState {
   std::unordered_map<Name, std::vector<InliningAction>> actionsForFunction;
 };
 
+// Whether a call is never actually performed, as it is in dead code.
+static bool isUnreachableCall(Call* curr) {
+  if (curr->isReturn) {
+    // Tail calls are only actually unreachable if an argument is
+    return std::any_of(
+      curr->operands.begin(), curr->operands.end(), [](Expression* op) {
+        return op->type == Type::unreachable;
+      });
+  }
+  return curr->type == Type::unreachable;
+}
+
 struct Planner : public WalkerPass<TryDepthWalker<Planner>> {
   bool isFunctionParallel() override { return true; }
 
@@ -338,18 +358,8 @@ struct Planner : public WalkerPass<TryDepthWalker<Planner>> {
     // plan to inline if we know this is valid to inline, and if the call is
     // actually performed - if it is dead code, it's pointless to inline.
     // we also cannot inline ourselves.
-    bool isUnreachable;
-    if (curr->isReturn) {
-      // Tail calls are only actually unreachable if an argument is
-      isUnreachable = std::any_of(
-        curr->operands.begin(), curr->operands.end(), [](Expression* op) {
-          return op->type == Type::unreachable;
-        });
-    } else {
-      isUnreachable = curr->type == Type::unreachable;
-    }
-    if (state->inlinableFunctions.contains(curr->target) && !isUnreachable &&
-        curr->target != getFunction()->name) {
+    if (state->inlinableFunctions.contains(curr->target) &&
+        !isUnreachableCall(curr) && curr->target != getFunction()->name) {
       // can't add a new element in parallel
       assert(state->actionsForFunction.contains(getFunction()->name));
       state->actionsForFunction[getFunction()->name].emplace_back(
@@ -363,6 +373,65 @@ private:
   InliningState* state;
 };
 
+// A direct call, as seen by bottom-up inlining (see BottomUpPlanner).
+struct CallSite {
+  Expression** callSite;
+  Name target;
+  bool insideATry;
+  // The number of loops the call is nested in.
+  Index loopDepth;
+  bool reachable;
+};
+
+// function name => the direct calls in it
+using CallSiteMap = std::unordered_map<Name, std::vector<CallSite>>;
+
+struct CallSiteFinder : public WalkerPass<TryDepthWalker<CallSiteFinder>> {
+  bool isFunctionParallel() override { return true; }
+
+  bool modifiesBinaryenIR() override { return false; }
+
+  CallSiteFinder(CallSiteMap& callSites) : callSites(callSites) {}
+
+  std::unique_ptr<Pass> create() override {
+    return std::make_unique<CallSiteFinder>(callSites);
+  }
+
+  Index loopDepth = 0;
+
+  static void doEnterLoop(CallSiteFinder* self, Expression** currp) {
+    self->loopDepth++;
+  }
+
+  static void doLeaveLoop(CallSiteFinder* self, Expression** currp) {
+    self->loopDepth--;
+  }
+
+  static void scan(CallSiteFinder* self, Expression** currp) {
+    bool isLoop = (*currp)->is<Loop>();
+    if (isLoop) {
+      self->pushTask(doLeaveLoop, currp);
+    }
+    TryDepthWalker<CallSiteFinder>::scan(self, currp);
+    if (isLoop) {
+      self->pushTask(doEnterLoop, currp);
+    }
+  }
+
+  void visitCall(Call* curr) {
+    // can't add a new element in parallel
+    assert(callSites.contains(getFunction()->name));
+    callSites[getFunction()->name].push_back({getCurrentPointer(),
+                                              curr->target,
+                                              tryDepth > 0,
+                                              loopDepth,
+                                              !isUnreachableCall(curr)});
+  }
+
+private:
+  CallSiteMap& callSites;
+};
+
 struct Updater : public TryDepthWalker<Updater> {
   Module* module;
   std::map<Index, Index> localMapping;
@@ -1260,6 +1329,363 @@ private:
   }
 };
 
+// Plans the inlining of the whole module at once, for bottom-up inlining (see
+// Inlining::runBottomUp). We visit the strongly connected components of the
+// call graph with callees first, and never inline a call between functions in
+// the same component, so the inlinings we plan form a DAG, and each function
+// can be inlined after everything we plan to inline into it.
+//
+// For that, we track the size each function will have after the inlinings
+// planned so far, and how many copies of its code the module will contain: one
+// for the function itself, unless we remove it, plus one for each copy of each
+// function we inline it into. That lets us estimate how much each inlining
+// grows the module, which we use to pick inlinings in order of growth per
+// estimated execution, until we reach a budget for the growth of the module.
+struct BottomUpPlanner {
+  Module* module;
+  NameInfoMap& infos;
+  PassOptions& options;
+  CallSiteMap& callSites;
+
+  BottomUpPlanner(Module* module,
+                  NameInfoMap& infos,
+                  PassOptions& options,
+                  CallSiteMap& callSites)
+    : module(module), infos(infos), options(options), callSites(callSites) {}
+
+  // The defined functions, and their indexes in that list.
+  std::vector<Function*> funcs;
+  std::unordered_map<Name, Index> indexes;
+
+  struct Node {
+    // The strongly connected component of the function.
+    Index scc = 0;
+    // The estimated size of the function after the inlinings we planned.
+    Index size = 0;
+    // How many copies of the function's code the module will contain.
+    Index copies = 1;
+    // How many references to the function we have not inlined.
+    Index remainingRefs = 0;
+    // The functions we inline into this one, and that we inline this one into,
+    // repeated if we inline more than one call.
+    std::vector<Index> inlinedCallees;
+    std::vector<Index> inlinedCallers;
+    // Zero if we inline nothing into the function, and otherwise one more
+    // than the greatest level of the functions we inline into it.
+    Index level = 0;
+    // An estimate of how often the function is called, relative to the
+    // functions that nothing calls. This can grow exponentially with the depth
+    // of the call graph, so it is capped at MaxFrequency.
+    double frequency = 1;
+  };
+  static constexpr double MaxFrequency = 1e100;
+  std::vector<Node> nodes;
+
+  // A call that we may inline.
+  struct Candidate {
+    Index caller;
+    Index callee;
+    CallSite* site;
+    bool chosen = false;
+  };
+  std::vector<Candidate> candidates;
+
+  // How much the inlinings we planned with the budget grow the module, and how
+  // much we allow them to, in expressions.
+  int64_t growth = 0;
+  int64_t budget = 0;
+
+  // The greatest level of a function (see Node::level).
+  Index numLevels = 0;
+
+  struct CallGraphSCCs : SCCs<std::vector<Index>::iterator, CallGraphSCCs> {
+    BottomUpPlanner& parent;
+
+    CallGraphSCCs(std::vector<Index>& roots, BottomUpPlanner& parent)
+      : SCCs<std::vector<Index>::iterator, CallGraphSCCs>(roots.begin(),
+                                                          roots.end()),
+        parent(parent) {}
+
+    void pushChildren(Index func) {
+      for (auto& site : parent.callSites[parent.funcs[func]->name]) {
+        if (auto iter = parent.indexes.find(site.target);
+            iter != parent.indexes.end()) {
+          push(iter->second);
+        }
+      }
+    }
+  };
+
+  void plan(Index budgetPercent) {
+    for (auto& func : module->functions) {
+      if (!func->imported()) {
+        indexes[func->name] = funcs.size();
+        funcs.push_back(func.get());
+      }
+    }
+    nodes.resize(funcs.size());
+    int64_t totalSize = 0;
+    for (Index i = 0; i < funcs.size(); i++) {
+      auto& info = infos[funcs[i]->name];
+      nodes[i].size = info.size;
+      nodes[i].remainingRefs = info.refs;
+      totalSize += info.size;
+    }
+    budget = totalSize * budgetPercent / 100;
+
+    // Find the components, in an order in which callees come first.
+    std::vector<Index> roots(funcs.size());
+    std::iota(roots.begin(), roots.end(), 0);
+    std::vector<Index> order;
+    Index numSCCs = 0;
+    CallGraphSCCs sccs(roots, *this);
+    for (auto scc : sccs) {
+      for (auto func : scc) {
+        nodes[func].scc = numSCCs;
+        order.push_back(func);
+      }
+      numSCCs++;
+    }
+
+    // Estimate how often functions are called, from how often their callers
+    // are and how many loops the calls are in, going from callers to callees.
+    // Calls from the same component (recursion) are ignored.
+    for (auto caller = order.rbegin(); caller != order.rend(); ++caller) {
+      for (auto& site : callSites[funcs[*caller]->name]) {
+        auto iter = indexes.find(site.target);
+        if (site.reachable && iter != indexes.end() &&
+            nodes[iter->second].scc != nodes[*caller].scc) {
+          auto& frequency = nodes[iter->second].frequency;
+          frequency = std::min(
+            frequency + nodes[*caller].frequency * getLoopFactor(site),
+            MaxFrequency);
+        }
+      }
+    }
+
+    for (auto caller : order) {
+      for (auto& site : callSites[funcs[caller]->name]) {
+        if (!site.reachable) {
+          continue;
+        }
+        auto iter = indexes.find(site.target);
+        if (iter == indexes.end()) {
+          continue;
+        }
+        auto callee = iter->second;
+        if (nodes[callee].scc == nodes[caller].scc) {
+          continue;
+        }
+        auto* func = funcs[callee];
+        auto& info = infos[func->name];
+        // Until we have proper support for try-delegate, ignore such functions.
+        // FIXME https://github.com/WebAssembly/binaryen/issues/3634
+        if (func->noFullInline || info.hasTryDelegate ||
+            info.toolchainInlineHint == CodeAnnotation::NeverInline) {
+          continue;
+        }
+        candidates.push_back({caller, callee, &site});
+      }
+    }
+
+    // First, inline what the normal mode always inlines. Those inlinings do
+    // not count against the budget. As the candidates are in the order of
+    // their callers, we have finished inlining into each callee by the time
+    // we look at calls to it.
+    for (auto& candidate : candidates) {
+      if (isAlwaysWorth(candidate.callee) && isUnderSizeLimit(candidate)) {
+        choose(candidate);
+      }
+    }
+
+    // Then, when optimizing for speed, inline the calls that add the least
+    // code per estimated execution first, until we run out of budget. Each
+    // inlining can change the cost of others, so we recompute the cost of a
+    // candidate when we get to it, and if it got worse, put it back in line.
+    if (options.optimizeLevel >= 3 && !options.shrinkLevel) {
+      using Entry = std::pair<double, Index>;
+      std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>>
+        queue;
+      for (Index i = 0; i < candidates.size(); i++) {
+        auto& candidate = candidates[i];
+        if (!candidate.chosen && mayInlineWithBudget(candidate.callee)) {
+          queue.push({getPriority(candidate), i});
+        }
+      }
+      while (!queue.empty()) {
+        auto [priority, i] = queue.top();
+        queue.pop();
+        auto& candidate = candidates[i];
+        if (!mayInlineWithBudget(candidate.callee) ||
+            !isUnderSizeLimit(candidate)) {
+          continue;
+        }
+        auto newPriority = getPriority(candidate);
+        if (newPriority > priority) {
+          queue.push({newPriority, i});
+          continue;
+        }
+        auto candidateGrowth = getGrowth(candidate);
+        if (candidateGrowth > 0 && growth + candidateGrowth > budget) {
+          continue;
+        }
+        growth += candidateGrowth;
+        choose(candidate);
+      }
+    }
+
+    for (auto func : order) {
+      auto& node = nodes[func];
+      for (auto callee : node.inlinedCallees) {
+        node.level = std::max(node.level, nodes[callee].level + 1);
+      }
+      numLevels = std::max(numLevels, node.level);
+    }
+  }
+
+  // Whether we inline calls to a function regardless of the budget, like the
+  // normal mode does (see FunctionInfo::worthFullInlining), given its size
+  // after the inlinings we planned into it.
+  bool isAlwaysWorth(Index callee) {
+    auto& info = infos[funcs[callee]->name];
+    auto size = nodes[callee].size;
+    if (info.toolchainInlineHint == CodeAnnotation::AlwaysInline ||
+        size <= options.inlining.alwaysInlineMaxSize) {
+      return true;
+    }
+    if (info.refs == 1 && !info.usedGlobally &&
+        size <= options.inlining.oneCallerInlineMaxSize) {
+      return true;
+    }
+    // A trivial instruction stops being one if we inline into it.
+    return info.trivialInstruction == TrivialInstruction::Shrinks &&
+           size == info.size;
+  }
+
+  bool mayInlineWithBudget(Index callee) {
+    auto& info = infos[funcs[callee]->name];
+    return nodes[callee].size <= options.inlining.flexibleInlineMaxSize &&
+           (!info.hasLoops || options.inlining.allowFunctionsWithLoops);
+  }
+
+  // See Inlining::isUnderSizeLimit.
+  bool isUnderSizeLimit(const Candidate& candidate) {
+    auto combinedSize =
+      nodes[candidate.caller].size + nodes[candidate.callee].size;
+    auto estimatedBinarySize = Measurer::BytesPerExpr * combinedSize;
+    return estimatedBinarySize < options.inlining.maxCombinedBinarySize;
+  }
+
+  // How much inlining a call would grow the module: the callee replaces the
+  // call in each copy of the caller, and if this is the last reference to the
+  // callee, the callee itself goes away.
+  int64_t getGrowth(const Candidate& candidate) {
+    auto& callee = nodes[candidate.callee];
+    int64_t calleeSize = callee.size;
+    auto growth = nodes[candidate.caller].copies * (calleeSize - 1);
+    if (callee.remainingRefs == 1 &&
+        !infos[funcs[candidate.callee]->name].usedGlobally) {
+      growth -= calleeSize;
+    }
+    return growth;
+  }
+
+  // Each loop a call is in multiplies our estimate of how often it executes,
+  // up to a limit.
+  static double getLoopFactor(const CallSite& site) {
+    return 1 << (3 * std::min(site.loopDepth, Index(3)));
+  }
+
+  // Lower is better.
+  double getPriority(const Candidate& candidate) {
+    auto frequency =
+      nodes[candidate.caller].frequency * getLoopFactor(*candidate.site);
+    return getGrowth(candidate) / frequency;
+  }
+
+  void choose(Candidate& candidate) {
+#if INLINING_DEBUG
+    std::cout << "bottom-up: inline " << funcs[candidate.callee]->name
+              << " into " << funcs[candidate.caller]->name << '\n';
+#endif
+    candidate.chosen = true;
+    auto& caller = nodes[candidate.caller];
+    auto& callee = nodes[candidate.callee];
+    // The caller grows, and so does everything we inline it into.
+    Index sizeChange = callee.size - 1;
+    forEachContaining(candidate.caller, [&](Node& node, uint64_t count) {
+      addSaturating(node.size, sizeChange * count);
+    });
+    // The callee, and everything we inline into it, is copied into each copy
+    // of the caller.
+    Index copiesChange = caller.copies;
+    forEachContained(candidate.callee, [&](Node& node, uint64_t count) {
+      addSaturating(node.copies, copiesChange * count);
+    });
+    caller.inlinedCallees.push_back(candidate.callee);
+    callee.inlinedCallers.push_back(candidate.caller);
+    if (--callee.remainingRefs == 0 &&
+        !infos[funcs[candidate.callee]->name].usedGlobally) {
+      // We will remove the callee.
+      forEachContained(candidate.callee, [&](Node& node, uint64_t count) {
+        node.copies -= std::min(uint64_t(node.copies), count);
+      });
+    }
+  }
+
+  // Our estimates are only estimates, so rather than overflow, they stop at
+  // the largest value they can hold.
+  static void addSaturating(Index& value, uint64_t change) {
+    value = std::min(uint64_t(value) + change, uint64_t(MaxIndex));
+  }
+  static constexpr Index MaxIndex = std::numeric_limits<Index>::max();
+
+  // Calls a function on a node and on each node whose code contains a copy of
+  // it (or that its code contains a copy of), with the number of copies.
+  template<typename T> void forEachContaining(Index func, T visit) {
+    forEachReachable(func, &Node::inlinedCallers, visit);
+  }
+  template<typename T> void forEachContained(Index func, T visit) {
+    forEachReachable(func, &Node::inlinedCallees, visit);
+  }
+  template<typename T>
+  void forEachReachable(Index func, std::vector<Index> Node::*edges, T visit) {
+    // The number of copies of a node is the number of paths to it, which can
+    // be exponential in the number of nodes, so rather than walk each path we
+    // add up the copies of each node from those of its predecessors, visiting
+    // the nodes in topological order (we never inline within a component, so
+    // there are no cycles). First, find how many edges lead to each node.
+    std::unordered_map<Index, Index> numPreds{{func, 0}};
+    std::vector<Index> work = {func};
+    while (!work.empty()) {
+      auto curr = work.back();
+      work.pop_back();
+      for (auto next : nodes[curr].*edges) {
+        auto [iter, inserted] = numPreds.insert({next, 0});
+        iter->second++;
+        if (inserted) {
+          work.push_back(next);
+        }
+      }
+    }
+    std::unordered_map<Index, uint64_t> counts{{func, 1}};
+    work = {func};
+    while (!work.empty()) {
+      auto curr = work.back();
+      work.pop_back();
+      auto count = counts[curr];
+      visit(nodes[curr], count);
+      for (auto next : nodes[curr].*edges) {
+        auto& nextCount = counts[next];
+        nextCount = std::min(nextCount + count, uint64_t(MaxIndex));
+        if (--numPreds[next] == 0) {
+          work.push_back(next);
+        }
+      }
+    }
+  }
+};
+
 struct Inlining : public Pass {
   // This pass changes locals and parameters.
   // FIXME DWARF updating does not handle local changes yet.
@@ -1281,6 +1707,11 @@ struct Inlining : public Pass {
   void run(Module* module_) override {
     module = module_;
 
+    if (hasArgument("inlining-bottom-up")) {
+      runBottomUp();
+      return;
+    }
+
     // No point to do more iterations than the number of functions, as it means
     // we are infinitely recursing (which should be very rare in practice, but
     // it is possible that a recursive call can look like it is worth inlining).
@@ -1467,19 +1898,7 @@ struct Inlining : public Pass {
       return;
     }
 
-    // Perform the inlinings in parallel (sequentially inside each function we
-    // inline into, but in parallel between them). If we are optimizing, do so
-    // as well.
-    {
-      PassUtils::FilteredPassRunner runner(
-        module, inlinedInto, getPassRunner()->options);
-      runner.setIsNested(true);
-      runner.add(std::make_unique<DoInlining>(chosenActions));
-      if (optimize) {
-        OptUtils::addUsefulPassesAfterInlining(runner);
-      }
-      runner.run();
-    }
+    performInlinings(chosenActions, inlinedInto);
 
     // remove functions that we no longer need after inlining
     module->removeFunctions([&](Function* func) {
@@ -1490,6 +1909,85 @@ struct Inlining : public Pass {
     });
   }
 
+  // Perform the inlinings in parallel (sequentially inside each function we
+  // inline into, but in parallel between them). If we are optimizing, do so
+  // as well.
+  void performInlinings(const ChosenActions& chosenActions,
+                        const std::unordered_set<Function*>& inlinedInto) {
+    PassUtils::FilteredPassRunner runner(
+      module, inlinedInto, getPassRunner()->options);
+    runner.setIsNested(true);
+    runner.add(std::make_unique<DoInlining>(chosenActions));
+    if (optimize) {
+      OptUtils::addUsefulPassesAfterInlining(runner);
+    }
+    runner.run();
+  }
+
+  // Bottom-up inlining. Rather than repeat iterations of local decisions, find
+  // the call graph once and plan all the inlining on it (see BottomUpPlanner).
+  // Then inline level by level, starting from the functions into which we only
+  // inline functions that we do not inline anything into. That way the code we
+  // copy into a caller is the final code of the callee, after its own inlining
+  // and, if we optimize, after optimizing it.
+  //
+  // We inline what the normal mode would always inline (small functions,
+  // functions with a single caller, etc.), and when optimizing for speed, also
+  // other calls of functions under the flexible size limit, prioritized by how
+  // much they grow the module per estimated execution (calls in loops are
+  // assumed to run more), until the module has grown by a budget, which is a
+  // percentage of its original size, set with
+  // --pass-arg=inlining-growth-budget@PERCENT (the default is 20).
+  //
+  // We do not inline calls between functions in the same strongly connected
+  // component of the call graph, nor inline parts of functions.
+  void runBottomUp() {
+    prepare();
+    functionSplitter.reset();
+
+    CallSiteMap callSites;
+    for (auto& func : module->functions) {
+      callSites.try_emplace(func->name);
+    }
+    CallSiteFinder(callSites).run(getPassRunner(), module);
+
+    BottomUpPlanner planner(module, infos, getPassOptions(), callSites);
+    planner.plan(
+      std::stoul(getArgumentOrDefault("inlining-growth-budget", "20")));
+
+    std::vector<ChosenActions> levels(planner.numLevels);
+    for (auto& candidate : planner.candidates) {
+      if (candidate.chosen) {
+        auto* func = planner.funcs[candidate.caller];
+        auto level = planner.nodes[candidate.caller].level;
+        levels[level - 1][func->name].emplace_back(
+          candidate.site->callSite,
+          planner.funcs[candidate.callee],
+          candidate.site->insideATry,
+          inlinedNameHint++);
+      }
+    }
+    for (auto& chosenActions : levels) {
+      std::unordered_set<Function*> inlinedInto;
+      for (auto& [name, _] : chosenActions) {
+        inlinedInto.insert(module->getFunction(name));
+      }
+      performInlinings(chosenActions, inlinedInto);
+      for (auto* func : inlinedInto) {
+        EHUtils::handleBlockNestedPops(func, *module);
+      }
+    }
+
+    // remove functions that we no longer need after inlining
+    module->removeFunctions([&](Function* func) {
+      auto& info = infos[func->name];
+      if (func->imported() || !info.refs || info.usedGlobally) {
+        return false;
+      }
+      return planner.nodes[planner.indexes[func->name]].remainingRefs == 0;
+    });
+  }
+
   // See explanation in InliningAction.
   Index inlinedNameHint = 0;
 
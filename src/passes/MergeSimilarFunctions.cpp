@@ -74,6 +74,10 @@
 // [location of (i32.const 42)] }` is derived. Then, clone `$big-const-42`
 // replacing uses of params with local.get, and create thunks for $big-const-42
 // and $big-const-43.
+//
+// With --pass-arg=merge-similar-functions-stats, the pass prints each class it
+// merges, with the size of the code of its functions in the binary before and
+// after merging them.
 
 #include "ir/hashed.h"
 #include "ir/manipulation.h"
@@ -84,6 +88,7 @@
 #include "pass.h"
 #include "support/hash.h"
 #include "support/utilities.h"
+#include "wasm-binary.h"
 #include "wasm-limits.h"
 #include "wasm.h"
 #include <algorithm>
@@ -93,6 +98,7 @@
 #include <map>
 #include <memory>
 #include <ostream>
+#include <unordered_map>
 #include <variant>
 #include <vector>
 
@@ -152,8 +158,8 @@ struct EquivalentClass {
 
   bool isEligibleToMerge() { return this->functions.size() >= 2; }
 
-  // Merge the functions in this class.
-  void merge(Module* module, const std::vector<ParamInfo>& params);
+  // Merge the functions in this class, returning the shared function.
+  Function* merge(Module* module, const std::vector<ParamInfo>& params);
 
   bool hasMergeBenefit(Module* module, const std::vector<ParamInfo>& params);
 
@@ -181,6 +187,15 @@ struct MergeSimilarFunctions : public Pass {
       classes.begin(), classes.end(), [](const auto& left, const auto& right) {
         return left.primaryFunction->name < right.primaryFunction->name;
       });
+
+    bool stats = hasArgument("merge-similar-functions-stats");
+    std::unordered_map<Name, size_t> sizesBefore;
+    // The classes we merged, with the shared functions we created for them.
+    std::vector<std::pair<EquivalentClass*, Name>> merged;
+    if (stats) {
+      sizesBefore = getCodeSizes(module);
+    }
+
     for (auto& clazz : classes) {
       if (!clazz.isEligibleToMerge()) {
         continue;
@@ -196,8 +211,52 @@ struct MergeSimilarFunctions : public Pass {
         continue;
       }
 
-      clazz.merge(module, params);
+      auto* shared = clazz.merge(module, params);
+      if (stats) {
+        merged.push_back({&clazz, shared->name});
+      }
     }
+
+    if (stats) {
+      reportStats(module, merged, sizesBefore);
+    }
+  }
+
+  // Returns the size of the code of each defined function in the binary.
+  std::unordered_map<Name, size_t> getCodeSizes(Module* module) {
+    BufferWithRandomAccess buffer;
+    WasmBinaryWriter writer(module, buffer, getPassOptions());
+    writer.write();
+    std::unordered_map<Name, size_t> sizes;
+    Index binaryIndex = 0;
+    ModuleUtils::iterDefinedFunctions(*module, [&](Function* func) {
+      sizes[func->name] =
+        writer.tableOfContents.functionBodies[binaryIndex++].size;
+    });
+    return sizes;
+  }
+
+  void
+  reportStats(Module* module,
+              const std::vector<std::pair<EquivalentClass*, Name>>& merged,
+              const std::unordered_map<Name, size_t>& sizesBefore) {
+    auto sizesAfter = getCodeSizes(module);
+    int64_t totalSaved = 0;
+    for (auto& [clazz, shared] : merged) {
+      size_t before = 0;
+      size_t after = sizesAfter.at(shared);
+      for (auto* func : clazz->functions) {
+        before += sizesBefore.at(func->name);
+        after += sizesAfter.at(func->name);
+      }
+      int64_t saved = int64_t(before) - int64_t(after);
+      totalSaved += saved;
+      std::cout << "merged " << clazz->functions.size() << " functions into "
+                << shared << ": " << before << " -> " << after << " bytes ("
+                << saved << " saved)\n";
+    }
+    std::cout << "merged " << merged.size() << " classes: " << totalSaved
+              << " bytes saved\n";
   }
 
   // Parameterize direct calls if the module supports func ref values.
@@ -290,13 +349,17 @@ void MergeSimilarFunctions::collectEquivalentClasses(
       if (expr->is<Const>()) {
         return true;
       }
-      // Ignore callee operands.
-      if (auto* call = expr->dynCast<Call>()) {
+      // Ignore callee operands, but not the type of the callee, which must
+      // match. Without call indirection, callees must be the same, which the
+      // default hashing handles.
+      auto* call = expr->dynCast<Call>();
+      if (call && isCallIndirectionEnabled(module)) {
         for (auto operand : call->operands) {
           rehash(digest,
                  ExpressionAnalyzer::flexibleHash(operand, ignoringConsts));
         }
         rehash(digest, call->isReturn);
+        rehash(digest, module->getFunction(call->target)->type);
         return true;
       }
       return false;
@@ -308,6 +371,26 @@ void MergeSimilarFunctions::collectEquivalentClasses(
   ModuleUtils::iterDefinedFunctions(
     *module, [&](Function* func) { hashGroups[hashes[func]].push_back(func); });
 
+  // The hash covers everything that areInEquvalentClass compares, so apart
+  // from collisions, each group is a single class, and being in a class is
+  // transitive. Compare each function with the first of its group, which
+  // takes a linear number of comparisons however large the group is, and do
+  // it in parallel, as large template-heavy modules can have groups of
+  // thousands of functions. Only the functions that are not equivalent to the
+  // first need to be compared with more functions.
+  std::unordered_map<Function*, Function*> firstInGroup;
+  for (auto& [_, hashGroup] : hashGroups) {
+    for (Index i = 1; i < hashGroup.size(); i++) {
+      firstInGroup[hashGroup[i]] = hashGroup[0];
+    }
+  }
+  ModuleUtils::ParallelFunctionAnalysis<bool> equivalentToFirst(
+    *module, [&](Function* func, bool& equivalent) {
+      if (auto it = firstInGroup.find(func); it != firstInGroup.end()) {
+        equivalent = areInEquvalentClass(it->second, func, module);
+      }
+    });
+
   for (auto& [_, hashGroup] : hashGroups) {
     if (hashGroup.size() < 2) {
       continue;
@@ -319,8 +402,13 @@ void MergeSimilarFunctions::collectEquivalentClasses(
 
     for (Index i = 1; i < hashGroup.size(); i++) {
       auto* func = hashGroup[i];
+      if (equivalentToFirst.map[func]) {
+        classesInGroup[0].functions.push_back(func);
+        continue;
+      }
       bool found = false;
-      for (auto& newClass : classesInGroup) {
+      for (Index j = 1; j < classesInGroup.size(); j++) {
+        auto& newClass = classesInGroup[j];
         if (areInEquvalentClass(newClass.primaryFunction, func, module)) {
           newClass.functions.push_back(func);
           found = true;
@@ -469,8 +557,8 @@ bool EquivalentClass::deriveParams(Module* module,
   return true;
 }
 
-void EquivalentClass::merge(Module* module,
-                            const std::vector<ParamInfo>& params) {
+Function* EquivalentClass::merge(Module* module,
+                                 const std::vector<ParamInfo>& params) {
   Function* sharedFn = createShared(module, params);
   for (size_t i = 0; i < functions.size(); ++i) {
     Builder builder(*module);
@@ -486,7 +574,7 @@ void EquivalentClass::merge(Module* module,
                      extraArgs,
                      module->features.hasTailCall());
   }
-  return;
+  return sharedFn;
 }
 
 // Determine if it's beneficial to merge the functions in the class
@@ -14,12 +14,15 @@
  * limitations under the License.
  */
 
+#include <map>
+
 #include "ir/names.h"
 #include "ir/stack-utils.h"
 #include "ir/utils.h"
 #include "pass.h"
 #include "passes/stringify-walker.h"
 #include "support/intervals.h"
+#include "support/suffix_array.h"
 #include "support/suffix_tree.h"
 #include "wasm-ir-builder.h"
 #include "wasm.h"
@@ -155,7 +158,8 @@ using Substrings = std::vector<SuffixTree::RepeatedSubstring>;
 
 // Functions that filter vectors of SuffixTree::RepeatedSubstring
 struct StringifyProcessor {
-  static Substrings repeatSubstrings(std::vector<uint32_t>& hashString);
+  static Substrings repeatSubstrings(std::vector<uint32_t>& hashString,
+                                     bool useSuffixTree = false);
   static Substrings dedupe(const Substrings& substrings);
   static Substrings filterOverlaps(const Substrings& substrings);
   // Filter is the general purpose function backing subsequent filter functions.
@@ -170,12 +174,29 @@ struct StringifyProcessor {
                                     const std::vector<Expression*>& exprs);
   static Substrings filterBranches(const Substrings& substrings,
                                    const std::vector<Expression*>& exprs);
+  // An alternative to repeatSubstrings and all of the above that selects the
+  // substrings to outline greedily by how much they save.
+  static Substrings selectByBenefit(const std::vector<uint32_t>& hashString,
+                                    const std::vector<Expression*>& exprs);
 };
 
 std::vector<SuffixTree::RepeatedSubstring>
-StringifyProcessor::repeatSubstrings(std::vector<uint32_t>& hashString) {
-  SuffixTree st(hashString);
-  std::vector<SuffixTree::RepeatedSubstring> substrings(st.begin(), st.end());
+StringifyProcessor::repeatSubstrings(std::vector<uint32_t>& hashString,
+                                     bool useSuffixTree) {
+  std::vector<SuffixTree::RepeatedSubstring> substrings;
+  if (useSuffixTree) {
+    SuffixTree st(hashString);
+    substrings.assign(st.begin(), st.end());
+  } else {
+    // The suffix array finds the same substrings as the suffix tree, with a
+    // fraction of the memory. Like the suffix tree, it needs the string to end
+    // with a unique symbol, which it does: the separator at the end of the last
+    // function.
+    SuffixArray sa(hashString);
+    sa.forEachRepeatWithDirectLeaves(2, [&](uint32_t length, auto starts) {
+      substrings.push_back({length, {starts.begin(), starts.end()}});
+    });
+  }
   for (auto& substring : substrings) {
     // Sort by increasing start index to ensure determinism.
     std::sort(substring.StartIndices.begin(), substring.StartIndices.end());
@@ -278,33 +299,34 @@ std::vector<SuffixTree::RepeatedSubstring> StringifyProcessor::filterOverlaps(
   return result;
 }
 
-std::vector<SuffixTree::RepeatedSubstring> StringifyProcessor::filter(
-  const std::vector<SuffixTree::RepeatedSubstring>& substrings,
-  const std::vector<Expression*>& exprs,
-  std::function<bool(const Expression*)> condition) {
+// Finds whether a control flow structure contains an expression that satisfies
+// a condition.
+struct FilterStringifyWalker : public StringifyWalker<FilterStringifyWalker> {
+  bool hasFilterValue = false;
+  std::function<bool(const Expression*)> condition;
 
-  struct FilterStringifyWalker : public StringifyWalker<FilterStringifyWalker> {
-    bool hasFilterValue = false;
-    std::function<bool(const Expression*)> condition;
-
-    FilterStringifyWalker(std::function<bool(const Expression*)> condition)
-      : condition(condition) {};
+  FilterStringifyWalker(std::function<bool(const Expression*)> condition)
+    : condition(condition) {};
 
-    void walk(Expression* curr) {
-      hasFilterValue = false;
-      Super::walk(curr);
-      flushControlFlowQueue();
-    }
+  void walk(Expression* curr) {
+    hasFilterValue = false;
+    Super::walk(curr);
+    flushControlFlowQueue();
+  }
 
-    void addUniqueSymbol(SeparatorReason reason) {}
+  void addUniqueSymbol(SeparatorReason reason) {}
 
-    void visitExpression(Expression* curr) {
-      if (condition(curr)) {
-        hasFilterValue = true;
-      }
+  void visitExpression(Expression* curr) {
+    if (condition(curr)) {
+      hasFilterValue = true;
     }
-  };
+  }
+};
 
+std::vector<SuffixTree::RepeatedSubstring> StringifyProcessor::filter(
+  const std::vector<SuffixTree::RepeatedSubstring>& substrings,
+  const std::vector<Expression*>& exprs,
+  std::function<bool(const Expression*)> condition) {
   FilterStringifyWalker walker(condition);
 
   std::vector<SuffixTree::RepeatedSubstring> result;
@@ -363,6 +385,179 @@ std::vector<SuffixTree::RepeatedSubstring> StringifyProcessor::filterBranches(
     });
 }
 
+// Rather than collecting all of the repeated substrings and then filtering
+// them in several passes, stream them out of a suffix array, keeping only the
+// ones that would save code size, as ranges of the suffix array, and then pick
+// from those greedily, starting with the one that would save the most. This
+// bounds memory by a few integers per symbol of the string, however many
+// repeats there are.
+//
+// The substrings are the LCP intervals of the suffix array, with all their
+// occurrences, so a substring that repeats more often inside of a longer one is
+// not lost as it is in dedupe. Outlining a substring of L instructions that
+// occurs N times replaces N * L instructions with N calls and adds a function
+// of L instructions, so it saves (N - 1) * L - N instructions.
+//
+// Substrings are cut short at the first instruction that the filters above
+// would remove them for: a branch, return, try_table, local.set or local.get,
+// or a control flow structure containing one.
+std::vector<SuffixTree::RepeatedSubstring>
+StringifyProcessor::selectByBenefit(const std::vector<uint32_t>& hashString,
+                                    const std::vector<Expression*>& exprs) {
+  auto getBenefit = [](int64_t length, int64_t count) {
+    return (count - 1) * length - count;
+  };
+
+  auto condition = [](const Expression* curr) {
+    return Properties::isBranch(curr) || curr->is<Return>() ||
+           curr->is<TryTable>() || curr->is<LocalSet>() || curr->is<LocalGet>();
+  };
+  FilterStringifyWalker walker(condition);
+  // Find the first position at or after each one that cannot be outlined.
+  // Control flow structures with equal symbols have equal contents, except
+  // that the condition of an if is not part of its symbol, so most only need
+  // to be walked once.
+  uint32_t size = hashString.size();
+  std::vector<uint32_t> nextFiltered(size + 1, size);
+  std::unordered_map<uint32_t, bool> structureFiltered;
+  for (uint32_t i = size; i-- > 0;) {
+    bool filtered = false;
+    if (auto* curr = exprs[i]) {
+      filtered = condition(curr);
+      if (!filtered && Properties::isControlFlowStructure(curr)) {
+        if (curr->is<If>()) {
+          walker.walk(curr);
+          filtered = walker.hasFilterValue;
+        } else {
+          auto [it, inserted] =
+            structureFiltered.insert({hashString[i], false});
+          if (inserted) {
+            walker.walk(curr);
+            it->second = walker.hasFilterValue;
+          }
+          filtered = it->second;
+        }
+      }
+    }
+    nextFiltered[i] = filtered ? i : nextFiltered[i + 1];
+  }
+  structureFiltered.clear();
+
+  // The candidates, as ranges of the suffix array.
+  struct Candidate {
+    uint32_t length;
+    uint32_t begin;
+    uint32_t count;
+    int64_t benefit;
+  };
+  std::vector<Candidate> candidates;
+  SuffixArray sa(hashString);
+  auto& suffixes = sa.getSuffixes();
+  sa.forEachRepeat(2, [&](uint32_t length, auto starts) {
+    // All of the occurrences are equal, so check any one of them.
+    auto start = starts[0];
+    length = std::min(length, nextFiltered[start] - start);
+    if (length < 2) {
+      return;
+    }
+    auto benefit = getBenefit(length, starts.size());
+    if (benefit > 0) {
+      candidates.push_back({length,
+                            uint32_t(starts.data() - suffixes.data()),
+                            uint32_t(starts.size()),
+                            benefit});
+    }
+  });
+  nextFiltered.clear();
+  nextFiltered.shrink_to_fit();
+
+  // Order the candidates by benefit, then length, and then arbitrarily but
+  // deterministically.
+  std::sort(candidates.begin(),
+            candidates.end(),
+            [](const Candidate& a, const Candidate& b) {
+              if (a.benefit != b.benefit) {
+                return a.benefit > b.benefit;
+              }
+              if (a.length != b.length) {
+                return a.length > b.length;
+              }
+              return a.begin < b.begin;
+            });
+
+  // Take each candidate in turn, with those of its occurrences that do not
+  // overlap anything taken before it, or each other, as long as that still
+  // saves something. What was taken is kept as a map from the start of each
+  // taken occurrence to its end, so checking an occurrence takes a lookup
+  // rather than a scan of its positions, and a candidate that cannot fit
+  // enough occurrences into the positions that are left, like most of those
+  // nested in what was taken on a long run of equal instructions, is skipped
+  // without looking at them at all.
+  std::vector<SuffixTree::RepeatedSubstring> result;
+  std::map<unsigned, unsigned> claimed;
+  unsigned numFree = size;
+  auto isFree = [&](unsigned start, unsigned length) {
+    auto next = claimed.upper_bound(start);
+    if (next != claimed.end() && next->first < start + length) {
+      return false;
+    }
+    return next == claimed.begin() || std::prev(next)->second <= start;
+  };
+  std::vector<unsigned> starts;
+  for (auto& candidate : candidates) {
+    auto length = candidate.length;
+    if (getBenefit(length, std::min(candidate.count, numFree / length)) <= 0) {
+      continue;
+    }
+    // Most candidates overlap too much of what was taken before them, so rule
+    // them out before doing anything more expensive.
+    starts.clear();
+    for (auto j = candidate.begin; j < candidate.begin + candidate.count; ++j) {
+      if (isFree(suffixes[j], length)) {
+        starts.push_back(suffixes[j]);
+      }
+    }
+    if (getBenefit(length, starts.size()) <= 0) {
+      continue;
+    }
+    std::sort(starts.begin(), starts.end());
+    std::vector<unsigned> kept;
+    for (auto start : starts) {
+      if (kept.empty() || start >= kept.back() + length) {
+        kept.push_back(start);
+      }
+    }
+    if (getBenefit(length, kept.size()) <= 0) {
+      continue;
+    }
+    // Expressions with equal symbols can still have different types when
+    // their children do, like drops of different values. Keep the occurrences
+    // that have the same signature as the first, so that they can all call the
+    // same function.
+    auto getSignature = [&](unsigned start) {
+      StackSignature sig;
+      for (auto i = start; i < start + length; ++i) {
+        sig += StackSignature(exprs[i]);
+      }
+      return sig;
+    };
+    auto first = kept[0];
+    auto sig = getSignature(first);
+    std::erase_if(kept, [&](unsigned start) {
+      return start != first && !(getSignature(start) == sig);
+    });
+    if (getBenefit(length, kept.size()) <= 0) {
+      continue;
+    }
+    for (auto start : kept) {
+      claimed.emplace(start, start + length);
+    }
+    numFree -= kept.size() * length;
+    result.push_back({length, std::move(kept)});
+  }
+  return result;
+}
+
 struct OutliningSequence {
   unsigned startIdx;
   unsigned endIdx;
@@ -667,29 +862,35 @@ struct Outlining : public Pass {
     // Walk the module and create a "string representation" of the program.
     stringify.walkModule(module);
     ODBG(printHashString(stringify.hashString, stringify.exprs));
-    // Collect all of the substrings of the string representation that appear
-    // more than once in the program.
-    auto substrings =
-      StringifyProcessor::repeatSubstrings(stringify.hashString);
-    // Remove substrings that are substrings of longer repeat substrings.
-    substrings = StringifyProcessor::dedupe(substrings);
-    // Remove substrings with overlapping indices.
-    substrings = StringifyProcessor::filterOverlaps(substrings);
-    // Remove substrings with branch, return, and try_table instructions until
-    // an analysis is performed to see if the intended destination of the branch
-    // is included in the substring to be outlined.
-    substrings =
-      StringifyProcessor::filterBranches(substrings, stringify.exprs);
-    // Remove substrings with local.set instructions until Outlining is extended
-    // to support arranging for the written values to be returned from the
-    // outlined function and written back to the original locals.
-    substrings =
-      StringifyProcessor::filterLocalSets(substrings, stringify.exprs);
-    // Remove substrings with local.get instructions until Outlining is extended
-    // to support passing the local values as additional arguments to the
-    // outlined function.
-    substrings =
-      StringifyProcessor::filterLocalGets(substrings, stringify.exprs);
+    Substrings substrings;
+    if (hasArgument("outlining-select-by-benefit")) {
+      substrings = StringifyProcessor::selectByBenefit(stringify.hashString,
+                                                       stringify.exprs);
+    } else {
+      // Collect all of the substrings of the string representation that appear
+      // more than once in the program.
+      substrings = StringifyProcessor::repeatSubstrings(
+        stringify.hashString, hasArgument("outlining-suffix-tree"));
+      // Remove substrings that are substrings of longer repeat substrings.
+      substrings = StringifyProcessor::dedupe(substrings);
+      // Remove substrings with overlapping indices.
+      substrings = StringifyProcessor::filterOverlaps(substrings);
+      // Remove substrings with branch, return, and try_table instructions
+      // until an analysis is performed to see if the intended destination of
+      // the branch is included in the substring to be outlined.
+      substrings =
+        StringifyProcessor::filterBranches(substrings, stringify.exprs);
+      // Remove substrings with local.set instructions until Outlining is
+      // extended to support arranging for the written values to be returned
+      // from the outlined function and written back to the original locals.
+      substrings =
+        StringifyProcessor::filterLocalSets(substrings, stringify.exprs);
+      // Remove substrings with local.get instructions until Outlining is
+      // extended to support passing the local values as additional arguments to
+      // the outlined function.
+      substrings =
+        StringifyProcessor::filterLocalGets(substrings, stringify.exprs);
+    }
     // Convert substrings to sequences that are more easily outlineable as we
     // walk the functions in a module. Sequences contain indices that
     // are relative to the enclosing function while substrings have indices
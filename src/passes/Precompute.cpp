@@ -47,6 +47,19 @@ namespace wasm {
 // majority of gets).
 using GetValues = std::unordered_map<LocalGet*, Literals>;
 
+// A map of expressions that we found cannot be precomputed. This lets us stop
+// as soon as we reach them when evaluating their parents, which would otherwise
+// evaluate them again, as well as in later walks. If an expression did not read
+// any local or global whose value depends on the code evaluated before it (that
+// is, any get that is not in GetValues, or any mutable global), it is not
+// constant wherever it is, and it maps to AnyContext. Otherwise, it is known
+// not to be constant only when evaluated before any sets, and only while the
+// gets it reads are not in GetValues, and it maps to the size of GetValues
+// when we found it (which only grows).
+using Nonconstants = std::unordered_map<Expression*, size_t>;
+
+static constexpr size_t AnyContext = -1;
+
 // A map of values on the heap. This maps the expressions that create the
 // heap data (struct.new, array.new, etc.) to the data they are created with.
 // Each such expression gets its own GCData created for it. This allows
@@ -102,6 +115,19 @@ class PrecomputingExpressionRunner
 
   HeapValues& heapValues;
 
+  // Expressions that are known not to be constant, or null if we should not
+  // use or add to them.
+  Nonconstants* nonconstants;
+
+  // The number of reads of locals and globals whose values depend on the code
+  // evaluated before them (see Nonconstants).
+  Index contextReads = 0;
+
+  // Whether we hit a host limit, such as the expression being too deep. An
+  // expression that is too deep might not be after we precompute parts of it,
+  // so this does not tell us that it is not constant in general.
+  bool hitHostLimit = false;
+
   // Limit evaluation depth for 2 reasons: first, it is highly unlikely
   // that we can do anything useful to precompute a hugely nested expression
   // (we should succeed at smaller parts of it first). Second, a low limit is
@@ -114,10 +140,19 @@ class PrecomputingExpressionRunner
   // more than one iteration before becoming concrete.
   static const Index MAX_LOOP_ITERATIONS = 1;
 
+  // For each depth, the number of context reads and whether we had evaluated
+  // any sets when we began to evaluate the expression at that depth.
+  struct EntryState {
+    Index contextReads;
+    bool hadSets;
+  };
+  std::array<EntryState, MAX_DEPTH + 1> entryStates;
+
 public:
   PrecomputingExpressionRunner(Module* module,
                                const GetValues& getValues,
                                HeapValues& heapValues,
+                               Nonconstants* nonconstants,
                                bool replaceExpression)
     : ConstantExpressionRunner<PrecomputingExpressionRunner>(
         module,
@@ -125,7 +160,48 @@ public:
                           : FlagValues::DEFAULT,
         MAX_DEPTH,
         MAX_LOOP_ITERATIONS),
-      getValues(getValues), heapValues(heapValues) {}
+      getValues(getValues), heapValues(heapValues),
+      nonconstants(nonconstants) {}
+
+  bool getKnownBreak(Expression* curr, Flow& flow) {
+    // We are about to evaluate |curr| at depth + 1.
+    entryStates[depth] = {contextReads, hasEffectfulSets()};
+    if (!nonconstants) {
+      return false;
+    }
+    auto iter = nonconstants->find(curr);
+    if (iter == nonconstants->end()) {
+      return false;
+    }
+    if (iter->second != AnyContext) {
+      if (iter->second != getValues.size() || hasEffectfulSets()) {
+        return false;
+      }
+      // This depends on the reads in |curr|, as would the expressions we are
+      // inside of had we evaluated it.
+      contextReads++;
+    }
+    flow = Flow(NONCONSTANT_FLOW);
+    return true;
+  }
+
+  void noteBreak(Expression* curr, const Flow& flow) {
+    auto& entry = entryStates[depth - 1];
+    noteNonconstant(curr, flow, entry.contextReads, entry.hadSets);
+  }
+
+  // Notes that evaluating |curr|, the entire expression we were asked to
+  // evaluate, threw a NonconstantException.
+  void noteException(Expression* curr) {
+    if (!hitHostLimit) {
+      noteNonconstant(curr, Flow(NONCONSTANT_FLOW), 0, false);
+    }
+  }
+
+  void hostLimit(std::string_view why) override {
+    hitHostLimit = true;
+    Super::hostLimit(why);
+  }
 
   Flow visitLocalGet(LocalGet* curr) {
     auto iter = getValues.find(curr);
@@ -134,10 +210,19 @@ public:
       assert(values.isConcrete());
       return Flow(values);
     }
+    contextReads++;
     return ConstantExpressionRunner<
       PrecomputingExpressionRunner>::visitLocalGet(curr);
   }
 
+  Flow visitGlobalGet(GlobalGet* curr) {
+    auto* global = getModule()->getGlobal(curr->name);
+    if (global->imported() || global->mutable_) {
+      contextReads++;
+    }
+    return Super::visitGlobalGet(curr);
+  }
+
   // TODO: Use immutability for values
   Flow visitStructNew(StructNew* curr) {
     return getGCAllocation(curr, [&]() { return Super::visitStructNew(curr); });
@@ -293,6 +378,26 @@ public:
     // string.encode_wtf16_array anyhow.)
     return Flow(NONCONSTANT_FLOW);
   }
+
+private:
+  void noteNonconstant(Expression* curr,
+                       const Flow& flow,
+                       Index entryContextReads,
+                       bool entryHadSets) {
+    // A set of a local or a global can make a later expression constant, so an
+    // expression that is not constant while preserving side effects might be
+    // without doing so. The converse holds, so we only note what we find while
+    // not preserving them.
+    if (!nonconstants || flow.breakTo != NONCONSTANT_FLOW ||
+        (flags & FlagValues::PRESERVE_SIDEEFFECTS)) {
+      return;
+    }
+    if (contextReads == entryContextReads) {
+      (*nonconstants)[curr] = AnyContext;
+    } else if (!entryHadSets) {
+      (*nonconstants)[curr] = getValues.size();
+    }
+  }
 };
 
 struct Precompute
@@ -311,12 +416,19 @@ struct Precompute
   GetValues getValues;
   HeapValues heapValues;
 
+  // Expressions in the current function that we found are not constant.
+  // Replacing an expression with what we precomputed for it does not change
+  // whether the expressions it is in are constant, but partially precomputing
+  // it does, so we remove those then.
+  Nonconstants nonconstants;
+
   bool canPartiallyPrecompute;
 
   void doWalkFunction(Function* func) {
     // Perform partial precomputing only when the optimization level is non-
     // trivial, as it is slower and less likely to help.
     canPartiallyPrecompute = getPassOptions().optimizeLevel >= 2;
+    nonconstants.clear();
 
     // Walk the function and precompute things.
     Super::doWalkFunction(func);
@@ -366,11 +478,15 @@ struct Precompute
     // replace it entirely, see below - we may keep parts, in some cases, if we
     // can still simplify it to a precomputed value.
     Flow flow;
-    PrecomputingExpressionRunner runner(
-      getModule(), getValues, heapValues, false /* replaceExpression */);
+    PrecomputingExpressionRunner runner(getModule(),
+                                        getValues,
+                                        heapValues,
+                                        &nonconstants,
+                                        false /* replaceExpression */);
     try {
       flow = runner.visit(curr);
     } catch (NonconstantException&) {
+      runner.noteException(curr);
       return;
     }
     // The resulting value must be of a type we can emit a constant for (or
@@ -499,6 +615,7 @@ struct Precompute
         }
       }
     }
+    nonconstants.erase(curr);
     if (!value) {
       // We don't need to replace this with anything: there is no value or other
       // code that we need. Just nop it.
@@ -829,10 +946,15 @@ struct Precompute
             *pointerToParent = select;
 
             // Update state for further iterations: Mark everything modified and
-            // move the select to the parent's location.
+            // move the select to the parent's location. Whatever we found about
+            // the select and the expressions it is now inside of no longer
+            // holds.
             for (Index i = parentIndex; i <= selectIndex; i++) {
               modified.insert(stack[i]);
             }
+            for (Index i = 0; i <= selectIndex; i++) {
+              nonconstants.erase(stack[i]);
+            }
             selectIndex = parentIndex;
             stack[selectIndex] = select;
             stack.resize(selectIndex + 1);
@@ -856,19 +978,27 @@ private:
   // Precompute an expression, returning a flow, which may be a constant
   // (that we can replace the expression with if replaceExpression is set). When
   // |usedHeapValues| is provided, we use those values instead of the normal
-  // |heapValues| (that is, we do not use the normal heap value cache).
+  // |heapValues| (that is, we do not use the normal heap value cache), and we
+  // do not use |nonconstants| either.
   Flow precomputeExpression(Expression* curr,
                             bool replaceExpression = true,
                             HeapValues* usedHeapValues = nullptr) {
-    if (!usedHeapValues) {
+    auto* usedNonconstants = &nonconstants;
+    if (usedHeapValues) {
+      usedNonconstants = nullptr;
+    } else {
       usedHeapValues = &heapValues;
     }
+    PrecomputingExpressionRunner runner(getModule(),
+                                        getValues,
+                                        *usedHeapValues,
+                                        usedNonconstants,
+                                        replaceExpression);
     Flow flow;
     try {
-      flow = PrecomputingExpressionRunner(
-               getModule(), getValues, *usedHeapValues, replaceExpression)
-               .visit(curr);
+      flow = runner.visit(curr);
     } catch (NonconstantException&) {
+      runner.noteException(curr);
       return Flow(NONCONSTANT_FLOW);
     }
     // If we are replacing the expression, then the resulting value must be of
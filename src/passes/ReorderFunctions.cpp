@@ -26,11 +26,19 @@
 // order, the has some natural tendency one way or the other). TODO: investigate
 // similarity ordering here (see #4322)
 //
+// There is also a variant that orders functions by a profile from
+// `wasm-split --instrument`, putting the functions that ran first and close to
+// the functions they called, so that engines that compile or cache code as it
+// streams in get to the code that runs at startup early.
+//
 
 #include <memory>
 
 #include <ir/element-utils.h>
+#include <ir/module-utils.h>
+#include <ir/split-profile.h>
 #include <pass.h>
+#include <wasm-binary.h>
 #include <wasm.h>
 
 namespace wasm {
@@ -117,4 +125,191 @@ Pass* createReorderFunctionsByNamePass() {
   return new ReorderFunctionsByName();
 }
 
+// Orders functions by a profile from `wasm-split --instrument`, which must have
+// been made for this module: the profile refers to the defined functions by
+// their indices, so this should run before anything adds, removes or reorders
+// functions.
+//
+// Functions that ran come first, and functions that did not keep their order
+// after them. If the profile has call edges, the functions that ran are
+// gathered into chains by merging, from the hottest edge down, the chain that
+// ends in the caller with the chain that starts with the callee. Chains are
+// then ordered by the earliest first call of their functions, and then by how
+// many calls they had in total. Without call edges each function is its own
+// chain.
+//
+// The profile records a hash of the module file it was made for, which is
+// checked against the file given by
+// --pass-arg=reorder-functions-by-profile-module@FILE. wasm-opt passes its
+// input file by default. Without a file to check against, this warns.
+//
+// With --pass-arg=reorder-functions-by-profile-report this also prints how many
+// bytes of function bodies come up to the end of the last function that ran,
+// before and after reordering.
+struct ReorderFunctionsByProfile : public Pass {
+  // Only reorders functions, does not change their contents.
+  bool requiresNonNullableLocalFixups() override { return false; }
+
+  void run(Module* module) override {
+    auto profile = SplitProfile::read(
+      getArgument("reorder-functions-by-profile",
+                  "usage: --reorder-functions-by-profile=PROFILE_FILE"));
+    if (hasArgument("reorder-functions-by-profile-module")) {
+      auto file = getArgument("reorder-functions-by-profile-module", "");
+      if (profile.hash != SplitProfile::hashFile(file)) {
+        Fatal() << "reorder-functions-by-profile: checksum in profile does not "
+                   "match the checksum of "
+                << file
+                << ". The profile must have been made for this module, "
+                   "before it was optimized.";
+      }
+    } else {
+      std::cerr << "warning: reorder-functions-by-profile: cannot check that "
+                   "the profile was made for this module (use "
+                   "--pass-arg=reorder-functions-by-profile-module@FILE)\n";
+    }
+
+    std::vector<Function*> defined;
+    ModuleUtils::iterDefinedFunctions(
+      *module, [&](Function* func) { defined.push_back(func); });
+    if (profile.timestamps.size() != defined.size()) {
+      Fatal() << "reorder-functions-by-profile: the profile has "
+              << profile.timestamps.size() << " functions but the module has "
+              << defined.size() << " defined functions";
+    }
+    std::unordered_set<Function*> executed;
+    for (Index i = 0; i < defined.size(); ++i) {
+      if (profile.timestamps[i]) {
+        executed.insert(defined[i]);
+      }
+    }
+
+    bool report = hasArgument("reorder-functions-by-profile-report");
+    if (report) {
+      reportStartupSize(module, executed, "before");
+    }
+
+    // Imports keep their places, as they are not in the code section.
+    std::vector<std::unique_ptr<Function>> functions;
+    std::unordered_map<Function*, std::unique_ptr<Function>> owned;
+    for (auto& func : module->functions) {
+      if (func->imported()) {
+        functions.push_back(std::move(func));
+      } else {
+        owned[func.get()] = std::move(func);
+      }
+    }
+    for (auto index : getOrder(profile)) {
+      functions.push_back(std::move(owned[defined[index]]));
+    }
+    module->functions = std::move(functions);
+    module->updateFunctionsMap();
+
+    if (report) {
+      reportStartupSize(module, executed, "after");
+    }
+  }
+
+  // Returns the indices of the defined functions in their new order.
+  std::vector<Index> getOrder(const SplitProfile::ProfileData& profile) {
+    Index numFuncs = profile.timestamps.size();
+    auto getCount = [&](Index func) -> uint64_t {
+      return profile.hasCallCounts ? profile.callCounts[func] : 0;
+    };
+
+    // Each function that ran starts in a chain of its own.
+    std::vector<std::vector<Index>> chains(numFuncs);
+    std::vector<Index> chainOf(numFuncs);
+    for (Index i = 0; i < numFuncs; ++i) {
+      if (profile.timestamps[i]) {
+        chains[i].push_back(i);
+      }
+      chainOf[i] = i;
+    }
+
+    auto edges = profile.callEdges;
+    std::stable_sort(edges.begin(), edges.end(), [](auto& a, auto& b) {
+      return a.count > b.count;
+    });
+    for (auto& edge : edges) {
+      if (!edge.count || !profile.timestamps[edge.caller] ||
+          !profile.timestamps[edge.callee]) {
+        continue;
+      }
+      auto& callerChain = chains[chainOf[edge.caller]];
+      auto& calleeChain = chains[chainOf[edge.callee]];
+      if (&callerChain == &calleeChain || callerChain.back() != edge.caller ||
+          calleeChain.front() != edge.callee) {
+        continue;
+      }
+      for (auto func : calleeChain) {
+        chainOf[func] = chainOf[edge.caller];
+      }
+      callerChain.insert(
+        callerChain.end(), calleeChain.begin(), calleeChain.end());
+      calleeChain.clear();
+    }
+
+    struct ChainInfo {
+      Index chain;
+      size_t firstCall;
+      uint64_t calls;
+    };
+    std::vector<ChainInfo> infos;
+    for (Index i = 0; i < numFuncs; ++i) {
+      if (chains[i].empty()) {
+        continue;
+      }
+      ChainInfo info{i, std::numeric_limits<size_t>::max(), 0};
+      for (auto func : chains[i]) {
+        info.firstCall = std::min(info.firstCall, profile.timestamps[func]);
+        info.calls += getCount(func);
+      }
+      infos.push_back(info);
+    }
+    std::stable_sort(infos.begin(), infos.end(), [](auto& a, auto& b) {
+      if (a.firstCall != b.firstCall) {
+        return a.firstCall < b.firstCall;
+      }
+      return a.calls > b.calls;
+    });
+
+    std::vector<Index> order;
+    order.reserve(numFuncs);
+    for (auto& info : infos) {
+      order.insert(
+        order.end(), chains[info.chain].begin(), chains[info.chain].end());
+    }
+    for (Index i = 0; i < numFuncs; ++i) {
+      if (!profile.timestamps[i]) {
+        order.push_back(i);
+      }
+    }
+    return order;
+  }
+
+  void reportStartupSize(Module* module,
+                         const std::unordered_set<Function*>& executed,
+                         const char* when) {
+    BufferWithRandomAccess buffer;
+    WasmBinaryWriter writer(module, buffer, getPassOptions());
+    writer.write();
+    size_t total = 0;
+    size_t startup = 0;
+    Index binaryIndex = 0;
+    ModuleUtils::iterDefinedFunctions(*module, [&](Function* func) {
+      total += writer.tableOfContents.functionBodies[binaryIndex++].size;
+      if (executed.contains(func)) {
+        startup = total;
+      }
+    });
+    std::cout << "startup code " << when << ": " << startup << " of " << total
+              << " bytes\n";
+  }
+};
+
+Pass* createReorderFunctionsByProfilePass() {
+  return new ReorderFunctionsByProfile();
+}
+
 } // namespace wasm
@@ -0,0 +1,554 @@
+/*
+ * Copyright 2026 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <set>
+#include <sstream>
+#include <thread>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif !defined(__EMSCRIPTEN__)
+#include <dlfcn.h>
+#endif
+
+#include "config.h"
+#include "ir/find_all.h"
+#include "ir/module-utils.h"
+#include "parser/wat-parser.h"
+#include "passes/function-cache.h"
+#include "support/hash.h"
+#include "wasm-builder.h"
+
+namespace wasm {
+
+namespace {
+
+// Entries start with this, followed by the size of the key. Bump the version
+// when the format of entries or what goes into keys changes.
+const char* EntryMagic = "binaryen-function-cache-1";
+
+// In the modules we print, the module items that the function refers to are
+// all imports. Items that are defined in the real module are imported from
+// this module.
+const char* DefinedModule = "binaryen-function-cache-defined";
+
+const char* NamedLocalsPrefix = ";; named locals:";
+
+// Identifies the build of Binaryen that is running, as a different build may
+// optimize differently. The version is not enough for that, as all development
+// builds between two releases have the same one, so we add the size and the
+// modification time of the binary that contains this code (the library, if it
+// is shared), which change whenever it is rebuilt.
+std::string getBuildId() {
+  std::string id = PROJECT_VERSION;
+  std::string path;
+#if defined(_WIN32)
+  HMODULE module;
+  char name[MAX_PATH];
+  if (GetModuleHandleExA(GET_MODULE_HANDLE_EX_FLAG_FROM_ADDRESS |
+                           GET_MODULE_HANDLE_EX_FLAG_UNCHANGED_REFCOUNT,
+                         (LPCSTR)&getBuildId,
+                         &module)) {
+    auto size = GetModuleFileNameA(module, name, MAX_PATH);
+    if (size > 0 && size < MAX_PATH) {
+      path = name;
+    }
+  }
+#elif !defined(__EMSCRIPTEN__)
+  Dl_info info;
+  if (dladdr((void*)&getBuildId, &info) && info.dli_fname) {
+    path = info.dli_fname;
+  }
+#endif
+  std::error_code ec;
+  auto size = std::filesystem::file_size(path, ec);
+  if (ec) {
+    return id;
+  }
+  auto time = std::filesystem::last_write_time(path, ec);
+  if (ec) {
+    return id;
+  }
+  return id + ' ' + std::to_string(size) + ' ' +
+         std::to_string(time.time_since_epoch().count());
+}
+
+using References = std::vector<std::pair<ModuleItemKind, Name>>;
+
+// Returns the module items that a function refers to, in the order they are
+// first referred to.
+References collectReferences(Function* func) {
+  struct Collector
+    : public PostWalker<Collector, UnifiedExpressionVisitor<Collector>> {
+    References references;
+    std::set<std::pair<ModuleItemKind, Name>> seen;
+
+    void visitExpression(Expression* curr) {
+#define DELEGATE_ID curr->_id
+#define DELEGATE_START(id) [[maybe_unused]] auto* cast = curr->cast<id>();
+#define DELEGATE_GET_FIELD(id, field) cast->field
+#define DELEGATE_FIELD_TYPE(id, field)
+#define DELEGATE_FIELD_HEAPTYPE(id, field)
+#define DELEGATE_FIELD_CHILD(id, field)
+#define DELEGATE_FIELD_OPTIONAL_CHILD(id, field)
+#define DELEGATE_FIELD_INT(id, field)
+#define DELEGATE_FIELD_LITERAL(id, field)
+#define DELEGATE_FIELD_NAME(id, field)
+#define DELEGATE_FIELD_SCOPE_NAME_DEF(id, field)
+#define DELEGATE_FIELD_SCOPE_NAME_USE(id, field)
+#define DELEGATE_FIELD_ADDRESS(id, field)
+
+#define DELEGATE_FIELD_NAME_KIND(id, field, kind)                              \
+  if (cast->field.is() && seen.insert({kind, cast->field}).second) {          \
+    references.emplace_back(kind, cast->field);                                \
+  }
+
+#include "wasm-delegations-fields.def"
+    }
+  } collector;
+  collector.walk(func->body);
+  return std::move(collector.references);
+}
+
+// Prints something to a string. The printer may add color codes, depending on
+// whether stdout is a terminal, which we remove so that the text is the same
+// in every run.
+template<typename T> std::string print(T&& value) {
+  std::stringstream ss;
+  ss << value;
+  auto text = ss.str();
+  std::string out;
+  out.reserve(text.size());
+  for (size_t i = 0; i < text.size(); i++) {
+    if (text[i] == '\033' && i + 1 < text.size() && text[i + 1] == '[') {
+      auto end = text.find('m', i);
+      if (end != std::string::npos) {
+        i = end;
+        continue;
+      }
+    }
+    out += text[i];
+  }
+  return out;
+}
+
+void setImport(Importable& import, const Importable& original) {
+  if (original.imported()) {
+    import.module = original.module;
+    import.base = original.base;
+  } else {
+    import.module = DefinedModule;
+    import.base = original.name;
+  }
+}
+
+} // anonymous namespace
+
+bool FunctionCache::canCache(Module& wasm, const std::vector<Pass*>& stack) {
+  for (auto* pass : stack) {
+    // Passes without a name are internal parts of other passes, and may have
+    // state that we cannot see. Passes that do not modify the IR are run for
+    // some other effect, like printing, which we must not skip.
+    if (pass->name.empty() || !pass->modifiesBinaryenIR()) {
+      return false;
+    }
+  }
+  // Passes use computed effects of the functions that a function calls, which
+  // are not part of the key.
+  if (!wasm.indirectCallEffects.empty()) {
+    return false;
+  }
+  for (auto& func : wasm.functions) {
+    if (func->effects) {
+      return false;
+    }
+  }
+  return true;
+}
+
+FunctionCache::FunctionCache(Module& wasm,
+                             const std::vector<Pass*>& stack,
+                             const PassOptions& options)
+  : wasm(wasm), options(options) {
+  std::stringstream ss;
+  static const std::string buildId = getBuildId();
+  ss << ";; binaryen " << buildId << "\n;; passes:";
+  for (auto* pass : stack) {
+    ss << ' ' << pass->name;
+  }
+  auto& inlining = options.inlining;
+  ss << "\n;; options: -O" << options.optimizeLevel << " -s"
+     << options.shrinkLevel << " inlining " << inlining.alwaysInlineMaxSize
+     << ' ' << inlining.oneCallerInlineMaxSize << ' '
+     << inlining.flexibleInlineMaxSize << ' '
+     << inlining.maxCombinedBinarySize << ' '
+     << inlining.allowFunctionsWithLoops << ' '
+     << inlining.partialInliningIfs << " flags "
+     << options.ignoreImplicitTraps << options.trapsNeverHappen
+     << options.lowMemoryUnused << options.fastMath
+     << options.zeroFilledMemory << (options.worldMode == WorldMode::Closed)
+     << options.targetJS << options.debugInfo;
+  // Sort these so that the order in which they were given does not matter.
+  std::set<std::pair<std::string, std::string>> arguments(
+    options.arguments.begin(), options.arguments.end());
+  for (auto& [key, value] : arguments) {
+    ss << "\n;; argument: " << key << '=' << value;
+  }
+  std::set<std::string> skipped(options.passesToSkip.begin(),
+                                options.passesToSkip.end());
+  for (auto& name : skipped) {
+    ss << "\n;; skip: " << name;
+  }
+  ss << "\n;; features: " << wasm.features.toString() << '\n';
+  header = ss.str();
+
+  // The initial value of an immutable global can be propagated into the
+  // function, and it can depend on the globals that it reads.
+  for (auto& global : wasm.globals) {
+    if (global->imported()) {
+      continue;
+    }
+    auto digest = hash(print(*global->init));
+    for (auto* get : FindAll<GlobalGet>(global->init).list) {
+      if (auto it = globalDigests.find(get->name); it != globalDigests.end()) {
+        hash_combine(digest, it->second);
+      }
+    }
+    globalDigests[global->name] = digest;
+  }
+
+  for (auto& segment : wasm.elementSegments) {
+    auto digest = hash(segment->type.toString());
+    if (segment->offset) {
+      rehash(digest, print(*segment->offset));
+    }
+    for (auto* item : segment->data) {
+      rehash(digest, print(*item));
+      rehash(digest, item->type.toString());
+    }
+    elemDigests[segment->name] = digest;
+    if (segment->table) {
+      hash_combine(tableDigests[segment->table], digest);
+    }
+  }
+  for (auto& table : wasm.tables) {
+    if (table->init) {
+      rehash(tableDigests[table->name], print(*table->init));
+    }
+  }
+  for (auto& segment : wasm.dataSegments) {
+    auto digest =
+      hash(std::string_view(segment->data.data(), segment->data.size()));
+    if (segment->offset) {
+      rehash(digest, segment->memory.toString());
+      rehash(digest, print(*segment->offset));
+    }
+    dataDigests[segment->name] = digest;
+  }
+
+  for (Index i = 0; i < wasm.debugInfoFileNames.size(); i++) {
+    fileIndices.insert({wasm.debugInfoFileNames[i], i});
+  }
+  for (Index i = 0; i < wasm.debugInfoSymbolNames.size(); i++) {
+    symbolIndices.insert({wasm.debugInfoSymbolNames[i], i});
+  }
+
+  std::error_code error;
+  std::filesystem::create_directories(options.functionCache, error);
+}
+
+std::string FunctionCache::describe(Function* func) {
+  Module context;
+  context.features = wasm.features;
+  for (auto& [kind, name] : collectReferences(func)) {
+    switch (kind) {
+      case ModuleItemKind::Function: {
+        if (name == func->name) {
+          break;
+        }
+        auto* target = wasm.getFunction(name);
+        auto import = Builder::makeFunction(name, target->type, {});
+        setImport(*import, *target);
+        context.addFunction(std::move(import));
+        break;
+      }
+      case ModuleItemKind::Table: {
+        auto* table = wasm.getTable(name);
+        auto* import = ModuleUtils::copyTable(table, context);
+        import->init = nullptr;
+        setImport(*import, *table);
+        break;
+      }
+      case ModuleItemKind::Memory: {
+        auto* memory = wasm.getMemory(name);
+        setImport(*ModuleUtils::copyMemory(memory, context), *memory);
+        break;
+      }
+      case ModuleItemKind::Global: {
+        auto* global = wasm.getGlobal(name);
+        auto import = Builder::makeGlobal(
+          name,
+          global->type,
+          nullptr,
+          global->mutable_ ? Builder::Mutable : Builder::Immutable);
+        setImport(*import, *global);
+        context.addGlobal(std::move(import));
+        break;
+      }
+      case ModuleItemKind::Tag: {
+        auto* tag = wasm.getTag(name);
+        setImport(*ModuleUtils::copyTag(tag, context), *tag);
+        break;
+      }
+      case ModuleItemKind::DataSegment:
+        context.addDataSegment(Builder::makeDataSegment(name));
+        break;
+      case ModuleItemKind::ElementSegment:
+        context.addElementSegment(Builder::makeElementSegment(
+          name, Name(), nullptr, wasm.getElementSegment(name)->type));
+        break;
+      case ModuleItemKind::Invalid:
+        WASM_UNREACHABLE("unexpected kind");
+    }
+  }
+
+  // Give the context module just the source map names that the function uses.
+  auto copy = ModuleUtils::copyFunctionWithoutAdd(func, context);
+  std::unordered_map<Index, Index> files, symbols;
+  auto remap = [&](std::optional<Function::DebugLocation>& location) {
+    if (!location) {
+      return;
+    }
+    auto [file, newFile] = files.insert({location->fileIndex, files.size()});
+    if (newFile) {
+      context.debugInfoFileNames.push_back(
+        wasm.debugInfoFileNames[location->fileIndex]);
+    }
+    location->fileIndex = file->second;
+    if (location->symbolNameIndex) {
+      auto [symbol, newSymbol] =
+        symbols.insert({*location->symbolNameIndex, symbols.size()});
+      if (newSymbol) {
+        context.debugInfoSymbolNames.push_back(
+          wasm.debugInfoSymbolNames[*location->symbolNameIndex]);
+      }
+      location->symbolNameIndex = symbol->second;
+    }
+  };
+  for (auto& [_, location] : copy->debugLocations) {
+    remap(location);
+  }
+  remap(copy->prologLocation);
+  remap(copy->epilogLocation);
+  context.addFunction(std::move(copy));
+
+  // Unnamed locals are printed with their index as their name, so note which
+  // locals really have names.
+  std::vector<Index> named;
+  for (auto& [index, _] : func->localNames) {
+    named.push_back(index);
+  }
+  std::sort(named.begin(), named.end());
+  std::stringstream ss;
+  ss << NamedLocalsPrefix;
+  for (auto index : named) {
+    ss << ' ' << index;
+  }
+  ss << '\n';
+  return ss.str() + print(context);
+}
+
+void FunctionCache::describeReferences(Function* func, std::string& out) {
+  auto add = [&](const char* what, Name name, size_t digest) {
+    std::stringstream ss;
+    ss << ";; " << what << ' ' << name << ' ' << std::hex << digest << '\n';
+    out += ss.str();
+  };
+  for (auto& [kind, name] : collectReferences(func)) {
+    switch (kind) {
+      case ModuleItemKind::Global:
+        if (auto it = globalDigests.find(name); it != globalDigests.end()) {
+          add("global", name, it->second);
+        }
+        break;
+      case ModuleItemKind::Table:
+        if (auto it = tableDigests.find(name); it != tableDigests.end()) {
+          add("table", name, it->second);
+        }
+        break;
+      case ModuleItemKind::DataSegment:
+        add("data", name, dataDigests.at(name));
+        break;
+      case ModuleItemKind::ElementSegment:
+        add("elem", name, elemDigests.at(name));
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+FunctionCache::Entry FunctionCache::lookup(Function* func) {
+  Entry entry;
+  entry.key = header + describe(func);
+  describeReferences(func, entry.key);
+
+  std::stringstream filename;
+  filename << std::hex << std::setw(16) << std::setfill('0')
+           << hash(entry.key) << ".wast";
+  entry.path =
+    (std::filesystem::path(options.functionCache) / filename.str()).string();
+
+  std::ifstream in(entry.path, std::ios::binary);
+  if (!in) {
+    return entry;
+  }
+  std::stringstream contents;
+  contents << in.rdbuf();
+  auto text = contents.str();
+  // Check the key in full, as different keys can have the same hash.
+  std::stringstream start;
+  start << EntryMagic << ' ' << entry.key.size() << '\n';
+  auto keyStart = start.str().size();
+  if (text.compare(0, keyStart, start.str()) == 0 &&
+      text.compare(keyStart, entry.key.size(), entry.key) == 0) {
+    entry.result = text.substr(keyStart + entry.key.size());
+  }
+  return entry;
+}
+
+bool FunctionCache::apply(Function* func, const std::string& result) {
+  if (!applyResult(func, result)) {
+    return false;
+  }
+  hits++;
+  return true;
+}
+
+bool FunctionCache::applyResult(Function* func, const std::string& result) {
+  Module cached;
+  cached.features = wasm.features;
+  if (WATParser::parseModule(cached, result).getErr()) {
+    return false;
+  }
+  Function* found = nullptr;
+  for (auto& cachedFunc : cached.functions) {
+    if (!cachedFunc->imported()) {
+      found = cachedFunc.get();
+    }
+  }
+  if (!found || found->type != func->type) {
+    return false;
+  }
+
+  // Map the source map names to the ones in the module. We cannot add new
+  // ones, as other functions are being worked on in parallel.
+  std::vector<Index> fileIndexMap, symbolIndexMap;
+  for (auto& file : cached.debugInfoFileNames) {
+    auto it = fileIndices.find(file);
+    if (it == fileIndices.end()) {
+      return false;
+    }
+    fileIndexMap.push_back(it->second);
+  }
+  for (auto& symbol : cached.debugInfoSymbolNames) {
+    auto it = symbolIndices.find(symbol);
+    if (it == symbolIndices.end()) {
+      return false;
+    }
+    symbolIndexMap.push_back(it->second);
+  }
+
+  auto copy = ModuleUtils::copyFunctionWithoutAdd(
+    found, wasm, func->name, fileIndexMap, symbolIndexMap);
+  func->vars = std::move(copy->vars);
+  func->body = copy->body;
+  func->debugLocations = std::move(copy->debugLocations);
+  func->prologLocation = copy->prologLocation;
+  func->epilogLocation = copy->epilogLocation;
+  func->codeAnnotations = std::move(copy->codeAnnotations);
+
+  // The parser named all the locals. Keep only the names of the locals that
+  // had names (see describe()).
+  auto line = result.substr(0, result.find('\n'));
+  if (line.rfind(NamedLocalsPrefix, 0) != 0) {
+    return false;
+  }
+  std::istringstream named(line.substr(strlen(NamedLocalsPrefix)));
+  func->localNames.clear();
+  func->localIndices.clear();
+  for (Index index; named >> index;) {
+    auto name = copy->getLocalNameOrDefault(index);
+    if (name) {
+      func->setLocalName(index, name);
+    }
+  }
+  return true;
+}
+
+void FunctionCache::finish(Function* func, const Entry& entry) {
+  auto result = describe(func);
+  if (entry.result) {
+    // We are verifying the cache: the entry must match what the passes did,
+    // and applying it must give us back the same function.
+    hits++;
+    if (result != *entry.result) {
+      Fatal() << "function cache entry " << entry.path << " for function "
+              << func->name << " does not match the result of the passes";
+    }
+    Function applied;
+    applied.name = func->name;
+    applied.type = func->type;
+    if (applyResult(&applied, *entry.result) &&
+        describe(&applied) != result) {
+      Fatal() << "function cache entry " << entry.path << " for function "
+              << func->name << " is not applied correctly";
+    }
+    return;
+  }
+  misses++;
+
+  // Write to a temporary file and rename it into place, so that concurrent
+  // processes sharing the cache never see a partial entry.
+  std::stringstream temp;
+  temp << entry.path << ".tmp-" << std::hex
+       << hash(std::this_thread::get_id()) << '-'
+       << std::chrono::steady_clock::now().time_since_epoch().count();
+  {
+    std::ofstream out(temp.str(), std::ios::binary);
+    out << EntryMagic << ' ' << entry.key.size() << '\n'
+        << entry.key << result;
+    if (!out) {
+      return;
+    }
+  }
+  std::error_code error;
+  std::filesystem::rename(temp.str(), entry.path, error);
+  if (error) {
+    std::filesystem::remove(temp.str(), error);
+  }
+}
+
+} // namespace wasm
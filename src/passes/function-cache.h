@@ -0,0 +1,117 @@
+/*
+ * Copyright 2026 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+//
+// An on-disk cache of the results of running a stack of function-parallel
+// passes on a function (see PassOptions::functionCache). When a module is
+// rebuilt and most of its functions did not change, the cache lets us skip
+// optimizing those functions again.
+//
+// An entry's key is the text of the function before the passes, together with
+// everything the passes can see that affects it: the build of Binaryen that
+// runs them, the passes in the stack and the pass options, the module
+// features, and the module items the function refers to (printed as imports,
+// plus digests of things like the initial values of defined globals). The
+// entry's value is the text of the function after the passes. Both are
+// printed as small standalone modules, so that an entry can be parsed back in
+// isolation. The full key is stored in the entry and compared on lookup, so
+// hash collisions cannot cause wrong results.
+//
+
+#ifndef wasm_passes_function_cache_h
+#define wasm_passes_function_cache_h
+
+#include <atomic>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "pass.h"
+#include "wasm.h"
+
+namespace wasm {
+
+class FunctionCache {
+public:
+  // Returns whether the results of running |stack| on the functions of
+  // |wasm| can be cached. That is not the case when the passes depend on
+  // information that we do not include in keys, like computed effects of other
+  // functions.
+  static bool canCache(Module& wasm, const std::vector<Pass*>& stack);
+
+  // The module must not change, other than in the bodies of its functions,
+  // while this exists.
+  FunctionCache(Module& wasm,
+                const std::vector<Pass*>& stack,
+                const PassOptions& options);
+
+  struct Entry {
+    std::string key;
+    std::string path;
+    // The cached result, if there is one.
+    std::optional<std::string> result;
+  };
+
+  // Computes the key of a function, which must not have been optimized yet,
+  // and reads the cached result for it, if there is one. This and the methods
+  // below can be called in parallel on different functions.
+  Entry lookup(Function* func);
+
+  // Replaces the contents of a function with a cached result. Returns false if
+  // that is not possible (for example, if the result refers to a source map
+  // file that the module does not have).
+  bool apply(Function* func, const std::string& result);
+
+  // Called after the passes were run on a function that was looked up. Stores
+  // the result in the cache, or, if the entry already had a result (which
+  // happens when verifying the cache), checks that it matches.
+  void finish(Function* func, const Entry& entry);
+
+  // Statistics.
+  std::atomic<size_t> hits = 0;
+  std::atomic<size_t> misses = 0;
+
+private:
+  Module& wasm;
+  const PassOptions& options;
+
+  // The part of the key that is the same for all functions.
+  std::string header;
+
+  // Digests of module items whose contents are not part of the context
+  // modules that we print (see describe()).
+  std::unordered_map<Name, size_t> globalDigests;
+  std::unordered_map<Name, size_t> tableDigests;
+  std::unordered_map<Name, size_t> dataDigests;
+  std::unordered_map<Name, size_t> elemDigests;
+
+  // Maps source map file and symbol names to their indices in the module.
+  std::unordered_map<std::string, Index> fileIndices;
+  std::unordered_map<std::string, Index> symbolIndices;
+
+  // Prints a module that contains |func| and everything it refers to.
+  std::string describe(Function* func);
+
+  bool applyResult(Function* func, const std::string& result);
+
+  // Appends the digests of the items |func| refers to.
+  void describeReferences(Function* func, std::string& out);
+};
+
+} // namespace wasm
+
+#endif // wasm_passes_function_cache_h
@@ -14,8 +14,14 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cstdio>
+#include <ctime>
+#include <deque>
 #include <sstream>
+#include <unordered_set>
 
 #ifdef __linux__
 #include <unistd.h>
@@ -24,7 +30,9 @@
 #include "ir/hashed.h"
 #include "ir/module-utils.h"
 #include "ir/type-updating.h"
+#include "ir/utils.h"
 #include "pass.h"
+#include "passes/function-cache.h"
 #include "passes/passes.h"
 #include "support/colors.h"
 #include "wasm-debug.h"
@@ -453,6 +461,10 @@ void PassRegistry::registerPasses() {
   registerPass("reorder-functions-by-name",
                "sorts functions by name (useful for debugging)",
                createReorderFunctionsByNamePass);
+  registerPass("reorder-functions-by-profile",
+               "sorts functions by a wasm-split profile so that the code that "
+               "runs first comes first",
+               createReorderFunctionsByProfilePass);
   registerPass("reorder-functions",
                "sorts functions by access frequency",
                createReorderFunctionsPass);
@@ -868,8 +880,145 @@ static void dumpWasm(Name name, Module* wasm, const PassOptions& options) {
   writer.writeBinary(*wasm, fullName + ".wasm");
 }
 
+namespace {
+
+// Records the profile for --profile-passes. The events of all the top-level
+// pass runners in the process are collected, and the whole profile is written
+// out again after each of them finishes, as tools may exit without running
+// destructors.
+struct PassProfiler {
+  using Clock = std::chrono::steady_clock;
+
+  // How many of the slowest functions to record for each function-parallel
+  // pass.
+  static constexpr size_t HottestFunctions = 10;
+
+  // The measurements we take before and after running passes.
+  struct Sample {
+    Clock::time_point wall;
+    std::clock_t cpu;
+    size_t arenaBytes;
+    size_t nodes;
+  };
+
+  Clock::time_point origin = Clock::now();
+
+  std::mutex mutex;
+  std::vector<std::string> events;
+
+  // The modules that runners are recording profiles of.
+  std::unordered_set<Module*> modules;
+
+  static PassProfiler& get() {
+    static PassProfiler profiler;
+    return profiler;
+  }
+
+  static Sample sample(Module& wasm) {
+    size_t nodes = 0;
+    for (auto& func : wasm.functions) {
+      if (!func->imported()) {
+        nodes += Measurer::measure(func->body);
+      }
+    }
+    for (auto& global : wasm.globals) {
+      if (!global->imported()) {
+        nodes += Measurer::measure(global->init);
+      }
+    }
+    return {
+      Clock::now(), std::clock(), wasm.allocator.getAllocatedBytes(), nodes};
+  }
+
+  static void printString(std::ostream& o, std::string_view str) {
+    o << '"';
+    for (unsigned char c : str) {
+      if (c == '"' || c == '\\') {
+        o << '\\' << c;
+      } else if (c < 0x20) {
+        char buffer[8];
+        snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+        o << buffer;
+      } else {
+        o << c;
+      }
+    }
+    o << '"';
+  }
+
+  static double toMs(Clock::duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+  }
+
+  // Add a complete event on a thread (0 for the main one). |args| are the
+  // members of the event's arguments object.
+  void addEvent(std::string_view name,
+                size_t thread,
+                Clock::time_point start,
+                Clock::time_point end,
+                const std::string& args) {
+    std::stringstream event;
+    event << "{\"name\": ";
+    printString(event, name);
+    event << ", \"cat\": \"pass\", \"ph\": \"X\", \"pid\": 0, \"tid\": "
+          << thread << ", \"ts\": " << toMs(start - origin) * 1000
+          << ", \"dur\": " << toMs(end - start) * 1000 << ", \"args\": {"
+          << args << "}}";
+    std::lock_guard<std::mutex> lock(mutex);
+    events.push_back(event.str());
+  }
+
+  // Add an event for passes that ran between two samples.
+  void addPassEvent(std::string_view name,
+                    const Sample& before,
+                    const Sample& after,
+                    const std::string& extraArgs = "") {
+    std::stringstream args;
+    args << "\"wall_ms\": " << toMs(after.wall - before.wall)
+         << ", \"cpu_ms\": "
+         << 1000.0 * (after.cpu - before.cpu) / CLOCKS_PER_SEC
+         << ", \"arena_bytes\": " << after.arenaBytes - before.arenaBytes
+         << ", \"nodes_before\": " << before.nodes
+         << ", \"nodes_after\": " << after.nodes << ", \"nodes_delta\": "
+         << int64_t(after.nodes) - int64_t(before.nodes) << extraArgs;
+    addEvent(name, 0, before.wall, after.wall, args.str());
+  }
+
+  // Start recording a profile of a module, unless one is already being
+  // recorded for it. Returns whether we started.
+  bool start(Module& wasm) {
+    std::lock_guard<std::mutex> lock(mutex);
+    return modules.insert(&wasm).second;
+  }
+
+  void stop(Module& wasm) {
+    std::lock_guard<std::mutex> lock(mutex);
+    modules.erase(&wasm);
+  }
+
+  void write(const std::string& filename) {
+    std::lock_guard<std::mutex> lock(mutex);
+    Output output(filename, Flags::Text);
+    output << "{\"traceEvents\": [\n";
+    for (size_t i = 0; i < events.size(); i++) {
+      output << events[i] << (i + 1 < events.size() ? ",\n" : "\n");
+    }
+    output << "], \"displayTimeUnit\": \"ms\"}\n";
+  }
+};
+
+} // anonymous namespace
+
 void PassRunner::run() {
   static const int passDebug = getPassDebug();
+
+  // Passes may create runners of their own without marking them as nested, so
+  // to avoid profiling those, we do not start a profile of a module while
+  // another runner is recording one of it. Runners on other modules, like
+  // those of other threads, are profiled independently.
+  profiling = !isNested && !options.profilePasses.empty() &&
+              PassProfiler::get().start(*wasm);
+
   // Emit logging information when asked for. At passDebug level 1+ we log
   // the main passes, while in 2 we also log nested ones. Note that for
   // nested ones we can only emit their name - we can't validate, or save the
@@ -902,6 +1051,10 @@ void PassRunner::run() {
       for (size_t i = 0; i < padding - pass->name.size(); i++) {
         std::cerr << ' ';
       }
+      std::optional<PassProfiler::Sample> sampleBefore;
+      if (profiling) {
+        sampleBefore = PassProfiler::sample(*wasm);
+      }
       auto before = std::chrono::steady_clock::now();
       if (pass->isFunctionParallel()) {
         // function-parallel passes should get a new instance per function
@@ -911,6 +1064,10 @@ void PassRunner::run() {
         runPass(pass.get());
       }
       auto after = std::chrono::steady_clock::now();
+      if (profiling) {
+        PassProfiler::get().addPassEvent(
+          pass->name, *sampleBefore, PassProfiler::sample(*wasm));
+      }
       std::chrono::duration<double> diff = after - before;
       std::cerr << diff.count() << " seconds." << std::endl;
       totalTime += diff;
@@ -951,33 +1108,7 @@ void PassRunner::run() {
     std::vector<Pass*> stack;
     auto flush = [&]() {
       if (stack.size() > 0) {
-        // run the stack of passes on all the functions, in parallel
-        size_t num = ThreadPool::get()->size();
-        std::vector<std::function<ThreadWorkState()>> doWorkers;
-        std::atomic<size_t> nextFunction;
-        nextFunction.store(0);
-        size_t numFunctions = wasm->functions.size();
-        for (size_t i = 0; i < num; i++) {
-          doWorkers.push_back([&]() {
-            auto index = nextFunction.fetch_add(1);
-            // get the next task, if there is one
-            if (index >= numFunctions) {
-              return ThreadWorkState::Finished; // nothing left
-            }
-            Function* func = this->wasm->functions[index].get();
-            if (!func->imported()) {
-              // do the current task: run all passes on this function
-              for (auto* pass : stack) {
-                runPassOnFunction(pass, func);
-              }
-            }
-            if (index + 1 == numFunctions) {
-              return ThreadWorkState::Finished; // we did the last one
-            }
-            return ThreadWorkState::More;
-          });
-        }
-        ThreadPool::get()->work(doWorkers);
+        runFunctionParallelStack(stack);
       }
       stack.clear();
     };
@@ -986,11 +1117,253 @@ void PassRunner::run() {
         stack.push_back(pass.get());
       } else {
         flush();
-        runPass(pass.get());
+        if (profiling) {
+          auto before = PassProfiler::sample(*wasm);
+          runPass(pass.get());
+          PassProfiler::get().addPassEvent(
+            pass->name, before, PassProfiler::sample(*wasm));
+        } else {
+          runPass(pass.get());
+        }
       }
     }
     flush();
   }
+
+  if (profiling) {
+    PassProfiler::get().write(options.profilePasses);
+    PassProfiler::get().stop(*wasm);
+    profiling = false;
+  }
+}
+
+namespace {
+
+// Schedules the functions that a stack of function-parallel passes operates on
+// onto the threads of the pool. Functions are sorted by estimated cost (their
+// size in expressions) and dealt out round-robin to per-thread queues, largest
+// first, so the largest functions start as early as possible instead of being
+// left for last while the other threads sit idle. A thread whose own queue is
+// empty steals the smallest remaining function from the back of another
+// thread's queue.
+struct FunctionScheduler {
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Function*> funcs;
+
+    // Statistics, only accessed by the thread that owns this queue.
+    size_t done = 0;
+    size_t stolen = 0;
+    std::chrono::duration<double> busy{0};
+  };
+
+  std::vector<Queue> queues;
+
+  FunctionScheduler(Module& wasm, size_t numThreads) : queues(numThreads) {
+    std::vector<std::pair<Index, Function*>> work;
+    for (auto& func : wasm.functions) {
+      if (!func->imported()) {
+        work.emplace_back(0, func.get());
+      }
+    }
+    // With a single thread the order does not matter, so avoid measuring.
+    if (numThreads > 1 && work.size() > 1) {
+      for (auto& [cost, func] : work) {
+        cost = Measurer::measure(func->body);
+      }
+      // Sort stably so that the schedule is deterministic.
+      std::stable_sort(work.begin(), work.end(), [](auto& a, auto& b) {
+        return a.first > b.first;
+      });
+    }
+    for (size_t i = 0; i < work.size(); i++) {
+      queues[i % numThreads].funcs.push_back(work[i].second);
+    }
+  }
+
+  // Returns the next function for a thread to work on, or nullptr if there is
+  // no work left.
+  Function* next(size_t thread) {
+    auto& own = queues[thread];
+    {
+      std::lock_guard<std::mutex> lock(own.mutex);
+      if (!own.funcs.empty()) {
+        auto* func = own.funcs.front();
+        own.funcs.pop_front();
+        return func;
+      }
+    }
+    for (size_t i = 1; i < queues.size(); i++) {
+      auto& victim = queues[(thread + i) % queues.size()];
+      std::lock_guard<std::mutex> lock(victim.mutex);
+      if (!victim.funcs.empty()) {
+        auto* func = victim.funcs.back();
+        victim.funcs.pop_back();
+        own.stolen++;
+        return func;
+      }
+    }
+    return nullptr;
+  }
+
+  void printStats(const std::vector<Pass*>& stack,
+                  std::chrono::duration<double> wall) {
+    size_t done = 0, stolen = 0;
+    double maxBusy = 0, totalBusy = 0;
+    for (auto& queue : queues) {
+      done += queue.done;
+      stolen += queue.stolen;
+      maxBusy = std::max(maxBusy, queue.busy.count());
+      totalBusy += queue.busy.count();
+    }
+    auto meanBusy = totalBusy / queues.size();
+    std::cerr << "[PassRunner] parallel stack [";
+    for (size_t i = 0; i < stack.size(); i++) {
+      if (i > 0) {
+        std::cerr << ", ";
+      }
+      std::cerr << stack[i]->name;
+    }
+    std::cerr << "]: " << done << " functions on " << queues.size()
+              << " threads in " << wall.count()
+              << " seconds; thread time max " << maxBusy << ", mean "
+              << meanBusy << " (imbalance "
+              << (meanBusy > 0 ? maxBusy / meanBusy : 1.0) << "), " << stolen
+              << " stolen" << std::endl;
+  }
+};
+
+} // anonymous namespace
+
+void PassRunner::runFunctionParallelStack(const std::vector<Pass*>& stack) {
+  static const bool passStats = getPassStats();
+  std::optional<PassProfiler::Sample> sampleBefore;
+  if (profiling) {
+    sampleBefore = PassProfiler::sample(*wasm);
+  }
+  auto start = std::chrono::steady_clock::now();
+  size_t num = ThreadPool::get()->size();
+  FunctionScheduler scheduler(*wasm, num);
+
+  // When profiling, each worker records every run of a pass on a function.
+  struct FunctionRun {
+    Index pass;
+    Function* func;
+    PassProfiler::Clock::time_point start, end;
+    int64_t nodesDelta;
+  };
+  std::vector<std::vector<FunctionRun>> runs(num);
+
+  std::unique_ptr<FunctionCache> cache;
+  if (!options.functionCache.empty() && !isNested && !shouldPreserveDWARF() &&
+      FunctionCache::canCache(*wasm, stack)) {
+    cache = std::make_unique<FunctionCache>(*wasm, stack, options);
+  }
+
+  std::vector<std::function<ThreadWorkState()>> doWorkers;
+  for (size_t i = 0; i < num; i++) {
+    doWorkers.push_back([&, i]() {
+      // get the next task, if there is one
+      auto* func = scheduler.next(i);
+      if (!func) {
+        return ThreadWorkState::Finished; // nothing left
+      }
+      // do the current task: run all passes on this function
+      auto before = std::chrono::steady_clock::now();
+      // If the result of the passes on this function is cached, we can use it
+      // instead of running them (unless we are verifying the cache).
+      std::optional<FunctionCache::Entry> entry;
+      bool cached = false;
+      if (cache) {
+        entry = cache->lookup(func);
+        if (entry->result && !options.functionCacheVerify) {
+          cached = cache->apply(func, *entry->result);
+          if (!cached) {
+            // Replace the entry with one that we can apply.
+            entry->result.reset();
+          }
+        }
+      }
+      for (Index p = 0; !cached && p < stack.size(); p++) {
+        if (profiling) {
+          auto nodesBefore = Measurer::measure(func->body);
+          auto runStart = PassProfiler::Clock::now();
+          runPassOnFunction(stack[p], func);
+          auto runEnd = PassProfiler::Clock::now();
+          int64_t nodesDelta =
+            int64_t(Measurer::measure(func->body)) - int64_t(nodesBefore);
+          runs[i].push_back({p, func, runStart, runEnd, nodesDelta});
+        } else {
+          runPassOnFunction(stack[p], func);
+        }
+      }
+      if (cache && !cached) {
+        cache->finish(func, *entry);
+      }
+      auto& queue = scheduler.queues[i];
+      queue.busy += std::chrono::steady_clock::now() - before;
+      queue.done++;
+      return ThreadWorkState::More;
+    });
+  }
+  ThreadPool::get()->work(doWorkers);
+  if (passStats) {
+    scheduler.printStats(stack, std::chrono::steady_clock::now() - start);
+    if (cache) {
+      std::cerr << "[PassRunner] function cache: " << cache->hits << " hits, "
+                << cache->misses << " misses" << std::endl;
+    }
+  }
+  if (profiling) {
+    // Summarize each pass in the stack, and add events for the functions it
+    // spent the most time on, on the threads that ran them.
+    auto& profiler = PassProfiler::get();
+    std::string name;
+    std::stringstream args;
+    args << ", \"passes\": [";
+    for (Index p = 0; p < stack.size(); p++) {
+      std::vector<std::pair<const FunctionRun*, size_t>> passRuns;
+      PassProfiler::Clock::duration total{0};
+      int64_t nodesDelta = 0;
+      for (size_t i = 0; i < num; i++) {
+        for (auto& run : runs[i]) {
+          if (run.pass == p) {
+            passRuns.emplace_back(&run, i);
+            total += run.end - run.start;
+            nodesDelta += run.nodesDelta;
+          }
+        }
+      }
+      auto hottest = std::min(passRuns.size(), PassProfiler::HottestFunctions);
+      std::partial_sort(passRuns.begin(),
+                        passRuns.begin() + hottest,
+                        passRuns.end(),
+                        [](auto& a, auto& b) {
+                          return a.first->end - a.first->start >
+                                 b.first->end - b.first->start;
+                        });
+      name += (p ? ", " : "") + stack[p]->name;
+      args << (p ? ", " : "") << "{\"name\": ";
+      PassProfiler::printString(args, stack[p]->name);
+      args << ", \"thread_ms\": " << PassProfiler::toMs(total)
+           << ", \"nodes_delta\": " << nodesDelta << ", \"hottest\": [";
+      for (size_t h = 0; h < hottest; h++) {
+        auto& [run, thread] = passRuns[h];
+        std::stringstream funcArgs;
+        funcArgs << "\"function\": ";
+        PassProfiler::printString(funcArgs, run->func->name.view());
+        funcArgs << ", \"ms\": " << PassProfiler::toMs(run->end - run->start)
+                 << ", \"nodes_delta\": " << run->nodesDelta;
+        args << (h ? ", " : "") << "{" << funcArgs.str() << "}";
+        profiler.addEvent(
+          stack[p]->name, thread + 1, run->start, run->end, funcArgs.str());
+      }
+      args << "]}";
+    }
+    args << "]";
+    profiler.addPassEvent(
+      name, *sampleBefore, PassProfiler::sample(*wasm), args.str());
+  }
 }
 
 void PassRunner::runOnFunction(Function* func) {
@@ -1116,6 +1489,11 @@ int PassRunner::getPassDebug() {
   return passDebug;
 }
 
+bool PassRunner::getPassStats() {
+  static const bool passStats = getenv("BINARYEN_PASS_STATS") != nullptr;
+  return passStats;
+}
+
 bool PassRunner::passRemovesDebugInfo(const std::string& name) {
   return name == "strip" || name == "strip-debug" || name == "strip-dwarf";
 }
@@ -64,6 +64,31 @@ public:
   // Do not reuse debug info across function boundaries.
   void finishFunction() { hasInfo = false; }
 
+  // The position of the reader in the mappings. This can be saved and later
+  // restored, possibly in a copy of the reader, to read the debug locations of
+  // different parts of the binary independently.
+  struct State {
+    size_t pos;
+    size_t location;
+    uint32_t file, line, col, symbol;
+    bool hasInfo, hasSymbol;
+  };
+
+  State getState() const {
+    return {pos, location, file, line, col, symbol, hasInfo, hasSymbol};
+  }
+
+  void setState(const State& state) {
+    pos = state.pos;
+    location = state.location;
+    file = state.file;
+    line = state.line;
+    col = state.col;
+    symbol = state.symbol;
+    hasInfo = state.hasInfo;
+    hasSymbol = state.hasSymbol;
+  }
+
 private:
   char peek() {
     if (pos == mappings.size()) {
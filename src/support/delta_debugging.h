@@ -19,6 +19,8 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <functional>
 #include <vector>
 
 #include "support/index.h"
@@ -30,7 +32,15 @@ namespace wasm {
 // items found so far and `test` is the smaller set of items that should be
 // tested next. After testing, call `accept()`, `reject()`, or `resolve(bool
 // accepted)` to update the working and test sets appropriately.
+//
+// Items can optionally be given weights, such as their sizes. Partitions are
+// then made to have similar total weights instead of similar numbers of items,
+// so that a few large items are tested apart from many small ones early on.
+// Once there are as many partitions as items, each item is a partition of its
+// own either way, so the result is minimal in the same sense.
 template<typename T> struct DeltaDebugger {
+  using Weight = std::function<uint64_t(const T&)>;
+
   std::vector<T> working;
   std::vector<T> test;
 
@@ -41,9 +51,11 @@ private:
   bool triedEmpty = false;
   bool isFinished = false;
   std::vector<std::vector<T>> partitions;
+  Weight weight;
 
 public:
-  DeltaDebugger(std::vector<T> items) : working(std::move(items)) {}
+  DeltaDebugger(std::vector<T> items, Weight weight = nullptr)
+    : working(std::move(items)), weight(std::move(weight)) {}
 
   bool finished() const {
     return isFinished || (triedEmpty && working.size() <= 1);
@@ -93,7 +105,7 @@ public:
     if (currentPartition >= partitions.size()) {
       // No need to test complements if there are only two partitions, since
       // that is no different.
-      if (!testingComplements && numPartitions > 2) {
+      if (!testingComplements && partitions.size() > 2) {
         testingComplements = true;
         currentPartition = 0;
       } else {
@@ -149,6 +161,16 @@ private:
     size_t size = working.size();
     assert(numPartitions != 0 && numPartitions <= size);
 
+    if (weight && numPartitions < size) {
+      generateWeightedPartitions();
+      // If a single item is heavy enough to pull all the others into its
+      // partition, there is nothing to test, so split by count instead.
+      if (partitions.size() > 1) {
+        return;
+      }
+      partitions.clear();
+    }
+
     size_t basePartitionSize = size / numPartitions;
     size_t rem = size % numPartitions;
     size_t idx = 0;
@@ -164,6 +186,35 @@ private:
       }
     }
   }
+
+  void generateWeightedPartitions() {
+    // Every item weighs something, so that the partitions cover them all.
+    std::vector<uint64_t> weights;
+    weights.reserve(working.size());
+    uint64_t total = 0;
+    for (auto& item : working) {
+      weights.push_back(std::max(weight(item), uint64_t(1)));
+      total += weights.back();
+    }
+
+    // Each item goes in the partition that contains the middle of its weight.
+    // Heavy items can leave some partitions empty, which we skip, so there may
+    // be fewer partitions than asked for.
+    partitions.resize(numPartitions);
+    uint64_t before = 0;
+    for (size_t i = 0; i < working.size(); ++i) {
+      double middle = (double(before) + weights[i] / 2.0) / total;
+      auto index = std::min(size_t(middle * numPartitions),
+                            size_t(numPartitions - 1));
+      partitions[index].push_back(working[i]);
+      before += weights[i];
+    }
+    partitions.erase(
+      std::remove_if(partitions.begin(),
+                     partitions.end(),
+                     [](auto& partition) { return partition.empty(); }),
+      partitions.end());
+  }
 };
 
 } // namespace wasm
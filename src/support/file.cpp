@@ -24,6 +24,14 @@
 #include <iostream>
 #include <limits>
 
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+#define HAVE_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #define DEBUG_TYPE "file"
 
 std::vector<char> wasm::read_stdin() {
@@ -90,6 +98,46 @@ T wasm::read_file(const std::string& filename, Flags::BinaryOption binary) {
   return input;
 }
 
+wasm::MappedFile::MappedFile(const std::string& filename) {
+#ifdef HAVE_MMAP
+  if (filename != "-") {
+    BYN_TRACE("Mapping '" << filename << "'...\n");
+    int fd = open(wasm::Path::to_path(filename).c_str(), O_RDONLY);
+    if (fd < 0) {
+      Fatal() << "Failed opening '" << filename << "'";
+    }
+    struct stat info;
+    if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0 &&
+        uint64_t(info.st_size) < std::numeric_limits<size_t>::max()) {
+      void* addr =
+        mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+      if (addr != MAP_FAILED) {
+        data = static_cast<const char*>(addr);
+        size = size_t(info.st_size);
+        mapped = true;
+      }
+    }
+    // The mapping, if we made one, keeps the file alive.
+    close(fd);
+    if (mapped) {
+      return;
+    }
+  }
+#endif
+  // Fall back to reading the whole file.
+  buffer = read_file<std::vector<char>>(filename, Flags::Binary);
+  data = buffer.data();
+  size = buffer.size();
+}
+
+wasm::MappedFile::~MappedFile() {
+#ifdef HAVE_MMAP
+  if (mapped) {
+    munmap(const_cast<char*>(data), size);
+  }
+#endif
+}
+
 std::string wasm::read_possible_response_file(const std::string& input) {
   if (input.size() == 0 || input[0] != '@') {
     return input;
@@ -23,6 +23,7 @@
 
 #include <fstream>
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
@@ -43,6 +44,28 @@ extern template std::string read_file<>(const std::string&,
 extern template std::vector<char> read_file<>(const std::string&,
                                               Flags::BinaryOption);
 
+// The contents of a file, for reading. Where the platform supports it the file
+// is mapped into memory instead of being copied into a buffer, so large inputs
+// are paged in on demand and shared with the OS file cache. The contents stay
+// valid for the lifetime of this object. A filename of "-" reads stdin.
+class MappedFile {
+public:
+  MappedFile(const std::string& filename);
+  ~MappedFile();
+
+  std::string_view view() const { return {data, size}; }
+
+private:
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  const char* data = nullptr;
+  size_t size = 0;
+  bool mapped = false;
+  // Holds the contents when they could not be mapped.
+  std::vector<char> buffer;
+};
+
 // Given a string which may be a response file (i.e., a filename starting
 // with "@"), if it is a response file read it and return that, or if it
 // is not a response file, return it as is.
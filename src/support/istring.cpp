@@ -48,16 +48,20 @@ const char* IString::interned(std::string_view s) {
   };
   using StringSet = std::unordered_set<View, InternedHash, InternedEqual>;
 
-  // The authoritative global set of interned string views.
-  static StringSet globalStrings;
+  // The authoritative global set of interned string views, split into shards
+  // by hash so that threads interning different strings rarely contend on the
+  // same lock. Each shard's lock guards its set.
+  struct Shard {
+    std::mutex mutex;
+    StringSet strings;
+  };
+  static constexpr size_t NumShards = 64;
+  static Shard shards[NumShards];
 
   // The global backing store for interned strings that do not otherwise have
-  // stable addresses.
+  // stable addresses. (note: `arena` is thread-safe anyhow)
   static MixedArena arena;
 
-  // Guards access to `globalStrings`. (note: `arena` is thread-safe anyhow)
-  static std::mutex mutex;
-
   // A thread-local cache of strings to reduce contention.
   thread_local static StringSet localStrings;
 
@@ -67,8 +71,9 @@ const char* IString::interned(std::string_view s) {
   }
 
   // No copy yet in the local cache. Check the global cache.
-  std::unique_lock<std::mutex> lock(mutex);
-  if (auto it = globalStrings.find(s); it != globalStrings.end()) {
+  auto& shard = shards[std::hash<std::string_view>{}(s) % NumShards];
+  std::unique_lock<std::mutex> lock(shard.mutex);
+  if (auto it = shard.strings.find(s); it != shard.strings.end()) {
     // We already had a global copy of this string. Cache it locally.
     localStrings.insert(*it);
     return it->internal;
@@ -89,7 +94,7 @@ const char* IString::interned(std::string_view s) {
 
   // Intern our new string.
   View v{data};
-  globalStrings.insert(v);
+  shard.strings.insert(v);
   localStrings.insert(v);
   return data;
 }
@@ -70,6 +70,11 @@ struct MixedArena {
 
   size_t index = 0; // in last chunk
 
+  // The total size of the chunks of this arena (not including the arenas for
+  // other threads). This is only updated when a chunk is allocated, so that
+  // allocations that fit in the current chunk do not pay for it.
+  size_t chunkBytes = 0;
+
   std::thread::id threadId;
 
   // multithreaded allocation - each arena is valid on a specific thread.
@@ -130,6 +135,7 @@ struct MixedArena {
         abort();
       }
       chunks.push_back(allocation);
+      chunkBytes += numChunks * CHUNK_SIZE;
       index = 0;
     }
     uint8_t* ret = static_cast<uint8_t*>(chunks.back());
@@ -139,6 +145,21 @@ struct MixedArena {
     return static_cast<void*>(ret);
   }
 
+  // The number of bytes allocated so far on all threads, including padding
+  // and the ends of chunks that were too small for the next allocation. This
+  // must not be called while other threads may be allocating.
+  size_t getAllocatedBytes() const {
+    size_t total = 0;
+    for (auto* curr = this; curr; curr = curr->next.load()) {
+      total += curr->chunkBytes;
+      // Do not count the part of the last chunk that is still free.
+      if (!curr->chunks.empty() && curr->index < CHUNK_SIZE) {
+        total -= CHUNK_SIZE - curr->index;
+      }
+    }
+    return total;
+  }
+
   template<class T> T* alloc() {
     static_assert(alignof(T) <= MAX_ALIGN,
                   "maximum alignment not large enough");
@@ -153,6 +174,7 @@ struct MixedArena {
       wasm::aligned_free(chunk);
     }
     chunks.clear();
+    chunkBytes = 0;
   }
 
   ~MixedArena() {
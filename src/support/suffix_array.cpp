@@ -0,0 +1,244 @@
+/*
+ * Copyright 2026 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <limits>
+
+#include "support/suffix_array.h"
+
+namespace wasm {
+
+namespace {
+
+// Replace the symbols of a string with their ranks among its distinct symbols,
+// so that they can index buckets in SA-IS. Sorts the positions of the string by
+// symbol with two passes of a radix sort on 16 bits, so this is linear in the
+// size of the string however large the symbols are. Returns the largest rank.
+int32_t rankSymbols(const std::vector<uint32_t>& str,
+                    std::vector<int32_t>& ranks) {
+  std::vector<uint32_t> order(str.size()), sorted(str.size());
+  for (uint32_t i = 0; i < str.size(); ++i) {
+    order[i] = i;
+  }
+  for (int shift : {0, 16}) {
+    std::vector<uint32_t> starts((1 << 16) + 1);
+    for (auto i : order) {
+      ++starts[((str[i] >> shift) & 0xffff) + 1];
+    }
+    for (size_t digit = 1; digit < starts.size(); ++digit) {
+      starts[digit] += starts[digit - 1];
+    }
+    for (auto i : order) {
+      sorted[starts[(str[i] >> shift) & 0xffff]++] = i;
+    }
+    std::swap(order, sorted);
+  }
+  ranks.resize(str.size());
+  int32_t rank = 0;
+  for (size_t j = 0; j < order.size(); ++j) {
+    if (j > 0 && str[order[j]] != str[order[j - 1]]) {
+      ++rank;
+    }
+    ranks[order[j]] = rank;
+  }
+  return rank;
+}
+
+// Compute the suffix array of a string of symbols in [0, maxSymbol] with SA-IS.
+// Suffixes are classified as S-type if they are smaller than the suffix after
+// them and L-type otherwise, with the last one L-type as if the string ended
+// with a symbol smaller than all others. The leftmost S-type suffixes of each
+// run (the LMS suffixes) are sorted by sorting the substrings that start at
+// them, naming those and recursively sorting the string of their names, and
+// the order of all the other suffixes is then induced from theirs.
+std::vector<int32_t> sais(const std::vector<int32_t>& str, int32_t maxSymbol) {
+  int32_t size = str.size();
+  if (size == 0) {
+    return {};
+  }
+  if (size == 1) {
+    return {0};
+  }
+  if (size == 2) {
+    if (str[0] < str[1]) {
+      return {0, 1};
+    }
+    return {1, 0};
+  }
+
+  std::vector<bool> isS(size);
+  for (int32_t i = size - 2; i >= 0; --i) {
+    isS[i] = str[i] == str[i + 1] ? isS[i + 1] : str[i] < str[i + 1];
+  }
+
+  // Each symbol has a bucket of the suffixes that start with it, with the
+  // L-type ones first. Find where the S-type and L-type parts of each start.
+  std::vector<int32_t> sStarts(maxSymbol + 1), lStarts(maxSymbol + 2);
+  for (int32_t i = 0; i < size; ++i) {
+    if (isS[i]) {
+      ++lStarts[str[i] + 1];
+    } else {
+      ++sStarts[str[i]];
+    }
+  }
+  for (int32_t symbol = 0; symbol <= maxSymbol; ++symbol) {
+    sStarts[symbol] += lStarts[symbol];
+    lStarts[symbol + 1] += sStarts[symbol];
+  }
+
+  auto isLMS = [&](int32_t i) { return i > 0 && !isS[i - 1] && isS[i]; };
+
+  std::vector<int32_t> suffixes(size);
+  std::vector<int32_t> next(maxSymbol + 2);
+  // Place the given LMS suffixes in the S-type parts of their buckets, in
+  // order, and induce the order of the L-type suffixes from them, left to
+  // right, and then of all the S-type ones, right to left.
+  auto induce = [&](const std::vector<int32_t>& lms) {
+    std::fill(suffixes.begin(), suffixes.end(), -1);
+    std::copy(sStarts.begin(), sStarts.end(), next.begin());
+    for (auto i : lms) {
+      suffixes[next[str[i]]++] = i;
+    }
+    std::copy(lStarts.begin(), lStarts.end() - 1, next.begin());
+    suffixes[next[str[size - 1]]++] = size - 1;
+    for (int32_t j = 0; j < size; ++j) {
+      auto i = suffixes[j];
+      if (i >= 1 && !isS[i - 1]) {
+        suffixes[next[str[i - 1]]++] = i - 1;
+      }
+    }
+    std::copy(lStarts.begin(), lStarts.end(), next.begin());
+    for (int32_t j = size - 1; j >= 0; --j) {
+      auto i = suffixes[j];
+      if (i >= 1 && isS[i - 1]) {
+        suffixes[--next[str[i - 1] + 1]] = i - 1;
+      }
+    }
+  };
+
+  // Number the LMS suffixes in string order.
+  std::vector<int32_t> lms;
+  std::vector<int32_t> lmsIndex(size, -1);
+  for (int32_t i = 1; i < size; ++i) {
+    if (isLMS(i)) {
+      lmsIndex[i] = lms.size();
+      lms.push_back(i);
+    }
+  }
+  int32_t numLMS = lms.size();
+
+  // Inducing from the LMS suffixes in any order sorts the LMS substrings, each
+  // of which runs from an LMS suffix to the next one, or to the end.
+  induce(lms);
+  if (numLMS == 0) {
+    return suffixes;
+  }
+
+  std::vector<int32_t> sortedLMS;
+  sortedLMS.reserve(numLMS);
+  for (auto i : suffixes) {
+    if (lmsIndex[i] != -1) {
+      sortedLMS.push_back(i);
+    }
+  }
+
+  // Name the LMS substrings by their rank among the distinct ones, and sort the
+  // LMS suffixes by sorting the string of names.
+  std::vector<int32_t> names(numLMS);
+  int32_t name = 0;
+  names[lmsIndex[sortedLMS[0]]] = 0;
+  for (int32_t j = 1; j < numLMS; ++j) {
+    auto a = sortedLMS[j - 1], b = sortedLMS[j];
+    auto aEnd = lmsIndex[a] + 1 < numLMS ? lms[lmsIndex[a] + 1] : size;
+    auto bEnd = lmsIndex[b] + 1 < numLMS ? lms[lmsIndex[b] + 1] : size;
+    bool same = aEnd - a == bEnd - b;
+    if (same) {
+      while (a < aEnd && str[a] == str[b]) {
+        ++a;
+        ++b;
+      }
+      same = a < size && b < size && str[a] == str[b];
+    }
+    if (!same) {
+      ++name;
+    }
+    names[lmsIndex[sortedLMS[j]]] = name;
+  }
+  lmsIndex.clear();
+  lmsIndex.shrink_to_fit();
+
+  if (name + 1 < numLMS) {
+    auto order = sais(names, name);
+    for (int32_t j = 0; j < numLMS; ++j) {
+      sortedLMS[j] = lms[order[j]];
+    }
+  } else {
+    // The names are distinct, so they already give the order.
+    for (int32_t j = 0; j < numLMS; ++j) {
+      sortedLMS[names[j]] = lms[j];
+    }
+  }
+  names.clear();
+  names.shrink_to_fit();
+
+  induce(sortedLMS);
+  return suffixes;
+}
+
+} // anonymous namespace
+
+SuffixArray::SuffixArray(const std::vector<uint32_t>& str) : str(str) {
+  assert(str.size() <= uint32_t(std::numeric_limits<int32_t>::max()));
+  uint32_t size = str.size();
+
+  {
+    std::vector<int32_t> ranks;
+    auto maxRank = rankSymbols(str, ranks);
+    auto sorted = sais(ranks, maxRank);
+    suffixes.assign(sorted.begin(), sorted.end());
+  }
+
+  // Kasai et al.: the suffix after the one at i shares at least one symbol less
+  // than it with its predecessor in the suffix array than the suffix at i does
+  // with its own, so the LCPs can be found in string order in linear time.
+  lcps.resize(size);
+  {
+    std::vector<uint32_t> positions(size);
+    for (uint32_t j = 0; j < size; ++j) {
+      positions[suffixes[j]] = j;
+    }
+    uint32_t lcp = 0;
+    for (uint32_t i = 0; i < size; ++i) {
+      auto j = positions[i];
+      if (j == 0) {
+        lcp = 0;
+        continue;
+      }
+      auto prev = suffixes[j - 1];
+      while (i + lcp < size && prev + lcp < size &&
+             str[i + lcp] == str[prev + lcp]) {
+        ++lcp;
+      }
+      lcps[j] = lcp;
+      if (lcp > 0) {
+        --lcp;
+      }
+    }
+  }
+}
+
+} // namespace wasm
@@ -0,0 +1,154 @@
+/*
+ * Copyright 2026 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// A suffix array with its LCP array, for finding repeated substrings of a
+// string of integers.
+//
+// This answers the same questions as the SuffixTree in suffix_tree.h, but it
+// needs only a few flat arrays of 32-bit integers (two once constructed) rather
+// than a node with a map of children per suffix, and it reports the repeated
+// substrings one at a time rather than collecting them, so it scales to very
+// large strings. The suffix array is built in linear time with SA-IS (Nong,
+// Zhang & Chan, "Linear Suffix Array Construction by Almost Pure
+// Induced-Sorting"), the LCP array with Kasai et al.'s algorithm, and the
+// repeated substrings are found by a bottom-up traversal of the LCP intervals,
+// each of which corresponds to an internal node of the suffix tree
+// (Abouelhoda, Kurtz & Ohlebusch, "Replacing suffix trees with enhanced suffix
+// arrays").
+
+#ifndef wasm_support_suffix_array_h
+#define wasm_support_suffix_array_h
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace wasm {
+
+class SuffixArray {
+public:
+  // Build the suffix array of a string. The string is not copied, and must
+  // outlive this object.
+  SuffixArray(const std::vector<uint32_t>& str);
+
+  // The start indices of the suffixes of the string, in lexicographic order
+  // (comparing symbols as unsigned integers).
+  const std::vector<uint32_t>& getSuffixes() const { return suffixes; }
+
+  // The length of the longest common prefix of each suffix and the previous
+  // one in the order above. The first entry is 0.
+  const std::vector<uint32_t>& getLCPs() const { return lcps; }
+
+  // Call |func| with each substring of at least |minLength| symbols that
+  // occurs more than once and that cannot be extended to the right without
+  // losing an occurrence, with its length and the start indices of all its
+  // occurrences, in no particular order. Occurrences may overlap each other.
+  // The start indices are a range of getSuffixes().
+  template<typename F> void forEachRepeat(uint32_t minLength, F func) const;
+
+  // Call |func| with the same substrings as SuffixTree's iterator would find,
+  // with the start indices it would find for them: the suffixes that are leaves
+  // directly under the substring's node in the suffix tree, i.e. the
+  // occurrences that are not also occurrences of a longer repeated substring
+  // that starts with this one. Substrings with fewer than two such occurrences
+  // are skipped. This requires the string to end with a symbol that occurs
+  // nowhere else, as otherwise the suffix tree has no leaves for some
+  // suffixes. The span is only valid during the call.
+  template<typename F>
+  void forEachRepeatWithDirectLeaves(uint32_t minLength, F func) const;
+
+private:
+  const std::vector<uint32_t>& str;
+  std::vector<uint32_t> suffixes;
+  std::vector<uint32_t> lcps;
+};
+
+template<typename F>
+void SuffixArray::forEachRepeat(uint32_t minLength, F func) const {
+  // Each repeated substring is an LCP interval: a maximal range of suffixes
+  // whose common prefix is that substring. Find them with a stack of the open
+  // intervals, which are nested, and report each as it is closed.
+  struct Open {
+    uint32_t lcp;
+    uint32_t begin;
+  };
+  std::vector<Open> stack{{0, 0}};
+  uint32_t size = suffixes.size();
+  for (uint32_t i = 1; i <= size; ++i) {
+    uint32_t lcp = i < size ? lcps[i] : 0;
+    uint32_t begin = i - 1;
+    while (lcp < stack.back().lcp) {
+      auto closed = stack.back();
+      stack.pop_back();
+      if (closed.lcp >= minLength) {
+        func(closed.lcp,
+             std::span<const uint32_t>(suffixes.data() + closed.begin,
+                                       i - closed.begin));
+      }
+      begin = closed.begin;
+    }
+    if (lcp > stack.back().lcp) {
+      stack.push_back({lcp, begin});
+    }
+  }
+}
+
+template<typename F>
+void SuffixArray::forEachRepeatWithDirectLeaves(uint32_t minLength,
+                                                F func) const {
+  // As above, but rather than the range of all the suffixes in an interval,
+  // keep the suffixes that are not in any nested interval. They are the last
+  // ones in |leaves| when the interval is closed, as the leaves of the nested
+  // intervals have been removed when those were closed.
+  struct Open {
+    uint32_t lcp;
+    uint32_t leavesBegin;
+  };
+  std::vector<Open> stack{{0, 0}};
+  std::vector<uint32_t> leaves;
+  uint32_t size = suffixes.size();
+  for (uint32_t i = 0; i < size; ++i) {
+    // The top of the stack is the deepest interval that contains suffix i and
+    // the one before it, whose common prefix has length lcps[i]. If suffix i
+    // shares a longer prefix with the next one, it is the first suffix of a
+    // deeper interval instead.
+    uint32_t lcp = i + 1 < size ? lcps[i + 1] : 0;
+    if (lcp > stack.back().lcp) {
+      stack.push_back({lcp, uint32_t(leaves.size())});
+    }
+    leaves.push_back(suffixes[i]);
+    while (lcp < stack.back().lcp) {
+      auto closed = stack.back();
+      stack.pop_back();
+      auto numLeaves = leaves.size() - closed.leavesBegin;
+      if (closed.lcp >= minLength && numLeaves >= 2) {
+        func(closed.lcp,
+             std::span<const uint32_t>(leaves.data() + closed.leavesBegin,
+                                       numLeaves));
+      }
+      leaves.resize(closed.leavesBegin);
+      // The interval may be nested in one that has not been opened yet,
+      // because it starts at the same suffix.
+      if (lcp > stack.back().lcp) {
+        stack.push_back({lcp, uint32_t(leaves.size())});
+      }
+    }
+  }
+}
+
+} // namespace wasm
+
+#endif // wasm_support_suffix_array_h
@@ -19,11 +19,16 @@
 #include <algorithm>
 #include <iostream>
 #include <string>
+#include <unordered_set>
 
 #ifdef __linux__
 #include <sched.h> // For sched_getaffinity
 #endif
 
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+#include <pthread.h> // For pthread_atfork
+#endif
+
 #include "compiler-support.h"
 #include "support/debug.h"
 #include "threads.h"
@@ -58,97 +63,66 @@ static std::mutex debug;
 
 namespace wasm {
 
-// Thread
+// ThreadPool
 
-Thread::Thread(ThreadPool* parent) : parent(parent) {
-  assert(!parent->isRunning());
-  thread = std::make_unique<std::thread>(mainLoop, this);
-}
+// Global threadPool state. We have a singleton pool, which is shared by all
+// users of parallelism, so that nested parallel work does not oversubscribe
+// the cores.
 
-Thread::~Thread() {
-  {
-    std::lock_guard<std::mutex> lock(mutex);
-    // notify the thread that it can exit
-    done = true;
-    condition.notify_one();
+static std::unique_ptr<ThreadPool> pool;
+
+std::mutex ThreadPool::creationMutex;
+
+void ThreadPool::initialize(size_t num) {
+  // The threads that wait on tasks help to run them, so we need one fewer
+  // helper thread than the number of cores.
+  if (num <= 1) {
+    return; // no multiple cores, don't create threads
   }
-  thread->join();
+  DEBUG_POOL("initialize()\n");
+  for (size_t i = 0; i + 1 < num; i++) {
+    try {
+      threads.emplace_back(std::make_unique<std::thread>(mainLoop, this));
+    } catch (std::system_error&) {
+      // failed to create a thread - make do with the ones we have
+      DEBUG_POOL("could not create thread\n");
+      break;
+    }
+  }
+  DEBUG_POOL("initialize() is done\n");
 }
 
-void Thread::work(std::function<ThreadWorkState()> doWork_) {
-  // TODO: fancy work stealing
-  DEBUG_THREAD("send work to thread\n");
+ThreadPool::~ThreadPool() {
   {
     std::lock_guard<std::mutex> lock(mutex);
-    // notify the thread that it can do some work
-    doWork = doWork_;
-    condition.notify_one();
-    DEBUG_THREAD("work sent\n");
+    // notify the threads that they can exit
+    shutdown = true;
+    condition.notify_all();
+  }
+  for (auto& thread : threads) {
+    thread->join();
   }
 }
 
-void Thread::mainLoop(void* self_) {
-  auto* self = static_cast<Thread*>(self_);
+void ThreadPool::mainLoop(ThreadPool* self) {
   while (1) {
-    DEBUG_THREAD("checking for work\n");
+    std::shared_ptr<ThreadTask> task;
     {
       std::unique_lock<std::mutex> lock(self->mutex);
-      if (self->doWork) {
-        DEBUG_THREAD("doing work\n");
-        // run tasks until they are all done
-        while (self->doWork() == ThreadWorkState::More) {
-        }
-        self->doWork = nullptr;
-      } else if (self->done) {
+      DEBUG_THREAD("thread waiting\n");
+      self->condition.wait(
+        lock, [&]() { return self->shutdown || !self->queue.empty(); });
+      if (self->queue.empty()) {
         DEBUG_THREAD("done\n");
         return;
       }
+      // Idle threads take the oldest tasks first.
+      task = self->queue.front();
+      self->queue.pop_front();
     }
-    self->parent->notifyThreadIsReady();
-    {
-      std::unique_lock<std::mutex> lock(self->mutex);
-      if (!self->done && !self->doWork) {
-        DEBUG_THREAD("thread waiting\n");
-        self->condition.wait(lock);
-      }
-    }
-  }
-}
-
-// ThreadPool
-
-// Global threadPool state. We have a singleton pool, which can only be
-// used from one place at a time.
-
-static std::unique_ptr<ThreadPool> pool;
-
-std::mutex ThreadPool::creationMutex;
-std::mutex ThreadPool::workMutex;
-std::mutex ThreadPool::threadMutex;
-
-void ThreadPool::initialize(size_t num) {
-  if (num == 1) {
-    return; // no multiple cores, don't create threads
-  }
-  DEBUG_POOL("initialize()\n");
-  std::unique_lock<std::mutex> lock(threadMutex);
-  // initial state before first resetThreadsAreReady()
-  ready.store(threads.size());
-  resetThreadsAreReady();
-  for (size_t i = 0; i < num; i++) {
-    try {
-      threads.emplace_back(std::make_unique<Thread>(this));
-    } catch (std::system_error&) {
-      // failed to create a thread - don't use multithreading, as if num cores
-      // == 1
-      DEBUG_POOL("could not create thread\n");
-      threads.clear();
-      return;
-    }
+    DEBUG_THREAD("doing work\n");
+    self->tryRun(task);
   }
-  DEBUG_POOL("initialize() waiting\n");
-  condition.wait(lock, [this]() { return areThreadsReady(); });
-  DEBUG_POOL("initialize() is done\n");
 }
 
 size_t ThreadPool::getNumCores() {
@@ -190,69 +164,154 @@ ThreadPool* ThreadPool::get() {
     temp->initialize(getNumCores());
     // assign it to the global location now that it is all ready
     pool.swap(temp);
+#if !defined(_WIN32) && !defined(__EMSCRIPTEN__)
+    // A child process that is forked from this one has none of our helper
+    // threads, so it must run everything on its own thread. The threads can
+    // neither be joined nor destroyed there, so just forget about them.
+    pthread_atfork(nullptr, nullptr, []() {
+      for (auto& thread : pool->threads) {
+        thread.release();
+      }
+      pool->threads.clear();
+    });
+#endif
     DEBUG_POOL("::get() created\n");
   }
   return pool.get();
 }
 
-void ThreadPool::work(
-  std::vector<std::function<ThreadWorkState()>>& doWorkers) {
-  size_t num = threads.size();
-  // If no multiple cores, or on a side thread, do not use worker threads
-  if (num == 0) {
-    // just run sequentially
-    DEBUG_POOL("work() sequentially\n");
-    assert(doWorkers.size() > 0);
-    while (doWorkers[0]() == ThreadWorkState::More) {
-    }
+void ThreadPool::schedule(std::shared_ptr<ThreadTask> task) {
+  if (threads.empty()) {
+    // Without helper threads, just run sequentially.
+    tryRun(task);
     return;
   }
-  // run in parallel on threads
-  // TODO: fancy work stealing
-  DEBUG_POOL("work() on threads\n");
-  // lock globally on doing work in the pool - the threadPool can only be used
-  // from one thread at a time, all others must wait patiently
-  std::lock_guard<std::mutex> poolLock(workMutex);
-  assert(doWorkers.size() == num);
-  assert(!running);
-  DEBUG_POOL("running = true\n");
-  running = true;
-  std::unique_lock<std::mutex> lock(threadMutex);
-  resetThreadsAreReady();
-  for (size_t i = 0; i < num; i++) {
-    threads[i]->work(doWorkers[i]);
-  }
-  DEBUG_POOL("main thread waiting\n");
-  condition.wait(lock, [this]() { return areThreadsReady(); });
-  DEBUG_POOL("main thread done waiting\n");
-  DEBUG_POOL("running = false\n");
-  running = false;
-  DEBUG_POOL("work() is done\n");
+  std::lock_guard<std::mutex> lock(mutex);
+  queue.push_back(task);
+  generation++;
+  // Wake up a helper thread, and any thread waiting on this task.
+  condition.notify_all();
 }
 
-size_t ThreadPool::size() { return std::max(size_t(1), threads.size()); }
+bool ThreadPool::tryRun(std::shared_ptr<ThreadTask> task) {
+  if (task->claimed.exchange(true)) {
+    return false;
+  }
+  task->func();
+  // Free anything the work captured as soon as we can.
+  task->func = nullptr;
+  std::vector<std::shared_ptr<ThreadTask>> successors;
+  {
+    std::lock_guard<std::mutex> lock(task->mutex);
+    task->done = true;
+    successors.swap(task->successors);
+  }
+  for (auto& successor : successors) {
+    if (successor->pending.fetch_sub(1) == 1) {
+      schedule(successor);
+    }
+  }
+  // Wake up anyone waiting on this task. Taking the lock ensures that a waiter
+  // cannot miss the notification between checking the task and waiting.
+  std::lock_guard<std::mutex> lock(mutex);
+  generation++;
+  condition.notify_all();
+  return true;
+}
 
-bool ThreadPool::isRunning() {
-  DEBUG_POOL("check if running\n");
-  return running;
+std::shared_ptr<ThreadTask>
+ThreadPool::findRunnable(std::shared_ptr<ThreadTask> task) {
+  // The dependencies of a task never change once it is created, so they can be
+  // walked without locking. A task whose dependencies are all done is either
+  // queued or about to be, and can be run by whoever claims it first.
+  std::vector<std::shared_ptr<ThreadTask>> stack{task};
+  std::unordered_set<ThreadTask*> seen;
+  while (!stack.empty()) {
+    auto curr = stack.back();
+    stack.pop_back();
+    if (curr->done || curr->claimed || !seen.insert(curr.get()).second) {
+      continue;
+    }
+    if (curr->pending == 0) {
+      return curr;
+    }
+    for (auto& weakDep : curr->deps) {
+      if (auto dep = weakDep.lock()) {
+        stack.push_back(dep);
+      }
+    }
+  }
+  return nullptr;
 }
 
-void ThreadPool::notifyThreadIsReady() {
-  DEBUG_POOL("notify thread is ready\n";)
-  std::lock_guard<std::mutex> lock(threadMutex);
-  ready.fetch_add(1);
-  condition.notify_one();
+Future ThreadPool::async(std::function<void()> func) { return after({}, func); }
+
+Future ThreadPool::after(const std::vector<Future>& deps,
+                         std::function<void()> func) {
+  Future future;
+  future.task = std::make_shared<ThreadTask>();
+  auto& task = future.task;
+  task->func = std::move(func);
+  // Hold an extra pending count while we register with the dependencies, so
+  // that the task cannot be scheduled before we are done.
+  task->pending = deps.size() + 1;
+  for (auto& dep : deps) {
+    assert(dep.valid());
+    task->deps.push_back(dep.task);
+    std::lock_guard<std::mutex> lock(dep.task->mutex);
+    if (dep.task->done) {
+      task->pending--;
+    } else {
+      dep.task->successors.push_back(task);
+    }
+  }
+  if (task->pending.fetch_sub(1) == 1) {
+    schedule(task);
+  }
+  return future;
 }
 
-void ThreadPool::resetThreadsAreReady() {
-  DEBUG_POOL("reset threads are ready\n";)
-  [[maybe_unused]] auto old = ready.exchange(0);
-  assert(old == threads.size());
+void ThreadPool::wait(const Future& future) {
+  assert(future.valid());
+  while (!future.isReady()) {
+    size_t seen;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      seen = generation;
+    }
+    // Help out while we wait, but only with work that the future is blocked
+    // on. Running other tasks here would nest them on our stack, could hold us
+    // up long after the future is ready, and could deadlock if they need a
+    // lock that our caller holds.
+    if (auto task = findRunnable(future.task)) {
+      tryRun(task);
+      continue;
+    }
+    // Nothing to do but wait until something changes.
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(
+      lock, [&]() { return future.isReady() || generation != seen; });
+  }
 }
 
-bool ThreadPool::areThreadsReady() {
-  DEBUG_POOL("are threads ready?\n";)
-  return ready.load() == threads.size();
+void ThreadPool::work(
+  std::vector<std::function<ThreadWorkState()>>& doWorkers) {
+  assert(doWorkers.size() > 0);
+  DEBUG_POOL("work()\n");
+  std::vector<Future> futures;
+  for (auto& doWorker : doWorkers) {
+    futures.push_back(async([&doWorker]() {
+      // run tasks until they are all done
+      while (doWorker() == ThreadWorkState::More) {
+      }
+    }));
+  }
+  for (auto& future : futures) {
+    wait(future);
+  }
+  DEBUG_POOL("work() is done\n");
 }
 
+size_t ThreadPool::size() { return threads.size() + 1; }
+
 } // namespace wasm
@@ -24,6 +24,7 @@
 #include <atomic>
 #include <cassert>
 #include <condition_variable>
+#include <deque>
 #include <functional>
 #include <memory>
 #include <mutex>
@@ -41,80 +42,137 @@ enum class ThreadWorkState { More, Finished };
 class ThreadPool;
 
 //
-// A helper thread.
-//
-// You can only create and destroy these on the main thread.
+// A task in the pool's task graph: some work to do, and the tasks that depend
+// on it, which become runnable once it (and their other dependencies) finish.
 //
 
-class Thread {
-  ThreadPool* parent;
-  std::unique_ptr<std::thread> thread;
+struct ThreadTask {
+  std::function<void()> func;
+
+  // The number of dependencies that must finish before this task can run.
+  std::atomic<size_t> pending;
+
+  std::atomic<bool> done = false;
+
+  // Set by the thread that runs the task. A task may be claimed by a thread
+  // that waits on it while it is still in the queue, in which case the queue
+  // entry is skipped later.
+  std::atomic<bool> claimed = false;
+
+  // The tasks this one depends on, so that a thread waiting on it can find
+  // the work it is blocked on.
+  std::vector<std::weak_ptr<ThreadTask>> deps;
+
+  // Guards |successors| against concurrent registration and completion.
   std::mutex mutex;
-  std::condition_variable condition;
-  bool done = false;
-  std::function<ThreadWorkState()> doWork = nullptr;
+  std::vector<std::shared_ptr<ThreadTask>> successors;
+};
+
+//
+// A handle to a task that was submitted to the pool. Waiting on it is safe
+// from any thread, including from inside another task: the waiting thread
+// helps to run the task and the tasks it (transitively) depends on, so nested
+// parallelism makes progress without adding threads beyond the pool's cap.
+// Unrelated tasks are left to other threads, so that they do not nest on the
+// waiter's stack or delay it.
+//
+
+class Future {
+  std::shared_ptr<ThreadTask> task;
+
+  friend ThreadPool;
 
 public:
-  Thread(ThreadPool* parent);
-  ~Thread();
+  Future() = default;
 
-  // Start to do work, calling doWork() until
-  // it returns false.
-  void work(std::function<ThreadWorkState()> doWork);
+  bool valid() const { return bool(task); }
 
-private:
-  static void mainLoop(void* self);
+  bool isReady() const { return task->done.load(); }
+
+  // Block until the task has run.
+  void wait() const;
+
+  // Run |func| after this task. Returns a future for the continuation.
+  Future then(std::function<void()> func) const;
 };
 
 //
-// A pool of helper threads.
+// A pool of helper threads that runs a graph of tasks.
 //
-// There is only one, to avoid recursive pools using too many cores.
+// There is only one, which is shared by all users, including nested ones, so
+// that the total number of threads stays within the number of cores (which
+// can be capped with BINARYEN_CORES). The pool has one fewer helper thread
+// than that, as a thread that waits on a task helps to run tasks itself.
 //
 
 class ThreadPool {
-  std::vector<std::unique_ptr<Thread>> threads;
-  bool running = false;
+  std::vector<std::unique_ptr<std::thread>> threads;
+
+  // Guards |queue| and |shutdown|, and is used with |condition| to wake up
+  // threads when tasks are queued or finish.
+  std::mutex mutex;
   std::condition_variable condition;
-  std::atomic<size_t> ready;
+  std::deque<std::shared_ptr<ThreadTask>> queue;
+  bool shutdown = false;
+
+  // Incremented whenever a task becomes ready or finishes, so that a waiting
+  // thread can tell whether there may be something new for it to do.
+  size_t generation = 0;
 
   // A mutex for creating the pool safely
   static std::mutex creationMutex;
-  // A mutex for work() so that the pool can only work on one
-  // thing at a time
-  static std::mutex workMutex;
-  // A mutex for communication with the worker threads
-  static std::mutex threadMutex;
 
 private:
   void initialize(size_t num);
 
+  // Queue a task whose dependencies are all done, or run it right away if
+  // there are no helper threads.
+  void schedule(std::shared_ptr<ThreadTask> task);
+
+  // Run a task, unless another thread has claimed it, and then schedule the
+  // successors that it unblocks. Returns whether the task was run.
+  bool tryRun(std::shared_ptr<ThreadTask> task);
+
+  // Find a task that |task| depends on, or |task| itself, that is ready to
+  // run and not yet claimed.
+  std::shared_ptr<ThreadTask> findRunnable(std::shared_ptr<ThreadTask> task);
+
+  static void mainLoop(ThreadPool* self);
+
 public:
+  ~ThreadPool();
+
   // Get the number of cores we can use.
   static size_t getNumCores();
 
   // Get the singleton threadpool.
   static ThreadPool* get();
 
-  // Execute a bunch of tasks by the pool. This calls
-  // getTask() (in a thread-safe manner) to get tasks, and
-  // sends them to workers to be executed. This method
-  // blocks until all tasks are complete.
-  void work(std::vector<std::function<ThreadWorkState()>>& doWorkers);
-
-  size_t size();
+  // Run |func| asynchronously.
+  Future async(std::function<void()> func);
 
-  bool isRunning();
+  // Run |func| asynchronously once all of |deps| are done.
+  Future after(const std::vector<Future>& deps, std::function<void()> func);
 
-  // Called by helper threads when they are free and ready.
-  void notifyThreadIsReady();
+  // Block until |future| is done, running the tasks it depends on in the
+  // meantime.
+  void wait(const Future& future);
 
-private:
-  void resetThreadsAreReady();
+  // Execute a bunch of workers in parallel. Each one is called repeatedly
+  // until it returns ThreadWorkState::Finished. This method blocks until all
+  // of them are finished, and it may be called from inside other work.
+  void work(std::vector<std::function<ThreadWorkState()>>& doWorkers);
 
-  bool areThreadsReady();
+  // The number of threads that can work in parallel.
+  size_t size();
 };
 
+inline void Future::wait() const { ThreadPool::get()->wait(*this); }
+
+inline Future Future::then(std::function<void()> func) const {
+  return ThreadPool::get()->after({*this}, std::move(func));
+}
+
 // Verify a code segment is only entered once. Usage:
 //    static OnlyOnce onlyOnce;
 //    onlyOnce.verify();
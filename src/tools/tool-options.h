@@ -174,6 +174,36 @@ struct ToolOptions : public Options {
 
              addPassArg(key, value);
            })
+      .add("--profile-passes",
+           "",
+           "Write a profile of the passes that are run to a file, in the "
+           "Chrome trace event format: the wall and CPU time, arena memory "
+           "allocated and change in IR size of each pass, and the slowest "
+           "functions in each function-parallel pass",
+           ToolOptionsCategory,
+           Options::Arguments::One,
+           [this](Options*, const std::string& argument) {
+             passOptions.profilePasses = argument;
+           })
+      .add("--function-cache",
+           "",
+           "Cache the results of optimizing functions in a directory, and "
+           "reuse them for functions that did not change since a previous "
+           "run",
+           ToolOptionsCategory,
+           Options::Arguments::One,
+           [this](Options*, const std::string& argument) {
+             passOptions.functionCache = argument;
+           })
+      .add("--function-cache-verify",
+           "",
+           "Optimize functions even when their results are in the function "
+           "cache, and check that the cached results match",
+           ToolOptionsCategory,
+           Options::Arguments::Zero,
+           [this](Options*, const std::string&) {
+             passOptions.functionCacheVerify = true;
+           })
       .add(
         "--closed-world",
         "-cw",
@@ -217,9 +217,20 @@ public:
     if (curr->value->type.isContinuation()) {
       throw FailToEvalException("cannot serialize continuations to globals");
     }
+    savedGlobals.try_emplace(curr->name, allGlobals.at(curr->name)->literals);
     return ModuleRunnerBase<EvallingModuleRunner>::visitGlobalSet(curr);
   }
 
+  void noteGCWrite(const std::shared_ptr<GCData>& data) {
+    savedGCData.try_emplace(data, data->values);
+  }
+
+  // The values that globals and GC data had at the last checkpoint, for those
+  // that were written to since then (see
+  // CtorEvalExternalInterface::checkpoint()).
+  std::unordered_map<Name, Literals> savedGlobals;
+  std::unordered_map<std::shared_ptr<GCData>, Literals> savedGCData;
+
   Flow visitTableGet(TableGet* curr) {
     // We support tableLoad, below, so that call_indirect works (it calls it
     // internally), but we want to disable table.get for now.
@@ -325,20 +336,100 @@ struct CtorEvalExternalInterface : EvallingModuleRunner::ExternalInterface {
     linkedInstances.swap(linkedInstances_);
   }
 
-  bool firstApplication = true;
+  // Execution is checkpointed after each piece of code that we eval
+  // successfully, and when we stop, we roll back to the last checkpoint and
+  // apply that state to the module, once. Checkpoints are cheap: rather than
+  // copy the entire state, we keep an undo log of the parts of it that were
+  // written to since the last checkpoint, that is, the original contents of
+  // memory pages (here) and of globals and GC data (in the instance). Tables
+  // cannot be modified after instantiation (see EvallingRuntimeTable), so they
+  // need no tracking.
+  static constexpr size_t CheckpointPageSize = 4096;
+
+  struct MemoryCheckpoint {
+    // The size of the memory at the checkpoint.
+    size_t size = 0;
+    // Page indexes to the contents those pages had at the checkpoint.
+    std::unordered_map<size_t, std::vector<char>> savedPages;
+  };
+  std::unordered_map<Name, MemoryCheckpoint> memoryCheckpoints;
+
+  // Whether we reached a checkpoint, that is, whether we evalled anything
+  // successfully, so that there is state to apply to the module.
+  bool hasCheckpoint = false;
+
+  // Set once we applied the state to the module.
+  bool applied = false;
+
+  // Exports of evalled ctors that we keep around, and the results they must
+  // return. Their bodies are serialized when we apply to the module.
+  std::vector<std::pair<Function*, Literals>> keptResults;
+
+  // Starts tracking changes to the state from the current one, forgetting any
+  // changes made before.
+  void clearUndoLog() {
+    for (auto& [name, memory] : memories) {
+      auto& saved = memoryCheckpoints[name];
+      saved.size = memory.size();
+      saved.savedPages.clear();
+    }
+    instance->savedGlobals.clear();
+    instance->savedGCData.clear();
+  }
+
+  // Marks the current state of execution as valid to be applied to the module.
+  void checkpoint() {
+    clearUndoLog();
+    hasCheckpoint = true;
+  }
+
+  // Rolls back all changes to the state since the last checkpoint. This is
+  // proportional to the amount of state that was written to since then.
+  void restoreCheckpoint() {
+    for (auto& [name, memory] : memories) {
+      auto& saved = memoryCheckpoints[name];
+      for (auto& [page, contents] : saved.savedPages) {
+        std::copy(contents.begin(),
+                  contents.end(),
+                  memory.begin() + page * CheckpointPageSize);
+      }
+      memory.resize(saved.size);
+      saved.savedPages.clear();
+    }
+    for (auto& [name, literals] : instance->savedGlobals) {
+      instance->allGlobals.at(name)->literals = literals;
+    }
+    instance->savedGlobals.clear();
+    for (auto& [data, values] : instance->savedGCData) {
+      data->values = values;
+    }
+    instance->savedGCData.clear();
+  }
 
-  // Called when we want to apply the current state of execution to the Module.
-  // Until this is called the Module is never changed.
+  // Called when we are done evalling, to apply the state of execution at the
+  // last checkpoint to the Module, if there is one. Until this is called the
+  // Module is never changed (except for the serialization of any locals of a
+  // partially-evalled function, which must happen right before this, see
+  // evalCtor).
   void applyToModule() {
-    if (firstApplication) {
-      // The first time we apply things to the module, we can remove the start
-      // function: we evalled it successfully, if we got to here (and we must
-      // not execute it again later, which would mean it runs twice). We do not
-      // do this after the first application because we start to build up a new
-      // start function with the things we need, unrelated to the original one
-      // (see addStartFixup).
-      wasm->start = Name();
-      firstApplication = false;
+    if (!hasCheckpoint || applied) {
+      return;
+    }
+    applied = true;
+
+    // Drop any incomplete changes made after the last checkpoint.
+    restoreCheckpoint();
+
+    // We can remove the start function: we evalled it successfully, if we got
+    // to here (and we must not execute it again later, which would mean it
+    // runs twice). If we need a start function, we build up a new one with the
+    // things we need, unrelated to the original one (see addStartFixup).
+    wasm->start = Name();
+
+    for (auto& [func, results] : keptResults) {
+      func->body = getSerialization(results);
+      // Serialization problems were ruled out before evalling.
+      assert(func->body);
     }
 
     // If nothing was ever written to memories then there is nothing to update.
@@ -533,31 +624,36 @@ private:
   }
 
   template<typename T> void doStore(Address address, T value, Name memoryName) {
-    Bits::writeLE<T>(value, getMemory(address, memoryName, sizeof(T)));
+    auto* ptr = getMemory(address, memoryName, sizeof(T));
+    notePagesWritten(address, memoryName, sizeof(T));
+    Bits::writeLE<T>(value, ptr);
   }
 
   template<typename T> T doLoad(Address address, Name memoryName) {
     return Bits::readLE<T>(getMemory(address, memoryName, sizeof(T)));
   }
 
-public:
-  // Clear the state of the operation of applying the interpreter's runtime
-  // information into the module. This must be done before we start to serialize
-  // content (as the serialization uses this state - defining globals must be
-  // set and are latter used, etc.). After this, serialization can happen, and
-  // after that, a call to applyToModule() can be done.
-  void clearApplyState() {
-    // The process of allocating "defining globals" begins here, from scratch
-    // each time (things live before may no longer be).
-    definingGlobals.clear();
-
-    // Clear any startup operations as well (which may apply to globals that
-    // become no longer live; we'll create new start operations as we need
-    // them).
-    clearStartBlock();
+  // Saves the contents of pages that are about to be written to for the first
+  // time since the last checkpoint. Pages past the size the memory had at the
+  // checkpoint are simply truncated when we restore, so they need no saving.
+  void notePagesWritten(Address address, Name memoryName, size_t size) {
+    auto& memory = memories[memoryName];
+    auto& saved = memoryCheckpoints[memoryName];
+    auto end = std::min(size_t(address) + size, saved.size);
+    for (size_t page = address / CheckpointPageSize;
+         page * CheckpointPageSize < end;
+         page++) {
+      auto [it, inserted] = saved.savedPages.try_emplace(page);
+      if (inserted) {
+        auto begin = memory.begin() + page * CheckpointPageSize;
+        it->second.assign(
+          begin,
+          memory.begin() +
+            std::min((page + 1) * CheckpointPageSize, saved.size));
+      }
+    }
   }
 
-private:
   void applyMemoryToModule() {
     // Memory must have already been flattened into the standard form: one
     // segment at offset 0, or none.
@@ -987,6 +1083,38 @@ public:
     return ret;
   }
 
+  // Returns whether getSerialization() would succeed, without modifying the
+  // module.
+  bool canSerialize(const Literals& values) {
+    if (!wasm->features.hasStackSwitching()) {
+      // Continuations are the only thing we cannot serialize.
+      return true;
+    }
+    std::vector<Literal> work(values.begin(), values.end());
+    std::unordered_set<GCData*> seen;
+    while (!work.empty()) {
+      auto value = work.back();
+      work.pop_back();
+      if (value.isContinuation()) {
+        return false;
+      }
+      if (value.type.isRef() &&
+          value.type.getHeapType().isMaybeShared(HeapType::ext)) {
+        value = value.internalize();
+      }
+      if (!value.isData() || value.isString() ||
+          !seen.insert(value.getGCData().get()).second) {
+        continue;
+      }
+      auto& data = *value.getGCData();
+      work.insert(work.end(), data.values.begin(), data.values.end());
+      if (data.desc.getGCData()) {
+        work.push_back(data.desc);
+      }
+    }
+    return true;
+  }
+
   Expression* getSerialization(const Literals& values,
                                Name possibleDefiningGlobal = Name()) {
     if (values.size() > 1) {
@@ -1066,12 +1194,6 @@ public:
         wasm->start, Signature{Type::none, Type::none}, {}, *startBlock));
     }
   }
-
-  void clearStartBlock() {
-    if (startBlock) {
-      (*startBlock)->list.clear();
-    }
-  }
 };
 
 // The outcome of evalling a ctor is one of three states:
@@ -1132,15 +1254,15 @@ EvalCtorOutcome evalCtor(EvallingModuleRunner& instance,
     params.push_back(Literal::makeZero(type));
   }
 
-  // After we successfully eval a line we will store the operations to set up
-  // the locals here. That is, we need to save the local state in the function,
-  // which we do by setting up at the entry. We update this list of expressions
-  // at the same time as applyToModule() - we must only do it after an entire
-  // atomic "chunk" has been processed successfully, we do not want partial
-  // updates from an item in the block that we only partially evalled. When we
-  // construct the (partially) evalled function, we will create local.sets of
-  // these expressions at the beginning.
-  std::vector<Expression*> localExprs;
+  // After we successfully eval a line we will store the values of the locals
+  // here, at the same time as we checkpoint the rest of the state. That is, we
+  // need to save the local state in the function, which we do by setting up at
+  // the entry. We must only do it after an entire atomic "chunk" has been
+  // processed successfully, we do not want partial updates from an item in the
+  // block that we only partially evalled. When we construct the (partially)
+  // evalled function, we will create local.sets of these values at the
+  // beginning.
+  std::vector<Literals> savedLocals;
 
   // We might have to evaluate multiple functions due to return calls.
 start_eval:
@@ -1212,63 +1334,50 @@ start_eval:
         break;
       }
 
-      // We are about to serialize content (the code paths below call
-      // getSerialization). Clear the state.
-      interface.clearApplyState();
-
       if (flow.breakTo == RETURN_CALL_FLOW) {
         // The return-called function is stored in the last value.
-        func = wasm.getFunction(flow.values.back().getFunc());
+        auto target = flow.values.back().getFunc();
         flow.values.pop_back();
-        params = std::move(flow.values);
-
-        // Serialize the arguments for the new function and save the module
-        // state in case we fail to eval the new function.
-        localExprs.clear();
-        for (auto& param : params) {
-          auto* serialized = interface.getSerialization(param);
-          if (!serialized) {
-            break;
-          }
-          localExprs.push_back(serialized);
-        }
-        if (localExprs.size() < params.size()) {
+        if (!interface.canSerialize(flow.values)) {
           if (!quiet) {
             std::cout << "  ...stopping due to non-serializable param\n";
           }
           break;
         }
-        interface.applyToModule();
+
+        // Save the arguments for the new function and checkpoint the state in
+        // case we fail to eval the new function.
+        func = wasm.getFunction(target);
+        params = std::move(flow.values);
+        savedLocals.clear();
+        for (auto& param : params) {
+          savedLocals.push_back({param});
+        }
+        interface.checkpoint();
         goto start_eval;
       }
 
-      // So far so good! Serialize the values of locals, and apply to the
-      // module. Note that we must serialize the locals now as doing so may
-      // cause changes that must be applied to the module (e.g. GC data may
-      // cause globals to be added). And we must apply to the module now, and
-      // not later, as we must do so right after a successful partial eval
-      // (after any failure to eval, the global state is no long valid to be
-      // applied to the module, as incomplete changes may have occurred).
+      // So far so good! Save the values of locals, and checkpoint the state. We
+      // must do so right after a successful partial eval (after any failure to
+      // eval, the state is no longer valid to be applied to the module, as
+      // incomplete changes may have occurred, which restoring the checkpoint
+      // undoes).
       //
       // Note that we make no effort to optimize locals: we just write out all
       // of them, and leave it to the optimizer to remove redundant or
-      // unnecessary operations. We just recompute the entire local
-      // serialization sets from scratch each time here, for all locals.
-      localExprs.clear();
-      for (Index i = 0; i < func->getNumLocals(); i++) {
-        auto* serialized = interface.getSerialization(scope.locals[i]);
-        if (!serialized) {
-          break;
-        }
-        localExprs.push_back(serialized);
-      }
-      if (localExprs.size() < func->getNumLocals()) {
+      // unnecessary operations.
+      if (!std::all_of(scope.locals.begin(),
+                       scope.locals.end(),
+                       [&](const Literals& local) {
+                         return interface.canSerialize(local);
+                       })) {
         if (!quiet) {
           std::cout << "  ...stopping due to non-serializable local\n";
         }
         break;
       }
-      interface.applyToModule();
+      savedLocals = scope.locals;
+      interface.checkpoint();
       successes++;
 
       // Note the values here, if any. If we are exiting the function now then
@@ -1300,7 +1409,20 @@ start_eval:
     // original.
     if ((func->imported() || successes < block->list.size()) &&
         (successes > 0 || func->name != funcName ||
-         (localExprs.size() && func->getParams() != Type::none))) {
+         (savedLocals.size() && func->getParams() != Type::none))) {
+      // Serialize the locals at the last checkpoint, and apply that state to
+      // the module. Note that we must serialize the locals first as doing so
+      // may cause changes that must be applied to the module (e.g. GC data may
+      // cause globals to be added).
+      interface.restoreCheckpoint();
+      std::vector<Expression*> localExprs;
+      for (auto& local : savedLocals) {
+        localExprs.push_back(interface.getSerialization(local));
+        // We checked for serialization problems when we saved the locals.
+        assert(localExprs.back());
+      }
+      interface.applyToModule();
+
       auto originalFuncType = wasm.getFunction(funcName)->type;
       auto copyName = Names::getValidFunctionName(wasm, funcName);
       *wasm.getExport(exportName)->getInternalName() = copyName;
@@ -1418,6 +1540,9 @@ void evalCtors(Module& wasm,
       wasm, &interface, interface.instanceInitialized, linkedInstances);
     instance.instantiate();
     interface.instanceInitialized = true;
+    // Track changes from the instantiated state, so that we can undo those of
+    // anything we fail to eval.
+    interface.clearUndoLog();
     // go one by one, in order, until we fail
     // TODO: if we knew priorities, we could reorder?
     for (auto& ctor : ctors) {
@@ -1465,7 +1590,7 @@ void evalCtors(Module& wasm,
         if (!quiet) {
           std::cout << "  ...stopping\n";
         }
-        return;
+        break;
       }
 
       // Success! And we can continue to try more.
@@ -1483,17 +1608,20 @@ void evalCtors(Module& wasm,
         auto copyName = Names::getValidFunctionName(wasm, func->name);
         auto copyFunc =
           ModuleUtils::copyFunctionWithoutAdd(func, wasm, copyName);
+        auto* added = wasm.addFunction(std::move(copyFunc));
         if (func->getResults() == Type::none) {
-          copyFunc->body = Builder(wasm).makeNop();
+          added->body = Builder(wasm).makeNop();
         } else {
-          copyFunc->body = interface.getSerialization(*outcome);
-          // We have ruled out serialization problems earlier.
-          assert(copyFunc->body);
+          // Return the results, which we serialize when we apply to the module.
+          interface.keptResults.push_back({added, *outcome});
         }
-        wasm.addFunction(std::move(copyFunc));
         *wasm.getExport(exp->name)->getInternalName() = copyName;
       }
     }
+
+    // Apply the state of execution to the module, if we have not already (when
+    // we partially evalled a function).
+    interface.applyToModule();
   } catch (FailToEvalException& fail) {
     // That's it, we failed to even create the instance.
     if (!quiet) {
@@ -419,6 +419,19 @@ For more on how to optimize effectively, see
       std::cerr << "warning: no passes specified, not doing any work\n";
     }
   } else {
+    // Profiles for --reorder-functions-by-profile record a hash of the module
+    // file they were made for. Unless told otherwise, that is the input.
+    if (!translateToFuzz && options.extra["infile"] != "-" &&
+        !options.passOptions.arguments.count(
+          "reorder-functions-by-profile-module") &&
+        std::any_of(options.passes.begin(),
+                    options.passes.end(),
+                    [](const OptimizationOptions::PassInfo& info) {
+                      return info.name == "reorder-functions-by-profile";
+                    })) {
+      options.passOptions.arguments["reorder-functions-by-profile-module"] =
+        options.extra["infile"];
+    }
     BYN_TRACE("running passes...\n");
     auto runPasses = [&]() {
       options.runPasses(wasm);
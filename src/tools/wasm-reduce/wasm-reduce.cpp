@@ -26,6 +26,10 @@
 #include <cstdio>
 #include <cstdlib>
 #include <memory>
+#include <optional>
+#include <sstream>
+#include <string_view>
+#include <thread>
 
 #include "ir/branch-utils.h"
 #include "ir/eh-utils.h"
@@ -41,6 +45,7 @@
 #include "support/hash.h"
 #include "support/path.h"
 #include "support/timing.h"
+#include "tools/optimization-options.h"
 #include "tools/tool-options.h"
 #include "wasm-builder.h"
 #include "wasm-io.h"
@@ -74,6 +79,10 @@ std::string GetLastErrorStdStr() {
   }
   return std::string();
 }
+#else
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
 #endif
 
 using namespace wasm;
@@ -88,6 +97,14 @@ static std::string extraFlags = "-all";
 // Whether to save all intermediate working files as we go.
 static bool saveAllWorkingFiles = false;
 
+// How many candidate reductions to test at the same time. Each job has a test
+// file of its own, see getJobTest().
+static size_t jobs = 1;
+
+// The wasm-opt options to run in-process on each candidate, instead of running
+// the command on it, if --in-process is used.
+static std::unique_ptr<OptimizationOptions> oracleOptions;
+
 struct ProgramResult {
   int code;
   std::string output;
@@ -222,6 +239,174 @@ inline std::ostream& operator<<(std::ostream& o, ProgramResult& result) {
 
 ProgramResult expected;
 
+// Reads a module for reduction, assuming that it may need all features.
+static void
+readModule(const std::string& file, Module& wasm, ToolOptions& toolOptions) {
+  toolOptions.applyOptionsBeforeParse(wasm);
+
+  // Assume we may need all features.
+  wasm.features = FeatureSet::All;
+
+  ModuleReader reader;
+  try {
+    reader.read(file, wasm);
+  } catch (ParseException& p) {
+    p.dump(std::cerr);
+    std::cerr << '\n';
+    Fatal() << "error in parsing wasm binary " << file;
+  }
+
+  toolOptions.applyOptionsAfterParse(wasm);
+}
+
+// A run of the in-process oracle on a module, which does what wasm-opt does
+// with the oracle options. It runs in a child process that is forked from us,
+// so that crashes are isolated, and that shares the module with us by
+// copy-on-write, so that the module does not need to be written out and read
+// back in. Its result is that of a command: the exit status of the child and
+// what it writes to stdout (the same timeout applies, too).
+struct OracleRun {
+#ifndef _WIN32
+  pid_t pid;
+  int fd;
+#endif
+  Timer timer;
+
+  OracleRun(Module& wasm) {
+#ifdef _WIN32
+    Fatal() << "--in-process is not supported on Windows";
+#else
+    int fds[2];
+    if (pipe(fds) != 0) {
+      Fatal() << "failed to create a pipe for the in-process oracle";
+    }
+    // Flush our output so that the child does not write it out again.
+    std::cout.flush();
+    std::cerr.flush();
+    pid = fork();
+    if (pid < 0) {
+      Fatal() << "failed to fork the in-process oracle";
+    }
+    if (pid == 0) {
+      close(fds[0]);
+      dup2(fds[1], STDOUT_FILENO);
+      close(fds[1]);
+      int null = open("/dev/null", O_WRONLY);
+      dup2(null, STDERR_FILENO);
+      alarm(timeout);
+      run(wasm);
+      std::cout.flush();
+      // Do not run static destructors, which are for the parent.
+      _exit(0);
+    }
+    close(fds[1]);
+    fd = fds[0];
+#endif
+  }
+
+  // Waits for the run to finish, and notes its result.
+  void finish(ProgramResult& result) {
+#ifndef _WIN32
+    const int MAX_BUFFER = 1024;
+    char buffer[MAX_BUFFER];
+    result.output.clear();
+    ssize_t size;
+    while ((size = read(fd, buffer, MAX_BUFFER)) > 0) {
+      result.output.append(buffer, size);
+    }
+    close(fd);
+    int status;
+    waitpid(pid, &status, 0);
+    result.code = status;
+    result.time = timer.totalElapsed();
+#endif
+  }
+
+private:
+  static void run(Module& wasm) {
+    auto& options = *oracleOptions;
+    if (options.passOptions.validate &&
+        !WasmValidator().validate(wasm, options.passOptions)) {
+      Fatal() << "error validating input";
+    }
+    options.runPasses(wasm);
+    if (options.passOptions.validate &&
+        !WasmValidator().validate(wasm, options.passOptions)) {
+      Fatal() << "error after opts";
+    }
+  }
+};
+
+// Runs commands at the same time, and returns their results in order.
+static std::vector<ProgramResult>
+runInParallel(const std::vector<std::string>& commands) {
+  std::vector<ProgramResult> results(commands.size());
+  if (commands.size() == 1) {
+    results[0].getFromExecution(commands[0]);
+    return results;
+  }
+  std::vector<std::thread> threads;
+  for (size_t i = 0; i < commands.size(); i++) {
+    threads.emplace_back(
+      [&, i]() { results[i].getFromExecution(commands[i]); });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  return results;
+}
+
+// Returns the test file of a job. The first job uses the test file itself, and
+// the others use files next to it with the same extension, so that a test file
+// t.wasm has t.job1.wasm, t.job2.wasm, etc. next to it.
+static std::string getJobTest(const std::string& test, size_t job) {
+  if (job == 0) {
+    return test;
+  }
+  auto suffix = ".job" + std::to_string(job);
+  auto dot = test.rfind('.');
+  auto separator = test.find_last_of("/\\");
+  if (dot == std::string::npos ||
+      (separator != std::string::npos && dot < separator)) {
+    return test + suffix;
+  }
+  return test.substr(0, dot) + suffix + test.substr(dot);
+}
+
+// Whether a character can be part of a file name in a command, as opposed to
+// separating it from the rest of the command (like spaces, quotes, or the '='
+// in --file=name).
+static bool isFileNameChar(char c) {
+  return isalnum((unsigned char)c) ||
+         std::string_view("._-+~@%,:/\\").find(c) != std::string_view::npos;
+}
+
+// Returns the command of a job, which is the command with every mention of the
+// test file replaced by the test file of the job. Only whole file names are
+// replaced, so that other files whose names contain that of the test file
+// (like out.wasm when the test file is t.wasm) are left alone.
+static std::string
+getJobCommand(const std::string& command, const std::string& test, size_t job) {
+  auto jobTest = getJobTest(test, job);
+  std::string result;
+  size_t start = 0, from = 0;
+  while (1) {
+    auto found = command.find(test, from);
+    if (found == std::string::npos) {
+      break;
+    }
+    auto end = found + test.size();
+    from = found + 1;
+    if ((found > 0 && isFileNameChar(command[found - 1])) ||
+        (end < command.size() && isFileNameChar(command[end]))) {
+      continue;
+    }
+    result += command.substr(start, found - start) + jobTest;
+    start = from = end;
+  }
+  return result + command.substr(start);
+}
+
 // Removing functions is extremely beneficial and efficient. We aggressively
 // try to remove functions, unless we've seen they can't be removed, in which
 // case we may try again but much later.
@@ -238,6 +423,10 @@ struct Reducer
   bool binary, deNan, verbose, debugInfo;
   ToolOptions& toolOptions;
 
+  // The test file and the command of each job. Those of the first job are the
+  // test file and the command themselves.
+  std::vector<std::string> jobTests, jobCommands;
+
   // test is the file we write to that the command will operate on
   // working is the current temporary state, the reduction so far
   Reducer(std::string command,
@@ -250,7 +439,12 @@ struct Reducer
           ToolOptions& toolOptions)
     : command(command), test(test), working(working), binary(binary),
       deNan(deNan), verbose(verbose), debugInfo(debugInfo),
-      toolOptions(toolOptions) {}
+      toolOptions(toolOptions) {
+    for (size_t i = 0; i < jobs; i++) {
+      jobTests.push_back(getJobTest(test, i));
+      jobCommands.push_back(getJobCommand(command, test, i));
+    }
+  }
 
   // runs passes in order to reduce, until we can't reduce any more
   // the criterion here is wasm binary size
@@ -306,29 +500,71 @@ struct Reducer
       more = false;
       // try both combining with a generic shrink (so minor pass overhead is
       // compensated for), and without
-      for (auto pass : passes) {
-        std::string currCommand = Path::getBinaryenBinaryTool("wasm-opt") + " ";
-        currCommand += working + " -o " + test + " " + pass + " " + extraFlags;
-        if (!binary) {
-          currCommand += " -S ";
+      size_t i = 0;
+      while (i < passes.size()) {
+        // Try the next passes on the working file, one in each job, and take
+        // the first that works. The ones after it were tried on a working file
+        // that is now stale, so we continue right after it, which gives the
+        // same results as trying the passes one by one.
+        auto numJobs = std::min(jobs, passes.size() - i);
+        std::vector<std::string> passCommands;
+        for (size_t job = 0; job < numJobs; job++) {
+          std::string currCommand =
+            Path::getBinaryenBinaryTool("wasm-opt") + " ";
+          currCommand += working + " -o " + jobTests[job] + " " +
+                         passes[i + job] + " " + extraFlags;
+          if (!binary) {
+            currCommand += " -S ";
+          }
+          if (verbose) {
+            std::cerr << "|    trying pass command: " << currCommand << "\n";
+          }
+          passCommands.push_back(currCommand);
         }
-        if (verbose) {
-          std::cerr << "|    trying pass command: " << currCommand << "\n";
+        // Run the passes, and then the command on the outputs that look
+        // promising.
+        std::vector<char> promising(numJobs), accepted(numJobs);
+        std::vector<std::thread> threads;
+        for (size_t job = 0; job < numJobs; job++) {
+          threads.emplace_back([&, job]() {
+            if (!ProgramResult(passCommands[job]).failed() &&
+                file_size(jobTests[job]) < oldSize) {
+              // the pass didn't fail, and the size looks smaller, so promising
+              // see if it is still has the property we are preserving
+              promising[job] = true;
+              if (!oracleOptions) {
+                accepted[job] = ProgramResult(jobCommands[job]) == expected;
+              }
+            }
+          });
         }
-        if (!ProgramResult(currCommand).failed()) {
-          auto newSize = file_size(test);
-          if (newSize < oldSize) {
-            // the pass didn't fail, and the size looks smaller, so promising
-            // see if it is still has the property we are preserving
-            if (ProgramResult(command) == expected) {
-              std::cerr << "|    command \"" << currCommand
-                        << "\" succeeded, reduced size to " << newSize << '\n';
-              applyTestToWorking();
-              more = true;
-              oldSize = newSize;
+        for (auto& thread : threads) {
+          thread.join();
+        }
+        size_t job = 0;
+        while (job < numJobs && !accepted[job]) {
+          if (oracleOptions && promising[job]) {
+            Module candidate;
+            readModule(jobTests[job], candidate, toolOptions);
+            ProgramResult result;
+            OracleRun(candidate).finish(result);
+            if (result == expected) {
+              break;
             }
           }
+          job++;
+        }
+        if (job == numJobs) {
+          i += numJobs;
+          continue;
         }
+        auto newSize = file_size(jobTests[job]);
+        std::cerr << "|    command \"" << passCommands[job]
+                  << "\" succeeded, reduced size to " << newSize << '\n';
+        applyTestToWorking(job);
+        more = true;
+        oldSize = newSize;
+        i += job + 1;
       }
     }
     if (verbose) {
@@ -336,10 +572,10 @@ struct Reducer
     }
   }
 
-  // Apply the test file to the working file, after we saw that it successfully
-  // reduced the testcase.
-  void applyTestToWorking() {
-    copy_file(test, working);
+  // Apply the test file of a job to the working file, after we saw that it
+  // successfully reduced the testcase.
+  void applyTestToWorking(size_t job = 0) {
+    copy_file(jobTests[job], working);
 
     if (saveAllWorkingFiles) {
       copy_file(working, working + '.' + std::to_string(workingFileIndex++));
@@ -374,23 +610,7 @@ struct Reducer
 
   void loadWorking() {
     module = std::make_unique<Module>();
-
-    toolOptions.applyOptionsBeforeParse(*module);
-
-    // Assume we may need all features.
-    module->features = FeatureSet::All;
-
-    ModuleReader reader;
-    try {
-      reader.read(working, *module);
-    } catch (ParseException& p) {
-      p.dump(std::cerr);
-      std::cerr << '\n';
-      Fatal() << "error in parsing working wasm binary";
-    }
-
-    toolOptions.applyOptionsAfterParse(*module);
-
+    readModule(working, *module, toolOptions);
     builder = std::make_unique<Builder>(*module);
     setModule(module.get());
   }
@@ -411,11 +631,12 @@ struct Reducer
   }
 
   bool writeAndTestReduction(ProgramResult& out) {
-    // write the module out
-    ModuleWriter writer(toolOptions.passOptions);
-    writer.setBinary(binary);
-    writer.setDebugInfo(debugInfo);
-    toolOptions.write(writer, *getModule(), test);
+    if (oracleOptions) {
+      // Test the module in memory. It is only written out if we keep it.
+      OracleRun(*getModule()).finish(out);
+      return out == expected;
+    }
+    writeModule(test);
     // note that it is ok for the destructively-reduced module to be bigger
     // than the previous - each destructive reduction removes logical code,
     // and so is strictly better, even if the wasm binary format happens to
@@ -425,6 +646,173 @@ struct Reducer
     return out == expected;
   }
 
+  void writeModule(const std::string& file) {
+    ModuleWriter writer(toolOptions.passOptions);
+    writer.setBinary(binary);
+    writer.setDebugInfo(debugInfo);
+    toolOptions.write(writer, *getModule(), file);
+  }
+
+  // The runs of the in-process oracle that were started for each job.
+  std::vector<std::optional<OracleRun>> oracleRuns;
+
+  // Prepares a job to test the module as it is now, by writing it to the test
+  // file of the job, or by starting the in-process oracle on it, which can
+  // continue after the module is modified.
+  void prepareJob(size_t job) {
+    if (!oracleOptions) {
+      writeModule(jobTests[job]);
+      return;
+    }
+    oracleRuns.resize(jobs);
+    oracleRuns[job].emplace(*getModule());
+  }
+
+  // Tests the first |numJobs| jobs, which must have been prepared, at the same
+  // time, and returns the first job whose result is the expected one, if
+  // there is one.
+  std::optional<size_t> testJobs(size_t numJobs) {
+    std::vector<ProgramResult> results;
+    if (oracleOptions) {
+      results.resize(numJobs);
+      for (size_t job = 0; job < numJobs; job++) {
+        oracleRuns[job]->finish(results[job]);
+        oracleRuns[job].reset();
+      }
+    } else {
+      results = runInParallel(std::vector<std::string>(
+        jobCommands.begin(), jobCommands.begin() + numJobs));
+    }
+    for (size_t job = 0; job < numJobs; job++) {
+      if (results[job] == expected) {
+        return job;
+      }
+    }
+    return std::nullopt;
+  }
+
+  // Whether the partitions of a delta debugger have become so small that we
+  // had better switch to another reduction strategy, which is when the test
+  // set is smaller than the square root of the working set.
+  template<typename T> static bool isTooFine(const DeltaDebugger<T>& dd) {
+    size_t sqrtRemaining = std::sqrt(dd.working.size());
+    return dd.test.size() > 0 && dd.test.size() < sqrtRemaining;
+  }
+
+  // Returns the states of a delta debugger in which it tests the sets that it
+  // will test next if all the ones before them are rejected, one for each job.
+  // To use them, test their sets in order and, if the one in the i-th state is
+  // the first that works, continue from that state after accepting it; if none
+  // works, continue from the last state after rejecting it. That gives the same
+  // results as testing the sets one by one.
+  template<typename T>
+  std::vector<DeltaDebugger<T>> getNextTests(const DeltaDebugger<T>& dd) {
+    std::vector<DeltaDebugger<T>> next = {dd};
+    while (next.size() < jobs) {
+      auto after = next.back();
+      after.reject();
+      if (after.finished() || isTooFine(after)) {
+        break;
+      }
+      next.push_back(std::move(after));
+    }
+    return next;
+  }
+
+  // Reduces a kind of item with delta debugging, looking for a small set of
+  // them to keep. The partitions are balanced by the |weight| of the items,
+  // which is roughly how much of the module they make up. |remove| removes a
+  // set of items from the module, and returns a function that puts them back.
+  template<typename T>
+  void reduceWithDeltaDebugging(
+    std::vector<T> items,
+    typename DeltaDebugger<T>::Weight weight,
+    std::function<std::function<void()>(const std::vector<T>&)> remove) {
+    // The items of the working set that are not in the test set.
+    auto getRemoved = [](const DeltaDebugger<T>& state) {
+      std::vector<T> removed;
+      size_t testIndex = 0;
+      for (auto& item : state.working) {
+        if (testIndex < state.test.size() && item == state.test[testIndex]) {
+          // Kept, skip it.
+          testIndex++;
+        } else {
+          removed.push_back(item);
+        }
+      }
+      assert(testIndex == state.test.size());
+      return removed;
+    };
+
+    DeltaDebugger<T> dd(std::move(items), std::move(weight));
+    // Stop early if the partition size is less than the square root of the
+    // remaining set. We don't want to waste time on very fine-grained
+    // partitions when we could switch to another reduction strategy instead.
+    while (!dd.finished() && !isTooFine(dd)) {
+      auto next = getNextTests(dd);
+
+      // Prepare a job for each of the next tests, and undo the removal right
+      // after.
+      for (size_t job = 0; job < next.size(); job++) {
+        auto& curr = next[job];
+        std::cerr << "|     try partition " << curr.partitionIndex() + 1
+                  << " / " << curr.partitionCount() << " (size "
+                  << curr.test.size() << " / " << curr.working.size()
+                  << ")\n";
+        auto undo = remove(getRemoved(curr));
+        prepareJob(job);
+        undo();
+      }
+
+      if (auto job = testJobs(next.size())) {
+        // Success!
+        dd = std::move(next[*job]);
+        auto removed = getRemoved(dd);
+        remove(removed);
+        noteReduction(removed.size(), *job);
+        dd.accept();
+      } else {
+        // Failure.
+        dd = std::move(next.back());
+        dd.reject();
+      }
+    }
+  }
+
+  // Removes some of the items in a vector of owned items, and returns a
+  // function that puts them back where they were.
+  template<typename T>
+  static std::function<void()>
+  removeFromVector(std::vector<std::unique_ptr<T>>& vec,
+                   const std::vector<T*>& items) {
+    std::unordered_set<T*> removedItems(items.begin(), items.end());
+    std::vector<T*> order;
+    auto removed = std::make_shared<std::vector<std::unique_ptr<T>>>();
+    std::vector<std::unique_ptr<T>> kept;
+    for (auto& item : vec) {
+      order.push_back(item.get());
+      if (removedItems.contains(item.get())) {
+        removed->push_back(std::move(item));
+      } else {
+        kept.push_back(std::move(item));
+      }
+    }
+    vec = std::move(kept);
+    return [&vec, order, removed]() {
+      std::unordered_map<T*, std::unique_ptr<T>> all;
+      for (auto& item : vec) {
+        all[item.get()] = std::move(item);
+      }
+      for (auto& item : *removed) {
+        all[item.get()] = std::move(item);
+      }
+      vec.clear();
+      for (auto* item : order) {
+        vec.push_back(std::move(all[item]));
+      }
+    };
+  }
+
   size_t decisionCounter = 0;
 
   bool shouldTryToReduce(size_t bonus = 1) {
@@ -477,9 +865,13 @@ struct Reducer
     return true;
   }
 
-  void noteReduction(size_t amount = 1) {
+  void noteReduction(size_t amount = 1, size_t job = 0) {
     reduced += amount;
-    applyTestToWorking();
+    if (oracleOptions) {
+      // The module was only tested in memory, so write it out now.
+      writeModule(jobTests[job]);
+    }
+    applyTestToWorking(job);
   }
 
   // tests a reduction on an arbitrary child
@@ -912,6 +1304,7 @@ struct Reducer
     // partition.
     std::vector<Index> nontrivialFuncIndices;
     nontrivialFuncIndices.reserve(module->functions.size());
+    std::vector<uint64_t> sizes(module->functions.size());
     for (Index i = 0; i < module->functions.size(); ++i) {
       auto& func = module->functions[i];
       // Skip functions that already have trivial bodies.
@@ -919,70 +1312,29 @@ struct Reducer
         continue;
       }
       nontrivialFuncIndices.push_back(i);
-    }
-    DeltaDebugger<Index> dd(std::move(nontrivialFuncIndices));
-    while (!dd.finished()) {
-      // Stop early if the partition size is less than the square root of
-      // the remaining set. We don't want to waste time on very fine-grained
-      // partitions when we could switch to another reduction strategy
-      // instead.
-      if (size_t sqrtRemaining = std::sqrt(dd.working.size());
-          dd.test.size() > 0 && dd.test.size() < sqrtRemaining) {
-        break;
-      }
-
-      std::cerr << "|     try partition " << dd.partitionIndex() + 1 << " / "
-                << dd.partitionCount() << " (size " << dd.test.size() << " / "
-                << dd.working.size() << ")\n";
-      Index removedSize = dd.working.size() - dd.test.size();
-      std::vector<Expression*> oldBodies(removedSize);
-
-      // We first need to remove each non-kept function body, and later we
-      // might need to restore the same function bodies. Abstract the logic
-      // for iterating over these function bodies. `f` takes a Function* and
-      // Expression*& for the stashed body.
-      auto forEachRemovedFuncBody = [&](auto f) {
-        Index bodyIndex = 0;
-        Index workingIndex = 0;
-        Index testIndex = 0;
-        while (workingIndex < dd.working.size()) {
-          if (testIndex < dd.test.size() &&
-              dd.working[workingIndex] == dd.test[testIndex]) {
-            // Kept, skip it.
-            workingIndex++;
-            testIndex++;
+      sizes[i] = Measurer::measure(func->body);
+    }
+    reduceWithDeltaDebugging<Index>(
+      std::move(nontrivialFuncIndices),
+      [&](Index i) { return sizes[i]; },
+      [&](const std::vector<Index>& removed) -> std::function<void()> {
+        // Stash the bodies.
+        std::vector<Expression*> oldBodies;
+        for (auto i : removed) {
+          auto* func = module->functions[i].get();
+          oldBodies.push_back(func->body);
+          if (func->getResults() == Type::none) {
+            func->body = builder->makeNop();
           } else {
-            // Removed, process it
-            Index funcIndex = dd.working[workingIndex++];
-            f(module->functions[funcIndex].get(), oldBodies[bodyIndex++]);
+            func->body = builder->makeUnreachable();
           }
         }
-        assert(bodyIndex == removedSize);
-        assert(testIndex == dd.test.size());
-      };
-
-      // Stash the bodies.
-      forEachRemovedFuncBody([&](Function* func, Expression*& oldBody) {
-        oldBody = func->body;
-        Builder builder(*module);
-        if (func->getResults() == Type::none) {
-          func->body = builder.makeNop();
-        } else {
-          func->body = builder.makeUnreachable();
-        }
+        return [&, removed, oldBodies]() {
+          for (size_t j = 0; j < removed.size(); j++) {
+            module->functions[removed[j]]->body = oldBodies[j];
+          }
+        };
       });
-
-      if (!writeAndTestReduction()) {
-        // Failure. Restore the bodies.
-        forEachRemovedFuncBody(
-          [](Function* func, Expression*& oldBody) { func->body = oldBody; });
-        dd.reject();
-      } else {
-        // Success!
-        noteReduction(removedSize);
-        dd.accept();
-      }
-    }
   }
 
   void reduceFunctions() {
@@ -1028,26 +1380,14 @@ struct Reducer
       currentIndices.push_back(i);
     }
 
-    DeltaDebugger<Index> dd(std::move(initialCandidates));
-    while (!dd.finished()) {
-      // Exit early if the test set size is less than the square root of the
-      // working set size. We don't want to waste time on very fine-grained
-      // partitions when we could switch to a different reduction strategy
-      // instead.
-      if (size_t sqrtRemaining = std::sqrt(dd.working.size());
-          dd.test.size() > 0 && dd.test.size() < sqrtRemaining) {
-        break;
-      }
-
-      std::cerr << "|     try partition " << dd.partitionIndex() + 1 << " / "
-                << dd.partitionCount() << " (size " << dd.test.size() << " / "
-                << dd.working.size() << ")\n";
-
+    // Removes the functions that are not in a test set, and returns the new
+    // index mapping we will have to use if this reduction works.
+    auto removeFunctions = [&](const std::vector<Index>& test) {
       std::unordered_set<Index> keptIndices;
       for (Index i : unremovableIndices) {
         keptIndices.insert(*currentIndices[i]);
       }
-      for (Index i : dd.test) {
+      for (Index i : test) {
         keptIndices.insert(*currentIndices[i]);
       }
 
@@ -1142,17 +1482,235 @@ struct Reducer
 
       assert(WasmValidator().validate(
         *module, WasmValidator::Globally | WasmValidator::Quiet));
-      if (writeAndTestReduction()) {
-        noteReduction(dd.working.size() - dd.test.size());
-        currentIndices = std::move(newCurrentIndices);
+      return newCurrentIndices;
+    };
+
+    // Balance the partitions by the sizes of the functions.
+    std::vector<uint64_t> sizes;
+    sizes.reserve(module->functions.size());
+    for (auto& func : module->functions) {
+      sizes.push_back(func->imported() ? 0 : Measurer::measure(func->body));
+    }
+
+    DeltaDebugger<Index> dd(std::move(initialCandidates),
+                            [&](Index i) { return sizes[i]; });
+    // Exit early if the test set size is less than the square root of the
+    // working set size. We don't want to waste time on very fine-grained
+    // partitions when we could switch to a different reduction strategy
+    // instead.
+    while (!dd.finished() && !isTooFine(dd)) {
+      auto next = getNextTests(dd);
+
+      // Write the reduction of each of the next tests to the test file of a
+      // job, starting each one from the working module.
+      std::vector<std::vector<std::optional<Index>>> nextIndices;
+      for (size_t job = 0; job < next.size(); job++) {
+        auto& curr = next[job];
+        std::cerr << "|     try partition " << curr.partitionIndex() + 1
+                  << " / " << curr.partitionCount() << " (size "
+                  << curr.test.size() << " / " << curr.working.size()
+                  << ")\n";
+        if (job > 0) {
+          loadWorking();
+        }
+        nextIndices.push_back(removeFunctions(curr.test));
+        prepareJob(job);
+      }
+
+      if (auto job = testJobs(next.size())) {
+        if (*job != next.size() - 1) {
+          // The module has the reduction of a later job, so redo this one.
+          loadWorking();
+          removeFunctions(next[*job].test);
+        }
+        dd = std::move(next[*job]);
+        noteReduction(dd.working.size() - dd.test.size(), *job);
+        currentIndices = std::move(nextIndices[*job]);
         dd.accept();
       } else {
         loadWorking();
+        dd = std::move(next.back());
         dd.reject();
       }
     }
   }
 
+  // Returns something with a given type to use instead of an expression that
+  // we remove. Unlike Builder::replaceWithIdenticalType, this never reuses the
+  // expression, so that we can put it back.
+  Expression* makeReplacement(Type type) {
+    if (type.isDefaultable()) {
+      auto* zero = builder->makeConstantExpression(Literal::makeZeros(type));
+      return zero->type == type ? zero : builder->makeBlock({zero}, type);
+    }
+    return builder->makeBlock({builder->makeUnreachable()}, type);
+  }
+
+  void reduceBlockChildren() {
+    std::cerr << "|    try to remove top-level block children\n";
+    // The items are the places of the children of blocks at the top level of
+    // function bodies, and removing one replaces it with a nop. Only children
+    // without a value are removed, so that types do not change.
+    std::vector<Expression**> children;
+    std::unordered_map<Expression**, uint64_t> sizes;
+    for (auto& func : module->functions) {
+      if (func->imported()) {
+        continue;
+      }
+      auto* block = func->body->dynCast<Block>();
+      if (!block) {
+        continue;
+      }
+      for (auto*& child : block->list) {
+        if (child->type == Type::none && !child->is<Nop>()) {
+          children.push_back(&child);
+          sizes[&child] = Measurer::measure(child);
+        }
+      }
+    }
+    reduceWithDeltaDebugging<Expression**>(
+      std::move(children),
+      [&](Expression** child) { return sizes.at(child); },
+      [&](const std::vector<Expression**>& removed) -> std::function<void()> {
+        std::vector<Expression*> oldChildren;
+        for (auto* child : removed) {
+          oldChildren.push_back(*child);
+          *child = builder->makeNop();
+        }
+        return [removed, oldChildren]() {
+          for (size_t i = 0; i < removed.size(); i++) {
+            *removed[i] = oldChildren[i];
+          }
+        };
+      });
+  }
+
+  void reduceGlobals() {
+    std::cerr << "|    try to remove globals\n";
+    // Globals that are read in module code (like in the initializers of other
+    // globals) would need those places fixed up as well, and exported ones are
+    // left for the removal of exports, so only look at the others.
+    struct ModuleCodeUses : public PostWalker<ModuleCodeUses> {
+      std::unordered_set<Name> used;
+      void visitGlobalGet(GlobalGet* curr) { used.insert(curr->name); }
+    };
+    ModuleCodeUses uses;
+    uses.walkModuleCode(module.get());
+    for (auto& exp : module->exports) {
+      if (exp->kind == ExternalKind::Global) {
+        uses.used.insert(*exp->getInternalName());
+      }
+    }
+    std::vector<Global*> globals;
+    for (auto& global : module->globals) {
+      if (!uses.used.contains(global->name)) {
+        globals.push_back(global.get());
+      }
+    }
+
+    // Replaces the uses of removed globals in functions, noting what was there
+    // so that it can be put back.
+    struct UseReplacer : public PostWalker<UseReplacer> {
+      Reducer& parent;
+      std::unordered_set<Name> removed;
+      std::vector<std::pair<Expression**, Expression*>> replaced;
+
+      UseReplacer(Reducer& parent) : parent(parent) {}
+
+      void replace(Expression* with) {
+        replaced.push_back({getCurrentPointer(), getCurrent()});
+        replaceCurrent(with);
+      }
+      void visitGlobalGet(GlobalGet* curr) {
+        if (removed.contains(curr->name)) {
+          replace(parent.makeReplacement(curr->type));
+        }
+      }
+      void visitGlobalSet(GlobalSet* curr) {
+        if (removed.contains(curr->name)) {
+          replace(parent.builder->makeDrop(curr->value));
+        }
+      }
+    };
+
+    reduceWithDeltaDebugging<Global*>(
+      std::move(globals),
+      [&](Global* global) {
+        return global->imported() ? 0 : Measurer::measure(global->init);
+      },
+      [&](const std::vector<Global*>& removed) -> std::function<void()> {
+        auto replacer = std::make_shared<UseReplacer>(*this);
+        for (auto* global : removed) {
+          replacer->removed.insert(global->name);
+        }
+        for (auto& func : module->functions) {
+          if (!func->imported()) {
+            replacer->walkFunctionInModule(func.get(), module.get());
+          }
+        }
+        auto undo = removeFromVector(module->globals, removed);
+        module->updateMaps();
+        return [&, replacer, undo]() {
+          undo();
+          module->updateMaps();
+          // Put back the uses in reverse order, as later ones may be inside
+          // earlier ones' replacements.
+          auto& replaced = replacer->replaced;
+          for (auto it = replaced.rbegin(); it != replaced.rend(); ++it) {
+            *it->first = it->second;
+          }
+        };
+      });
+  }
+
+  void reduceDataSegments() {
+    std::cerr << "|    try to remove data segments\n";
+    // Only look at segments that no instruction refers to.
+    struct SegmentUses
+      : public PostWalker<SegmentUses, UnifiedExpressionVisitor<SegmentUses>> {
+      std::unordered_set<Name> used;
+      void visitExpression(Expression* curr) {
+#define DELEGATE_ID curr->_id
+#define DELEGATE_START(id) [[maybe_unused]] auto* cast = curr->cast<id>();
+#define DELEGATE_GET_FIELD(id, field) cast->field
+#define DELEGATE_FIELD_NAME_KIND(id, field, kind)                              \
+  if (kind == ModuleItemKind::DataSegment) {                                   \
+    used.insert(cast->field);                                                  \
+  }
+#define DELEGATE_FIELD_CHILD(id, field)
+#define DELEGATE_FIELD_OPTIONAL_CHILD(id, field)
+#define DELEGATE_FIELD_INT(id, field)
+#define DELEGATE_FIELD_LITERAL(id, field)
+#define DELEGATE_FIELD_NAME(id, field)
+#define DELEGATE_FIELD_SCOPE_NAME_DEF(id, field)
+#define DELEGATE_FIELD_SCOPE_NAME_USE(id, field)
+#define DELEGATE_FIELD_TYPE(id, field)
+#define DELEGATE_FIELD_HEAPTYPE(id, field)
+#define DELEGATE_FIELD_ADDRESS(id, field)
+#include "wasm-delegations-fields.def"
+      }
+    };
+    SegmentUses uses;
+    uses.walkModule(module.get());
+    std::vector<DataSegment*> segments;
+    for (auto& segment : module->dataSegments) {
+      if (!uses.used.contains(segment->name)) {
+        segments.push_back(segment.get());
+      }
+    }
+    reduceWithDeltaDebugging<DataSegment*>(
+      std::move(segments),
+      [&](DataSegment* segment) { return segment->data.size(); },
+      [&](const std::vector<DataSegment*>& removed) -> std::function<void()> {
+        auto undo = removeFromVector(module->dataSegments, removed);
+        module->updateMaps();
+        return [&, undo]() {
+          undo();
+          module->updateMaps();
+        };
+      });
+  }
+
   void visitModule([[maybe_unused]] Module* curr) {
     // The initial module given to us is our global object. As we continue to
     // process things here, we may replace the module, so we should never again
@@ -1162,6 +1720,9 @@ struct Reducer
 
     reduceFunctionBodies();
     reduceFunctions();
+    reduceBlockChildren();
+    reduceGlobals();
+    reduceDataSegments();
 
     shrinkElementSegments();
 
@@ -1335,6 +1896,7 @@ struct Reducer
 
 int main(int argc, const char* argv[]) {
   std::string input, test, working, command;
+  std::optional<std::string> inProcess;
   // By default, look for binaries alongside our own binary.
   std::string binDir = Path::getDirName(argv[0]);
   bool binary = true, deNan = false, verbose = false, debugInfo = false,
@@ -1492,6 +2054,37 @@ More documentation can be found at
            saveAllWorkingFiles = true;
            std::cout << "|saving all intermediate working files\n";
          })
+    .add("--jobs",
+         "-j",
+         "How many candidate reductions to test at the same time (default: 1). "
+         "Each one is written to a test file of its own, next to the test file "
+         "($TEST.job1, $TEST.job2 etc., before the extension), and the command "
+         "is run with every mention of the test file replaced by that file. "
+         "The results are the same as with a single job. Any other files that "
+         "the command writes to must be different for each job, or the jobs "
+         "will interfere with each other",
+         WasmReduceOption,
+         Options::Arguments::One,
+         [&](Options* o, const std::string& argument) {
+           int value = atoi(argument.c_str());
+           if (value < 1) {
+             Fatal() << "--jobs must be at least 1";
+           }
+           jobs = value;
+           std::cout << "|applying jobs: " << jobs << "\n";
+         })
+    .add("--in-process",
+         "-ip",
+         "Instead of running a command on each candidate, do what wasm-opt "
+         "does with these arguments (for example, \"-O3\", or an empty string "
+         "to just validate) in a child process that is forked from this one, "
+         "and reduce while keeping its return code and stdout unchanged. That "
+         "avoids writing and reading the candidate, and running a new process",
+         WasmReduceOption,
+         Options::Arguments::One,
+         [&](Options* o, const std::string& argument) {
+           inProcess = argument;
+         })
     .add_positional(
       "INFILE",
       Options::Arguments::One,
@@ -1511,6 +2104,30 @@ More documentation can be found at
   if (working.size() == 0) {
     Fatal() << "working file not provided\n";
   }
+  if (inProcess) {
+    if (!command.empty()) {
+      Fatal() << "--command and --in-process cannot be used together\n";
+    }
+    // Parse the arguments like wasm-opt would.
+    oracleOptions =
+      std::make_unique<OptimizationOptions>("wasm-opt", "in-process oracle");
+    std::vector<std::string> args = {"wasm-opt"};
+    std::istringstream stream(*inProcess);
+    std::string arg;
+    while (stream >> arg) {
+      args.push_back(arg);
+    }
+    std::vector<const char*> argv;
+    for (auto& arg : args) {
+      argv.push_back(arg.c_str());
+    }
+    oracleOptions->parse(argv.size(), argv.data());
+  }
+  if (jobs > 1 && !oracleOptions &&
+      getJobCommand(command, test, 1) == command) {
+    Fatal() << "with --jobs, the command must mention the test file, so that "
+               "each job can run it on a test file of its own\n";
+  }
 
   if (!binary) {
     Colors::setEnabled(false);
@@ -1524,10 +2141,27 @@ More documentation can be found at
   std::cerr << "|working: " << working << '\n';
   std::cerr << "|bin dir: " << binDir << '\n';
   std::cerr << "|extra flags: " << extraFlags << '\n';
+  std::cerr << "|jobs: " << jobs << '\n';
+  if (inProcess) {
+    std::cerr << "|in-process: " << *inProcess << '\n';
+  }
+
+  // Runs the command, or the in-process oracle, on the test file.
+  auto runOnTest = [&]() {
+    ProgramResult result;
+    if (oracleOptions) {
+      Module wasm;
+      readModule(test, wasm, options);
+      OracleRun(wasm).finish(result);
+    } else {
+      result.getFromExecution(command);
+    }
+    return result;
+  };
 
   // get the expected output
   copy_file(input, test);
-  expected.getFromExecution(command);
+  expected = runOnTest();
 
   std::cerr << "|expected result:\n" << expected << '\n';
   std::cerr << "|!! Make sure the above is what you expect! !!\n\n";
@@ -1550,19 +2184,27 @@ More documentation can be found at
     std::cerr << "|checking that command has different behavior on different "
                  "inputs (this "
                  "verifies that the test file is used by the command)\n";
-    // Try it on an invalid input.
-    {
-      std::ofstream dst(test, std::ios::binary);
-      dst << "waka waka\n";
+    // Try it on an invalid input, which the in-process oracle can not read.
+    ProgramResult resultOnInvalid;
+    if (!oracleOptions) {
+      {
+        std::ofstream dst(test, std::ios::binary);
+        dst << "waka waka\n";
+      }
+      resultOnInvalid = runOnTest();
     }
-    ProgramResult resultOnInvalid(command);
-    if (resultOnInvalid == expected) {
+    if (oracleOptions || resultOnInvalid == expected) {
       // Try it on a valid input.
       Module emptyModule;
       ModuleWriter writer(options.passOptions);
       writer.setBinary(true);
       options.write(writer, emptyModule, test);
-      ProgramResult resultOnValid(command);
+      ProgramResult resultOnValid = runOnTest();
+      if (resultOnValid == expected && oracleOptions) {
+        Fatal() << "the in-process oracle gives the same result on the given "
+                   "input as on a trivial valid wasm, so there is nothing to "
+                   "reduce (use -f to ignore this check)";
+      }
       if (resultOnValid == expected) {
         Fatal()
           << "running the command on the given input gives the same result as "
@@ -1586,7 +2228,7 @@ More documentation can be found at
     if (readWrite.failed()) {
       stopIfNotForced("failed to read and write the binary", readWrite);
     } else {
-      ProgramResult result(command);
+      ProgramResult result = runOnTest();
       if (result != expected) {
         stopIfNotForced("running command on the canonicalized module should "
                         "give the same results",
@@ -1620,6 +2262,9 @@ More documentation can be found at
       reducer.loadWorking();
       reducer.reduceFunctionBodies();
       reducer.reduceFunctions();
+      reducer.reduceBlockChildren();
+      reducer.reduceGlobals();
+      reducer.reduceDataSegments();
       first = false;
     }
 
@@ -1701,4 +2346,7 @@ More documentation can be found at
   }
   std::cerr << "|finished, final size: " << file_size(working) << "\n";
   copy_file(working, test); // just to avoid confusion
+  for (size_t i = 1; i < jobs; i++) {
+    std::remove(getJobTest(test, i).c_str());
+  }
 }
@@ -15,7 +15,10 @@
  */
 
 #include "instrumenter.h"
+#include "ir/eh-utils.h"
+#include "ir/find_all.h"
 #include "ir/module-utils.h"
+#include "ir/split-profile.h"
 #include "ir/names.h"
 #include "support/name.h"
 #include "wasm-builder.h"
@@ -23,6 +26,16 @@
 
 namespace wasm {
 
+// The profile refers to functions by their indices among the defined functions.
+static std::unordered_map<Name, Index> getDefinedFunctionIndices(Module& wasm) {
+  std::unordered_map<Name, Index> indices;
+  ModuleUtils::iterDefinedFunctions(wasm, [&](Function* func) {
+    Index index = indices.size();
+    indices[func->name] = index;
+  });
+  return indices;
+}
+
 Instrumenter::Instrumenter(const InstrumenterConfig& config,
                            uint64_t moduleHash)
   : config(config), moduleHash(moduleHash) {}
@@ -33,12 +46,43 @@ void Instrumenter::run(Module* wasm) {
   size_t numFuncs = 0;
   ModuleUtils::iterDefinedFunctions(*wasm, [&](Function*) { ++numFuncs; });
 
+  if ((config.callCounts || config.callEdges) &&
+      config.storageKind == WasmSplitOptions::StorageKind::InMemory) {
+    Fatal() << "error: --call-counts and --call-edges cannot be used with "
+               "--in-memory";
+  }
+
+  if (config.callEdges) {
+    findCallEdges();
+  }
   addGlobals(numFuncs);
   addSecondaryMemory(numFuncs);
   instrumentFuncs();
+  instrumentCalls();
   addProfileExport(numFuncs);
 }
 
+void Instrumenter::findCallEdges() {
+  auto funcIndices = getDefinedFunctionIndices(*wasm);
+
+  // Note each pair of a caller and a defined callee once, in the order in which
+  // they are first seen.
+  std::set<std::pair<Index, Index>> seen;
+  ModuleUtils::iterDefinedFunctions(*wasm, [&](Function* func) {
+    Index caller = funcIndices[func->name];
+    for (auto* call : FindAll<Call>(func->body).list) {
+      auto it = funcIndices.find(call->target);
+      if (it == funcIndices.end()) {
+        continue;
+      }
+      std::pair<Index, Index> edge{caller, it->second};
+      if (seen.insert(edge).second) {
+        callEdges.push_back(edge);
+      }
+    }
+  });
+}
+
 void Instrumenter::addGlobals(size_t numFuncs) {
   if (config.storageKind != WasmSplitOptions::StorageKind::InGlobals) {
     // Don't need globals
@@ -53,12 +97,12 @@ void Instrumenter::addGlobals(size_t numFuncs) {
   });
 
   // Create and add new globals
-  auto addGlobal = [&](Name name) {
-    auto global = Builder::makeGlobal(
-      name,
-      Type::i32,
-      Builder(*wasm).makeConst(Literal::makeZero(Type::i32)),
-      Builder::Mutable);
+  auto addGlobal = [&](Name name, Type type = Type::i32) {
+    auto global =
+      Builder::makeGlobal(name,
+                          type,
+                          Builder(*wasm).makeConst(Literal::makeZero(type)),
+                          Builder::Mutable);
     global->hasExplicitName = true;
     wasm->addGlobal(std::move(global));
   };
@@ -66,6 +110,32 @@ void Instrumenter::addGlobals(size_t numFuncs) {
   for (auto& name : functionGlobals) {
     addGlobal(name);
   }
+
+  // The counters are 64-bit, so they do not overflow in long runs. Add each one
+  // as soon as it is named, as their names are not otherwise guaranteed to be
+  // distinct from each other.
+  auto addCounter = [&](const std::string& name) {
+    auto valid = Names::getValidGlobalName(*wasm, name);
+    addGlobal(valid, Type::i64);
+    return valid;
+  };
+  if (config.callCounts) {
+    callCountGlobals.reserve(numFuncs);
+    ModuleUtils::iterDefinedFunctions(*wasm, [&](Function* func) {
+      callCountGlobals.push_back(addCounter(func->name.toString() + "_calls"));
+    });
+  }
+  if (config.callEdges) {
+    std::vector<Name> funcNames;
+    ModuleUtils::iterDefinedFunctions(
+      *wasm, [&](Function* func) { funcNames.push_back(func->name); });
+    callEdgeGlobals.reserve(callEdges.size());
+    for (auto& [caller, callee] : callEdges) {
+      callEdgeGlobals.push_back(addCounter(funcNames[caller].toString() +
+                                           "_to_" +
+                                           funcNames[callee].toString()));
+    }
+  }
 }
 
 void Instrumenter::addSecondaryMemory(size_t numFuncs) {
@@ -80,17 +150,102 @@ void Instrumenter::addSecondaryMemory(size_t numFuncs) {
 
   secondaryMemory =
     Names::getValidMemoryName(*wasm, config.secondaryMemoryName);
+  // The memory holds a byte for each function, followed by the 64-bit counters,
+  // if any, which are aligned.
+  size_t size = numFuncs;
+  if (config.callCounts || config.callEdges) {
+    callCountsOffset = (numFuncs + 7) & ~size_t(7);
+    callEdgesOffset =
+      callCountsOffset + (config.callCounts ? 8 * numFuncs : 0);
+    size = callEdgesOffset + 8 * callEdges.size();
+  }
+
   // Create a memory with enough pages to write into
   // The memory uses the default page size to avoid issues in case custom page
   // sizes are not supported.
   size_t pages =
-    (numFuncs + Memory::kDefaultPageSize - 1) / Memory::kDefaultPageSize;
+    (size + Memory::kDefaultPageSize - 1) / Memory::kDefaultPageSize;
   auto mem = Builder::makeMemory(secondaryMemory, pages, pages, true);
   mem->module = config.importNamespace;
   mem->base = config.secondaryMemoryName;
   wasm->addMemory(std::move(mem));
 }
 
+Expression* Instrumenter::makeIncrement(Name global, Address offset) {
+  Builder builder(*wasm);
+  if (config.storageKind == WasmSplitOptions::StorageKind::InGlobals) {
+    // (global.set $counter
+    //   (i64.add (global.get $counter) (i64.const 1))
+    // )
+    return builder.makeGlobalSet(
+      global,
+      builder.makeBinary(AddInt64,
+                         builder.makeGlobalGet(global, Type::i64),
+                         builder.makeConst(int64_t(1))));
+  }
+  // (drop (i64.atomic.rmw.add offset=offset (i32.const 0) (i64.const 1)))
+  return builder.makeDrop(
+    builder.makeAtomicRMW(RMWAdd,
+                          8,
+                          offset,
+                          builder.makeConstPtr(0, Type::i32),
+                          builder.makeConst(int64_t(1)),
+                          Type::i64,
+                          secondaryMemory,
+                          MemoryOrder::SeqCst));
+}
+
+void Instrumenter::instrumentCalls() {
+  if (!config.callEdges) {
+    return;
+  }
+  auto funcIndices = getDefinedFunctionIndices(*wasm);
+  std::map<std::pair<Index, Index>, Index> edgeIndices;
+  for (Index i = 0; i < callEdges.size(); ++i) {
+    edgeIndices[callEdges[i]] = i;
+  }
+
+  // Count each direct call to a defined function right before it is made.
+  Builder builder(*wasm);
+  ModuleUtils::iterDefinedFunctions(*wasm, [&](Function* func) {
+    Index caller = funcIndices[func->name];
+    bool hasPop = false;
+    for (auto** callp : FindAllPointers<Call>(func->body).list) {
+      auto* call = (*callp)->cast<Call>();
+      auto it = funcIndices.find(call->target);
+      if (it == funcIndices.end()) {
+        continue;
+      }
+      Index edge = edgeIndices.at({caller, it->second});
+      Name global =
+        config.storageKind == WasmSplitOptions::StorageKind::InGlobals
+          ? callEdgeGlobals[edge]
+          : Name();
+      std::vector<Expression*> list;
+      if (auto* pop = EHUtils::findPop(call)) {
+        // The pop must stay first in its catch, so take it out of the call
+        // before the increment. It is then nested in our block, which we fix
+        // up below.
+        for (auto** popp : FindAllPointers<Pop>(*callp).list) {
+          if (*popp == pop) {
+            Index local = builder.addVar(func, pop->type);
+            list.push_back(builder.makeLocalSet(local, pop));
+            *popp = builder.makeLocalGet(local, pop->type);
+            break;
+          }
+        }
+        hasPop = true;
+      }
+      list.push_back(makeIncrement(global, callEdgesOffset + 8 * edge));
+      list.push_back(call);
+      *callp = builder.makeBlock(list);
+    }
+    if (hasPop) {
+      EHUtils::handleBlockNestedPops(func, *wasm);
+    }
+  });
+}
+
 void Instrumenter::instrumentFuncs() {
   // Inject code at the beginning of each function to advance the monotonic
   // counter and set the function's timestamp if it hasn't already been set.
@@ -111,23 +266,28 @@ void Instrumenter::instrumentFuncs() {
       //   )
       // )
       auto globalIt = functionGlobals.begin();
+      Index funcIdx = 0;
       ModuleUtils::iterDefinedFunctions(*wasm, [&](Function* func) {
-        func->body = builder.makeSequence(
-          builder.makeIf(
-            builder.makeUnary(EqZInt32,
-                              builder.makeGlobalGet(*globalIt, Type::i32)),
-            builder.makeSequence(
-              builder.makeGlobalSet(
-                counterGlobal,
-                builder.makeBinary(
-                  AddInt32,
-                  builder.makeGlobalGet(counterGlobal, Type::i32),
-                  builder.makeConst(Literal::makeOne(Type::i32)))),
-              builder.makeGlobalSet(
-                *globalIt, builder.makeGlobalGet(counterGlobal, Type::i32)))),
-          func->body,
-          func->body->type);
+        Expression* entry = builder.makeIf(
+          builder.makeUnary(EqZInt32,
+                            builder.makeGlobalGet(*globalIt, Type::i32)),
+          builder.makeSequence(
+            builder.makeGlobalSet(
+              counterGlobal,
+              builder.makeBinary(
+                AddInt32,
+                builder.makeGlobalGet(counterGlobal, Type::i32),
+                builder.makeConst(Literal::makeOne(Type::i32)))),
+            builder.makeGlobalSet(
+              *globalIt, builder.makeGlobalGet(counterGlobal, Type::i32))));
+        std::vector<Expression*> list{entry};
+        if (config.callCounts) {
+          list.push_back(makeIncrement(callCountGlobals[funcIdx], 0));
+        }
+        list.push_back(func->body);
+        func->body = builder.makeBlock(list, func->body->type);
         ++globalIt;
+        ++funcIdx;
       });
       break;
     }
@@ -148,16 +308,20 @@ void Instrumenter::instrumentFuncs() {
           ? wasm->memories[0]->name
           : secondaryMemory;
       ModuleUtils::iterDefinedFunctions(*wasm, [&](Function* func) {
-        func->body = builder.makeSequence(
+        Expression* entry =
           builder.makeAtomicStore(1,
                                   funcIdx,
                                   builder.makeConstPtr(0, Type::i32),
                                   builder.makeConst(uint32_t(1)),
                                   Type::i32,
                                   memoryName,
-                                  MemoryOrder::SeqCst),
-          func->body,
-          func->body->type);
+                                  MemoryOrder::SeqCst);
+        std::vector<Expression*> list{entry};
+        if (config.callCounts) {
+          list.push_back(makeIncrement(Name(), callCountsOffset + 8 * funcIdx));
+        }
+        list.push_back(func->body);
+        func->body = builder.makeBlock(list, func->body->type);
         ++funcIdx;
       });
       break;
@@ -179,12 +343,44 @@ void Instrumenter::instrumentFuncs() {
 // are non-zero for functions that were called during the instrumented run and 0
 // otherwise. Functions with smaller non-zero timestamps were called earlier in
 // the instrumented run than funtions with larger timestamps.
+//
+// When call counts or call edges are recorded, the profile is in an extended
+// format instead, which is comprised of:
+//
+//   1. An 8-byte module hash
+//
+//   2. The 4-byte magic number "wsp1", 4 bytes of flags saying which of the
+//      optional parts below are present, and the 4-byte number of defined
+//      functions
+//
+//   3. A 4-byte timestamp for each defined function
+//
+//   4. Optionally, an 8-byte call count for each defined function
+//
+//   5. Optionally, the 4-byte number of direct call edges between defined
+//      functions, followed by each of them as the 4-byte index of the caller,
+//      the 4-byte index of the callee and the 8-byte number of calls. The
+//      indices are those of the defined functions.
+//
+// A timestamp cannot be as large as the magic number, so the formats can be
+// told apart.
 
 void Instrumenter::addProfileExport(size_t numFuncs) {
   // Calculate the size of the profile:
   //   8 bytes module hash +
-  //   4 bytes for the timestamp for each function
-  const size_t profileSize = 8 + 4 * numFuncs;
+  //   12 bytes for the magic number, flags and number of functions, if the
+  //     format is extended +
+  //   4 bytes for the timestamp for each function +
+  //   8 bytes for the call count of each function, if recorded +
+  //   4 bytes for the number of call edges and 16 bytes for each of them, if
+  //     recorded
+  const bool extended = config.callCounts || config.callEdges;
+  const size_t timestampsStart = extended ? 20 : 8;
+  const size_t callCountsStart = timestampsStart + 4 * numFuncs;
+  const size_t callEdgesStart =
+    callCountsStart + (config.callCounts ? 8 * numFuncs : 0);
+  const size_t profileSize =
+    callEdgesStart + (config.callEdges ? 4 + 16 * callEdges.size() : 0);
 
   // Make sure there is a memory with enough pages to write into
   if (wasm->memories.empty()) {
@@ -226,10 +422,28 @@ void Instrumenter::addProfileExport(size_t numFuncs) {
     return builder.makeConst(int32_t(profileSize));
   };
 
+  auto storeI32 = [&](uint32_t offset, uint32_t value) {
+    return builder.makeStore(4,
+                             offset,
+                             1,
+                             getAddr(),
+                             builder.makeConst(value),
+                             Type::i32,
+                             wasm->memories[0]->name);
+  };
+
   // Write the hash followed by all the time stamps
   Expression* writeData = builder.makeStore(
     8, 0, 1, getAddr(), hashConst(), Type::i64, wasm->memories[0]->name);
-  uint32_t offset = 8;
+  if (extended) {
+    uint32_t flags = (config.callCounts ? SplitProfile::HasCallCounts : 0) |
+                     (config.callEdges ? SplitProfile::HasCallEdges : 0);
+    writeData = builder.blockify(writeData,
+                                 storeI32(8, SplitProfile::ExtendedMagic),
+                                 storeI32(12, flags),
+                                 storeI32(16, numFuncs));
+  }
+  uint32_t offset = timestampsStart;
 
   switch (config.storageKind) {
     case WasmSplitOptions::StorageKind::InGlobals: {
@@ -245,6 +459,18 @@ void Instrumenter::addProfileExport(size_t numFuncs) {
                             wasm->memories[0]->name));
         offset += 4;
       }
+      for (const auto& global : callCountGlobals) {
+        writeData = builder.blockify(
+          writeData,
+          builder.makeStore(8,
+                            offset,
+                            1,
+                            getAddr(),
+                            builder.makeGlobalGet(global, Type::i64),
+                            Type::i64,
+                            wasm->memories[0]->name));
+        offset += 8;
+      }
       break;
     }
     case WasmSplitOptions::StorageKind::InMemory:
@@ -274,45 +500,109 @@ void Instrumenter::addProfileExport(size_t numFuncs) {
       //     (br $l)
       //   )
       // )
+      Expression* loopBody = builder.blockify(
+        builder.makeBreak(
+          "outer",
+          nullptr,
+          builder.makeBinary(
+            EqInt32, getFuncIdx(), builder.makeConst(uint32_t(numFuncs)))),
+        builder.makeStore(
+          4,
+          offset,
+          4,
+          builder.makeBinary(
+            AddInt32,
+            getAddr(),
+            builder.makeBinary(
+              MulInt32, getFuncIdx(), builder.makeConst(uint32_t(4)))),
+          builder.makeAtomicLoad(
+            1, 0, getFuncIdx(), Type::i32, loadMemoryName, MemoryOrder::SeqCst),
+          Type::i32,
+          wasm->memories[0]->name));
+      if (config.callCounts) {
+        // (i64.store offset=callCountsStart
+        //   (i32.add
+        //     (local.get $addr)
+        //     (i32.mul (local.get $funcIdx) (i32.const 8))
+        //   )
+        //   (i64.atomic.load offset=callCountsOffset
+        //     (i32.mul (local.get $funcIdx) (i32.const 8))
+        //   )
+        // )
+        auto getCountOffset = [&]() {
+          return builder.makeBinary(
+            MulInt32, getFuncIdx(), builder.makeConst(uint32_t(8)));
+        };
+        loopBody = builder.blockify(
+          loopBody,
+          builder.makeStore(8,
+                            callCountsStart,
+                            1,
+                            builder.makeBinary(
+                              AddInt32, getAddr(), getCountOffset()),
+                            builder.makeAtomicLoad(8,
+                                                   callCountsOffset,
+                                                   getCountOffset(),
+                                                   Type::i64,
+                                                   loadMemoryName,
+                                                   MemoryOrder::SeqCst),
+                            Type::i64,
+                            wasm->memories[0]->name));
+      }
+      loopBody = builder.blockify(
+        loopBody,
+        builder.makeLocalSet(
+          funcIdxVar,
+          builder.makeBinary(
+            AddInt32, getFuncIdx(), builder.makeConst(uint32_t(1)))),
+        builder.makeBreak("l"));
       writeData = builder.blockify(
         writeData,
-        builder.makeBlock(
-          "outer",
-          builder.makeLoop(
-            "l",
-            builder.blockify(
-              builder.makeBreak(
-                "outer",
-                nullptr,
-                builder.makeBinary(EqInt32,
-                                   getFuncIdx(),
-                                   builder.makeConst(uint32_t(numFuncs)))),
-              builder.makeStore(
-                4,
-                offset,
-                4,
-                builder.makeBinary(
-                  AddInt32,
-                  getAddr(),
-                  builder.makeBinary(
-                    MulInt32, getFuncIdx(), builder.makeConst(uint32_t(4)))),
-                builder.makeAtomicLoad(1,
-                                       0,
-                                       getFuncIdx(),
-                                       Type::i32,
-                                       loadMemoryName,
-                                       MemoryOrder::SeqCst),
-                Type::i32,
-                wasm->memories[0]->name),
-              builder.makeLocalSet(
-                funcIdxVar,
-                builder.makeBinary(
-                  AddInt32, getFuncIdx(), builder.makeConst(uint32_t(1)))),
-              builder.makeBreak("l")))));
+        builder.makeBlock("outer", builder.makeLoop("l", loopBody)));
       break;
     }
   }
 
+  if (config.callEdges) {
+    // Write the number of edges, then each edge's caller and callee together
+    // as a single 64-bit value, followed by its count.
+    writeData = builder.blockify(writeData,
+                                 storeI32(callEdgesStart, callEdges.size()));
+    offset = callEdgesStart + 4;
+    for (Index i = 0; i < callEdges.size(); ++i) {
+      auto [caller, callee] = callEdges[i];
+      Expression* count;
+      if (config.storageKind == WasmSplitOptions::StorageKind::InGlobals) {
+        count = builder.makeGlobalGet(callEdgeGlobals[i], Type::i64);
+      } else {
+        count = builder.makeAtomicLoad(8,
+                                       callEdgesOffset + 8 * i,
+                                       builder.makeConstPtr(0, Type::i32),
+                                       Type::i64,
+                                       secondaryMemory,
+                                       MemoryOrder::SeqCst);
+      }
+      writeData = builder.blockify(
+        writeData,
+        builder.makeStore(
+          8,
+          offset,
+          1,
+          getAddr(),
+          builder.makeConst(uint64_t(caller) | (uint64_t(callee) << 32)),
+          Type::i64,
+          wasm->memories[0]->name),
+        builder.makeStore(8,
+                          offset + 8,
+                          1,
+                          getAddr(),
+                          count,
+                          Type::i64,
+                          wasm->memories[0]->name));
+      offset += 16;
+    }
+  }
+
   writeProfile->body = builder.makeSequence(
     builder.makeIf(builder.makeBinary(GeUInt32, getSize(), profileSizeConst()),
                    writeData),
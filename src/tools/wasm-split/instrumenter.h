@@ -35,11 +35,17 @@ struct InstrumenterConfig {
   // The export name of the function the embedder calls to write the profile
   // into memory
   std::string profileExport = DEFAULT_PROFILE_EXPORT;
+  // Whether to also count the calls to each function
+  bool callCounts = false;
+  // Whether to also count the calls along each direct call edge between
+  // defined functions
+  bool callEdges = false;
 };
 
 // Add a global monotonic counter and a timestamp global for each function, code
 // at the beginning of each function to set its timestamp, and a new exported
-// function for dumping the profile data.
+// function for dumping the profile data. Optionally also count the calls to
+// each function and along each direct call edge.
 struct Instrumenter : public Pass {
   Module* wasm = nullptr;
 
@@ -48,16 +54,29 @@ struct Instrumenter : public Pass {
 
   Name counterGlobal;
   std::vector<Name> functionGlobals;
+  std::vector<Name> callCountGlobals;
+  std::vector<Name> callEdgeGlobals;
+
+  // The direct call edges between defined functions, as pairs of indices of
+  // defined functions, in the order of their counters.
+  std::vector<std::pair<Index, Index>> callEdges;
 
   Name secondaryMemory;
+  // Where the call counts and the call edge counts start in the secondary
+  // memory.
+  Address callCountsOffset = 0;
+  Address callEdgesOffset = 0;
 
   Instrumenter(const InstrumenterConfig& config, uint64_t moduleHash);
 
   void run(Module* wasm) override;
 
 private:
+  void findCallEdges();
   void addGlobals(size_t numFuncs);
   void addSecondaryMemory(size_t numFuncs);
+  Expression* makeIncrement(Name global, Address offset);
+  void instrumentCalls();
   void instrumentFuncs();
   void addProfileExport(size_t numFuncs);
 };
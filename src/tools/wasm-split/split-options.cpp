@@ -302,6 +302,23 @@ WasmSplitOptions::WasmSplitOptions()
       [&](Options* o, const std::string& argument) {
         storageKind = StorageKind::InSecondaryMemory;
       })
+    .add("--call-counts",
+         "",
+         "Also count the calls to each function, which the profile then "
+         "includes. Cannot be used with --in-memory.",
+         WasmSplitOption,
+         {Mode::Instrument},
+         Options::Arguments::Zero,
+         [&](Options* o, const std::string& argument) { callCounts = true; })
+    .add("--call-edges",
+         "",
+         "Also count the direct calls from each function to each other "
+         "function, which the profile then includes. Cannot be used with "
+         "--in-memory.",
+         WasmSplitOption,
+         {Mode::Instrument},
+         Options::Arguments::Zero,
+         [&](Options* o, const std::string& argument) { callEdges = true; })
     .add("--secondary-memory-name",
          "",
          "The name of the secondary memory created to store profile "
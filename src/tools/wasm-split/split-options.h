@@ -43,6 +43,8 @@ struct WasmSplitOptions : ToolOptions {
     InSecondaryMemory, // Store profile data in memory separate from main memory
   };
   StorageKind storageKind = StorageKind::InGlobals;
+  bool callCounts = false;
+  bool callEdges = false;
 
   bool usePlaceholders = true;
   bool verbose = false;
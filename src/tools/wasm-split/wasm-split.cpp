@@ -20,6 +20,7 @@
 #include <fstream>
 
 #include "ir/module-splitting.h"
+#include "ir/split-profile.h"
 #include "ir/names.h"
 #include "support/file.h"
 #include "support/name.h"
@@ -33,6 +34,7 @@
 #include "split-options.h"
 
 using namespace wasm;
+using SplitProfile::ProfileData;
 
 namespace {
 
@@ -58,16 +60,6 @@ void parseInput(Module& wasm, const WasmSplitOptions& options) {
   }
 }
 
-uint64_t hashFile(const std::string& filename) {
-  auto contents(read_file<std::vector<char>>(filename, Flags::Binary));
-  size_t digest = 0;
-  // Don't use `hash` or `rehash` - they aren't deterministic between executions
-  for (char c : contents) {
-    hash_combine(digest, c);
-  }
-  return uint64_t(digest);
-}
-
 void adjustTableSize(Module& wasm, int initialSize, bool secondary = false) {
   if (initialSize < 0) {
     return;
@@ -116,7 +108,7 @@ void instrumentModule(const WasmSplitOptions& options) {
     Fatal() << "error: Export " << options.profileExport << " already exists.";
   }
 
-  uint64_t moduleHash = hashFile(options.inputFiles[0]);
+  uint64_t moduleHash = SplitProfile::hashFile(options.inputFiles[0]);
   InstrumenterConfig config;
   if (options.importNamespace) {
     config.importNamespace = *options.importNamespace;
@@ -126,6 +118,8 @@ void instrumentModule(const WasmSplitOptions& options) {
   }
   config.storageKind = options.storageKind;
   config.profileExport = options.profileExport;
+  config.callCounts = options.callCounts;
+  config.callEdges = options.callEdges;
 
   PassRunner runner(&wasm, options.passOptions);
   runner.add(std::make_unique<Instrumenter>(config, moduleHash));
@@ -137,44 +131,11 @@ void instrumentModule(const WasmSplitOptions& options) {
   writeModule(wasm, options.output, options);
 }
 
-struct ProfileData {
-  uint64_t hash;
-  std::vector<size_t> timestamps;
-};
-
-// See "wasm-split profile format" in instrumenter.cpp for more information.
-ProfileData readProfile(const std::string& file) {
-  auto profileData = read_file<std::vector<char>>(file, Flags::Binary);
-  size_t i = 0;
-  auto readi32 = [&]() {
-    if (i + 4 > profileData.size()) {
-      Fatal() << "Unexpected end of profile data in " << file;
-    }
-    uint32_t i32 = 0;
-    i32 |= uint32_t(uint8_t(profileData[i++]));
-    i32 |= uint32_t(uint8_t(profileData[i++])) << 8;
-    i32 |= uint32_t(uint8_t(profileData[i++])) << 16;
-    i32 |= uint32_t(uint8_t(profileData[i++])) << 24;
-    return i32;
-  };
-
-  uint64_t hash = readi32();
-  hash |= uint64_t(readi32()) << 32;
-
-  std::vector<size_t> timestamps;
-  while (i < profileData.size()) {
-    timestamps.push_back(readi32());
-  }
-
-  return {hash, timestamps};
-}
-
 void getFunctionsToKeepAndSplit(Module& wasm,
                                 uint64_t wasmHash,
-                                const std::string& profileFile,
+                                const ProfileData& profile,
                                 std::set<Name>& keepFuncs,
                                 std::set<Name>& splitFuncs) {
-  ProfileData profile = readProfile(profileFile);
   if (profile.hash != wasmHash) {
     Fatal() << "error: checksum in profile does not match module checksum. "
             << "The module to split must be the original, uninstrumented "
@@ -279,9 +240,12 @@ void splitModule(const WasmSplitOptions& options) {
 
   if (options.profileFile.size()) {
     // Use the profile to set `keepFuncs` and `splitFuncs`.
-    uint64_t hash = hashFile(options.inputFiles[0]);
-    getFunctionsToKeepAndSplit(
-      wasm, hash, options.profileFile, keepFuncs, splitFuncs);
+    uint64_t hash = SplitProfile::hashFile(options.inputFiles[0]);
+    getFunctionsToKeepAndSplit(wasm,
+                               hash,
+                               SplitProfile::read(options.profileFile),
+                               keepFuncs,
+                               splitFuncs);
   } else {
     // Normally the default is to keep each function, but if --keep-funcs is the
     // only thing specified, then all other functions will be split.
@@ -493,7 +457,7 @@ void multiSplitModule(const WasmSplitOptions& options) {
 
 void mergeProfiles(const WasmSplitOptions& options) {
   // Read the initial profile. We will merge other profiles into this one.
-  ProfileData data = readProfile(options.inputFiles[0]);
+  ProfileData data = SplitProfile::read(options.inputFiles[0]);
 
   // In verbose mode, we want to find profiles that don't contribute to the
   // merged profile. To do that, keep track of how many profiles each function
@@ -509,15 +473,32 @@ void mergeProfiles(const WasmSplitOptions& options) {
     }
   }
 
+  // Sums counts, saturating rather than wrapping around.
+  auto addCounts = [](uint64_t a, uint64_t b) {
+    return a > std::numeric_limits<uint64_t>::max() - b
+             ? std::numeric_limits<uint64_t>::max()
+             : a + b;
+  };
+  // The counts of the call edges by caller and callee. Instrumenting the same
+  // module always finds the same edges, but they are summed by their ends
+  // anyhow.
+  std::map<std::pair<uint32_t, uint32_t>, uint64_t> edgeCounts;
+  for (auto& edge : data.callEdges) {
+    edgeCounts[{edge.caller, edge.callee}] =
+      addCounts(edgeCounts[{edge.caller, edge.callee}], edge.count);
+  }
+
   // Read all the other profiles, taking the minimum nonzero timestamp for each
-  // function.
+  // function and summing the call counts.
   for (size_t i = 1; i < options.inputFiles.size(); ++i) {
-    ProfileData newData = readProfile(options.inputFiles[i]);
+    ProfileData newData = SplitProfile::read(options.inputFiles[i]);
     if (newData.hash != data.hash) {
       Fatal() << "Checksum in profile " << options.inputFiles[i]
               << " does not match hash in profile " << options.inputFiles[0];
     }
-    if (newData.timestamps.size() != data.timestamps.size()) {
+    if (newData.timestamps.size() != data.timestamps.size() ||
+        newData.hasCallCounts != data.hasCallCounts ||
+        newData.hasCallEdges != data.hasCallEdges) {
       Fatal() << "Profile " << options.inputFiles[i]
               << " incompatible with profile " << options.inputFiles[0];
     }
@@ -532,13 +513,25 @@ void mergeProfiles(const WasmSplitOptions& options) {
         ++numProfiles[t];
       }
     }
+    // Sum the call counts.
+    for (size_t t = 0; t < data.callCounts.size(); ++t) {
+      data.callCounts[t] = addCounts(data.callCounts[t], newData.callCounts[t]);
+    }
+    for (auto& edge : newData.callEdges) {
+      edgeCounts[{edge.caller, edge.callee}] =
+        addCounts(edgeCounts[{edge.caller, edge.callee}], edge.count);
+    }
+  }
+  data.callEdges.clear();
+  for (auto& [edge, count] : edgeCounts) {
+    data.callEdges.push_back({edge.first, edge.second, count});
   }
 
   // Check for useless profiles.
   if (options.verbose) {
     for (const auto& file : options.inputFiles) {
       bool useless = true;
-      ProfileData newData = readProfile(file);
+      ProfileData newData = SplitProfile::read(file);
       for (size_t t = 0; t < newData.timestamps.size(); ++t) {
         if (newData.timestamps[t] && numProfiles[t] == 1) {
           useless = false;
@@ -553,13 +546,7 @@ void mergeProfiles(const WasmSplitOptions& options) {
   }
 
   // Write the combined profile.
-  BufferWithRandomAccess buffer;
-  buffer << data.hash;
-  for (size_t t = 0; t < data.timestamps.size(); ++t) {
-    buffer << uint32_t(data.timestamps[t]);
-  }
-  Output out(options.output, Flags::Binary);
-  buffer.writeTo(out.getStream());
+  SplitProfile::write(data, options.output);
 }
 
 void checkExists(const std::string& path) {
@@ -580,13 +567,26 @@ void printReadableProfile(const WasmSplitOptions& options) {
   std::set<Name> keepFuncs;
   std::set<Name> splitFuncs;
 
-  uint64_t hash = hashFile(wasmFile);
-  getFunctionsToKeepAndSplit(
-    wasm, hash, options.profileFile, keepFuncs, splitFuncs);
+  uint64_t hash = SplitProfile::hashFile(wasmFile);
+  ProfileData profile = SplitProfile::read(options.profileFile);
+  getFunctionsToKeepAndSplit(wasm, hash, profile, keepFuncs, splitFuncs);
+
+  std::vector<Name> funcNames;
+  std::unordered_map<Name, uint64_t> callCounts;
+  ModuleUtils::iterDefinedFunctions(wasm, [&](Function* func) {
+    if (profile.hasCallCounts) {
+      callCounts[func->name] = profile.callCounts[funcNames.size()];
+    }
+    funcNames.push_back(func->name);
+  });
 
   auto printFnSet = [&](auto funcs, std::string prefix) {
     for (auto it = funcs.begin(); it != funcs.end(); ++it) {
-      std::cout << prefix << " " << it->toString() << std::endl;
+      std::cout << prefix << " " << it->toString();
+      if (profile.hasCallCounts) {
+        std::cout << " (calls: " << callCounts[*it] << ")";
+      }
+      std::cout << std::endl;
     }
   };
 
@@ -597,6 +597,23 @@ void printReadableProfile(const WasmSplitOptions& options) {
   std::cout << "Splitting out functions: " << std::endl;
   printFnSet(splitFuncs, "-");
   std::cout << std::endl;
+
+  if (profile.hasCallEdges) {
+    // Print the edges that were taken, the hottest first.
+    auto edges = profile.callEdges;
+    std::stable_sort(edges.begin(), edges.end(), [](auto& a, auto& b) {
+      return a.count > b.count;
+    });
+    std::cout << "Call edges: " << std::endl;
+    for (auto& edge : edges) {
+      if (edge.count) {
+        std::cout << "  " << funcNames[edge.caller] << " -> "
+                  << funcNames[edge.callee] << " (calls: " << edge.count
+                  << ")" << std::endl;
+      }
+    }
+    std::cout << std::endl;
+  }
 }
 
 } // anonymous namespace
@@ -1313,6 +1313,8 @@ enum FeaturePrefix { FeatureUsed = '+', FeatureDisallowed = '-' };
 // (local index in IR, tuple index) => binary local index
 using MappedLocals = std::unordered_map<std::pair<Index, Index>, size_t>;
 
+class ModuleStackIR;
+
 // Writes out wasm to the binary format
 
 class WasmBinaryWriter {
@@ -1330,6 +1332,7 @@ class WasmBinaryWriter {
     std::unordered_map<Name, Index> memoryIndexes;
     std::unordered_map<Name, Index> dataIndexes;
 
+    BinaryIndexes() = default;
     BinaryIndexes(Module& wasm) {
       auto addIndexes = [&](auto& source, auto& indexes) {
         auto addIndex = [&](auto* curr) {
@@ -1437,6 +1440,13 @@ public:
   void writeFunctionSignatures();
   void writeExpression(Expression* curr);
   void writeFunctions();
+  // Writes the body of a function (its locals and code), without its size.
+  void
+  writeFunctionBody(Function* func, ModuleStackIR* moduleStackIR, bool DWARF);
+  // Writes function bodies in parallel into separate buffers, then appends them
+  // to the output, rebasing their source map and DWARF locations.
+  void writeFunctionsInParallel(ModuleStackIR* moduleStackIR, bool DWARF);
+  void warnAboutFunctionLimits(Function* func);
   void writeStrings();
   void writeGlobals();
   void writeExports();
@@ -1529,6 +1539,11 @@ private:
   ModuleUtils::IndexedHeapTypes indexedTypes;
   std::unordered_map<Signature, uint32_t> signatureIndexes;
 
+  // The writer whose indexes we look things up in. That is this writer itself,
+  // unless this is a writer for a single function body that is written in
+  // parallel, in which case the tables are shared with the main writer.
+  const WasmBinaryWriter* tableOwner = this;
+
   bool debugInfo = true;
 
   // TODO: Remove `emitModuleName` in the future once there are better ways to
@@ -1573,6 +1588,13 @@ private:
 
   void prepare();
 
+  // Create a writer for a function body that shares the module and the tables
+  // of |parent|, and writes into |o|.
+  struct FunctionBodyWriter {};
+  WasmBinaryWriter(const WasmBinaryWriter& parent,
+                   BufferWithRandomAccess& o,
+                   FunctionBodyWriter);
+
   // Internal helper for emitting a code annotation section for a hint that is
   // expression offset based. Receives the name of the section and two
   // functions, one to check if the annotation we care about exists (receiving
@@ -1588,7 +1610,9 @@ extern std::vector<char> defaultEmptySourceMap;
 class WasmBinaryReader {
   Module& wasm;
   MixedArena& allocator;
-  const std::vector<char>& input;
+  // The input bytes, which are not owned by the reader, and which may be a
+  // memory-mapped file.
+  std::string_view input;
 
   // Settings.
 
@@ -1612,8 +1636,16 @@ class WasmBinaryReader {
 public:
   WasmBinaryReader(Module& wasm,
                    FeatureSet features,
-                   const std::vector<char>& input,
+                   std::string_view input,
                    std::vector<char>& sourceMap = defaultEmptySourceMap);
+  WasmBinaryReader(Module& wasm,
+                   FeatureSet features,
+                   const std::vector<char>& input,
+                   std::vector<char>& sourceMap = defaultEmptySourceMap)
+    : WasmBinaryReader(wasm,
+                       features,
+                       std::string_view(input.data(), input.size()),
+                       sourceMap) {}
 
   void setDebugInfo(bool value) { debugInfo = value; }
   void setDWARF(bool value) { DWARF = value; }
@@ -1750,6 +1782,13 @@ public:
   void requireFunctionContext(const char* error);
 
   void readFunctions();
+  // Read the size, locals and prolog debug location of the current function,
+  // returning the position of the end of its body.
+  size_t readFunctionHeader(Index i);
+  void readFunctionBody(size_t endOfFunction);
+  // Reads the bodies of all functions in parallel, after scanning where each of
+  // them starts.
+  void readFunctionsInParallel();
   void readVars();
   void setLocalNames(Function& func, Index i);
 
@@ -1835,6 +1874,12 @@ private:
   // needCodeLocations.
   void preScan();
 
+  // Create a reader for function bodies that shares the module, the input, and
+  // what was read from the sections before the code section with |parent|.
+  // Used to read function bodies in parallel.
+  struct FunctionBodyReader {};
+  WasmBinaryReader(const WasmBinaryReader& parent, FunctionBodyReader);
+
   // Internal helper for reading a code annotation section for a hint that is
   // expression offset based. Receives the section name, payload length of the
   // section and a function to read a single hint (receiving the annotation to
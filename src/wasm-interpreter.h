@@ -136,6 +136,61 @@ public:
   }
 };
 
+// A value of one of the MVP numeric types, i32, i64, f32 or f64, as its bits
+// and its type. Unlike Literal, which may hold reference counted data, this is
+// trivially copyable, so arithmetic on it does not need to go through Literal's
+// out-of-line copy and destruction logic. See ExpressionRunner::visitNumeric.
+struct NumericValue {
+  uint64_t bits = 0;
+  Type::BasicType type = Type::none;
+
+  NumericValue() = default;
+  NumericValue(uint32_t bits, Type::BasicType type) : bits(bits), type(type) {}
+  NumericValue(uint64_t bits, Type::BasicType type) : bits(bits), type(type) {}
+  explicit NumericValue(const Literal& value) : type(value.type.getBasic()) {
+    switch (type) {
+      case Type::i32:
+        bits = uint32_t(value.geti32());
+        break;
+      case Type::f32:
+        bits = uint32_t(value.reinterpreti32());
+        break;
+      case Type::i64:
+        bits = value.geti64();
+        break;
+      case Type::f64:
+        bits = value.reinterpreti64();
+        break;
+      default:
+        WASM_UNREACHABLE("unexpected type");
+    }
+  }
+
+  static bool isNumeric(Type type) {
+    return type == Type::i32 || type == Type::i64 || type == Type::f32 ||
+           type == Type::f64;
+  }
+
+  uint32_t geti32() const { return uint32_t(bits); }
+  uint64_t geti64() const { return bits; }
+
+  Literal toLiteral() const {
+    switch (type) {
+      case Type::i32:
+        return Literal(uint32_t(bits));
+      case Type::f32:
+        return Literal(uint32_t(bits)).castToF32();
+      case Type::i64:
+        return Literal(bits);
+      case Type::f64:
+        return Literal(bits).castToF64();
+      default:
+        WASM_UNREACHABLE("unexpected type");
+    }
+  }
+};
+static_assert(sizeof(NumericValue) == 16);
+
 struct FuncData {
   // Name of the function in the instance that defines it, if available, or
   // otherwise the internal name of a function import.
@@ -384,6 +439,19 @@ protected:
     return Literal(allocation, type.getHeapType());
   }
 
+  // Called right before the fields or elements of existing GC data are
+  // modified. Subclasses can override this to keep track of changes to the
+  // heap.
+  void noteGCWrite(const std::shared_ptr<GCData>& data) {}
+
+  // Called before an expression is evaluated and after it broke out,
+  // respectively. Subclasses can override these to remember expressions that
+  // always break out in the same way, wherever they are evaluated, and to skip
+  // evaluating them again: if getKnownBreak() returns true, |flow| is used as
+  // the result of |curr| instead of evaluating it.
+  bool getKnownBreak(Expression* curr, Flow& flow) { return false; }
+  void noteBreak(Expression* curr, const Flow& flow) {}
+
   // Same as makeGCData but for ExnData.
   Literal makeExnData(Tag* tag, const Literals& payload) {
     auto allocation = std::make_shared<ExnData>(tag, payload);
@@ -603,13 +671,17 @@ public:
     std::cout << indent() << "visit(" << getExpressionName(curr) << ")\n";
 #endif
 
+    Flow ret;
+    if (self()->getKnownBreak(curr, ret)) {
+      return ret;
+    }
+
     depth++;
     if (maxDepth != NO_LIMIT && depth > maxDepth) {
       hostLimit("interpreter recursion limit");
     }
 
     // Execute the instruction.
-    Flow ret;
     if (!getCurrContinuationOrNull()) {
       // We are not in a continuation, so we cannot suspend/resume. Just execute
       // normally.
@@ -721,6 +793,9 @@ public:
       }
     }
 #endif
+    if (ret.breaking()) {
+      self()->noteBreak(curr, ret);
+    }
     depth--;
 #if WASM_INTERPRETER_DEBUG
     std::cout << indent() << "=> returning: " << ret << '\n';
@@ -902,9 +977,338 @@ public:
   // Unary and Binary nodes, the core math computations. We mostly just
   // delegate to the Literal::* methods, except we handle traps here.
 
+  // The numeric path. Unary and binary operations on MVP numeric types, along
+  // with the constants, local.gets and loads that feed them, make up most of
+  // the work in typical code. Trees of them are evaluated here recursively on
+  // NumericValues, and a Flow is only built for the value of the root. Other
+  // expressions in such trees are visited as usual.
+  //
+  // This is not used in continuations, where the values of children must be
+  // noted in case we suspend (see visit()).
+  bool useNumericPath(Expression* curr) {
+    return NumericValue::isNumeric(curr->type) &&
+           (!continuationStore || continuationStore->continuations.empty());
+  }
+
+  Flow visitNumericRoot(Expression* curr) {
+    NumericValue value;
+    Flow flow;
+    bool ok;
+    if (auto* unary = curr->dynCast<Unary>()) {
+      ok = visitNumericUnary(unary, value, flow);
+    } else {
+      ok = visitNumericBinary(curr->cast<Binary>(), value, flow);
+    }
+    if (!ok) {
+      return flow;
+    }
+    return Flow(value.toLiteral());
+  }
+
+  // Evaluates an expression of a numeric type into |out|. Returns false if we
+  // are breaking out instead, in which case |flow| is set.
+  bool visitNumeric(Expression* curr, NumericValue& out, Flow& flow) {
+    switch (curr->_id) {
+      case Expression::ConstId:
+        out = NumericValue(curr->cast<Const>()->value);
+        return true;
+      case Expression::LocalGetId:
+        return self()->visitLocalGetNumeric(curr->cast<LocalGet>(), out, flow);
+      case Expression::LoadId:
+        return self()->visitLoadNumeric(curr->cast<Load>(), out, flow);
+      case Expression::UnaryId:
+      case Expression::BinaryId: {
+        auto* operand = curr->is<Unary>() ? curr->cast<Unary>()->value
+                                          : curr->cast<Binary>()->left;
+        if (!useNumericPath(curr) || !NumericValue::isNumeric(operand->type)) {
+          break;
+        }
+        if (self()->getKnownBreak(curr, flow)) {
+          return false;
+        }
+        depth++;
+        if (maxDepth != NO_LIMIT && depth > maxDepth) {
+          hostLimit("interpreter recursion limit");
+        }
+        bool ok = curr->is<Unary>()
+                    ? visitNumericUnary(curr->cast<Unary>(), out, flow)
+                    : visitNumericBinary(curr->cast<Binary>(), out, flow);
+        if (!ok) {
+          self()->noteBreak(curr, flow);
+        }
+        depth--;
+        return ok;
+      }
+      default:
+        break;
+    }
+    return visitNumericGeneric(curr, out, flow);
+  }
+
+  // Evaluates an expression through visit().
+  bool visitNumericGeneric(Expression* curr, NumericValue& out, Flow& flow) {
+    flow = self()->visit(curr);
+    if (flow.breaking()) {
+      return false;
+    }
+    out = NumericValue(flow.getSingleValue());
+    return true;
+  }
+
+  // Subclasses can override these to read locals and memory directly.
+  bool visitLocalGetNumeric(LocalGet* curr, NumericValue& out, Flow& flow) {
+    return visitNumericGeneric(curr, out, flow);
+  }
+  bool visitLoadNumeric(Load* curr, NumericValue& out, Flow& flow) {
+    return visitNumericGeneric(curr, out, flow);
+  }
+
+  bool visitNumericUnary(Unary* curr, NumericValue& out, Flow& flow) {
+    NumericValue value;
+    if (!visitNumeric(curr->value, value, flow)) {
+      return false;
+    }
+    uint32_t x32 = value.geti32();
+    uint64_t x64 = value.geti64();
+    switch (curr->op) {
+      case EqZInt32:
+        out = NumericValue(uint32_t(x32 == 0), Type::i32);
+        return true;
+      case EqZInt64:
+        out = NumericValue(uint32_t(x64 == 0), Type::i32);
+        return true;
+      case ClzInt32:
+        out = NumericValue(uint32_t(Bits::countLeadingZeroes(x32)), Type::i32);
+        return true;
+      case ClzInt64:
+        out = NumericValue(uint64_t(Bits::countLeadingZeroes(x64)), Type::i64);
+        return true;
+      case CtzInt32:
+        out = NumericValue(uint32_t(Bits::countTrailingZeroes(x32)), Type::i32);
+        return true;
+      case CtzInt64:
+        out = NumericValue(uint64_t(Bits::countTrailingZeroes(x64)), Type::i64);
+        return true;
+      case PopcntInt32:
+        out = NumericValue(uint32_t(Bits::popCount(x32)), Type::i32);
+        return true;
+      case PopcntInt64:
+        out = NumericValue(uint64_t(Bits::popCount(x64)), Type::i64);
+        return true;
+      case ExtendS8Int32:
+        out = NumericValue(uint32_t(int32_t(int8_t(x32))), Type::i32);
+        return true;
+      case ExtendS16Int32:
+        out = NumericValue(uint32_t(int32_t(int16_t(x32))), Type::i32);
+        return true;
+      case ExtendS8Int64:
+        out = NumericValue(uint64_t(int64_t(int8_t(x64))), Type::i64);
+        return true;
+      case ExtendS16Int64:
+        out = NumericValue(uint64_t(int64_t(int16_t(x64))), Type::i64);
+        return true;
+      case ExtendS32Int64:
+      case ExtendSInt32:
+        out = NumericValue(uint64_t(int64_t(int32_t(x64))), Type::i64);
+        return true;
+      case ExtendUInt32:
+        out = NumericValue(uint64_t(x32), Type::i64);
+        return true;
+      case WrapInt64:
+        out = NumericValue(uint32_t(x64), Type::i32);
+        return true;
+      case ReinterpretInt32:
+        out = NumericValue(x32, Type::f32);
+        return true;
+      case ReinterpretFloat32:
+        out = NumericValue(x32, Type::i32);
+        return true;
+      case ReinterpretInt64:
+        out = NumericValue(x64, Type::f64);
+        return true;
+      case ReinterpretFloat64:
+        out = NumericValue(x64, Type::i64);
+        return true;
+      default: {
+        auto result = doUnary(curr, value.toLiteral());
+        out = NumericValue(result.getSingleValue());
+        return true;
+      }
+    }
+  }
+
+  bool visitNumericBinary(Binary* curr, NumericValue& out, Flow& flow) {
+    NumericValue left, right;
+    if (!visitNumeric(curr->left, left, flow) ||
+        !visitNumeric(curr->right, right, flow)) {
+      return false;
+    }
+    uint32_t x32 = left.geti32(), y32 = right.geti32();
+    uint64_t x64 = left.geti64(), y64 = right.geti64();
+    auto i32 = [&](auto value) {
+      out = NumericValue(uint32_t(value), Type::i32);
+      return true;
+    };
+    auto i64 = [&](auto value) {
+      out = NumericValue(uint64_t(value), Type::i64);
+      return true;
+    };
+    switch (curr->op) {
+      case AddInt32:
+        return i32(x32 + y32);
+      case SubInt32:
+        return i32(x32 - y32);
+      case MulInt32:
+        return i32(x32 * y32);
+      case DivSInt32:
+        if (y32 == 0) {
+          trap("i32.div_s by 0");
+        }
+        if (int32_t(x32) == std::numeric_limits<int32_t>::min() &&
+            int32_t(y32) == -1) {
+          trap("i32.div_s overflow"); // signed division overflow
+        }
+        return i32(int32_t(x32) / int32_t(y32));
+      case DivUInt32:
+        if (y32 == 0) {
+          trap("i32.div_u by 0");
+        }
+        return i32(x32 / y32);
+      case RemSInt32:
+        if (y32 == 0) {
+          trap("i32.rem_s by 0");
+        }
+        if (int32_t(y32) == -1) {
+          return i32(0);
+        }
+        return i32(int32_t(x32) % int32_t(y32));
+      case RemUInt32:
+        if (y32 == 0) {
+          trap("i32.rem_u by 0");
+        }
+        return i32(x32 % y32);
+      case AndInt32:
+        return i32(x32 & y32);
+      case OrInt32:
+        return i32(x32 | y32);
+      case XorInt32:
+        return i32(x32 ^ y32);
+      case ShlInt32:
+        return i32(x32 << (y32 & 31));
+      case ShrSInt32:
+        return i32(int32_t(x32) >> (y32 & 31));
+      case ShrUInt32:
+        return i32(x32 >> (y32 & 31));
+      case RotLInt32:
+        return i32(Bits::rotateLeft(x32, y32));
+      case RotRInt32:
+        return i32(Bits::rotateRight(x32, y32));
+      case EqInt32:
+        return i32(x32 == y32);
+      case NeInt32:
+        return i32(x32 != y32);
+      case LtSInt32:
+        return i32(int32_t(x32) < int32_t(y32));
+      case LtUInt32:
+        return i32(x32 < y32);
+      case LeSInt32:
+        return i32(int32_t(x32) <= int32_t(y32));
+      case LeUInt32:
+        return i32(x32 <= y32);
+      case GtSInt32:
+        return i32(int32_t(x32) > int32_t(y32));
+      case GtUInt32:
+        return i32(x32 > y32);
+      case GeSInt32:
+        return i32(int32_t(x32) >= int32_t(y32));
+      case GeUInt32:
+        return i32(x32 >= y32);
+      case AddInt64:
+        return i64(x64 + y64);
+      case SubInt64:
+        return i64(x64 - y64);
+      case MulInt64:
+        return i64(x64 * y64);
+      case DivSInt64:
+        if (y64 == 0) {
+          trap("i64.div_s by 0");
+        }
+        if (int64_t(x64) == std::numeric_limits<int64_t>::min() &&
+            int64_t(y64) == -1) {
+          trap("i64.div_s overflow"); // signed division overflow
+        }
+        return i64(int64_t(x64) / int64_t(y64));
+      case DivUInt64:
+        if (y64 == 0) {
+          trap("i64.div_u by 0");
+        }
+        return i64(x64 / y64);
+      case RemSInt64:
+        if (y64 == 0) {
+          trap("i64.rem_s by 0");
+        }
+        if (int64_t(y64) == -1) {
+          return i64(0);
+        }
+        return i64(int64_t(x64) % int64_t(y64));
+      case RemUInt64:
+        if (y64 == 0) {
+          trap("i64.rem_u by 0");
+        }
+        return i64(x64 % y64);
+      case AndInt64:
+        return i64(x64 & y64);
+      case OrInt64:
+        return i64(x64 | y64);
+      case XorInt64:
+        return i64(x64 ^ y64);
+      case ShlInt64:
+        return i64(x64 << (y64 & 63));
+      case ShrSInt64:
+        return i64(int64_t(x64) >> (y64 & 63));
+      case ShrUInt64:
+        return i64(x64 >> (y64 & 63));
+      case RotLInt64:
+        return i64(Bits::rotateLeft(x64, y64));
+      case RotRInt64:
+        return i64(Bits::rotateRight(x64, y64));
+      case EqInt64:
+        return i32(x64 == y64);
+      case NeInt64:
+        return i32(x64 != y64);
+      case LtSInt64:
+        return i32(int64_t(x64) < int64_t(y64));
+      case LtUInt64:
+        return i32(x64 < y64);
+      case LeSInt64:
+        return i32(int64_t(x64) <= int64_t(y64));
+      case LeUInt64:
+        return i32(x64 <= y64);
+      case GtSInt64:
+        return i32(int64_t(x64) > int64_t(y64));
+      case GtUInt64:
+        return i32(x64 > y64);
+      case GeSInt64:
+        return i32(int64_t(x64) >= int64_t(y64));
+      case GeUInt64:
+        return i32(x64 >= y64);
+      default: {
+        // Float operations, whose NaN handling is in Literal.
+        auto result = doBinary(curr, left.toLiteral(), right.toLiteral());
+        out = NumericValue(result.getSingleValue());
+        return true;
+      }
+    }
+  }
+
   Flow visitUnary(Unary* curr) {
+    if (useNumericPath(curr) && NumericValue::isNumeric(curr->value->type)) {
+      return visitNumericRoot(curr);
+    }
     VISIT(flow, curr->value)
-    Literal value = flow.getSingleValue();
+    return doUnary(curr, flow.getSingleValue());
+  }
+  Flow doUnary(Unary* curr, Literal value) {
     switch (curr->op) {
       case ClzInt32:
       case ClzInt64:
@@ -1187,10 +1591,16 @@ public:
     WASM_UNREACHABLE("invalid op");
   }
   Flow visitBinary(Binary* curr) {
+    if (useNumericPath(curr) && NumericValue::isNumeric(curr->left->type)) {
+      return visitNumericRoot(curr);
+    }
     VISIT(flow, curr->left)
     Literal left = flow.getSingleValue();
     VISIT_REUSE(flow, curr->right)
     Literal right = flow.getSingleValue();
+    return doBinary(curr, left, right);
+  }
+  Flow doBinary(Binary* curr, Literal left, Literal right) {
     assert(curr->left->type.isConcrete() ? left.type == curr->left->type
                                          : true);
     assert(curr->right->type.isConcrete() ? right.type == curr->right->type
@@ -2268,6 +2678,7 @@ public:
       trap("null ref");
     }
     auto field = curr->ref->type.getHeapType().getStruct().fields[curr->index];
+    self()->noteGCWrite(data);
     data->values[curr->index] =
       truncateForPacking(value.getSingleValue(), field);
     return Flow();
@@ -2280,6 +2691,7 @@ public:
     if (!data) {
       trap("null ref");
     }
+    self()->noteGCWrite(data);
     auto& field = data->values[curr->index];
     auto oldVal = field;
     auto newVal = value.getSingleValue();
@@ -2314,6 +2726,7 @@ public:
     if (!data) {
       trap("null ref");
     }
+    self()->noteGCWrite(data);
     auto& field = data->values[curr->index];
     auto oldVal = field;
     if (field == expected.getSingleValue()) {
@@ -2463,6 +2876,7 @@ public:
       trap("array oob");
     }
     auto field = curr->ref->type.getHeapType().getArray().element;
+    self()->noteGCWrite(data);
     data->values[i] = truncateForPacking(value.getSingleValue(), field);
     return Flow();
   }
@@ -2533,6 +2947,7 @@ public:
     if (i >= size || curr->bytes > (size - i)) {
       trap("array oob");
     }
+    self()->noteGCWrite(data);
     switch (curr->value->type.getBasic()) {
       case Type::i32:
         writeBytes(
@@ -2600,6 +3015,7 @@ public:
     for (size_t i = 0; i < lengthVal; i++) {
       copied[i] = srcData->values[srcVal + i];
     }
+    self()->noteGCWrite(destData);
     for (size_t i = 0; i < lengthVal; i++) {
       destData->values[destVal + i] = copied[i];
     }
@@ -2626,6 +3042,7 @@ public:
         indexVal + sizeVal > arraySize || indexVal + sizeVal < indexVal) {
       trap("out of bounds array access in array.fill");
     }
+    self()->noteGCWrite(data);
     for (size_t i = 0; i < sizeVal; ++i) {
       data->values[indexVal + i] = fillVal;
     }
@@ -2645,6 +3062,7 @@ public:
     if (indexVal >= data->values.size()) {
       trap("array oob");
     }
+    self()->noteGCWrite(data);
     auto& field = data->values[indexVal];
     auto oldVal = field;
     auto newVal = value.getSingleValue();
@@ -2684,6 +3102,7 @@ public:
     if (indexVal >= data->values.size()) {
       trap("array oob");
     }
+    self()->noteGCWrite(data);
     auto& field = data->values[indexVal];
     auto oldVal = field;
     if (field == expected.getSingleValue()) {
@@ -2818,6 +3237,7 @@ public:
       trap("oob");
     }
 
+    self()->noteGCWrite(arrayData);
     for (Index i = 0; i < strValues.size(); i++) {
       arrayValues[startVal + i] = strValues[i];
     }
@@ -4287,6 +4707,10 @@ public:
     auto index = curr->index;
     return scope->locals[index];
   }
+  bool visitLocalGetNumeric(LocalGet* curr, NumericValue& out, Flow& flow) {
+    out = NumericValue(scope->locals[curr->index][0]);
+    return true;
+  }
   Flow visitLocalSet(LocalSet* curr) {
     auto index = curr->index;
     VISIT(flow, curr->value)
@@ -4308,16 +4732,34 @@ public:
   }
 
   Flow visitLoad(Load* curr) {
+    if (this->useNumericPath(curr)) {
+      NumericValue value;
+      Flow flow;
+      if (!visitLoadNumeric(curr, value, flow)) {
+        return flow;
+      }
+      return Flow(value.toLiteral());
+    }
     VISIT(flow, curr->ptr)
+    return doLoad(curr, flow.getSingleValue());
+  }
+  bool visitLoadNumeric(Load* curr, NumericValue& out, Flow& flow) {
+    NumericValue ptr;
+    if (!this->visitNumeric(curr->ptr, ptr, flow)) {
+      return false;
+    }
+    out = NumericValue(doLoad(curr, ptr.toLiteral()));
+    return true;
+  }
+  // The part of a load that is shared by the generic and numeric paths.
+  Literal doLoad(Load* curr, const Literal& ptr) {
     auto info = getMemoryInstanceInfo(curr->memory);
     auto memorySizeBytes = info.instance->getMemorySizeBytes(info.name);
-    auto addr = info.instance->getFinalAddress(
-      curr, flow.getSingleValue(), memorySizeBytes);
+    auto addr = info.instance->getFinalAddress(curr, ptr, memorySizeBytes);
     if (curr->isAtomic()) {
       info.instance->checkAtomicAddress(addr, curr->bytes, memorySizeBytes);
     }
-    auto ret = info.interface()->load(curr, addr, info.name);
-    return ret;
+    return info.interface()->load(curr, addr, info.name);
   }
   Flow visitStore(Store* curr) {
     VISIT(ptr, curr->ptr)
@@ -4857,6 +5299,7 @@ public:
         droppedDataSegments.contains(curr->segment)) {
       trap("out of bounds segment access in array.init_data");
     }
+    self()->noteGCWrite(data);
     for (size_t i = 0; i < sizeVal; i++) {
       void* addr = (void*)&seg->data[offsetVal + i * elemSize];
       data->values[indexVal + i] = this->makeFromMemory(addr, elem);
@@ -4891,6 +5334,7 @@ public:
     if (max > 0 && droppedElementSegments.contains(curr->segment)) {
       trap("out of bounds segment access in array.init_elem");
     }
+    self()->noteGCWrite(data);
     for (size_t i = 0; i < sizeVal; i++) {
       // TODO: This is not correct because it does not preserve the identity
       // of references in the table! ArrayNew suffers the same problem.
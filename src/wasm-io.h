@@ -79,7 +79,7 @@ private:
 
   void readStdin(Module& wasm, std::string sourceMapFilename);
 
-  void readBinaryData(std::vector<char>& input,
+  void readBinaryData(std::string_view input,
                       Module& wasm,
                       std::string sourceMapFilename);
 };
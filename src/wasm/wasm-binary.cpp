@@ -525,87 +525,69 @@ void WasmBinaryWriter::writeFunctions() {
   auto sectionStart = startSection(BinaryConsts::Section::Code);
   o << U32LEB(importInfo->getNumDefinedFunctions());
   bool DWARF = Debug::hasDWARFSections(*getModule());
-  ModuleUtils::iterDefinedFunctions(*wasm, [&](Function* func) {
-    assert(binaryLocationTrackedExpressionsForFunc.empty());
-    // Do not smear any debug location from the previous function.
-    writeNoDebugLocation();
-    size_t sourceMapLocationsSizeAtFunctionStart = sourceMapLocations.size();
-    size_t sizePos = writeU32LEBPlaceholder();
-    size_t start = o.size();
-    // Emit Stack IR if present.
-    StackIR* stackIR = nullptr;
-    if (moduleStackIR) {
-      stackIR = moduleStackIR->getStackIROrNull(func);
-    }
-    if (stackIR) {
-      StackIRToBinaryWriter writer(*this, o, func, *stackIR, sourceMap, DWARF);
-      writer.write();
-      if (debugInfo) {
-        funcMappedLocals[func->name] = std::move(writer.getMappedLocals());
-      }
-    } else {
-      BinaryenIRToBinaryWriter writer(*this, o, func, sourceMap, DWARF);
-      writer.write();
-      if (debugInfo) {
-        funcMappedLocals[func->name] = std::move(writer.getMappedLocals());
-      }
-    }
-    size_t size = o.size() - start;
-    assert(size <= std::numeric_limits<uint32_t>::max());
-    auto sizeFieldSize = o.writeAt(sizePos, U32LEB(size));
-    // We can move things back if the actual LEB for the size doesn't use the
-    // maximum 5 bytes. In that case we need to adjust offsets after we move
-    // things backwards.
-    auto adjustmentForLEBShrinking = MaxLEB32Bytes - sizeFieldSize;
-    if (adjustmentForLEBShrinking) {
-      // we can save some room, nice
-      assert(sizeFieldSize < MaxLEB32Bytes);
-      std::move(&o[start], &o[start] + size, &o[sizePos] + sizeFieldSize);
-      o.resize(o.size() - adjustmentForLEBShrinking);
-      if (sourceMap) {
-        for (auto i = sourceMapLocationsSizeAtFunctionStart;
-             i < sourceMapLocations.size();
-             ++i) {
-          sourceMapLocations[i].first -= adjustmentForLEBShrinking;
+  auto* stackIR = moduleStackIR ? &*moduleStackIR : nullptr;
+  if (importInfo->getNumDefinedFunctions() > 1 &&
+      ThreadPool::get()->size() > 1) {
+    writeFunctionsInParallel(stackIR, DWARF);
+  } else {
+    ModuleUtils::iterDefinedFunctions(*wasm, [&](Function* func) {
+      assert(binaryLocationTrackedExpressionsForFunc.empty());
+      // Do not smear any debug location from the previous function.
+      writeNoDebugLocation();
+      size_t sourceMapLocationsSizeAtFunctionStart = sourceMapLocations.size();
+      size_t sizePos = writeU32LEBPlaceholder();
+      size_t start = o.size();
+      writeFunctionBody(func, stackIR, DWARF);
+      size_t size = o.size() - start;
+      assert(size <= std::numeric_limits<uint32_t>::max());
+      auto sizeFieldSize = o.writeAt(sizePos, U32LEB(size));
+      // We can move things back if the actual LEB for the size doesn't use the
+      // maximum 5 bytes. In that case we need to adjust offsets after we move
+      // things backwards.
+      auto adjustmentForLEBShrinking = MaxLEB32Bytes - sizeFieldSize;
+      if (adjustmentForLEBShrinking) {
+        // we can save some room, nice
+        assert(sizeFieldSize < MaxLEB32Bytes);
+        std::move(&o[start], &o[start] + size, &o[sizePos] + sizeFieldSize);
+        o.resize(o.size() - adjustmentForLEBShrinking);
+        if (sourceMap) {
+          for (auto i = sourceMapLocationsSizeAtFunctionStart;
+               i < sourceMapLocations.size();
+               ++i) {
+            sourceMapLocations[i].first -= adjustmentForLEBShrinking;
+          }
         }
-      }
-      for (auto* curr : binaryLocationTrackedExpressionsForFunc) {
-        // We added the binary locations, adjust them: they must be relative
-        // to the code section.
-        auto& span = binaryLocations.expressions[curr];
-        span.start -= adjustmentForLEBShrinking;
-        span.end -= adjustmentForLEBShrinking;
-        auto iter = binaryLocations.delimiters.find(curr);
-        if (iter != binaryLocations.delimiters.end()) {
-          for (auto& item : iter->second) {
-            item -= adjustmentForLEBShrinking;
+        for (auto* curr : binaryLocationTrackedExpressionsForFunc) {
+          // We added the binary locations, adjust them: they must be relative
+          // to the code section.
+          auto& span = binaryLocations.expressions[curr];
+          span.start -= adjustmentForLEBShrinking;
+          span.end -= adjustmentForLEBShrinking;
+          auto iter = binaryLocations.delimiters.find(curr);
+          if (iter != binaryLocations.delimiters.end()) {
+            for (auto& item : iter->second) {
+              item -= adjustmentForLEBShrinking;
+            }
           }
         }
       }
-    }
-    // We need to track the function location if we are tracking the locations
-    // of expressions inside it, or, if it has code annotations (the function
-    // itself may be annotated, even if nothing inside it is).
-    if (!binaryLocationTrackedExpressionsForFunc.empty() ||
-        !func->codeAnnotations.empty()) {
-      binaryLocations.functions[func] = BinaryLocations::FunctionLocations{
-        BinaryLocation(sizePos),
-        BinaryLocation(start - adjustmentForLEBShrinking),
-        BinaryLocation(o.size())};
-    }
-    tableOfContents.functionBodies.emplace_back(
-      func->name, sizePos + sizeFieldSize, size);
-    binaryLocationTrackedExpressionsForFunc.clear();
+      // We need to track the function location if we are tracking the
+      // locations of expressions inside it, or, if it has code annotations
+      // (the function itself may be annotated, even if nothing inside it is).
+      if (!binaryLocationTrackedExpressionsForFunc.empty() ||
+          !func->codeAnnotations.empty()) {
+        binaryLocations.functions[func] = BinaryLocations::FunctionLocations{
+          BinaryLocation(sizePos),
+          BinaryLocation(start - adjustmentForLEBShrinking),
+          BinaryLocation(o.size())};
+      }
+      tableOfContents.functionBodies.emplace_back(
+        func->name, sizePos + sizeFieldSize, size);
+      binaryLocationTrackedExpressionsForFunc.clear();
 
-    if (func->getParams().size() > WebLimitations::MaxFunctionParams) {
-      std::cerr << "Some VMs may not accept this binary because it has a large "
-                << "number of parameters in function " << func->name << ".\n";
-    }
-    if (func->getNumLocals() > WebLimitations::MaxFunctionLocals) {
-      std::cerr << "Some VMs may not accept this binary because it has a large "
-                << "number of locals in function " << func->name << ".\n";
-    }
-  });
+      warnAboutFunctionLimits(func);
+    });
+  }
   finishSection(sectionStart);
 
   // Code annotations must come before the code section (see comment on
@@ -633,6 +615,130 @@ void WasmBinaryWriter::writeFunctions() {
   }
 }
 
+void WasmBinaryWriter::writeFunctionBody(Function* func,
+                                         ModuleStackIR* moduleStackIR,
+                                         bool DWARF) {
+  // Emit Stack IR if present.
+  StackIR* stackIR = nullptr;
+  if (moduleStackIR) {
+    stackIR = moduleStackIR->getStackIROrNull(func);
+  }
+  if (stackIR) {
+    StackIRToBinaryWriter writer(*this, o, func, *stackIR, sourceMap, DWARF);
+    writer.write();
+    if (debugInfo) {
+      funcMappedLocals[func->name] = std::move(writer.getMappedLocals());
+    }
+  } else {
+    BinaryenIRToBinaryWriter writer(*this, o, func, sourceMap, DWARF);
+    writer.write();
+    if (debugInfo) {
+      funcMappedLocals[func->name] = std::move(writer.getMappedLocals());
+    }
+  }
+}
+
+WasmBinaryWriter::WasmBinaryWriter(const WasmBinaryWriter& parent,
+                                   BufferWithRandomAccess& o,
+                                   FunctionBodyWriter)
+  : wasm(parent.wasm), o(o), options(parent.options), tableOwner(&parent),
+    debugInfo(parent.debugInfo), sourceMap(parent.sourceMap) {
+  initializeDebugInfo();
+}
+
+void WasmBinaryWriter::writeFunctionsInParallel(ModuleStackIR* moduleStackIR,
+                                                bool DWARF) {
+  std::vector<Function*> funcs;
+  ModuleUtils::iterDefinedFunctions(
+    *wasm, [&](Function* func) { funcs.push_back(func); });
+
+  // Write each body into its own buffer, with its own writer that notes source
+  // map and binary locations relative to that buffer.
+  struct Output {
+    BufferWithRandomAccess buffer;
+    std::unique_ptr<WasmBinaryWriter> writer;
+  };
+  std::vector<Output> outputs(funcs.size());
+  std::atomic<size_t> nextFunction = 0;
+  std::vector<std::function<ThreadWorkState()>> doWorkers;
+  for (size_t i = 0; i < ThreadPool::get()->size(); i++) {
+    doWorkers.push_back([&]() {
+      auto index = nextFunction.fetch_add(1);
+      if (index >= funcs.size()) {
+        return ThreadWorkState::Finished;
+      }
+      auto& output = outputs[index];
+      output.writer.reset(
+        new WasmBinaryWriter(*this, output.buffer, FunctionBodyWriter{}));
+      output.writer->writeFunctionBody(funcs[index], moduleStackIR, DWARF);
+      return ThreadWorkState::More;
+    });
+  }
+  ThreadPool::get()->work(doWorkers);
+
+  // Append the bodies in order. Each size is known, so we can write its final
+  // LEB right away, and rebase the locations by the start of the body.
+  for (size_t i = 0; i < funcs.size(); i++) {
+    auto* func = funcs[i];
+    auto& body = outputs[i].buffer;
+    auto& writer = *outputs[i].writer;
+    // Do not smear any debug location from the previous function.
+    writeNoDebugLocation();
+    size_t sizePos = o.size();
+    assert(body.size() <= std::numeric_limits<uint32_t>::max());
+    o << U32LEB(body.size());
+    size_t start = o.size();
+    o.insert(o.end(), body.begin(), body.end());
+    for (auto& [offset, loc] : writer.sourceMapLocations) {
+      sourceMapLocations.emplace_back(start + offset, loc);
+    }
+    lastDebugLocation = writer.lastDebugLocation;
+    for (auto* curr : writer.binaryLocationTrackedExpressionsForFunc) {
+      auto& span = binaryLocations.expressions[curr];
+      span = writer.binaryLocations.expressions[curr];
+      span.start += start;
+      span.end += start;
+      auto iter = writer.binaryLocations.delimiters.find(curr);
+      if (iter != writer.binaryLocations.delimiters.end()) {
+        auto& delimiters = binaryLocations.delimiters[curr];
+        delimiters = iter->second;
+        for (auto& item : delimiters) {
+          item += start;
+        }
+      }
+    }
+    // See the serial case in writeFunctions.
+    if (!writer.binaryLocationTrackedExpressionsForFunc.empty() ||
+        !func->codeAnnotations.empty()) {
+      binaryLocations.functions[func] = BinaryLocations::FunctionLocations{
+        BinaryLocation(sizePos),
+        BinaryLocation(start),
+        BinaryLocation(o.size())};
+    }
+    tableOfContents.functionBodies.emplace_back(func->name, start, body.size());
+    if (debugInfo) {
+      funcMappedLocals[func->name] =
+        std::move(writer.funcMappedLocals[func->name]);
+    }
+
+    warnAboutFunctionLimits(func);
+
+    // Free the memory of this body as we go.
+    outputs[i] = Output();
+  }
+}
+
+void WasmBinaryWriter::warnAboutFunctionLimits(Function* func) {
+  if (func->getParams().size() > WebLimitations::MaxFunctionParams) {
+    std::cerr << "Some VMs may not accept this binary because it has a large "
+              << "number of parameters in function " << func->name << ".\n";
+  }
+  if (func->getNumLocals() > WebLimitations::MaxFunctionLocals) {
+    std::cerr << "Some VMs may not accept this binary because it has a large "
+              << "number of locals in function " << func->name << ".\n";
+  }
+}
+
 void WasmBinaryWriter::writeStrings() {
   assert(wasm->features.hasStrings());
 
@@ -822,51 +928,51 @@ void WasmBinaryWriter::writeDataSegments() {
 }
 
 uint32_t WasmBinaryWriter::getFunctionIndex(Name name) const {
-  auto it = indexes.functionIndexes.find(name);
-  assert(it != indexes.functionIndexes.end());
+  auto it = tableOwner->indexes.functionIndexes.find(name);
+  assert(it != tableOwner->indexes.functionIndexes.end());
   return it->second;
 }
 
 uint32_t WasmBinaryWriter::getTableIndex(Name name) const {
-  auto it = indexes.tableIndexes.find(name);
-  assert(it != indexes.tableIndexes.end());
+  auto it = tableOwner->indexes.tableIndexes.find(name);
+  assert(it != tableOwner->indexes.tableIndexes.end());
   return it->second;
 }
 
 uint32_t WasmBinaryWriter::getMemoryIndex(Name name) const {
-  auto it = indexes.memoryIndexes.find(name);
-  assert(it != indexes.memoryIndexes.end());
+  auto it = tableOwner->indexes.memoryIndexes.find(name);
+  assert(it != tableOwner->indexes.memoryIndexes.end());
   return it->second;
 }
 
 uint32_t WasmBinaryWriter::getGlobalIndex(Name name) const {
-  auto it = indexes.globalIndexes.find(name);
-  assert(it != indexes.globalIndexes.end());
+  auto it = tableOwner->indexes.globalIndexes.find(name);
+  assert(it != tableOwner->indexes.globalIndexes.end());
   return it->second;
 }
 
 uint32_t WasmBinaryWriter::getTagIndex(Name name) const {
-  auto it = indexes.tagIndexes.find(name);
-  assert(it != indexes.tagIndexes.end());
+  auto it = tableOwner->indexes.tagIndexes.find(name);
+  assert(it != tableOwner->indexes.tagIndexes.end());
   return it->second;
 }
 
 uint32_t WasmBinaryWriter::getDataSegmentIndex(Name name) const {
-  auto it = indexes.dataIndexes.find(name);
-  assert(it != indexes.dataIndexes.end());
+  auto it = tableOwner->indexes.dataIndexes.find(name);
+  assert(it != tableOwner->indexes.dataIndexes.end());
   return it->second;
 }
 
 uint32_t WasmBinaryWriter::getElementSegmentIndex(Name name) const {
-  auto it = indexes.elemIndexes.find(name);
-  assert(it != indexes.elemIndexes.end());
+  auto it = tableOwner->indexes.elemIndexes.find(name);
+  assert(it != tableOwner->indexes.elemIndexes.end());
   return it->second;
 }
 
 uint32_t WasmBinaryWriter::getTypeIndex(HeapType type) const {
-  auto it = indexedTypes.indices.find(type);
+  auto it = tableOwner->indexedTypes.indices.find(type);
 #ifndef NDEBUG
-  if (it == indexedTypes.indices.end()) {
+  if (it == tableOwner->indexedTypes.indices.end()) {
     std::cout << "Missing type: " << type << '\n';
     assert(0);
   }
@@ -875,9 +981,9 @@ uint32_t WasmBinaryWriter::getTypeIndex(HeapType type) const {
 }
 
 uint32_t WasmBinaryWriter::getSignatureIndex(Signature sig) const {
-  auto it = signatureIndexes.find(sig);
+  auto it = tableOwner->signatureIndexes.find(sig);
 #ifndef NDEBUG
-  if (it == signatureIndexes.end()) {
+  if (it == tableOwner->signatureIndexes.end()) {
     std::cout << "Missing signature: " << sig << '\n';
     assert(0);
   }
@@ -886,8 +992,8 @@ uint32_t WasmBinaryWriter::getSignatureIndex(Signature sig) const {
 }
 
 uint32_t WasmBinaryWriter::getStringIndex(Name string) const {
-  auto it = stringIndexes.find(string);
-  assert(it != stringIndexes.end());
+  auto it = tableOwner->stringIndexes.find(string);
+  assert(it != tableOwner->stringIndexes.end());
   return it->second;
 }
 
@@ -2179,7 +2285,7 @@ void WasmBinaryWriter::writeMemoryOrder(MemoryOrder order, bool isRMW) {
 
 WasmBinaryReader::WasmBinaryReader(Module& wasm,
                                    FeatureSet features,
-                                   const std::vector<char>& input,
+                                   std::string_view input,
                                    std::vector<char>& sourceMap)
   : wasm(wasm), allocator(wasm.allocator), input(input), builder(wasm),
     sourceMapReader(sourceMap) {
@@ -3430,28 +3536,15 @@ void WasmBinaryReader::readFunctions() {
   if (needCodeLocations) {
     builder.setBinaryLocation(&pos, codeSectionLocation);
   }
+  if (!skipFunctionBodies && numFuncBodies > 1 &&
+      ThreadPool::get()->size() > 1) {
+    readFunctionsInParallel();
+    return;
+  }
   for (size_t i = 0; i < numFuncBodies; i++) {
-    auto sizePos = pos;
-    size_t size = getU32LEB();
-    if (size == 0) {
-      throwError("empty function size");
-    }
-    Index endOfFunction = pos + size;
-
     auto& func = wasm.functions[numFuncImports + i];
     currFunction = func.get();
-
-    if (needCodeLocations) {
-      func->funcLocation = BinaryLocations::FunctionLocations{
-        BinaryLocation(sizePos - codeSectionLocation),
-        BinaryLocation(pos - codeSectionLocation),
-        BinaryLocation(pos - codeSectionLocation + size)};
-    }
-
-    func->prologLocation = sourceMapReader.readDebugLocationAt(pos);
-
-    readVars();
-    setLocalNames(*func, numFuncImports + i);
+    Index endOfFunction = readFunctionHeader(i);
     {
       // Process the function body. Even if we are skipping function bodies we
       // need to not skip the start function. That contains important code for
@@ -3469,22 +3562,7 @@ void WasmBinaryReader::readFunctions() {
         // Skip reading the contents.
         pos = endOfFunction;
       } else {
-        auto start = builder.visitFunctionStart(func.get());
-        if (auto* err = start.getErr()) {
-          throwError(err->msg);
-        }
-        while (pos < endOfFunction) {
-          auto inst = readInst();
-          if (auto* err = inst.getErr()) {
-            throwError(err->msg);
-          }
-        }
-        if (pos != endOfFunction) {
-          throwError("function overflowed its bounds");
-        }
-        if (!builder.empty()) {
-          throwError("expected function end");
-        }
+        readFunctionBody(endOfFunction);
       }
     }
 
@@ -3494,6 +3572,144 @@ void WasmBinaryReader::readFunctions() {
   }
 }
 
+size_t WasmBinaryReader::readFunctionHeader(Index i) {
+  auto sizePos = pos;
+  size_t size = getU32LEB();
+  if (size == 0) {
+    throwError("empty function size");
+  }
+  size_t endOfFunction = pos + size;
+
+  if (needCodeLocations) {
+    currFunction->funcLocation = BinaryLocations::FunctionLocations{
+      BinaryLocation(sizePos - codeSectionLocation),
+      BinaryLocation(pos - codeSectionLocation),
+      BinaryLocation(pos - codeSectionLocation + size)};
+  }
+
+  currFunction->prologLocation = sourceMapReader.readDebugLocationAt(pos);
+
+  readVars();
+  setLocalNames(*currFunction, numFuncImports + i);
+  return endOfFunction;
+}
+
+void WasmBinaryReader::readFunctionBody(size_t endOfFunction) {
+  auto start = builder.visitFunctionStart(currFunction);
+  if (auto* err = start.getErr()) {
+    throwError(err->msg);
+  }
+  while (pos < endOfFunction) {
+    auto inst = readInst();
+    if (auto* err = inst.getErr()) {
+      throwError(err->msg);
+    }
+  }
+  if (pos != endOfFunction) {
+    throwError("function overflowed its bounds");
+  }
+  if (!builder.empty()) {
+    throwError("expected function end");
+  }
+}
+
+WasmBinaryReader::WasmBinaryReader(const WasmBinaryReader& parent,
+                                   FunctionBodyReader)
+  : wasm(parent.wasm), allocator(parent.allocator), input(parent.input),
+    debugInfo(parent.debugInfo), DWARF(parent.DWARF),
+    codeSectionLocation(parent.codeSectionLocation), builder(parent.wasm),
+    sourceMapReader(parent.sourceMapReader), types(parent.types),
+    functionTypes(parent.functionTypes),
+    numFuncImports(parent.numFuncImports),
+    numFuncBodies(parent.numFuncBodies), strings(parent.strings),
+    dataCount(parent.dataCount), hasDataCount(parent.hasDataCount),
+    needCodeLocations(parent.needCodeLocations),
+    featuresSectionFeatures(parent.featuresSectionFeatures) {
+  if (needCodeLocations) {
+    builder.setBinaryLocation(&pos, codeSectionLocation);
+  }
+}
+
+void WasmBinaryReader::readFunctionsInParallel() {
+  // First, scan the function headers serially, noting where each body starts
+  // and ends and the state of the source map reader at its start. Function
+  // bodies are length-prefixed, so this is fast.
+  struct BodyInfo {
+    size_t start;
+    size_t end;
+    SourceMapReader::State sourceMapState;
+  };
+  std::vector<BodyInfo> bodies;
+  bodies.reserve(numFuncBodies);
+
+  // If the scan fails, we must still report an error in an earlier body first,
+  // as the serial reader would. A failure while skipping over the source map
+  // entries of a body comes after any error in that body, which we have noted
+  // by then.
+  std::exception_ptr scanError;
+  try {
+    for (size_t i = 0; i < numFuncBodies; i++) {
+      currFunction = wasm.functions[numFuncImports + i].get();
+      auto endOfFunction = readFunctionHeader(i);
+      bodies.push_back({pos, endOfFunction, sourceMapReader.getState()});
+      // Skip the source map entries that reading the body serially would
+      // consume. A valid body ends with an `end` instruction in its last byte,
+      // which is the last place a debug location is read.
+      pos = endOfFunction;
+      sourceMapReader.readDebugLocationAt(endOfFunction - 1);
+      sourceMapReader.finishFunction();
+    }
+  } catch (...) {
+    scanError = std::current_exception();
+  }
+  currFunction = nullptr;
+
+  // Read the bodies in parallel. The module's arena supports allocation from
+  // multiple threads, and each thread gets a reader with its own IRBuilder.
+  size_t numBodies = bodies.size();
+  std::vector<std::exception_ptr> errors(numBodies);
+  std::atomic<size_t> nextBody = 0;
+  size_t num = ThreadPool::get()->size();
+  std::vector<std::unique_ptr<WasmBinaryReader>> readers(num);
+  std::vector<std::function<ThreadWorkState()>> doWorkers;
+  for (size_t i = 0; i < num; i++) {
+    doWorkers.push_back([&, i]() {
+      auto index = nextBody.fetch_add(1);
+      if (index >= numBodies) {
+        return ThreadWorkState::Finished;
+      }
+      if (!readers[i]) {
+        readers[i].reset(new WasmBinaryReader(*this, FunctionBodyReader{}));
+      }
+      auto& reader = *readers[i];
+      auto& body = bodies[index];
+      auto* func = wasm.functions[numFuncImports + index].get();
+      reader.pos = body.start;
+      reader.sourceMapReader.setState(body.sourceMapState);
+      reader.currFunction = func;
+      try {
+        reader.readFunctionBody(body.end);
+        TypeUpdating::handleNonDefaultableLocals(func, wasm);
+      } catch (...) {
+        errors[index] = std::current_exception();
+      }
+      reader.currFunction = nullptr;
+      return ThreadWorkState::More;
+    });
+  }
+  ThreadPool::get()->work(doWorkers);
+
+  // Report the first error in binary order.
+  for (auto& error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+  if (scanError) {
+    std::rethrow_exception(scanError);
+  }
+}
+
 void WasmBinaryReader::readVars() {
   uint32_t totalVars = 0;
   size_t numLocalTypes = getU32LEB();
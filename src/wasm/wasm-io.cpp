@@ -50,7 +50,7 @@ void ModuleReader::readText(std::string filename, Module& wasm) {
   readTextData(filename, input, wasm, profile);
 }
 
-void ModuleReader::readBinaryData(std::vector<char>& input,
+void ModuleReader::readBinaryData(std::string_view input,
                                   Module& wasm,
                                   std::string sourceMapFilename) {
   std::vector<char> sourceMapBuffer;
@@ -74,8 +74,10 @@ void ModuleReader::readBinary(std::string filename,
                               Module& wasm,
                               std::string sourceMapFilename) {
   BYN_TRACE("reading binary from " << filename << "\n");
-  auto input(read_file<std::vector<char>>(filename, Flags::Binary));
-  readBinaryData(input, wasm, sourceMapFilename);
+  // Map the file rather than reading it, so that the reader parses the bytes
+  // in place.
+  MappedFile input(filename);
+  readBinaryData(input.view(), wasm, sourceMapFilename);
 }
 
 bool ModuleReader::isBinaryFile(std::string filename) {
@@ -115,7 +117,8 @@ void ModuleReader::readStdin(Module& wasm, std::string sourceMapFilename) {
   std::vector<char> input = read_stdin();
   if (input.size() >= 4 && input[0] == '\0' && input[1] == 'a' &&
       input[2] == 's' && input[3] == 'm') {
-    readBinaryData(input, wasm, sourceMapFilename);
+    readBinaryData(
+      std::string_view(input.data(), input.size()), wasm, sourceMapFilename);
   } else {
     std::ostringstream s;
     s.write(input.data(), input.size());
@@ -15,6 +15,7 @@
  */
 
 #include <algorithm>
+#include <array>
 #include <cassert>
 #include <sstream>
 #include <unordered_map>
@@ -129,8 +130,15 @@ struct RecGroupEquator {
 // wrapped group itself.
 struct RecGroupStructure {
   RecGroup group;
+  // The structural hash, computed once since it is needed both to pick a
+  // stripe of the rec group store and to look the group up within it.
+  size_t digest;
+
+  RecGroupStructure(RecGroup group)
+    : group(group), digest(RecGroupHasher{group}()) {}
+
   bool operator==(const RecGroupStructure& other) const {
-    return RecGroupEquator{group, other.group}();
+    return digest == other.digest && RecGroupEquator{group, other.group}();
   }
 };
 
@@ -142,7 +150,7 @@ namespace std {
 template<> class hash<wasm::RecGroupStructure> {
 public:
   size_t operator()(const wasm::RecGroupStructure& structure) const {
-    return wasm::RecGroupHasher{structure.group}();
+    return structure.digest;
   }
 };
 
@@ -399,22 +407,33 @@ HeapTypeInfo::~HeapTypeInfo() {
 
 namespace {
 
+// Tuples and rec groups are canonicalized in stores that are split into
+// stripes by hash, each with its own lock, so that threads creating different
+// types rarely contend. Equal tuples and isorecursively equivalent rec groups
+// hash the same, so they always meet in the same stripe.
+static constexpr size_t NumTypeStoreStripes = 64;
+
 struct TupleStore {
-  std::recursive_mutex mutex;
+  struct Stripe {
+    std::recursive_mutex mutex;
 
-  // Track unique_ptrs for constructed tuples to avoid leaks.
-  std::vector<std::unique_ptr<Tuple>> constructedTuples;
+    // Track unique_ptrs for constructed tuples to avoid leaks.
+    std::vector<std::unique_ptr<Tuple>> constructedTuples;
 
-  // Maps from constructed tuples to their canonical Type IDs.
-  std::unordered_map<std::reference_wrapper<const Tuple>, uintptr_t> typeIDs;
+    // Maps from constructed tuples to their canonical Type IDs.
+    std::unordered_map<std::reference_wrapper<const Tuple>, uintptr_t> typeIDs;
+  };
+  std::array<Stripe, NumTypeStoreStripes> stripes;
 
   Type insert(const Tuple& info) { return doInsert(info); }
   Type insert(std::unique_ptr<Tuple>&& info) { return doInsert(info); }
   bool hasCanonical(const Tuple& info, Tuple& canonical);
 
   void clear() {
-    typeIDs.clear();
-    constructedTuples.clear();
+    for (auto& stripe : stripes) {
+      stripe.typeIDs.clear();
+      stripe.constructedTuples.clear();
+    }
   }
 
 private:
@@ -435,15 +454,6 @@ private:
       }
     };
 
-    auto insertNew = [&]() {
-      auto ptr = getPtr();
-      TypeID id = uintptr_t(ptr.get()) | 1;
-      assert(id > Type::_last_basic_type);
-      typeIDs.insert({*ptr, id});
-      constructedTuples.emplace_back(std::move(ptr));
-      return Type(id);
-    };
-
     // Turn e.g. singleton tuple into non-tuple.
     if (tuple.size() == 0) {
       return Type::none;
@@ -452,10 +462,22 @@ private:
       return tuple[0];
     }
 
-    std::lock_guard<std::recursive_mutex> lock(mutex);
+    auto digest = std::hash<std::reference_wrapper<const Tuple>>{}(tuple);
+    auto& stripe = stripes[digest % NumTypeStoreStripes];
+
+    auto insertNew = [&]() {
+      auto ptr = getPtr();
+      TypeID id = uintptr_t(ptr.get()) | 1;
+      assert(id > Type::_last_basic_type);
+      stripe.typeIDs.insert({*ptr, id});
+      stripe.constructedTuples.emplace_back(std::move(ptr));
+      return Type(id);
+    };
+
+    std::lock_guard<std::recursive_mutex> lock(stripe.mutex);
     // Check whether we already have a type for this tuple.
-    auto indexIt = typeIDs.find(std::cref(tuple));
-    if (indexIt != typeIDs.end()) {
+    auto indexIt = stripe.typeIDs.find(std::cref(tuple));
+    if (indexIt != stripe.typeIDs.end()) {
       return Type(indexIt->second);
     }
     // We do not have a type for this tuple already. Create one.
@@ -465,54 +487,64 @@ private:
 
 static TupleStore globalTupleStore;
 
-static std::vector<std::unique_ptr<HeapTypeInfo>> globalHeapTypeStore;
-static std::recursive_mutex globalHeapTypeStoreMutex;
-
 // Keep track of the constructed recursion groups.
 struct RecGroupStore {
-  std::mutex mutex;
-  // Store the structures of all rec groups created so far so we can avoid
-  // creating duplicates.
-  std::unordered_set<RecGroupStructure> canonicalGroups;
-  // Keep the `RecGroupInfos` for the nontrivial groups stored in
-  // `canonicalGroups` alive.
-  std::vector<std::unique_ptr<RecGroupInfo>> builtGroups;
-
-  RecGroup insert(RecGroup group) {
-    RecGroupStructure structure{group};
-    auto [it, inserted] = canonicalGroups.insert(structure);
-    if (inserted) {
-      return group;
-    } else {
-      return it->group;
+  struct Stripe {
+    std::mutex mutex;
+    // Store the structures of all rec groups created so far so we can avoid
+    // creating duplicates.
+    std::unordered_set<RecGroupStructure> canonicalGroups;
+    // Keep the `RecGroupInfos` for the nontrivial groups stored in
+    // `canonicalGroups` alive.
+    std::vector<std::unique_ptr<RecGroupInfo>> builtGroups;
+    // Keep the `HeapTypeInfos` of the canonical types in those groups alive.
+    std::vector<std::unique_ptr<HeapTypeInfo>> heapTypes;
+
+    // Insert a group, returning the canonical group with the same structure.
+    // The stripe's lock must be held.
+    RecGroup insert(const RecGroupStructure& structure) {
+      auto [it, inserted] = canonicalGroups.insert(structure);
+      if (inserted) {
+        return structure.group;
+      } else {
+        return it->group;
+      }
     }
-  }
 
-  RecGroup insert(std::unique_ptr<RecGroupInfo>&& info) {
-    RecGroup group{uintptr_t(info.get())};
-    auto canonical = insert(group);
-    if (canonical == group) {
-      builtGroups.emplace_back(std::move(info));
+    RecGroup insert(const RecGroupStructure& structure,
+                    std::unique_ptr<RecGroupInfo>&& info) {
+      auto canonical = insert(structure);
+      if (canonical == structure.group) {
+        builtGroups.emplace_back(std::move(info));
+      }
+      return canonical;
     }
-    return canonical;
+  };
+  std::array<Stripe, NumTypeStoreStripes> stripes;
+
+  Stripe& getStripe(const RecGroupStructure& structure) {
+    return stripes[structure.digest % NumTypeStoreStripes];
   }
 
   // Utility for canonicalizing HeapTypes with trivial recursion groups.
   HeapType insert(std::unique_ptr<HeapTypeInfo>&& info) {
-    std::lock_guard<std::mutex> lock(mutex);
     assert(!info->recGroup && "Unexpected nontrivial rec group");
-    auto group = asHeapType(info).getRecGroup();
-    auto canonical = insert(group);
-    if (group == canonical) {
-      std::lock_guard<std::recursive_mutex> storeLock(globalHeapTypeStoreMutex);
-      globalHeapTypeStore.emplace_back(std::move(info));
+    RecGroupStructure structure{asHeapType(info).getRecGroup()};
+    auto& stripe = getStripe(structure);
+    std::lock_guard<std::mutex> lock(stripe.mutex);
+    auto canonical = stripe.insert(structure);
+    if (structure.group == canonical) {
+      stripe.heapTypes.emplace_back(std::move(info));
     }
     return canonical[0];
   }
 
   void clear() {
-    canonicalGroups.clear();
-    builtGroups.clear();
+    for (auto& stripe : stripes) {
+      stripe.canonicalGroups.clear();
+      stripe.builtGroups.clear();
+      stripe.heapTypes.clear();
+    }
   }
 };
 
@@ -530,7 +562,6 @@ void validateTuple(const Tuple& tuple) {
 
 void destroyAllTypesForTestingPurposesOnly() {
   globalTupleStore.clear();
-  globalHeapTypeStore.clear();
   globalRecGroupStore.clear();
 }
 
@@ -2616,12 +2647,14 @@ buildRecGroup(std::unique_ptr<RecGroupInfo>&& groupInfo,
   // The rec group is valid, so we can try to move the group into the global rec
   // group store. If the returned canonical group is not the same as the input
   // group, then there is already a canonical version of this rec group. Lock
-  // the global rec group store here to avoid leaking temporary types to other
-  // threads that may be trying to build an identical group.
+  // the group's stripe of the store here to avoid leaking temporary types to
+  // other threads that may be trying to build an identical group.
   auto group = asHeapType(typeInfos[0]).getRecGroup();
-  std::lock_guard<std::mutex> lock(globalRecGroupStore.mutex);
-  auto canonical = groupInfo ? globalRecGroupStore.insert(std::move(groupInfo))
-                             : globalRecGroupStore.insert(group);
+  RecGroupStructure structure{group};
+  auto& stripe = globalRecGroupStore.getStripe(structure);
+  std::lock_guard<std::mutex> lock(stripe.mutex);
+  auto canonical = groupInfo ? stripe.insert(structure, std::move(groupInfo))
+                             : stripe.insert(structure);
   if (group != canonical) {
     // Replace the non-canonical types with their canonical equivalents.
     assert(canonical.size() == group.size());
@@ -2633,14 +2666,11 @@ buildRecGroup(std::unique_ptr<RecGroupInfo>&& groupInfo,
   }
 
   // The group was successfully moved to the global rec group store, so it is
-  // now canonical. We need to move its heap types to the heap type store so
-  // they become canonical as well.
-  {
-    std::lock_guard<std::recursive_mutex> lock(globalHeapTypeStoreMutex);
-    for (auto& info : typeInfos) {
-      info->isTemp = false;
-      globalHeapTypeStore.emplace_back(std::move(info));
-    }
+  // now canonical. We need to move its heap types to the store as well so they
+  // become canonical too.
+  for (auto& info : typeInfos) {
+    info->isTemp = false;
+    stripe.heapTypes.emplace_back(std::move(info));
   }
 
   std::vector<HeapType> results(group.begin(), group.end());
@@ -186,3 +186,39 @@ TEST(DeltaDebuggingTest, ResolveAfterFinished) {
   EXPECT_EQ(dd.working, expected);
   EXPECT_TRUE(dd.finished());
 }
+
+TEST(DeltaDebuggingTest, WeightedPartitions) {
+  // The first item weighs as much as all the others, so it is tested apart from
+  // them first.
+  std::vector<int> items = {0, 1, 2, 3, 4, 5, 6, 7};
+  DeltaDebugger<int> dd(items, [](int item) { return item == 0 ? 7 : 1; });
+  dd.reject();
+  std::vector<int> expected = {0};
+  EXPECT_EQ(dd.test, expected);
+  dd.reject();
+  expected = {1, 2, 3, 4, 5, 6, 7};
+  EXPECT_EQ(dd.test, expected);
+}
+
+TEST(DeltaDebuggingTest, WeightedSingleItem) {
+  std::vector<int> items = {0, 1, 2, 3, 4, 5, 6, 7};
+  DeltaDebugger<int> dd(items, [](int item) { return item * item; });
+  while (!dd.finished()) {
+    dd.resolve(std::find(dd.test.begin(), dd.test.end(), 3) != dd.test.end());
+  }
+  std::vector<int> expected = {3};
+  EXPECT_EQ(dd.working, expected);
+}
+
+TEST(DeltaDebuggingTest, WeightedMultipleItemsNonAdjacent) {
+  // One heavy item cannot pull all the others into its partition.
+  std::vector<int> items = {0, 1, 2, 3, 4, 5, 6, 7};
+  DeltaDebugger<int> dd(items, [](int item) { return item == 7 ? 1000 : 1; });
+  while (!dd.finished()) {
+    bool has1 = std::find(dd.test.begin(), dd.test.end(), 1) != dd.test.end();
+    bool has7 = std::find(dd.test.begin(), dd.test.end(), 7) != dd.test.end();
+    dd.resolve(has1 && has7);
+  }
+  std::vector<int> expected = {1, 7};
+  EXPECT_EQ(dd.working, expected);
+}
@@ -16,9 +16,15 @@
 
 // TODO: Replace this test file with spec tests as soon as possible.
 
+#include <chrono>
+#include <iostream>
+
 #include "interpreter/interpreter.h"
 #include "interpreter/store.h"
 #include "literal.h"
+#include "parser/wat-parser.h"
+#include "shell-interface.h"
+#include "wasm-interpreter.h"
 #include "wasm-ir-builder.h"
 #include "wasm.h"
 
@@ -1078,3 +1084,385 @@ TEST(InterpreterTest, InstanceReferenceStability) {
   EXPECT_EQ(store.callStack.back().instance.globalValues["x"],
             Literal(int32_t(42)));
 }
+
+// Bytecode
+
+// Ports of the fannkuch and fasta benchmarks in test/, written directly in the
+// text format.
+static const char* fannkuchText = R"wasm(
+  (module
+    (memory 1 1)
+    ;; perm1 is at 0, perm at 64 and count at 128.
+    (func $fannkuch (export "fannkuch") (param $n i32) (result i32)
+      (local $i i32) (local $j i32) (local $k i32) (local $r i32)
+      (local $tmp i32) (local $flips i32) (local $maxFlips i32)
+      (loop $init
+        (i32.store (i32.shl (local.get $i) (i32.const 2)) (local.get $i))
+        (br_if $init
+          (i32.lt_s
+            (local.tee $i (i32.add (local.get $i) (i32.const 1)))
+            (local.get $n))))
+      (local.set $r (local.get $n))
+      (loop $outer
+        (block $counted
+          (loop $count
+            (br_if $counted (i32.eq (local.get $r) (i32.const 1)))
+            (i32.store offset=124
+              (i32.shl (local.get $r) (i32.const 2))
+              (local.get $r))
+            (local.set $r (i32.sub (local.get $r) (i32.const 1)))
+            (br $count)))
+        (local.set $i (i32.const 0))
+        (loop $copy
+          (i32.store offset=64
+            (i32.shl (local.get $i) (i32.const 2))
+            (i32.load (i32.shl (local.get $i) (i32.const 2))))
+          (br_if $copy
+            (i32.lt_s
+              (local.tee $i (i32.add (local.get $i) (i32.const 1)))
+              (local.get $n))))
+        (local.set $flips (i32.const 0))
+        (block $flipped
+          (loop $flip
+            (br_if $flipped
+              (i32.eqz (local.tee $k (i32.load offset=64 (i32.const 0)))))
+            (local.set $i (i32.const 0))
+            (local.set $j (local.get $k))
+            (block $reversed
+              (loop $reverse
+                (br_if $reversed (i32.ge_s (local.get $i) (local.get $j)))
+                (local.set $tmp
+                  (i32.load offset=64 (i32.shl (local.get $i) (i32.const 2))))
+                (i32.store offset=64
+                  (i32.shl (local.get $i) (i32.const 2))
+                  (i32.load offset=64 (i32.shl (local.get $j) (i32.const 2))))
+                (i32.store offset=64
+                  (i32.shl (local.get $j) (i32.const 2))
+                  (local.get $tmp))
+                (local.set $i (i32.add (local.get $i) (i32.const 1)))
+                (local.set $j (i32.sub (local.get $j) (i32.const 1)))
+                (br $reverse)))
+            (local.set $flips (i32.add (local.get $flips) (i32.const 1)))
+            (br $flip)))
+        (local.set $maxFlips
+          (select
+            (local.get $flips)
+            (local.get $maxFlips)
+            (i32.gt_s (local.get $flips) (local.get $maxFlips))))
+        (loop $next
+          (if (i32.eq (local.get $r) (local.get $n))
+            (then (return (local.get $maxFlips))))
+          (local.set $tmp (i32.load (i32.const 0)))
+          (local.set $i (i32.const 0))
+          (block $rotated
+            (loop $rotate
+              (br_if $rotated (i32.ge_s (local.get $i) (local.get $r)))
+              (i32.store
+                (i32.shl (local.get $i) (i32.const 2))
+                (i32.load offset=4 (i32.shl (local.get $i) (i32.const 2))))
+              (local.set $i (i32.add (local.get $i) (i32.const 1)))
+              (br $rotate)))
+          (i32.store (i32.shl (local.get $r) (i32.const 2)) (local.get $tmp))
+          (i32.store offset=128
+            (i32.shl (local.get $r) (i32.const 2))
+            (local.tee $tmp
+              (i32.sub
+                (i32.load offset=128 (i32.shl (local.get $r) (i32.const 2)))
+                (i32.const 1))))
+          (br_if $outer (i32.gt_s (local.get $tmp) (i32.const 0)))
+          (local.set $r (i32.add (local.get $r) (i32.const 1)))
+          (br $next)))
+      (unreachable)
+    )
+  )
+)wasm";
+
+static const char* fastaText = R"wasm(
+  (module
+    (memory 1 1)
+    (data (i32.const 32) "acgt")
+    (global $last (mut i32) (i32.const 42))
+    (func $random (param $max f64) (result f64)
+      (global.set $last
+        (i32.rem_u
+          (i32.add
+            (i32.mul (global.get $last) (i32.const 3877))
+            (i32.const 29573))
+          (i32.const 139968)))
+      (f64.div
+        (f64.mul (local.get $max) (f64.convert_i32_u (global.get $last)))
+        (f64.const 139968)))
+    ;; Picks n random nucleotides by their cumulative probabilities, which are
+    ;; stored at 0, and returns a checksum of them.
+    (func $fasta (export "fasta") (param $n i32) (result i32)
+      (local $i i32) (local $j i32) (local $r f64) (local $checksum i32)
+      (f64.store (i32.const 0) (f64.const 0.27))
+      (f64.store (i32.const 8) (f64.const 0.39))
+      (f64.store (i32.const 16) (f64.const 0.51))
+      (f64.store (i32.const 24) (f64.const 1))
+      (block $done
+        (loop $outer
+          (br_if $done (i32.ge_u (local.get $i) (local.get $n)))
+          (local.set $r (call $random (f64.const 1)))
+          (local.set $j (i32.const 0))
+          (block $found
+            (loop $search
+              (br_if $found
+                (f64.lt
+                  (local.get $r)
+                  (f64.load (i32.shl (local.get $j) (i32.const 3)))))
+              (br_if $search
+                (i32.lt_u
+                  (local.tee $j (i32.add (local.get $j) (i32.const 1)))
+                  (i32.const 3)))))
+          (local.set $checksum
+            (i32.add
+              (i32.mul (local.get $checksum) (i32.const 31))
+              (i32.load8_u offset=32 (local.get $j))))
+          (local.set $i (i32.add (local.get $i) (i32.const 1)))
+          (br $outer)))
+      (local.get $checksum)
+    )
+  )
+)wasm";
+
+static std::shared_ptr<Module> parseModule(const char* text) {
+  auto wasm = std::make_shared<Module>();
+  auto parsed = WATParser::parseModule(*wasm, text);
+  if (auto* err = parsed.getErr()) {
+    ADD_FAILURE() << err->msg;
+  }
+  return wasm;
+}
+
+// Runs an export with the bytecode and with ModuleRunner.
+static std::pair<std::vector<Literal>, std::vector<Literal>>
+runBoth(const char* text, Name name, const std::vector<Literal>& args) {
+  auto wasm = parseModule(text);
+  Interpreter interpreter;
+  EXPECT_FALSE(interpreter.addInstance(wasm).getErr());
+  auto results = interpreter.invoke(name, args);
+  if (auto* err = results.getErr()) {
+    ADD_FAILURE() << err->msg;
+    return {};
+  }
+
+  Literals arguments;
+  for (auto& arg : args) {
+    arguments.push_back(arg);
+  }
+  ShellExternalInterface interface;
+  ModuleRunner instance(*wasm, &interface);
+  instance.instantiate();
+  auto flow = instance.callExport(name, arguments);
+  std::vector<Literal> expected(flow.values.begin(), flow.values.end());
+  return {*results, expected};
+}
+
+TEST(InterpreterTest, BytecodeFannkuch) {
+  auto [results, expected] =
+    runBoth(fannkuchText, "fannkuch", {Literal(int32_t(7))});
+  EXPECT_EQ(results, expected);
+  EXPECT_EQ(results, std::vector<Literal>{Literal(int32_t(16))});
+}
+
+TEST(InterpreterTest, BytecodeFasta) {
+  auto [results, expected] =
+    runBoth(fastaText, "fasta", {Literal(int32_t(1000))});
+  EXPECT_EQ(results, expected);
+}
+
+TEST(InterpreterTest, BytecodeControlFlow) {
+  auto text = R"wasm(
+    (module
+      (func $fac (param $n i64) (result i64)
+        (if (result i64) (i64.le_u (local.get $n) (i64.const 1))
+          (then (i64.const 1))
+          (else
+            (i64.mul
+              (local.get $n)
+              (call $fac (i64.sub (local.get $n) (i64.const 1)))))))
+      (func $classify (param $x i32) (result i32)
+        (block $default
+          (block $two
+            (block $one
+              (block $zero
+                (br_table $zero $one $two $default (local.get $x)))
+              (return (i32.const 100)))
+            (return (i32.const 101)))
+          (return (i32.const 102)))
+        (i32.const 103))
+      (func $sum (export "sum") (param $x i32) (result i64)
+        (i64.add
+          (call $fac (i64.const 20))
+          (i64.extend_i32_u
+            (i32.add
+              (i32.add (call $classify (i32.const 1))
+                       (call $classify (local.get $x)))
+              (block $out (result i32)
+                (drop (br_if $out (i32.const 7) (local.get $x)))
+                (i32.const 9))))))
+    )
+  )wasm";
+  for (int32_t x : {0, 2, 3, 100}) {
+    auto [results, expected] = runBoth(text, "sum", {Literal(x)});
+    EXPECT_EQ(results, expected);
+  }
+}
+
+TEST(InterpreterTest, BytecodeTraps) {
+  auto wasm = parseModule(R"wasm(
+    (module
+      (memory 1)
+      (func (export "div") (param i32) (result i32)
+        (i32.div_s (i32.const 1) (local.get 0)))
+      (func (export "load") (param i32) (result i32)
+        (i32.load (local.get 0)))
+      (func (export "trunc") (param f64) (result i32)
+        (i32.trunc_f64_s (local.get 0)))
+      (func (export "unreachable")
+        (unreachable))
+    )
+  )wasm");
+  Interpreter interpreter;
+  ASSERT_FALSE(interpreter.addInstance(wasm).getErr());
+
+  EXPECT_TRUE(interpreter.invoke("div", {Literal(int32_t(0))}).getErr());
+  auto div = interpreter.invoke("div", {Literal(int32_t(-1))});
+  ASSERT_FALSE(div.getErr());
+  EXPECT_EQ(*div, std::vector<Literal>{Literal(int32_t(-1))});
+
+  EXPECT_FALSE(interpreter.invoke("load", {Literal(int32_t(65532))}).getErr());
+  EXPECT_TRUE(interpreter.invoke("load", {Literal(int32_t(65533))}).getErr());
+
+  EXPECT_TRUE(interpreter.invoke("trunc", {Literal(double(1e10))}).getErr());
+  EXPECT_TRUE(interpreter.invoke("unreachable", {}).getErr());
+}
+
+TEST(InterpreterTest, BytecodeUnsupported) {
+  auto wasm = parseModule(R"wasm(
+    (module
+      (import "env" "f" (func $f))
+      (func (export "g")
+        (call $f))
+    )
+  )wasm");
+  Interpreter interpreter;
+  ASSERT_FALSE(interpreter.addInstance(wasm).getErr());
+  EXPECT_TRUE(interpreter.invoke("g", {}).getErr());
+}
+
+TEST(InterpreterTest, BytecodeTailCalls) {
+  // Tail calls reuse the frame of the caller, so they can go much deeper than
+  // the limit on the depth of calls.
+  auto wasm = parseModule(R"wasm(
+    (module
+      (func $even (export "even") (param $n i32) (result i32)
+        (if (result i32) (i32.eqz (local.get $n))
+          (then (i32.const 1))
+          (else (return_call $odd (i32.sub (local.get $n) (i32.const 1))))))
+      (func $odd (param $n i32) (result i32)
+        (if (result i32) (i32.eqz (local.get $n))
+          (then (i32.const 0))
+          (else (return_call $even (i32.sub (local.get $n) (i32.const 1))))))
+      (func $sum (export "sum") (param $n i64) (param $acc i64) (result i64)
+        (local $unused f64)
+        (if (result i64) (i64.eqz (local.get $n))
+          (then (local.get $acc))
+          (else
+            (return_call $sum
+              (i64.sub (local.get $n) (i64.const 1))
+              (i64.add (local.get $acc) (local.get $n))))))
+    )
+  )wasm");
+  Interpreter interpreter;
+  ASSERT_FALSE(interpreter.addInstance(wasm).getErr());
+
+  auto even = interpreter.invoke("even", {Literal(int32_t(100001))});
+  ASSERT_FALSE(even.getErr());
+  EXPECT_EQ(*even, std::vector<Literal>{Literal(int32_t(0))});
+
+  auto sum =
+    interpreter.invoke("sum", {Literal(int64_t(100000)), Literal(int64_t(0))});
+  ASSERT_FALSE(sum.getErr());
+  EXPECT_EQ(*sum, std::vector<Literal>{Literal(int64_t(5000050000))});
+}
+
+TEST(InterpreterTest, BytecodeDataSegments) {
+  // Memories are only allocated when code that uses them runs, so a large
+  // memory that is not used costs nothing.
+  auto wasm = parseModule(R"wasm(
+    (module
+      (memory 65536)
+      (data (i32.const 65536) "abcd")
+      (func (export "f") (result i32)
+        (i32.const 1))
+    )
+  )wasm");
+  Interpreter interpreter;
+  ASSERT_FALSE(interpreter.addInstance(wasm).getErr());
+  auto f = interpreter.invoke("f", {});
+  ASSERT_FALSE(f.getErr());
+  EXPECT_EQ(*f, std::vector<Literal>{Literal(int32_t(1))});
+
+  // Once the memory is used, it contains the data.
+  wasm = parseModule(R"wasm(
+    (module
+      (memory 1)
+      (data (i32.const 65532) "abcd")
+      (func (export "load") (result i32)
+        (i32.load (i32.const 65532)))
+    )
+  )wasm");
+  ASSERT_FALSE(interpreter.addInstance(wasm).getErr());
+  auto load = interpreter.invoke("load", {});
+  ASSERT_FALSE(load.getErr());
+  EXPECT_EQ(*load, std::vector<Literal>{Literal(int32_t(0x64636261))});
+
+  // A segment that does not fit is an error, even when the end of the segment
+  // does not fit in 64 bits.
+  wasm = parseModule(R"wasm(
+    (module
+      (memory 1)
+      (data (i32.const 65533) "abcd")
+    )
+  )wasm");
+  EXPECT_TRUE(interpreter.addInstance(wasm).getErr());
+  wasm = parseModule(R"wasm(
+    (module
+      (memory i64 1)
+      (data (i64.const -2) "abcd")
+    )
+  )wasm");
+  EXPECT_TRUE(interpreter.addInstance(wasm).getErr());
+}
+
+// Compares the speed of the bytecode with that of ModuleRunner. Run it with
+// --gtest_also_run_disabled_tests.
+TEST(InterpreterTest, DISABLED_BytecodeBenchmark) {
+  using Clock = std::chrono::steady_clock;
+  auto bench = [](const char* text, Name name, Literal arg) {
+    auto wasm = parseModule(text);
+
+    Interpreter interpreter;
+    ASSERT_FALSE(interpreter.addInstance(wasm).getErr());
+    auto start = Clock::now();
+    auto results = interpreter.invoke(name, {arg});
+    std::chrono::duration<double> bytecode = Clock::now() - start;
+    ASSERT_FALSE(results.getErr());
+
+    ShellExternalInterface interface;
+    ModuleRunner instance(*wasm, &interface);
+    instance.instantiate();
+    start = Clock::now();
+    auto flow = instance.callExport(name, {arg});
+    std::chrono::duration<double> tree = Clock::now() - start;
+    EXPECT_EQ(*results,
+              std::vector<Literal>(flow.values.begin(), flow.values.end()));
+
+    std::cout << name << ": bytecode " << bytecode.count() << "s, ModuleRunner "
+              << tree.count() << "s, speedup " << tree / bytecode << "x\n";
+  };
+  bench(fannkuchText, "fannkuch", Literal(int32_t(8)));
+  bench(fastaText, "fasta", Literal(int32_t(200000)));
+}
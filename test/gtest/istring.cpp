@@ -12,6 +12,12 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
 #include "support/istring.h"
 #include "gtest/gtest.h"
 
@@ -95,3 +101,60 @@ TEST_F(IStringTest, EndsWith) {
   EXPECT_FALSE(foo.endsWith("foobar"));
   EXPECT_FALSE(foo.endsWith("bar"));
 }
+
+TEST_F(IStringTest, ConcurrentInterning) {
+  // Threads that intern the same new strings at the same time all get the same
+  // interned copies.
+  constexpr size_t numThreads = 8;
+  constexpr size_t numStrings = 1000;
+  std::vector<std::vector<IString>> results(numThreads);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < numThreads; ++t) {
+    threads.emplace_back([&, t]() {
+      for (size_t i = 0; i < numStrings; ++i) {
+        results[t].push_back(IString("concurrent-" + std::to_string(i)));
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (size_t t = 1; t < numThreads; ++t) {
+    for (size_t i = 0; i < numStrings; ++i) {
+      EXPECT_EQ(results[0][i].str.data(), results[t][i].str.data());
+    }
+  }
+}
+
+// A microbenchmark of interning new strings from many threads at once, which
+// is what parallel passes that create names do. The total work is the same for
+// each number of threads. Run it with
+// --gtest_also_run_disabled_tests --gtest_filter=*InterningScaling*
+TEST_F(IStringTest, DISABLED_InterningScaling) {
+  constexpr size_t totalStrings = 1 << 18;
+  for (size_t numThreads = 1; numThreads <= 64; numThreads *= 2) {
+    size_t numStrings = totalStrings / numThreads;
+    auto prefix = "scaling-" + std::to_string(numThreads) + "-";
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t t = 0; t < numThreads; ++t) {
+      threads.emplace_back([&, t]() {
+        // Each thread interns its own new strings, plus some that all threads
+        // share.
+        auto own = prefix + std::to_string(t) + "-";
+        for (size_t i = 0; i < numStrings; ++i) {
+          IString(own + std::to_string(i));
+          IString(prefix + std::to_string(i % 1024));
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    std::chrono::duration<double> time =
+      std::chrono::steady_clock::now() - start;
+    auto ops = double(numThreads * numStrings * 2);
+    std::cerr << numThreads << " threads: " << time.count() << " s, "
+              << ops / time.count() / 1e6 << " M interns/s\n";
+  }
+}
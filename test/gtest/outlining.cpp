@@ -0,0 +1,65 @@
+/*
+ * Copyright 2026 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "pass.h"
+#include "wasm-builder.h"
+#include "wasm-validator.h"
+#include "wasm.h"
+#include "gtest/gtest.h"
+
+using namespace wasm;
+
+// A long run of equal instructions has a repeated substring of every length,
+// most of them with many overlapping occurrences. Selecting by benefit must
+// not look at all of those occurrences for every one of them, which took half
+// a minute here.
+TEST(OutliningTest, SelectByBenefitLongRun) {
+  const Index numDrops = 100000;
+
+  Module wasm;
+  Builder builder(wasm);
+  std::vector<Expression*> list;
+  for (Index i = 0; i < numDrops; ++i) {
+    list.push_back(builder.makeDrop(builder.makeConst(int32_t(1))));
+  }
+  wasm.addFunction(builder.makeFunction(
+    "run", Signature(Type::none, Type::none), {}, builder.makeBlock(list)));
+
+  PassOptions options;
+  options.arguments["outlining-select-by-benefit"] = "";
+  PassRunner runner(&wasm, options);
+  runner.add("outlining");
+  runner.run();
+  ASSERT_TRUE(WasmValidator().validate(wasm));
+
+  // The best substring to outline is half of the run, which occurs twice
+  // without overlapping.
+  ASSERT_EQ(wasm.functions.size(), 2u);
+  auto* outlined = wasm.functions[0].get();
+  auto* run = wasm.getFunction("run");
+  ASSERT_NE(outlined, run);
+  auto* outlinedBody = outlined->body->dynCast<Block>();
+  ASSERT_TRUE(outlinedBody);
+  EXPECT_EQ(outlinedBody->list.size(), numDrops / 2);
+  auto* runBody = run->body->dynCast<Block>();
+  ASSERT_TRUE(runBody);
+  ASSERT_EQ(runBody->list.size(), 2u);
+  for (auto* curr : runBody->list) {
+    auto* call = curr->dynCast<Call>();
+    ASSERT_TRUE(call);
+    EXPECT_EQ(call->target, outlined->name);
+  }
+}
@@ -1,6 +1,9 @@
+#include <chrono>
+
 #include "ir/possible-contents.h"
 #include "ir/subtypes.h"
 #include "parser/wat-parser.h"
+#include "support/threads.h"
 #include "wasm.h"
 #include "gtest/gtest.h"
 
@@ -989,6 +992,159 @@ TEST_F(PossibleContentsTest, TestOracleNoFullCones) {
   EXPECT_EQ(bodyContents.getCone().depth, Index(2));
 }
 
+TEST_F(PossibleContentsTest, TestOracleSeparateParts) {
+  // The flow in the fields of $A and $B can not interact with the one in the
+  // field of $C, so they may be flowed separately, but the results must be the
+  // same as when flowing everything together.
+  auto wasm = parse(R"(
+    (module
+      (rec
+        (type $A (sub (struct (field (mut i32)))))
+        (type $B (sub $A (struct (field (mut i32)))))
+        (type $C (sub (struct (field (mut i32)))))
+      )
+      (func $a (export "a") (param $x i32) (result i32)
+        (struct.get $A 0
+          (select (result (ref $A))
+            (struct.new $A
+              (i32.const 42)
+            )
+            (struct.new $B
+              (i32.const 42)
+            )
+            (local.get $x)
+          )
+        )
+      )
+      (func $c (export "c") (result i32)
+        (local $c (ref $C))
+        (local.set $c
+          (struct.new $C
+            (i32.const 1)
+          )
+        )
+        (struct.set $C 0
+          (local.get $c)
+          (i32.const 1)
+        )
+        (struct.get $C 0
+          (local.get $c)
+        )
+      )
+    )
+  )");
+  // Force each way of flowing, as which one is used by default depends on the
+  // number of threads. The parts are flowed separately even if there is only
+  // one thread.
+  ContentOracle serial(*wasm, options, ContentOracle::FlowMode::Serial);
+  ContentOracle oracle(*wasm, options, ContentOracle::FlowMode::Parallel);
+  auto getType = [&](Name name) {
+    for (auto& [type, names] : wasm->typeNames) {
+      if (names.name == name) {
+        return type;
+      }
+    }
+    WASM_UNREACHABLE("missing type");
+  };
+  auto fortyTwo = PossibleContents::literal(Literal(int32_t(42)));
+  auto one = PossibleContents::literal(Literal(int32_t(1)));
+  EXPECT_EQ(oracle.getContents(ResultLocation{wasm->getFunction("a"), 0}),
+            fortyTwo);
+  EXPECT_EQ(oracle.getContents(ResultLocation{wasm->getFunction("c"), 0}),
+            one);
+  EXPECT_EQ(oracle.getContents(DataLocation{getType("B"), 0}), fortyTwo);
+  EXPECT_EQ(oracle.getContents(DataLocation{getType("C"), 0}), one);
+
+  // Every location has the same contents either way.
+  size_t numLocations = 0;
+  serial.iterContents([&](const Location& location,
+                          const PossibleContents& contents) {
+    EXPECT_EQ(oracle.getContents(location), contents);
+    numLocations++;
+  });
+  oracle.iterContents([&](const Location& location,
+                          const PossibleContents& contents) {
+    EXPECT_EQ(serial.getContents(location), contents);
+    numLocations--;
+  });
+  EXPECT_EQ(numLocations, 0u);
+}
+
+// A module with many separate trees of types, each used by a ring of functions
+// that call each other.
+static std::string makeTreesModule(int numTrees, int numFuncs) {
+  std::stringstream text;
+  text << "(module\n (rec\n";
+  for (int i = 0; i < numTrees; i++) {
+    text << "  (type $A" << i
+         << " (sub (struct (field (mut i32)) (field (mut anyref)))))\n"
+         << "  (type $B" << i << " (sub $A" << i
+         << " (struct (field (mut i32)) (field (mut anyref)) "
+            "(field (mut f64)))))\n";
+  }
+  text << " )\n";
+  for (int i = 0; i < numTrees; i++) {
+    for (int j = 0; j < numFuncs; j++) {
+      auto A = "$A" + std::to_string(i);
+      auto B = "$B" + std::to_string(i);
+      auto next = "$f" + std::to_string(i) + "_" +
+                  std::to_string((j + 1) % numFuncs);
+      text << " (func $f" << i << "_" << j << " (export \"f" << i << "_" << j
+           << "\") (param $x i32) (result i32)\n"
+           << "  (local $a (ref null " << A << "))\n"
+           << "  (local $b (ref null " << B << "))\n"
+           << "  (local.set $a (struct.new " << A
+           << " (local.get $x) (ref.i31 (i32.const " << j << "))))\n"
+           << "  (local.set $b (struct.new " << B << " (i32.const " << i
+           << ") (local.get $a) (f64.const 1)))\n"
+           << "  (if (local.get $x) (then (local.set $a (local.get $b))))\n"
+           << "  (struct.set " << A << " 0 (local.get $a) (i32.add (struct.get "
+           << A << " 0 (local.get $b)) (i32.const 1)))\n"
+           << "  (struct.set " << A << " 1 (local.get $b) (struct.get " << A
+           << " 1 (local.get $a)))\n"
+           << "  (drop (struct.get " << B << " 2 (local.get $b)))\n"
+           << "  (i32.add (struct.get " << A << " 0 (local.get $a)) (call "
+           << next << " (i32.sub (local.get $x) (i32.const 1))))\n"
+           << " )\n";
+    }
+  }
+  text << ")\n";
+  return text.str();
+}
+
+TEST_F(PossibleContentsTest, TestOracleSeparatePartsMatch) {
+  // Flowing the parts separately gives the same contents everywhere as flowing
+  // everything at once.
+  auto wasm = parse(makeTreesModule(10, 5));
+  ContentOracle serial(*wasm, options, ContentOracle::FlowMode::Serial);
+  ContentOracle parallel(*wasm, options, ContentOracle::FlowMode::Parallel);
+  size_t numLocations = 0;
+  serial.iterContents([&](const Location& location,
+                          const PossibleContents& contents) {
+    EXPECT_EQ(parallel.getContents(location), contents);
+    numLocations++;
+  });
+  parallel.iterContents([&](const Location& location,
+                            const PossibleContents& contents) {
+    EXPECT_EQ(serial.getContents(location), contents);
+    numLocations--;
+  });
+  EXPECT_EQ(numLocations, 0u);
+}
+
+// Measures the time it takes to compute the contents of a large module with
+// many separate trees of types. Run with --gtest_also_run_disabled_tests, and
+// compare BINARYEN_CORES=1 to the default.
+TEST_F(PossibleContentsTest, DISABLED_TestOracleBenchmark) {
+  auto wasm = parse(makeTreesModule(500, 20));
+
+  auto start = std::chrono::steady_clock::now();
+  ContentOracle oracle(*wasm, options);
+  std::chrono::duration<double> time = std::chrono::steady_clock::now() - start;
+  std::cout << "ContentOracle with " << ThreadPool::get()->size()
+            << " threads: " << time.count() << "s\n";
+}
+
 TEST_F(PossibleContentsTest, TestTupleItems) {
   // All tuples must be exact (there is no subtyping for tuples).
   Type funcref = Type(HeapType::func, Nullable);
@@ -0,0 +1,176 @@
+#include <map>
+#include <random>
+
+#include "support/suffix_array.h"
+#include "support/suffix_tree.h"
+#include "gtest/gtest.h"
+
+using namespace wasm;
+
+namespace {
+
+using Repeat = std::pair<uint32_t, std::vector<uint32_t>>;
+
+std::vector<Repeat> getRepeats(const SuffixArray& sa, uint32_t minLength) {
+  std::vector<Repeat> repeats;
+  sa.forEachRepeat(minLength, [&](uint32_t length, auto starts) {
+    repeats.push_back({length, {starts.begin(), starts.end()}});
+    std::sort(repeats.back().second.begin(), repeats.back().second.end());
+  });
+  std::sort(repeats.begin(), repeats.end());
+  return repeats;
+}
+
+std::vector<Repeat> getDirectLeafRepeats(const SuffixArray& sa,
+                                         uint32_t minLength) {
+  std::vector<Repeat> repeats;
+  sa.forEachRepeatWithDirectLeaves(
+    minLength, [&](uint32_t length, auto starts) {
+      repeats.push_back({length, {starts.begin(), starts.end()}});
+      std::sort(repeats.back().second.begin(), repeats.back().second.end());
+    });
+  std::sort(repeats.begin(), repeats.end());
+  return repeats;
+}
+
+// The repeats that cannot be extended to the right, found by brute force.
+std::vector<Repeat> getNaiveRepeats(const std::vector<uint32_t>& str,
+                                    uint32_t minLength) {
+  std::map<std::vector<uint32_t>, std::vector<uint32_t>> occurrences;
+  for (uint32_t start = 0; start < str.size(); ++start) {
+    for (uint32_t end = start + minLength; end <= str.size(); ++end) {
+      occurrences[{str.begin() + start, str.begin() + end}].push_back(start);
+    }
+  }
+  std::vector<Repeat> repeats;
+  for (auto& [substring, starts] : occurrences) {
+    if (starts.size() < 2) {
+      continue;
+    }
+    uint32_t length = substring.size();
+    bool extensible = true;
+    for (auto start : starts) {
+      if (start + length == str.size() ||
+          str[start + length] != str[starts[0] + length]) {
+        extensible = false;
+      }
+    }
+    if (!extensible) {
+      repeats.push_back({length, starts});
+    }
+  }
+  std::sort(repeats.begin(), repeats.end());
+  return repeats;
+}
+
+std::vector<uint32_t> makeString(std::mt19937& rng,
+                                 size_t size,
+                                 uint32_t numSymbols) {
+  std::vector<uint32_t> str(size);
+  for (auto& symbol : str) {
+    symbol = rng() % numSymbols;
+  }
+  return str;
+}
+
+} // anonymous namespace
+
+TEST(SuffixArrayTest, Empty) {
+  std::vector<uint32_t> str;
+  SuffixArray sa(str);
+  EXPECT_TRUE(sa.getSuffixes().empty());
+  EXPECT_TRUE(sa.getLCPs().empty());
+  EXPECT_TRUE(getRepeats(sa, 1).empty());
+}
+
+TEST(SuffixArrayTest, Banana) {
+  // b a n a n a
+  std::vector<uint32_t> str{1, 0, 2, 0, 2, 0};
+  SuffixArray sa(str);
+  EXPECT_EQ(sa.getSuffixes(), (std::vector<uint32_t>{5, 3, 1, 0, 4, 2}));
+  EXPECT_EQ(sa.getLCPs(), (std::vector<uint32_t>{0, 1, 3, 0, 0, 2}));
+  std::vector<Repeat> expected{{1, {1, 3, 5}}, {2, {2, 4}}, {3, {1, 3}}};
+  EXPECT_EQ(getRepeats(sa, 1), expected);
+  expected = {{2, {2, 4}}, {3, {1, 3}}};
+  EXPECT_EQ(getRepeats(sa, 2), expected);
+}
+
+TEST(SuffixArrayTest, LargeSymbols) {
+  // Symbols are compared as unsigned integers, however large.
+  std::vector<uint32_t> str{0xffffffff, 0x10000, 0xffff, 0x10000, 0};
+  SuffixArray sa(str);
+  EXPECT_EQ(sa.getSuffixes(), (std::vector<uint32_t>{4, 2, 3, 1, 0}));
+  EXPECT_EQ(sa.getLCPs(), (std::vector<uint32_t>{0, 0, 0, 1, 0}));
+}
+
+TEST(SuffixArrayTest, RandomMatchesNaive) {
+  std::mt19937 rng(42);
+  for (int iter = 0; iter < 200; ++iter) {
+    auto str = makeString(rng, rng() % 60, iter % 2 ? 2 : 1 + rng() % 8);
+    if (iter % 3 == 0) {
+      // Spread the symbols out over the whole range.
+      for (auto& symbol : str) {
+        symbol *= 0x12345679;
+      }
+    }
+    SuffixArray sa(str);
+
+    std::vector<uint32_t> expected(str.size());
+    for (uint32_t i = 0; i < str.size(); ++i) {
+      expected[i] = i;
+    }
+    std::sort(expected.begin(), expected.end(), [&](uint32_t a, uint32_t b) {
+      return std::lexicographical_compare(
+        str.begin() + a, str.end(), str.begin() + b, str.end());
+    });
+    ASSERT_EQ(sa.getSuffixes(), expected);
+
+    for (uint32_t j = 1; j < str.size(); ++j) {
+      uint32_t a = expected[j - 1], b = expected[j], lcp = 0;
+      while (a + lcp < str.size() && b + lcp < str.size() &&
+             str[a + lcp] == str[b + lcp]) {
+        ++lcp;
+      }
+      ASSERT_EQ(sa.getLCPs()[j], lcp);
+    }
+
+    for (uint32_t minLength : {1, 2, 4}) {
+      ASSERT_EQ(getRepeats(sa, minLength), getNaiveRepeats(str, minLength));
+    }
+  }
+}
+
+TEST(SuffixArrayTest, DirectLeavesMatchSuffixTree) {
+  std::mt19937 rng(1234);
+  for (int iter = 0; iter < 200; ++iter) {
+    auto str = makeString(rng, rng() % 200, 1 + rng() % 6);
+    // The suffix tree needs a unique symbol at the end.
+    str.push_back(-1);
+    SuffixArray sa(str);
+    SuffixTree st(str);
+    std::vector<Repeat> expected;
+    for (auto& substring : st) {
+      expected.push_back({substring.Length, substring.StartIndices});
+      std::sort(expected.back().second.begin(), expected.back().second.end());
+    }
+    std::sort(expected.begin(), expected.end());
+    ASSERT_EQ(getDirectLeafRepeats(sa, 2), expected);
+  }
+}
+
+TEST(SuffixArrayTest, LongRuns) {
+  // A run of a single symbol has a repeat of every length up to its own, each
+  // nested in the next shorter one.
+  std::vector<uint32_t> str(1000, 7);
+  str.push_back(3);
+  SuffixArray sa(str);
+  for (uint32_t j = 0; j < str.size(); ++j) {
+    EXPECT_EQ(sa.getSuffixes()[j], 1000 - j);
+  }
+  size_t numRepeats = 0;
+  sa.forEachRepeat(1, [&](uint32_t length, auto starts) {
+    EXPECT_EQ(starts.size(), 1001 - length);
+    ++numRepeats;
+  });
+  EXPECT_EQ(numRepeats, 999u);
+}
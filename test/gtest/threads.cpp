@@ -0,0 +1,118 @@
+/*
+ * Copyright 2026 WebAssembly Community Group participants
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "support/threads.h"
+#include "gtest/gtest.h"
+
+using namespace wasm;
+
+TEST(ThreadPoolTest, Async) {
+  std::atomic<int> value = 0;
+  auto future = ThreadPool::get()->async([&]() { value = 42; });
+  future.wait();
+  EXPECT_TRUE(future.isReady());
+  EXPECT_EQ(value, 42);
+}
+
+TEST(ThreadPoolTest, Then) {
+  std::vector<int> order;
+  std::mutex mutex;
+  auto log = [&](int i) {
+    std::lock_guard<std::mutex> lock(mutex);
+    order.push_back(i);
+  };
+  auto first = ThreadPool::get()->async([&]() { log(1); });
+  auto second = first.then([&]() { log(2); });
+  auto third = second.then([&]() { log(3); });
+  third.wait();
+  EXPECT_EQ(order, (std::vector<int>{1, 2, 3}));
+  // A continuation of a task that is already done still runs.
+  auto fourth = first.then([&]() { log(4); });
+  fourth.wait();
+  EXPECT_EQ(order, (std::vector<int>{1, 2, 3, 4}));
+}
+
+TEST(ThreadPoolTest, After) {
+  // A diamond: the last task depends on two tasks that depend on the first.
+  std::atomic<int> a = 0, b = 0, c = 0, d = 0;
+  auto* pool = ThreadPool::get();
+  auto first = pool->async([&]() { a = 1; });
+  auto left = first.then([&]() { b = a + 1; });
+  auto right = first.then([&]() { c = a + 2; });
+  auto last = pool->after({left, right}, [&]() { d = b + c; });
+  last.wait();
+  EXPECT_EQ(d, 5);
+}
+
+TEST(ThreadPoolTest, NestedWork) {
+  // Work that starts more work from inside the pool must not deadlock, and
+  // must do everything exactly once.
+  auto* pool = ThreadPool::get();
+  constexpr size_t outerItems = 20;
+  constexpr size_t innerItems = 50;
+  std::atomic<size_t> nextOuter = 0;
+  std::atomic<size_t> total = 0;
+  std::vector<std::function<ThreadWorkState()>> doWorkers;
+  for (size_t i = 0; i < pool->size(); i++) {
+    doWorkers.push_back([&]() {
+      if (nextOuter.fetch_add(1) >= outerItems) {
+        return ThreadWorkState::Finished;
+      }
+      std::atomic<size_t> nextInner = 0;
+      std::vector<std::function<ThreadWorkState()>> innerWorkers;
+      for (size_t j = 0; j < pool->size(); j++) {
+        innerWorkers.push_back([&]() {
+          if (nextInner.fetch_add(1) >= innerItems) {
+            return ThreadWorkState::Finished;
+          }
+          total++;
+          return ThreadWorkState::More;
+        });
+      }
+      pool->work(innerWorkers);
+      return ThreadWorkState::More;
+    });
+  }
+  pool->work(doWorkers);
+  EXPECT_EQ(total, outerItems * innerItems);
+}
+
+TEST(ThreadPoolTest, WaitRunsOnlyDependencies) {
+  // A thread that waits on a task may help to run it and its dependencies, but
+  // not unrelated tasks, which would otherwise run nested inside the wait.
+  auto* pool = ThreadPool::get();
+  static thread_local bool waiting = false;
+  std::atomic<bool> unrelatedRanInWait = false;
+  std::vector<Future> unrelated;
+  for (int i = 0; i < 20; i++) {
+    unrelated.push_back(pool->async([&]() {
+      if (waiting) {
+        unrelatedRanInWait = true;
+      }
+    }));
+  }
+  std::atomic<int> value = 0;
+  auto first = pool->async([&]() { value = 1; });
+  auto second = first.then([&]() { value = value + 1; });
+  waiting = true;
+  second.wait();
+  waiting = false;
+  EXPECT_EQ(value, 2);
+  for (auto& future : unrelated) {
+    future.wait();
+  }
+  EXPECT_FALSE(unrelatedRanInWait);
+}
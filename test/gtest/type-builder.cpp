@@ -1,3 +1,7 @@
+#include <chrono>
+#include <iostream>
+#include <thread>
+
 #include "ir/subtypes.h"
 #include "type-test.h"
 #include "wasm-builder.h"
@@ -1820,3 +1824,82 @@ TEST_F(TypeTest, TestSupertypes) {
   ASSERT_FALSE(sig1.getDeclaredSuperType());
   ASSERT_EQ(sig2.getDeclaredSuperType(), sig1);
 }
+
+// Build a recursion group of two types that is distinct for each `i`, and a
+// tuple of references to them.
+static std::vector<HeapType> buildNumberedGroup(size_t i) {
+  TypeBuilder builder(2);
+  builder.createRecGroup(0, 2);
+  // Encode `i` in base 4 in the types of the struct's fields.
+  FieldList fields{
+    Field(builder.getTempRefType(builder[1], Nullable), Mutable)};
+  const Type digits[] = {Type::i32, Type::i64, Type::f32, Type::f64};
+  do {
+    fields.push_back(Field(digits[i % 4], Immutable));
+    i /= 4;
+  } while (i);
+  builder[0] = Struct(std::move(fields));
+  builder[1] =
+    Array(Field(builder.getTempRefType(builder[0], Nullable), Mutable));
+  auto result = builder.build();
+  assert(result);
+  Type tuple(Tuple{Type((*result)[0], Nullable), Type((*result)[1], Nullable)});
+  assert(tuple.isTuple());
+  return *result;
+}
+
+TEST_F(TypeTest, ConcurrentCanonicalization) {
+  // Threads that build the same types at the same time all get the same
+  // canonical types.
+  constexpr size_t numThreads = 8;
+  constexpr size_t numGroups = 500;
+  std::vector<std::vector<HeapType>> results(numThreads);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < numThreads; ++t) {
+    threads.emplace_back([&, t]() {
+      for (size_t i = 0; i < numGroups; ++i) {
+        auto group = buildNumberedGroup(i);
+        results[t].insert(results[t].end(), group.begin(), group.end());
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (size_t t = 1; t < numThreads; ++t) {
+    EXPECT_EQ(results[0], results[t]);
+  }
+  // Different groups got different types.
+  std::unordered_set<HeapType> unique(results[0].begin(), results[0].end());
+  EXPECT_EQ(unique.size(), 2 * numGroups);
+}
+
+// A microbenchmark of building types from many threads at once. Each thread
+// builds its share of a fixed total number of types, half of which another
+// thread builds as well. Run it with
+// --gtest_also_run_disabled_tests --gtest_filter=*ConcurrentBuildScaling*
+TEST_F(TypeTest, DISABLED_ConcurrentBuildScaling) {
+  constexpr size_t totalGroups = 1 << 20;
+  for (size_t numThreads = 1; numThreads <= 64; numThreads *= 2) {
+    size_t numGroups = totalGroups / numThreads;
+    std::vector<std::thread> threads;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t t = 0; t < numThreads; ++t) {
+      threads.emplace_back([&, t]() {
+        for (size_t i = 0; i < numGroups; ++i) {
+          // Every other group is one that the next thread builds as well.
+          size_t owner = i % 2 ? (t + 1) % numThreads : t;
+          buildNumberedGroup(owner * numGroups + i);
+        }
+      });
+    }
+    for (auto& thread : threads) {
+      thread.join();
+    }
+    std::chrono::duration<double> time =
+      std::chrono::steady_clock::now() - start;
+    std::cerr << numThreads << " threads: " << time.count() << " s, "
+              << 2 * totalGroups / time.count() / 1e6 << " M types/s\n";
+    destroyAllTypesForTestingPurposesOnly();
+  }
+}
@@ -66,18 +66,18 @@
 
 ;; CHECK:      (type $2 (func (result anyref)))
 
-;; CHECK:      (global $ctor-eval$global_3 (ref (exact $A)) (struct.new_default $A))
-
 ;; CHECK:      (global $ctor-eval$global_2 (ref (exact $A)) (struct.new_default $A))
 
+;; CHECK:      (global $ctor-eval$global_1 (ref (exact $A)) (struct.new_default $A))
+
 ;; CHECK:      (export "new" (func $new_2))
 
 ;; CHECK:      (export "nop" (func $nop_3))
 
 ;; CHECK:      (func $new_2 (type $1) (result (ref any))
-;; CHECK-NEXT:  (global.get $ctor-eval$global_2)
+;; CHECK-NEXT:  (global.get $ctor-eval$global_1)
 ;; CHECK-NEXT: )
 
 ;; CHECK:      (func $nop_3 (type $2) (result anyref)
-;; CHECK-NEXT:  (global.get $ctor-eval$global_3)
+;; CHECK-NEXT:  (global.get $ctor-eval$global_2)
 ;; CHECK-NEXT: )
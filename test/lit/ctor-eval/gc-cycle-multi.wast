@@ -13,26 +13,26 @@
 
  ;; CHECK:      (type $2 (func (result i32)))
 
- ;; CHECK:      (global $ctor-eval$global_6 (ref (exact $A)) (struct.new $A
+ ;; CHECK:      (global $ctor-eval$global (ref (exact $A)) (struct.new $A
  ;; CHECK-NEXT:  (ref.null none)
  ;; CHECK-NEXT:  (i32.const 10)
  ;; CHECK-NEXT: ))
 
- ;; CHECK:      (global $ctor-eval$global_7 (ref (exact $A)) (struct.new $A
+ ;; CHECK:      (global $ctor-eval$global_4 (ref (exact $A)) (struct.new $A
  ;; CHECK-NEXT:  (ref.null none)
  ;; CHECK-NEXT:  (i32.const 20)
  ;; CHECK-NEXT: ))
 
- ;; CHECK:      (global $ctor-eval$global_8 (ref (exact $A)) (struct.new $A
+ ;; CHECK:      (global $ctor-eval$global_5 (ref (exact $A)) (struct.new $A
  ;; CHECK-NEXT:  (ref.null none)
  ;; CHECK-NEXT:  (i32.const 30)
  ;; CHECK-NEXT: ))
 
- ;; CHECK:      (global $a (mut (ref null $A)) (global.get $ctor-eval$global_6))
+ ;; CHECK:      (global $a (mut (ref null $A)) (global.get $ctor-eval$global))
  (global $a (mut (ref null $A)) (ref.null $A))
- ;; CHECK:      (global $b (mut (ref null $A)) (global.get $ctor-eval$global_7))
+ ;; CHECK:      (global $b (mut (ref null $A)) (global.get $ctor-eval$global_4))
  (global $b (mut (ref null $A)) (ref.null $A))
- ;; CHECK:      (global $c (mut (ref null $A)) (global.get $ctor-eval$global_8))
+ ;; CHECK:      (global $c (mut (ref null $A)) (global.get $ctor-eval$global_5))
  (global $c (mut (ref null $A)) (ref.null $A))
 
  (func $makeCycle (param $i i32) (result (ref $A))
@@ -74,11 +74,11 @@
   )
  )
 
- ;; CHECK:      (export "test1" (func $test1_6))
+ ;; CHECK:      (export "test1" (func $test1_5))
 
- ;; CHECK:      (export "test2" (func $test2_7))
+ ;; CHECK:      (export "test2" (func $test2_6))
 
- ;; CHECK:      (export "test3" (func $test3_8))
+ ;; CHECK:      (export "test3" (func $test3_7))
 
  ;; CHECK:      (export "keepalive" (func $keepalive))
 
@@ -115,29 +115,29 @@
   )
  )
 )
-;; CHECK:      (func $start (type $1)
-;; CHECK-NEXT:  (struct.set $A 0
-;; CHECK-NEXT:   (global.get $ctor-eval$global_6)
-;; CHECK-NEXT:   (global.get $ctor-eval$global_6)
-;; CHECK-NEXT:  )
-;; CHECK-NEXT:  (struct.set $A 0
-;; CHECK-NEXT:   (global.get $ctor-eval$global_7)
-;; CHECK-NEXT:   (global.get $ctor-eval$global_7)
-;; CHECK-NEXT:  )
-;; CHECK-NEXT:  (struct.set $A 0
-;; CHECK-NEXT:   (global.get $ctor-eval$global_8)
-;; CHECK-NEXT:   (global.get $ctor-eval$global_8)
-;; CHECK-NEXT:  )
+;; CHECK:      (func $test1_5 (type $1)
+;; CHECK-NEXT:  (nop)
 ;; CHECK-NEXT: )
 
-;; CHECK:      (func $test1_6 (type $1)
+;; CHECK:      (func $test2_6 (type $1)
 ;; CHECK-NEXT:  (nop)
 ;; CHECK-NEXT: )
 
-;; CHECK:      (func $test2_7 (type $1)
+;; CHECK:      (func $test3_7 (type $1)
 ;; CHECK-NEXT:  (nop)
 ;; CHECK-NEXT: )
 
-;; CHECK:      (func $test3_8 (type $1)
-;; CHECK-NEXT:  (nop)
+;; CHECK:      (func $start (type $1)
+;; CHECK-NEXT:  (struct.set $A 0
+;; CHECK-NEXT:   (global.get $ctor-eval$global)
+;; CHECK-NEXT:   (global.get $ctor-eval$global)
+;; CHECK-NEXT:  )
+;; CHECK-NEXT:  (struct.set $A 0
+;; CHECK-NEXT:   (global.get $ctor-eval$global_4)
+;; CHECK-NEXT:   (global.get $ctor-eval$global_4)
+;; CHECK-NEXT:  )
+;; CHECK-NEXT:  (struct.set $A 0
+;; CHECK-NEXT:   (global.get $ctor-eval$global_5)
+;; CHECK-NEXT:   (global.get $ctor-eval$global_5)
+;; CHECK-NEXT:  )
 ;; CHECK-NEXT: )
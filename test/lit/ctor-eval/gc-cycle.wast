@@ -9,12 +9,12 @@
 
  ;; CHECK:      (type $2 (func (result i32)))
 
- ;; CHECK:      (global $ctor-eval$global_2 (ref (exact $A)) (struct.new $A
+ ;; CHECK:      (global $ctor-eval$global (ref (exact $A)) (struct.new $A
  ;; CHECK-NEXT:  (ref.null none)
  ;; CHECK-NEXT:  (i32.const 42)
  ;; CHECK-NEXT: ))
 
- ;; CHECK:      (global $a (mut (ref null $A)) (global.get $ctor-eval$global_2))
+ ;; CHECK:      (global $a (mut (ref null $A)) (global.get $ctor-eval$global))
  (global $a (mut (ref null $A)) (ref.null $A))
 
  (func $test (export "test")
@@ -36,7 +36,7 @@
   )
  )
 
- ;; CHECK:      (export "test" (func $test_3))
+ ;; CHECK:      (export "test" (func $test_2))
 
  ;; CHECK:      (export "keepalive" (func $keepalive))
 
@@ -62,17 +62,17 @@
  )
 )
 
+;; CHECK:      (func $test_2 (type $1)
+;; CHECK-NEXT:  (local $a (ref $A))
+;; CHECK-NEXT:  (nop)
+;; CHECK-NEXT: )
+
 ;; CHECK:      (func $start (type $1)
 ;; CHECK-NEXT:  (struct.set $A 0
-;; CHECK-NEXT:   (global.get $ctor-eval$global_2)
-;; CHECK-NEXT:   (global.get $ctor-eval$global_2)
+;; CHECK-NEXT:   (global.get $ctor-eval$global)
+;; CHECK-NEXT:   (global.get $ctor-eval$global)
 ;; CHECK-NEXT:  )
 ;; CHECK-NEXT: )
-
-;; CHECK:      (func $test_3 (type $1)
-;; CHECK-NEXT:  (local $a (ref $A))
-;; CHECK-NEXT:  (nop)
-;; CHECK-NEXT: )
 (module
  ;; As above, but with $A's fields reversed. This verifies we use the right
  ;; field index in the start function.
@@ -84,12 +84,12 @@
 
  ;; CHECK:      (type $2 (func (result i32)))
 
- ;; CHECK:      (global $ctor-eval$global_2 (ref (exact $A)) (struct.new $A
+ ;; CHECK:      (global $ctor-eval$global (ref (exact $A)) (struct.new $A
  ;; CHECK-NEXT:  (i32.const 42)
  ;; CHECK-NEXT:  (ref.null none)
  ;; CHECK-NEXT: ))
 
- ;; CHECK:      (global $a (mut (ref null $A)) (global.get $ctor-eval$global_2))
+ ;; CHECK:      (global $a (mut (ref null $A)) (global.get $ctor-eval$global))
  (global $a (mut (ref null $A)) (ref.null $A))
 
  (func $test (export "test")
@@ -108,7 +108,7 @@
   )
  )
 
- ;; CHECK:      (export "test" (func $test_3))
+ ;; CHECK:      (export "test" (func $test_2))
 
  ;; CHECK:      (export "keepalive" (func $keepalive))
 
@@ -130,17 +130,17 @@
  )
 )
 
+;; CHECK:      (func $test_2 (type $1)
+;; CHECK-NEXT:  (local $a (ref $A))
+;; CHECK-NEXT:  (nop)
+;; CHECK-NEXT: )
+
 ;; CHECK:      (func $start (type $1)
 ;; CHECK-NEXT:  (struct.set $A 1
-;; CHECK-NEXT:   (global.get $ctor-eval$global_2)
-;; CHECK-NEXT:   (global.get $ctor-eval$global_2)
+;; CHECK-NEXT:   (global.get $ctor-eval$global)
+;; CHECK-NEXT:   (global.get $ctor-eval$global)
 ;; CHECK-NEXT:  )
 ;; CHECK-NEXT: )
-
-;; CHECK:      (func $test_3 (type $1)
-;; CHECK-NEXT:  (local $a (ref $A))
-;; CHECK-NEXT:  (nop)
-;; CHECK-NEXT: )
 (module
  ;; A cycle between two globals.
 
@@ -151,20 +151,20 @@
 
  ;; CHECK:      (type $2 (func (result i32)))
 
- ;; CHECK:      (global $ctor-eval$global_5 (ref (exact $A)) (struct.new $A
+ ;; CHECK:      (global $ctor-eval$global (ref (exact $A)) (struct.new $A
  ;; CHECK-NEXT:  (ref.null none)
  ;; CHECK-NEXT:  (i32.const 42)
  ;; CHECK-NEXT: ))
 
- ;; CHECK:      (global $ctor-eval$global_6 (ref (exact $A)) (struct.new $A
- ;; CHECK-NEXT:  (global.get $ctor-eval$global_5)
+ ;; CHECK:      (global $ctor-eval$global_3 (ref (exact $A)) (struct.new $A
+ ;; CHECK-NEXT:  (global.get $ctor-eval$global)
  ;; CHECK-NEXT:  (i32.const 1337)
  ;; CHECK-NEXT: ))
 
- ;; CHECK:      (global $a (mut (ref null $A)) (global.get $ctor-eval$global_5))
+ ;; CHECK:      (global $a (mut (ref null $A)) (global.get $ctor-eval$global))
  (global $a (mut (ref null $A)) (ref.null $A))
 
- ;; CHECK:      (global $b (mut (ref null $A)) (global.get $ctor-eval$global_6))
+ ;; CHECK:      (global $b (mut (ref null $A)) (global.get $ctor-eval$global_3))
  (global $b (mut (ref null $A)) (ref.null $A))
 
  (func $test (export "test")
@@ -193,7 +193,7 @@
   )
  )
 
- ;; CHECK:      (export "test" (func $test_3))
+ ;; CHECK:      (export "test" (func $test_2))
 
  ;; CHECK:      (export "keepalive" (func $keepalive))
 
@@ -221,18 +221,18 @@
  )
 )
 
-;; CHECK:      (func $start (type $1)
-;; CHECK-NEXT:  (struct.set $A 0
-;; CHECK-NEXT:   (global.get $ctor-eval$global_5)
-;; CHECK-NEXT:   (global.get $ctor-eval$global_6)
-;; CHECK-NEXT:  )
-;; CHECK-NEXT: )
-
-;; CHECK:      (func $test_3 (type $1)
+;; CHECK:      (func $test_2 (type $1)
 ;; CHECK-NEXT:  (local $a (ref $A))
 ;; CHECK-NEXT:  (local $b (ref $A))
 ;; CHECK-NEXT:  (nop)
 ;; CHECK-NEXT: )
+
+;; CHECK:      (func $start (type $1)
+;; CHECK-NEXT:  (struct.set $A 0
+;; CHECK-NEXT:   (global.get $ctor-eval$global)
+;; CHECK-NEXT:   (global.get $ctor-eval$global_3)
+;; CHECK-NEXT:  )
+;; CHECK-NEXT: )
 (module
  ;; A cycle between two globals of different types. One of them has an
  ;; immutable field in the cycle.
@@ -250,20 +250,20 @@
 
  ;; CHECK:      (type $3 (func (result i32)))
 
- ;; CHECK:      (global $ctor-eval$global_5 (ref (exact $A)) (struct.new $A
+ ;; CHECK:      (global $ctor-eval$global (ref (exact $A)) (struct.new $A
  ;; CHECK-NEXT:  (ref.null none)
  ;; CHECK-NEXT:  (i32.const 42)
  ;; CHECK-NEXT: ))
 
- ;; CHECK:      (global $a (mut (ref null $A)) (global.get $ctor-eval$global_5))
- (global $a (mut (ref null $A)) (ref.null $A))
-
- ;; CHECK:      (global $ctor-eval$global_6 (ref (exact $B)) (struct.new $B
- ;; CHECK-NEXT:  (global.get $ctor-eval$global_5)
+ ;; CHECK:      (global $ctor-eval$global_3 (ref (exact $B)) (struct.new $B
+ ;; CHECK-NEXT:  (global.get $ctor-eval$global)
  ;; CHECK-NEXT:  (i32.const 1337)
  ;; CHECK-NEXT: ))
 
- ;; CHECK:      (global $b (mut (ref null $B)) (global.get $ctor-eval$global_6))
+ ;; CHECK:      (global $a (mut (ref null $A)) (global.get $ctor-eval$global))
+ (global $a (mut (ref null $A)) (ref.null $A))
+
+ ;; CHECK:      (global $b (mut (ref null $B)) (global.get $ctor-eval$global_3))
  (global $b (mut (ref null $B)) (ref.null $B))
 
  (func $test (export "test")
@@ -291,7 +291,7 @@
   )
  )
 
- ;; CHECK:      (export "test" (func $test_3))
+ ;; CHECK:      (export "test" (func $test_2))
 
  ;; CHECK:      (export "keepalive" (func $keepalive))
 
@@ -319,18 +319,18 @@
  )
 )
 
-;; CHECK:      (func $start (type $2)
-;; CHECK-NEXT:  (struct.set $A 0
-;; CHECK-NEXT:   (global.get $ctor-eval$global_5)
-;; CHECK-NEXT:   (global.get $ctor-eval$global_6)
-;; CHECK-NEXT:  )
-;; CHECK-NEXT: )
-
-;; CHECK:      (func $test_3 (type $2)
+;; CHECK:      (func $test_2 (type $2)
 ;; CHECK-NEXT:  (local $a (ref $A))
 ;; CHECK-NEXT:  (local $b (ref $B))
 ;; CHECK-NEXT:  (nop)
 ;; CHECK-NEXT: )
+
+;; CHECK:      (func $start (type $2)
+;; CHECK-NEXT:  (struct.set $A 0
+;; CHECK-NEXT:   (global.get $ctor-eval$global)
+;; CHECK-NEXT:   (global.get $ctor-eval$global_3)
+;; CHECK-NEXT:  )
+;; CHECK-NEXT: )
 (module
  ;; As above, but with the order of globals reversed.
 
@@ -348,19 +348,19 @@
 
  ;; CHECK:      (type $3 (func (result i32)))
 
- ;; CHECK:      (global $ctor-eval$global_5 (ref (exact $A)) (struct.new $A
+ ;; CHECK:      (global $ctor-eval$global_3 (ref (exact $A)) (struct.new $A
  ;; CHECK-NEXT:  (ref.null none)
  ;; CHECK-NEXT:  (i32.const 42)
  ;; CHECK-NEXT: ))
 
- ;; CHECK:      (global $a (mut (ref null $A)) (global.get $ctor-eval$global_5))
-
- ;; CHECK:      (global $ctor-eval$global_6 (ref (exact $B)) (struct.new $B
- ;; CHECK-NEXT:  (global.get $ctor-eval$global_5)
+ ;; CHECK:      (global $ctor-eval$global (ref (exact $B)) (struct.new $B
+ ;; CHECK-NEXT:  (global.get $ctor-eval$global_3)
  ;; CHECK-NEXT:  (i32.const 1337)
  ;; CHECK-NEXT: ))
 
- ;; CHECK:      (global $b (mut (ref null $B)) (global.get $ctor-eval$global_6))
+ ;; CHECK:      (global $a (mut (ref null $A)) (global.get $ctor-eval$global_3))
+
+ ;; CHECK:      (global $b (mut (ref null $B)) (global.get $ctor-eval$global))
  (global $b (mut (ref null $B)) (ref.null $B))
 
  (global $a (mut (ref null $A)) (ref.null $A))
@@ -390,7 +390,7 @@
   )
  )
 
- ;; CHECK:      (export "test" (func $test_3))
+ ;; CHECK:      (export "test" (func $test_2))
 
  ;; CHECK:      (export "keepalive" (func $keepalive))
 
@@ -418,18 +418,18 @@
  )
 )
 
-;; CHECK:      (func $start (type $2)
-;; CHECK-NEXT:  (struct.set $A 0
-;; CHECK-NEXT:   (global.get $ctor-eval$global_5)
-;; CHECK-NEXT:   (global.get $ctor-eval$global_6)
-;; CHECK-NEXT:  )
-;; CHECK-NEXT: )
-
-;; CHECK:      (func $test_3 (type $2)
+;; CHECK:      (func $test_2 (type $2)
 ;; CHECK-NEXT:  (local $a (ref $A))
 ;; CHECK-NEXT:  (local $b (ref $B))
 ;; CHECK-NEXT:  (nop)
 ;; CHECK-NEXT: )
+
+;; CHECK:      (func $start (type $2)
+;; CHECK-NEXT:  (struct.set $A 0
+;; CHECK-NEXT:   (global.get $ctor-eval$global_3)
+;; CHECK-NEXT:   (global.get $ctor-eval$global)
+;; CHECK-NEXT:  )
+;; CHECK-NEXT: )
 (module
   ;; A cycle as above, but with non-nullability rather than immutability.
 
@@ -446,12 +446,17 @@
 
  ;; CHECK:      (type $3 (func (result i32)))
 
- ;; CHECK:      (global $ctor-eval$global_5 (ref (exact $A)) (struct.new $A
+ ;; CHECK:      (global $ctor-eval$global (ref (exact $A)) (struct.new $A
  ;; CHECK-NEXT:  (ref.null none)
  ;; CHECK-NEXT:  (i32.const 42)
  ;; CHECK-NEXT: ))
 
- ;; CHECK:      (global $a (mut (ref null $A)) (global.get $ctor-eval$global_5))
+ ;; CHECK:      (global $ctor-eval$global_3 (ref (exact $B)) (struct.new $B
+ ;; CHECK-NEXT:  (global.get $ctor-eval$global)
+ ;; CHECK-NEXT:  (i32.const 1337)
+ ;; CHECK-NEXT: ))
+
+ ;; CHECK:      (global $a (mut (ref null $A)) (global.get $ctor-eval$global))
  (global $a (mut (ref null $A)) (ref.null $A))
 
  (global $b (mut (ref null $B)) (ref.null $B))
@@ -481,12 +486,7 @@
   )
  )
 
- ;; CHECK:      (global $ctor-eval$global_6 (ref (exact $B)) (struct.new $B
- ;; CHECK-NEXT:  (global.get $ctor-eval$global_5)
- ;; CHECK-NEXT:  (i32.const 1337)
- ;; CHECK-NEXT: ))
-
- ;; CHECK:      (export "test" (func $test_3))
+ ;; CHECK:      (export "test" (func $test_2))
 
  ;; CHECK:      (export "keepalive" (func $keepalive))
 
@@ -504,18 +504,18 @@
  )
 )
 
-;; CHECK:      (func $start (type $2)
-;; CHECK-NEXT:  (struct.set $A 0
-;; CHECK-NEXT:   (global.get $ctor-eval$global_5)
-;; CHECK-NEXT:   (global.get $ctor-eval$global_6)
-;; CHECK-NEXT:  )
-;; CHECK-NEXT: )
-
-;; CHECK:      (func $test_3 (type $2)
+;; CHECK:      (func $test_2 (type $2)
 ;; CHECK-NEXT:  (local $a (ref $A))
 ;; CHECK-NEXT:  (local $b (ref $B))
 ;; CHECK-NEXT:  (nop)
 ;; CHECK-NEXT: )
+
+;; CHECK:      (func $start (type $2)
+;; CHECK-NEXT:  (struct.set $A 0
+;; CHECK-NEXT:   (global.get $ctor-eval$global)
+;; CHECK-NEXT:   (global.get $ctor-eval$global_3)
+;; CHECK-NEXT:  )
+;; CHECK-NEXT: )
 (module
   ;; A cycle as above, but with globals in reverse order and with both non-
   ;; nullability and immutability.
@@ -536,12 +536,17 @@
 
  ;; CHECK:      (type $3 (func (result i32)))
 
- ;; CHECK:      (global $ctor-eval$global_5 (ref (exact $A)) (struct.new $A
+ ;; CHECK:      (global $ctor-eval$global_3 (ref (exact $A)) (struct.new $A
  ;; CHECK-NEXT:  (ref.null none)
  ;; CHECK-NEXT:  (i32.const 42)
  ;; CHECK-NEXT: ))
 
- ;; CHECK:      (global $a (mut (ref null $A)) (global.get $ctor-eval$global_5))
+ ;; CHECK:      (global $ctor-eval$global (ref (exact $B)) (struct.new $B
+ ;; CHECK-NEXT:  (global.get $ctor-eval$global_3)
+ ;; CHECK-NEXT:  (i32.const 1337)
+ ;; CHECK-NEXT: ))
+
+ ;; CHECK:      (global $a (mut (ref null $A)) (global.get $ctor-eval$global_3))
  (global $a (mut (ref null $A)) (ref.null $A))
 
  (func $test (export "test")
@@ -569,12 +574,7 @@
   )
  )
 
- ;; CHECK:      (global $ctor-eval$global_6 (ref (exact $B)) (struct.new $B
- ;; CHECK-NEXT:  (global.get $ctor-eval$global_5)
- ;; CHECK-NEXT:  (i32.const 1337)
- ;; CHECK-NEXT: ))
-
- ;; CHECK:      (export "test" (func $test_3))
+ ;; CHECK:      (export "test" (func $test_2))
 
  ;; CHECK:      (export "keepalive" (func $keepalive))
 
@@ -592,18 +592,18 @@
  )
 )
 
-;; CHECK:      (func $start (type $2)
-;; CHECK-NEXT:  (struct.set $A 0
-;; CHECK-NEXT:   (global.get $ctor-eval$global_5)
-;; CHECK-NEXT:   (global.get $ctor-eval$global_6)
-;; CHECK-NEXT:  )
-;; CHECK-NEXT: )
-
-;; CHECK:      (func $test_3 (type $2)
+;; CHECK:      (func $test_2 (type $2)
 ;; CHECK-NEXT:  (local $a (ref $A))
 ;; CHECK-NEXT:  (local $b (ref $B))
 ;; CHECK-NEXT:  (nop)
 ;; CHECK-NEXT: )
+
+;; CHECK:      (func $start (type $2)
+;; CHECK-NEXT:  (struct.set $A 0
+;; CHECK-NEXT:   (global.get $ctor-eval$global_3)
+;; CHECK-NEXT:   (global.get $ctor-eval$global)
+;; CHECK-NEXT:  )
+;; CHECK-NEXT: )
 (module
  ;; A cycle between three globals.
 
@@ -614,22 +614,22 @@
 
  ;; CHECK:      (type $2 (func (result i32)))
 
- ;; CHECK:      (global $ctor-eval$global_9 (ref (exact $A)) (struct.new $A
+ ;; CHECK:      (global $ctor-eval$global (ref (exact $A)) (struct.new $A
  ;; CHECK-NEXT:  (ref.null none)
  ;; CHECK-NEXT:  (i32.const 42)
  ;; CHECK-NEXT: ))
 
- ;; CHECK:      (global $ctor-eval$global_11 (ref (exact $A)) (struct.new $A
- ;; CHECK-NEXT:  (global.get $ctor-eval$global_9)
+ ;; CHECK:      (global $ctor-eval$global_5 (ref (exact $A)) (struct.new $A
+ ;; CHECK-NEXT:  (global.get $ctor-eval$global)
  ;; CHECK-NEXT:  (i32.const 1337)
  ;; CHECK-NEXT: ))
 
- ;; CHECK:      (global $ctor-eval$global_10 (ref (exact $A)) (struct.new $A
- ;; CHECK-NEXT:  (global.get $ctor-eval$global_11)
+ ;; CHECK:      (global $ctor-eval$global_4 (ref (exact $A)) (struct.new $A
+ ;; CHECK-NEXT:  (global.get $ctor-eval$global_5)
  ;; CHECK-NEXT:  (i32.const 99999)
  ;; CHECK-NEXT: ))
 
- ;; CHECK:      (global $a (mut (ref null $A)) (global.get $ctor-eval$global_9))
+ ;; CHECK:      (global $a (mut (ref null $A)) (global.get $ctor-eval$global))
  (global $a (mut (ref null $A)) (ref.null $A))
 
  (global $b (mut (ref null $A)) (ref.null $A))
@@ -670,7 +670,7 @@
   )
  )
 
- ;; CHECK:      (export "test" (func $test_3))
+ ;; CHECK:      (export "test" (func $test_2))
 
  ;; CHECK:      (export "keepalive" (func $keepalive))
 
@@ -688,19 +688,19 @@
  )
 )
 
-;; CHECK:      (func $start (type $1)
-;; CHECK-NEXT:  (struct.set $A 0
-;; CHECK-NEXT:   (global.get $ctor-eval$global_9)
-;; CHECK-NEXT:   (global.get $ctor-eval$global_10)
-;; CHECK-NEXT:  )
-;; CHECK-NEXT: )
-
-;; CHECK:      (func $test_3 (type $1)
+;; CHECK:      (func $test_2 (type $1)
 ;; CHECK-NEXT:  (local $a (ref $A))
 ;; CHECK-NEXT:  (local $b (ref $A))
 ;; CHECK-NEXT:  (local $c (ref $A))
 ;; CHECK-NEXT:  (nop)
 ;; CHECK-NEXT: )
+
+;; CHECK:      (func $start (type $1)
+;; CHECK-NEXT:  (struct.set $A 0
+;; CHECK-NEXT:   (global.get $ctor-eval$global)
+;; CHECK-NEXT:   (global.get $ctor-eval$global_4)
+;; CHECK-NEXT:  )
+;; CHECK-NEXT: )
 (module
  ;; A cycle between three globals as above, but now using different types and
  ;; also both structs and arrays. Also reverse the order of globals, make
@@ -725,12 +725,25 @@
 
  ;; CHECK:      (type $4 (func (result i32)))
 
- ;; CHECK:      (global $ctor-eval$global_9 (ref (exact $A)) (struct.new $A
+ ;; CHECK:      (global $ctor-eval$global_5 (ref (exact $A)) (struct.new $A
  ;; CHECK-NEXT:  (ref.null none)
  ;; CHECK-NEXT:  (i32.const 42)
  ;; CHECK-NEXT: ))
 
- ;; CHECK:      (global $a (mut (ref null $A)) (global.get $ctor-eval$global_9))
+ ;; CHECK:      (global $ctor-eval$global_4 (ref (exact $B)) (array.new_fixed $B 10
+ ;; CHECK-NEXT:  (global.get $ctor-eval$global_5)
+ ;; CHECK-NEXT:  (global.get $ctor-eval$global_5)
+ ;; CHECK-NEXT:  (global.get $ctor-eval$global_5)
+ ;; CHECK-NEXT:  (global.get $ctor-eval$global_5)
+ ;; CHECK-NEXT:  (global.get $ctor-eval$global_5)
+ ;; CHECK-NEXT:  (global.get $ctor-eval$global_5)
+ ;; CHECK-NEXT:  (global.get $ctor-eval$global_5)
+ ;; CHECK-NEXT:  (global.get $ctor-eval$global_5)
+ ;; CHECK-NEXT:  (global.get $ctor-eval$global_5)
+ ;; CHECK-NEXT:  (global.get $ctor-eval$global_5)
+ ;; CHECK-NEXT: ))
+
+ ;; CHECK:      (global $a (mut (ref null $A)) (global.get $ctor-eval$global_5))
  (global $a (mut (ref null $A)) (ref.null $A))
 
  (func $test (export "test")
@@ -767,25 +780,12 @@
   )
  )
 
- ;; CHECK:      (global $ctor-eval$global_11 (ref (exact $B)) (array.new_fixed $B 10
- ;; CHECK-NEXT:  (global.get $ctor-eval$global_9)
- ;; CHECK-NEXT:  (global.get $ctor-eval$global_9)
- ;; CHECK-NEXT:  (global.get $ctor-eval$global_9)
- ;; CHECK-NEXT:  (global.get $ctor-eval$global_9)
- ;; CHECK-NEXT:  (global.get $ctor-eval$global_9)
- ;; CHECK-NEXT:  (global.get $ctor-eval$global_9)
- ;; CHECK-NEXT:  (global.get $ctor-eval$global_9)
- ;; CHECK-NEXT:  (global.get $ctor-eval$global_9)
- ;; CHECK-NEXT:  (global.get $ctor-eval$global_9)
- ;; CHECK-NEXT:  (global.get $ctor-eval$global_9)
- ;; CHECK-NEXT: ))
-
- ;; CHECK:      (global $ctor-eval$global_10 (ref (exact $C)) (array.new_fixed $C 2
- ;; CHECK-NEXT:  (global.get $ctor-eval$global_11)
- ;; CHECK-NEXT:  (global.get $ctor-eval$global_9)
+ ;; CHECK:      (global $ctor-eval$global (ref (exact $C)) (array.new_fixed $C 2
+ ;; CHECK-NEXT:  (global.get $ctor-eval$global_4)
+ ;; CHECK-NEXT:  (global.get $ctor-eval$global_5)
  ;; CHECK-NEXT: ))
 
- ;; CHECK:      (export "test" (func $test_3))
+ ;; CHECK:      (export "test" (func $test_2))
 
  ;; CHECK:      (export "keepalive" (func $keepalive))
 
@@ -803,19 +803,19 @@
  )
 )
 
-;; CHECK:      (func $start (type $3)
-;; CHECK-NEXT:  (struct.set $A 0
-;; CHECK-NEXT:   (global.get $ctor-eval$global_9)
-;; CHECK-NEXT:   (global.get $ctor-eval$global_10)
-;; CHECK-NEXT:  )
-;; CHECK-NEXT: )
-
-;; CHECK:      (func $test_3 (type $3)
+;; CHECK:      (func $test_2 (type $3)
 ;; CHECK-NEXT:  (local $a (ref $A))
 ;; CHECK-NEXT:  (local $b (ref $B))
 ;; CHECK-NEXT:  (local $c (ref $C))
 ;; CHECK-NEXT:  (nop)
 ;; CHECK-NEXT: )
+
+;; CHECK:      (func $start (type $3)
+;; CHECK-NEXT:  (struct.set $A 0
+;; CHECK-NEXT:   (global.get $ctor-eval$global_5)
+;; CHECK-NEXT:   (global.get $ctor-eval$global)
+;; CHECK-NEXT:  )
+;; CHECK-NEXT: )
 (module
  ;; As above but with the order of globals reversed once more.
 
@@ -833,12 +833,25 @@
 
  ;; CHECK:      (type $4 (func (result i32)))
 
- ;; CHECK:      (global $ctor-eval$global_9 (ref (exact $A)) (struct.new $A
+ ;; CHECK:      (global $ctor-eval$global (ref (exact $A)) (struct.new $A
  ;; CHECK-NEXT:  (ref.null none)
  ;; CHECK-NEXT:  (i32.const 42)
  ;; CHECK-NEXT: ))
 
- ;; CHECK:      (global $a (mut (ref null $A)) (global.get $ctor-eval$global_9))
+ ;; CHECK:      (global $ctor-eval$global_5 (ref (exact $B)) (array.new_fixed $B 10
+ ;; CHECK-NEXT:  (global.get $ctor-eval$global)
+ ;; CHECK-NEXT:  (global.get $ctor-eval$global)
+ ;; CHECK-NEXT:  (global.get $ctor-eval$global)
+ ;; CHECK-NEXT:  (global.get $ctor-eval$global)
+ ;; CHECK-NEXT:  (global.get $ctor-eval$global)
+ ;; CHECK-NEXT:  (global.get $ctor-eval$global)
+ ;; CHECK-NEXT:  (global.get $ctor-eval$global)
+ ;; CHECK-NEXT:  (global.get $ctor-eval$global)
+ ;; CHECK-NEXT:  (global.get $ctor-eval$global)
+ ;; CHECK-NEXT:  (global.get $ctor-eval$global)
+ ;; CHECK-NEXT: ))
+
+ ;; CHECK:      (global $a (mut (ref null $A)) (global.get $ctor-eval$global))
  (global $a (mut (ref null $A)) (ref.null $A))
 
  (global $b (mut (ref null $B)) (ref.null $B))
@@ -879,25 +892,12 @@
   )
  )
 
- ;; CHECK:      (global $ctor-eval$global_11 (ref (exact $B)) (array.new_fixed $B 10
- ;; CHECK-NEXT:  (global.get $ctor-eval$global_9)
- ;; CHECK-NEXT:  (global.get $ctor-eval$global_9)
- ;; CHECK-NEXT:  (global.get $ctor-eval$global_9)
- ;; CHECK-NEXT:  (global.get $ctor-eval$global_9)
- ;; CHECK-NEXT:  (global.get $ctor-eval$global_9)
- ;; CHECK-NEXT:  (global.get $ctor-eval$global_9)
- ;; CHECK-NEXT:  (global.get $ctor-eval$global_9)
- ;; CHECK-NEXT:  (global.get $ctor-eval$global_9)
- ;; CHECK-NEXT:  (global.get $ctor-eval$global_9)
- ;; CHECK-NEXT:  (global.get $ctor-eval$global_9)
- ;; CHECK-NEXT: ))
-
- ;; CHECK:      (global $ctor-eval$global_10 (ref (exact $C)) (array.new_fixed $C 2
- ;; CHECK-NEXT:  (global.get $ctor-eval$global_11)
- ;; CHECK-NEXT:  (global.get $ctor-eval$global_9)
+ ;; CHECK:      (global $ctor-eval$global_4 (ref (exact $C)) (array.new_fixed $C 2
+ ;; CHECK-NEXT:  (global.get $ctor-eval$global_5)
+ ;; CHECK-NEXT:  (global.get $ctor-eval$global)
  ;; CHECK-NEXT: ))
 
- ;; CHECK:      (export "test" (func $test_3))
+ ;; CHECK:      (export "test" (func $test_2))
 
  ;; CHECK:      (export "keepalive" (func $keepalive))
 
@@ -915,19 +915,19 @@
  )
 )
 
-;; CHECK:      (func $start (type $3)
-;; CHECK-NEXT:  (struct.set $A 0
-;; CHECK-NEXT:   (global.get $ctor-eval$global_9)
-;; CHECK-NEXT:   (global.get $ctor-eval$global_10)
-;; CHECK-NEXT:  )
-;; CHECK-NEXT: )
-
-;; CHECK:      (func $test_3 (type $3)
+;; CHECK:      (func $test_2 (type $3)
 ;; CHECK-NEXT:  (local $a (ref $A))
 ;; CHECK-NEXT:  (local $b (ref $B))
 ;; CHECK-NEXT:  (local $c (ref $C))
 ;; CHECK-NEXT:  (nop)
 ;; CHECK-NEXT: )
+
+;; CHECK:      (func $start (type $3)
+;; CHECK-NEXT:  (struct.set $A 0
+;; CHECK-NEXT:   (global.get $ctor-eval$global)
+;; CHECK-NEXT:   (global.get $ctor-eval$global_4)
+;; CHECK-NEXT:  )
+;; CHECK-NEXT: )
 (module
  ;; A cycle between two globals, where some of the fields participate in the
  ;; cycle and some do not.
@@ -944,25 +944,25 @@
 
  ;; CHECK:      (type $3 (func (result anyref)))
 
- ;; CHECK:      (global $ctor-eval$global_11 (ref (exact $A)) (struct.new $A
+ ;; CHECK:      (global $ctor-eval$global_5 (ref (exact $A)) (struct.new $A
  ;; CHECK-NEXT:  (ref.null none)
  ;; CHECK-NEXT:  (ref.null none)
  ;; CHECK-NEXT:  (ref.null none)
  ;; CHECK-NEXT: ))
 
- ;; CHECK:      (global $ctor-eval$global_14 (ref (exact $A)) (struct.new $A
+ ;; CHECK:      (global $ctor-eval$global (ref (exact $A)) (struct.new $A
  ;; CHECK-NEXT:  (ref.null none)
  ;; CHECK-NEXT:  (ref.null none)
  ;; CHECK-NEXT:  (ref.null none)
  ;; CHECK-NEXT: ))
 
- ;; CHECK:      (global $ctor-eval$global_15 (ref (exact $A)) (struct.new $A
+ ;; CHECK:      (global $ctor-eval$global_6 (ref (exact $A)) (struct.new $A
  ;; CHECK-NEXT:  (ref.null none)
  ;; CHECK-NEXT:  (ref.null none)
  ;; CHECK-NEXT:  (ref.null none)
  ;; CHECK-NEXT: ))
 
- ;; CHECK:      (global $a (mut (ref null $A)) (global.get $ctor-eval$global_11))
+ ;; CHECK:      (global $a (mut (ref null $A)) (global.get $ctor-eval$global))
  (global $a (mut (ref null $A)) (ref.null $A))
  (global $b (mut (ref null $B)) (ref.null $B))
 
@@ -994,17 +994,17 @@
   )
  )
 
- ;; CHECK:      (global $ctor-eval$global_13 (ref (exact $B)) (array.new_fixed $B 3
- ;; CHECK-NEXT:  (global.get $ctor-eval$global_14)
- ;; CHECK-NEXT:  (global.get $ctor-eval$global_11)
- ;; CHECK-NEXT:  (global.get $ctor-eval$global_15)
+ ;; CHECK:      (global $ctor-eval$global_4 (ref (exact $B)) (array.new_fixed $B 3
+ ;; CHECK-NEXT:  (global.get $ctor-eval$global_5)
+ ;; CHECK-NEXT:  (global.get $ctor-eval$global)
+ ;; CHECK-NEXT:  (global.get $ctor-eval$global_6)
  ;; CHECK-NEXT: ))
 
- ;; CHECK:      (global $ctor-eval$global_12 (ref (exact $B)) (array.new_fixed $B 0))
+ ;; CHECK:      (global $ctor-eval$global_3 (ref (exact $B)) (array.new_fixed $B 0))
 
- ;; CHECK:      (global $ctor-eval$global_16 (ref (exact $B)) (array.new_fixed $B 0))
+ ;; CHECK:      (global $ctor-eval$global_7 (ref (exact $B)) (array.new_fixed $B 0))
 
- ;; CHECK:      (export "test" (func $test_3))
+ ;; CHECK:      (export "test" (func $test_2))
 
  ;; CHECK:      (export "keepalive" (func $keepalive))
 
@@ -1022,25 +1022,25 @@
  )
 )
 
+;; CHECK:      (func $test_2 (type $2)
+;; CHECK-NEXT:  (local $a (ref $A))
+;; CHECK-NEXT:  (nop)
+;; CHECK-NEXT: )
+
 ;; CHECK:      (func $start (type $2)
 ;; CHECK-NEXT:  (struct.set $A 0
-;; CHECK-NEXT:   (global.get $ctor-eval$global_11)
-;; CHECK-NEXT:   (global.get $ctor-eval$global_12)
+;; CHECK-NEXT:   (global.get $ctor-eval$global)
+;; CHECK-NEXT:   (global.get $ctor-eval$global_3)
 ;; CHECK-NEXT:  )
 ;; CHECK-NEXT:  (struct.set $A 1
-;; CHECK-NEXT:   (global.get $ctor-eval$global_11)
-;; CHECK-NEXT:   (global.get $ctor-eval$global_13)
+;; CHECK-NEXT:   (global.get $ctor-eval$global)
+;; CHECK-NEXT:   (global.get $ctor-eval$global_4)
 ;; CHECK-NEXT:  )
 ;; CHECK-NEXT:  (struct.set $A 2
-;; CHECK-NEXT:   (global.get $ctor-eval$global_11)
-;; CHECK-NEXT:   (global.get $ctor-eval$global_16)
+;; CHECK-NEXT:   (global.get $ctor-eval$global)
+;; CHECK-NEXT:   (global.get $ctor-eval$global_7)
 ;; CHECK-NEXT:  )
 ;; CHECK-NEXT: )
-
-;; CHECK:      (func $test_3 (type $2)
-;; CHECK-NEXT:  (local $a (ref $A))
-;; CHECK-NEXT:  (nop)
-;; CHECK-NEXT: )
 (module
  ;; As above, with the cycle creation logic reversed.
 
@@ -1056,23 +1056,23 @@
 
  ;; CHECK:      (type $3 (func (result anyref)))
 
- ;; CHECK:      (global $ctor-eval$global_11 (ref (exact $B)) (array.new_fixed $B 3
+ ;; CHECK:      (global $ctor-eval$global_3 (ref (exact $B)) (array.new_fixed $B 0))
+
+ ;; CHECK:      (global $ctor-eval$global_4 (ref (exact $B)) (array.new_fixed $B 3
  ;; CHECK-NEXT:  (ref.null none)
  ;; CHECK-NEXT:  (ref.null none)
  ;; CHECK-NEXT:  (ref.null none)
  ;; CHECK-NEXT: ))
 
- ;; CHECK:      (global $ctor-eval$global_14 (ref (exact $B)) (array.new_fixed $B 0))
-
- ;; CHECK:      (global $ctor-eval$global_15 (ref (exact $B)) (array.new_fixed $B 0))
+ ;; CHECK:      (global $ctor-eval$global_7 (ref (exact $B)) (array.new_fixed $B 0))
 
- ;; CHECK:      (global $ctor-eval$global_13 (ref (exact $A)) (struct.new $A
- ;; CHECK-NEXT:  (global.get $ctor-eval$global_14)
- ;; CHECK-NEXT:  (global.get $ctor-eval$global_11)
- ;; CHECK-NEXT:  (global.get $ctor-eval$global_15)
+ ;; CHECK:      (global $ctor-eval$global (ref (exact $A)) (struct.new $A
+ ;; CHECK-NEXT:  (global.get $ctor-eval$global_3)
+ ;; CHECK-NEXT:  (global.get $ctor-eval$global_4)
+ ;; CHECK-NEXT:  (global.get $ctor-eval$global_7)
  ;; CHECK-NEXT: ))
 
- ;; CHECK:      (global $a (mut (ref null $A)) (global.get $ctor-eval$global_13))
+ ;; CHECK:      (global $a (mut (ref null $A)) (global.get $ctor-eval$global))
  (global $a (mut (ref null $A)) (ref.null $A))
  (global $b (mut (ref null $B)) (ref.null $B))
 
@@ -1105,19 +1105,19 @@
   )
  )
 
- ;; CHECK:      (global $ctor-eval$global_12 (ref (exact $A)) (struct.new $A
+ ;; CHECK:      (global $ctor-eval$global_5 (ref (exact $A)) (struct.new $A
  ;; CHECK-NEXT:  (ref.null none)
  ;; CHECK-NEXT:  (ref.null none)
  ;; CHECK-NEXT:  (ref.null none)
  ;; CHECK-NEXT: ))
 
- ;; CHECK:      (global $ctor-eval$global_16 (ref (exact $A)) (struct.new $A
+ ;; CHECK:      (global $ctor-eval$global_6 (ref (exact $A)) (struct.new $A
  ;; CHECK-NEXT:  (ref.null none)
  ;; CHECK-NEXT:  (ref.null none)
  ;; CHECK-NEXT:  (ref.null none)
  ;; CHECK-NEXT: ))
 
- ;; CHECK:      (export "test" (func $test_3))
+ ;; CHECK:      (export "test" (func $test_2))
 
  ;; CHECK:      (export "keepalive" (func $keepalive))
 
@@ -1135,28 +1135,28 @@
  )
 )
 
+;; CHECK:      (func $test_2 (type $2)
+;; CHECK-NEXT:  (local $b (ref $B))
+;; CHECK-NEXT:  (nop)
+;; CHECK-NEXT: )
+
 ;; CHECK:      (func $start (type $2)
 ;; CHECK-NEXT:  (array.set $B
-;; CHECK-NEXT:   (global.get $ctor-eval$global_11)
+;; CHECK-NEXT:   (global.get $ctor-eval$global_4)
 ;; CHECK-NEXT:   (i32.const 0)
-;; CHECK-NEXT:   (global.get $ctor-eval$global_12)
+;; CHECK-NEXT:   (global.get $ctor-eval$global_5)
 ;; CHECK-NEXT:  )
 ;; CHECK-NEXT:  (array.set $B
-;; CHECK-NEXT:   (global.get $ctor-eval$global_11)
+;; CHECK-NEXT:   (global.get $ctor-eval$global_4)
 ;; CHECK-NEXT:   (i32.const 1)
-;; CHECK-NEXT:   (global.get $ctor-eval$global_13)
+;; CHECK-NEXT:   (global.get $ctor-eval$global)
 ;; CHECK-NEXT:  )
 ;; CHECK-NEXT:  (array.set $B
-;; CHECK-NEXT:   (global.get $ctor-eval$global_11)
+;; CHECK-NEXT:   (global.get $ctor-eval$global_4)
 ;; CHECK-NEXT:   (i32.const 2)
-;; CHECK-NEXT:   (global.get $ctor-eval$global_16)
+;; CHECK-NEXT:   (global.get $ctor-eval$global_6)
 ;; CHECK-NEXT:  )
 ;; CHECK-NEXT: )
-
-;; CHECK:      (func $test_3 (type $2)
-;; CHECK-NEXT:  (local $b (ref $B))
-;; CHECK-NEXT:  (nop)
-;; CHECK-NEXT: )
 (module
  ;; The start function already exists here. We must *not* prepend to it: it gets
  ;; evalled away too (we execute it before the first ctor, and we should not
@@ -1169,12 +1169,12 @@
 
  ;; CHECK:      (type $2 (func (result i32)))
 
- ;; CHECK:      (global $ctor-eval$global_3 (ref (exact $A)) (struct.new $A
+ ;; CHECK:      (global $ctor-eval$global (ref (exact $A)) (struct.new $A
  ;; CHECK-NEXT:  (ref.null none)
  ;; CHECK-NEXT:  (i32.const 42)
  ;; CHECK-NEXT: ))
 
- ;; CHECK:      (global $a (mut (ref null $A)) (global.get $ctor-eval$global_3))
+ ;; CHECK:      (global $a (mut (ref null $A)) (global.get $ctor-eval$global))
  (global $a (mut (ref null $A)) (ref.null $A))
 
  ;; CHECK:      (global $b (mut (ref null $A)) (ref.null none))
@@ -1198,11 +1198,11 @@
   )
  )
 
- ;; CHECK:      (export "test" (func $test_4))
+ ;; CHECK:      (export "test" (func $test_3))
 
  ;; CHECK:      (export "keepalive" (func $keepalive))
 
- ;; CHECK:      (start $start_3)
+ ;; CHECK:      (start $start_4)
 
  ;; CHECK:      (func $keepalive (type $2) (result i32)
  ;; CHECK-NEXT:  (i32.add
@@ -1232,17 +1232,17 @@
  )
 )
 
-;; CHECK:      (func $start_3 (type $1)
-;; CHECK-NEXT:  (struct.set $A 0
-;; CHECK-NEXT:   (global.get $ctor-eval$global_3)
-;; CHECK-NEXT:   (global.get $ctor-eval$global_3)
-;; CHECK-NEXT:  )
-;; CHECK-NEXT: )
-
-;; CHECK:      (func $test_4 (type $1)
+;; CHECK:      (func $test_3 (type $1)
 ;; CHECK-NEXT:  (local $a (ref $A))
 ;; CHECK-NEXT:  (nop)
 ;; CHECK-NEXT: )
+
+;; CHECK:      (func $start_4 (type $1)
+;; CHECK-NEXT:  (struct.set $A 0
+;; CHECK-NEXT:   (global.get $ctor-eval$global)
+;; CHECK-NEXT:   (global.get $ctor-eval$global)
+;; CHECK-NEXT:  )
+;; CHECK-NEXT: )
 (module
  ;; CHECK:      (type $A (struct (field (mut (ref null $A)))))
  (type $A (struct (field (mut (ref null $A)))))
@@ -1297,33 +1297,14 @@
  ;; above, we cannot break up such cycles, and must give up. We should at least
  ;; not error.
 
- ;; CHECK:      (type $array (array i8))
  (type $array  (array i8))
+ ;; CHECK:      (type $0 (func))
+
  ;; CHECK:      (type $struct (struct (field (mut (ref any)))))
  (type $struct (struct (field (mut (ref any)))))
 
- ;; CHECK:      (type $2 (func))
-
- ;; CHECK:      (global $global (mut i32) (i32.const 42))
  (global $global (mut i32) (i32.const 42))
 
- ;; CHECK:      (export "test" (func $test))
-
- ;; CHECK:      (func $test (type $2)
- ;; CHECK-NEXT:  (local $temp (ref $struct))
- ;; CHECK-NEXT:  (global.set $global
- ;; CHECK-NEXT:   (i32.const 1337)
- ;; CHECK-NEXT:  )
- ;; CHECK-NEXT:  (local.set $temp
- ;; CHECK-NEXT:   (struct.new $struct
- ;; CHECK-NEXT:    (array.new_fixed $array 0)
- ;; CHECK-NEXT:   )
- ;; CHECK-NEXT:  )
- ;; CHECK-NEXT:  (struct.set $struct 0
- ;; CHECK-NEXT:   (local.get $temp)
- ;; CHECK-NEXT:   (local.get $temp)
- ;; CHECK-NEXT:  )
- ;; CHECK-NEXT: )
  (func $test (export "test")
   (local $temp (ref $struct))
 
@@ -1348,3 +1329,9 @@
  )
 )
 
+;; CHECK:      (export "test" (func $test_1))
+
+;; CHECK:      (func $test_1 (type $0)
+;; CHECK-NEXT:  (local $temp (ref $struct))
+;; CHECK-NEXT:  (nop)
+;; CHECK-NEXT: )
@@ -0,0 +1,57 @@
+;; NOTE: Assertions have been generated by update_lit_checks.py --all-items and should not be edited.
+;; RUN: wasm-ctor-eval %s --ctors=ctor --kept-exports=ctor --quiet -all -S -o - | filecheck %s
+
+;; The first item of the ctor can be evalled. The second writes to the array
+;; using string.encode_wtf16_array before it fails, and that write may not be
+;; applied: we roll back to the state after the first item, in which only the
+;; last element of the array is set.
+
+(module
+ ;; CHECK:      (type $array (array (mut i16)))
+ (type $array (array (mut i16)))
+
+ ;; CHECK:      (type $1 (func))
+
+ ;; CHECK:      (import "a" "b" (func $import (type $1)))
+ (import "a" "b" (func $import))
+
+ ;; CHECK:      (global $ctor-eval$global (ref (exact $array)) (array.new_fixed $array 3
+ ;; CHECK-NEXT:  (i32.const 0)
+ ;; CHECK-NEXT:  (i32.const 0)
+ ;; CHECK-NEXT:  (i32.const 7)
+ ;; CHECK-NEXT: ))
+
+ ;; CHECK:      (global $array (ref $array) (global.get $ctor-eval$global))
+ (global $array (ref $array) (array.new_default $array (i32.const 3)))
+
+ (func $ctor (export "ctor")
+  (array.set $array (global.get $array) (i32.const 2) (i32.const 7))
+  (call $helper)
+ )
+
+ ;; CHECK:      (export "ctor" (func $ctor_3))
+
+ ;; CHECK:      (func $helper (type $1)
+ ;; CHECK-NEXT:  (drop
+ ;; CHECK-NEXT:   (string.encode_wtf16_array
+ ;; CHECK-NEXT:    (string.const "abc")
+ ;; CHECK-NEXT:    (global.get $array)
+ ;; CHECK-NEXT:    (i32.const 0)
+ ;; CHECK-NEXT:   )
+ ;; CHECK-NEXT:  )
+ ;; CHECK-NEXT:  (call $import)
+ ;; CHECK-NEXT: )
+ (func $helper
+  (drop
+   (string.encode_wtf16_array
+    (string.const "abc")
+    (global.get $array)
+    (i32.const 0)
+   )
+  )
+  (call $import)
+ )
+)
+;; CHECK:      (func $ctor_3 (type $1)
+;; CHECK-NEXT:  (call $helper)
+;; CHECK-NEXT: )
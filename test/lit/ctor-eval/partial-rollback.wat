@@ -0,0 +1,69 @@
+;; NOTE: Assertions have been generated by update_lit_checks.py --all-items and should not be edited.
+;; RUN: wasm-ctor-eval %s --ctors=first,second --kept-exports=second --quiet -all -S -o - | filecheck %s
+
+;; The first ctor and the first item of the second can be evalled. The second
+;; item of the second ctor writes to memory, a global and a struct before it
+;; fails, and none of those writes may be applied: we roll back to the state
+;; after the first item, in which the memory, the global and the struct all
+;; contain 2.
+
+(module
+ ;; CHECK:      (type $struct (struct (field (mut i32))))
+ (type $struct (struct (field (mut i32))))
+
+ ;; CHECK:      (type $1 (func))
+
+ ;; CHECK:      (import "a" "b" (func $import (type $1)))
+ (import "a" "b" (func $import))
+
+ ;; CHECK:      (global $ctor-eval$global (ref (exact $struct)) (struct.new $struct
+ ;; CHECK-NEXT:  (i32.const 2)
+ ;; CHECK-NEXT: ))
+
+ ;; CHECK:      (global $ref (ref $struct) (global.get $ctor-eval$global))
+
+ ;; CHECK:      (global $global (mut i32) (i32.const 2))
+
+ ;; CHECK:      (memory $memory 1 1)
+ (memory $memory 1 1)
+
+ (global $global (mut i32) (i32.const 0))
+
+ (global $ref (ref $struct) (struct.new $struct (i32.const 0)))
+
+ (func $first (export "first")
+  (i32.store (i32.const 8) (i32.const 1))
+  (global.set $global (i32.const 1))
+  (struct.set $struct 0 (global.get $ref) (i32.const 1))
+ )
+
+ (func $second (export "second")
+  (i32.store (i32.const 8) (i32.const 2))
+  (global.set $global (i32.const 2))
+  (struct.set $struct 0 (global.get $ref) (i32.const 2))
+  (block
+   (i32.store (i32.const 8) (i32.const 3))
+   (global.set $global (i32.const 3))
+   (struct.set $struct 0 (global.get $ref) (i32.const 3))
+   (call $import)
+  )
+ )
+)
+;; CHECK:      (data $0 (i32.const 8) "\02")
+
+;; CHECK:      (export "second" (func $second_3))
+
+;; CHECK:      (func $second_3 (type $1)
+;; CHECK-NEXT:  (i32.store
+;; CHECK-NEXT:   (i32.const 8)
+;; CHECK-NEXT:   (i32.const 3)
+;; CHECK-NEXT:  )
+;; CHECK-NEXT:  (global.set $global
+;; CHECK-NEXT:   (i32.const 3)
+;; CHECK-NEXT:  )
+;; CHECK-NEXT:  (struct.set $struct 0
+;; CHECK-NEXT:   (global.get $ref)
+;; CHECK-NEXT:   (i32.const 3)
+;; CHECK-NEXT:  )
+;; CHECK-NEXT:  (call $import)
+;; CHECK-NEXT: )
@@ -24,11 +24,11 @@
 
  ;; CHECK:      (type $3 (func (result i32)))
 
- ;; CHECK:      (global $ctor-eval$global_4 (ref (exact $A)) (struct.new $A
+ ;; CHECK:      (global $ctor-eval$global (ref (exact $A)) (struct.new $A
  ;; CHECK-NEXT:  (ref.null (shared none))
  ;; CHECK-NEXT: ))
 
- ;; CHECK:      (global $ctor-eval$global_5 (ref (exact $B)) (struct.new $B
+ ;; CHECK:      (global $ctor-eval$global_3 (ref (exact $B)) (struct.new $B
  ;; CHECK-NEXT:  (ref.null (shared none))
  ;; CHECK-NEXT: ))
 
@@ -61,9 +61,9 @@
 
  ;; CHECK:      (export "keepalive" (func $keepalive))
 
- ;; CHECK:      (export "s" (func $s_5))
+ ;; CHECK:      (export "s" (func $s_4))
 
- ;; CHECK:      (export "t" (func $t_4))
+ ;; CHECK:      (export "t" (func $t_3))
 
  ;; CHECK:      (start $start)
 
@@ -76,17 +76,17 @@
  )
 )
 
-;; CHECK:      (func $start (type $2)
-;; CHECK-NEXT:  (struct.set $A 0
-;; CHECK-NEXT:   (global.get $ctor-eval$global_4)
-;; CHECK-NEXT:   (global.get $ctor-eval$global_5)
-;; CHECK-NEXT:  )
+;; CHECK:      (func $t_3 (type $2)
+;; CHECK-NEXT:  (nop)
 ;; CHECK-NEXT: )
 
-;; CHECK:      (func $t_4 (type $2)
+;; CHECK:      (func $s_4 (type $2)
 ;; CHECK-NEXT:  (nop)
 ;; CHECK-NEXT: )
 
-;; CHECK:      (func $s_5 (type $2)
-;; CHECK-NEXT:  (nop)
+;; CHECK:      (func $start (type $2)
+;; CHECK-NEXT:  (struct.set $A 0
+;; CHECK-NEXT:   (global.get $ctor-eval$global)
+;; CHECK-NEXT:   (global.get $ctor-eval$global_3)
+;; CHECK-NEXT:  )
 ;; CHECK-NEXT: )
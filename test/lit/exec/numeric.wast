@@ -0,0 +1,440 @@
+;; NOTE: Assertions have been generated by update_lit_checks.py --output=fuzz-exec and should not be edited.
+;; RUN: wasm-opt %s -all --fuzz-exec -o /dev/null 2>&1 | filecheck %s
+
+;; Trees of numeric operations, local.gets and loads are evaluated on unboxed
+;; values. Check that they trap and handle edge cases like the rest of the
+;; interpreter.
+
+(module
+ (memory 1 1)
+
+ (data (i32.const 65528) "\01\02\03\04\05\06\07\80")
+
+ ;; CHECK:      [fuzz-exec] export div-s-by-zero
+ ;; CHECK-NEXT: [trap i32.div_s by 0]
+ (func $div-s-by-zero (export "div-s-by-zero") (result i32)
+  (local $x i32)
+  (local.set $x (i32.const 0))
+  (i32.div_s
+   (i32.const 1)
+   (local.get $x)
+  )
+ )
+
+ ;; CHECK:      [fuzz-exec] export div-u-by-zero-i64
+ ;; CHECK-NEXT: [trap i64.div_u by 0]
+ (func $div-u-by-zero-i64 (export "div-u-by-zero-i64") (result i64)
+  (i64.div_u
+   (i64.const 1)
+   (i64.const 0)
+  )
+ )
+
+ ;; CHECK:      [fuzz-exec] export rem-u-by-zero
+ ;; CHECK-NEXT: [trap i32.rem_u by 0]
+ (func $rem-u-by-zero (export "rem-u-by-zero") (result i32)
+  (i32.rem_u
+   (i32.const 1)
+   (i32.const 0)
+  )
+ )
+
+ ;; CHECK:      [fuzz-exec] export rem-s-by-zero-i64
+ ;; CHECK-NEXT: [trap i64.rem_s by 0]
+ (func $rem-s-by-zero-i64 (export "rem-s-by-zero-i64") (result i64)
+  (i64.rem_s
+   (i64.const 1)
+   (i64.const 0)
+  )
+ )
+
+ ;; CHECK:      [fuzz-exec] export div-s-overflow
+ ;; CHECK-NEXT: [trap i32.div_s overflow]
+ (func $div-s-overflow (export "div-s-overflow") (result i32)
+  (local $x i32)
+  (local.set $x (i32.const -1))
+  (i32.div_s
+   (i32.const 0x80000000)
+   (local.get $x)
+  )
+ )
+
+ ;; CHECK:      [fuzz-exec] export div-s-overflow-i64
+ ;; CHECK-NEXT: [trap i64.div_s overflow]
+ (func $div-s-overflow-i64 (export "div-s-overflow-i64") (result i64)
+  (i64.div_s
+   (i64.const 0x8000000000000000)
+   (i64.const -1)
+  )
+ )
+
+ ;; CHECK:      [fuzz-exec] export rem-s-min
+ ;; CHECK-NEXT: [fuzz-exec] note result: rem-s-min => 0
+ (func $rem-s-min (export "rem-s-min") (result i32)
+  ;; This does not trap, unlike the division.
+  (i32.rem_s
+   (i32.const 0x80000000)
+   (i32.const -1)
+  )
+ )
+
+ ;; CHECK:      [fuzz-exec] export rem-s-min-i64
+ ;; CHECK-NEXT: [fuzz-exec] note result: rem-s-min-i64 => 0
+ (func $rem-s-min-i64 (export "rem-s-min-i64") (result i64)
+  (i64.rem_s
+   (i64.const 0x8000000000000000)
+   (i64.const -1)
+  )
+ )
+
+ ;; CHECK:      [fuzz-exec] export div-rem-signs
+ ;; CHECK-NEXT: [fuzz-exec] note result: div-rem-signs => -31
+ (func $div-rem-signs (export "div-rem-signs") (result i32)
+  ;; -7 / 2 rounds towards zero, and -7 % 2 has the sign of the dividend, so
+  ;; this is -3 * 10 + -1 = -31.
+  (i32.add
+   (i32.mul
+    (i32.div_s
+     (i32.const -7)
+     (i32.const 2)
+    )
+    (i32.const 10)
+   )
+   (i32.rem_s
+    (i32.const -7)
+    (i32.const 2)
+   )
+  )
+ )
+
+ ;; CHECK:      [fuzz-exec] export div-u-large
+ ;; CHECK-NEXT: [fuzz-exec] note result: div-u-large => 9223372036854775807
+ (func $div-u-large (export "div-u-large") (result i64)
+  (i64.div_u
+   (i64.const -1)
+   (i64.const 2)
+  )
+ )
+
+ ;; CHECK:      [fuzz-exec] export trunc-overflow
+ ;; CHECK-NEXT: [trap i32.truncSFloat overflow]
+ (func $trunc-overflow (export "trunc-overflow") (result i32)
+  (i32.trunc_f32_s
+   (f32.const 2147483648)
+  )
+ )
+
+ ;; CHECK:      [fuzz-exec] export trunc-overflow-u-i64
+ ;; CHECK-NEXT: [trap i64.truncUFloat overflow]
+ (func $trunc-overflow-u-i64 (export "trunc-overflow-u-i64") (result i64)
+  (i64.trunc_f64_u
+   (f64.const -1)
+  )
+ )
+
+ ;; CHECK:      [fuzz-exec] export trunc-nan
+ ;; CHECK-NEXT: [trap truncUFloat of nan]
+ (func $trunc-nan (export "trunc-nan") (result i32)
+  (i32.trunc_f64_u
+   (f64.const nan)
+  )
+ )
+
+ ;; CHECK:      [fuzz-exec] export trunc-edge
+ ;; CHECK-NEXT: [fuzz-exec] note result: trunc-edge => -2147483648
+ (func $trunc-edge (export "trunc-edge") (result i32)
+  ;; The largest magnitude that fits, and a value just above -1 that truncates
+  ;; to 0, which is valid for an unsigned conversion.
+  (i32.add
+   (i32.trunc_f64_s
+    (f64.const -2147483648.9)
+   )
+   (i32.trunc_f64_u
+    (f64.const -0.9)
+   )
+  )
+ )
+
+ ;; CHECK:      [fuzz-exec] export trunc-sat
+ ;; CHECK-NEXT: [fuzz-exec] note result: trunc-sat => 9223372036854775807
+ (func $trunc-sat (export "trunc-sat") (result i64)
+  (i64.add
+   (i64.trunc_sat_f32_s
+    (f32.const 1e30)
+   )
+   (i64.extend_i32_s
+    (i32.trunc_sat_f64_u
+     (f64.const nan)
+    )
+   )
+  )
+ )
+
+ ;; CHECK:      [fuzz-exec] export shifts
+ ;; CHECK-NEXT: [fuzz-exec] note result: shifts => -2
+ (func $shifts (export "shifts") (result i32)
+  ;; Shift counts are taken modulo the number of bits: 1 << 33 is 2, and
+  ;; -16 >> 34 (signed) is -4.
+  (i32.add
+   (i32.shl
+    (i32.const 1)
+    (i32.const 33)
+   )
+   (i32.shr_s
+    (i32.const -16)
+    (i32.const 34)
+   )
+  )
+ )
+
+ ;; CHECK:      [fuzz-exec] export rotates
+ ;; CHECK-NEXT: [fuzz-exec] note result: rotates => -9223372036854775805
+ (func $rotates (export "rotates") (result i64)
+  (i64.xor
+   (i64.rotl
+    (i64.const 0x8000000000000001)
+    (i64.const 65)
+   )
+   (i64.rotr
+    (i64.const 1)
+    (i64.const 1)
+   )
+  )
+ )
+
+ ;; CHECK:      [fuzz-exec] export bits
+ ;; CHECK-NEXT: [fuzz-exec] note result: bits => 97
+ (func $bits (export "bits") (result i32)
+  ;; 32 + 64 (wrapped) + 1.
+  (i32.add
+   (i32.add
+    (i32.clz
+     (i32.const 0)
+    )
+    (i32.wrap_i64
+     (i64.ctz
+      (i64.const 0)
+     )
+    )
+   )
+   (i32.popcnt
+    (i32.const 0x80000000)
+   )
+  )
+ )
+
+ ;; CHECK:      [fuzz-exec] export extends
+ ;; CHECK-NEXT: [fuzz-exec] note result: extends => 4294967167
+ (func $extends (export "extends") (result i64)
+  ;; -128 + 0xffffffff.
+  (i64.add
+   (i64.extend8_s
+    (i64.const 0x80)
+   )
+   (i64.extend_i32_u
+    (i32.const -1)
+   )
+  )
+ )
+
+ ;; CHECK:      [fuzz-exec] export compare-unsigned
+ ;; CHECK-NEXT: [fuzz-exec] note result: compare-unsigned => 1
+ (func $compare-unsigned (export "compare-unsigned") (result i32)
+  (i32.add
+   (i32.lt_u
+    (i32.const -1)
+    (i32.const 1)
+   )
+   (i64.gt_s
+    (i64.const 1)
+    (i64.const -1)
+   )
+  )
+ )
+
+ ;; CHECK:      [fuzz-exec] export load-last
+ ;; CHECK-NEXT: [fuzz-exec] note result: load-last => -2147023355
+ (func $load-last (export "load-last") (result i32)
+  (i32.load
+   (i32.const 65532)
+  )
+ )
+
+ ;; CHECK:      [fuzz-exec] export load-signed
+ ;; CHECK-NEXT: [fuzz-exec] note result: load-signed => -128
+ (func $load-signed (export "load-signed") (result i64)
+  (i64.load8_s
+   (i32.const 65535)
+  )
+ )
+
+ ;; CHECK:      [fuzz-exec] export load-oob
+ ;; CHECK-NEXT: [trap highest > memory: 65535 > 65532]
+ (func $load-oob (export "load-oob") (result i32)
+  ;; Only the first byte is in bounds.
+  (i32.load
+   (i32.const 65535)
+  )
+ )
+
+ ;; CHECK:      [fuzz-exec] export load-oob-offset
+ ;; CHECK-NEXT: [trap highest > memory: 65536 > 65532]
+ (func $load-oob-offset (export "load-oob-offset") (result i32)
+  ;; The address is in bounds, but adding the offset is not.
+  (i32.load offset=65536
+   (i32.const 0)
+  )
+ )
+
+ ;; CHECK:      [fuzz-exec] export load-oob-wrap
+ ;; CHECK-NEXT: [trap offset > memory: 4294967295 > 65536]
+ (func $load-oob-wrap (export "load-oob-wrap") (result i64)
+  ;; The address plus the offset does not wrap around.
+  (i64.load offset=4294967295
+   (i32.const 1)
+  )
+ )
+
+ ;; CHECK:      [fuzz-exec] export load-oob-in-tree
+ ;; CHECK-NEXT: [trap highest > memory: 65536 > 65535]
+ (func $load-oob-in-tree (export "load-oob-in-tree") (result i32)
+  ;; A trap in a load deep in a tree stops the whole tree.
+  (local $x i32)
+  (local.set $x (i32.const 65536))
+  (i32.add
+   (i32.const 1)
+   (i32.mul
+    (i32.load8_u
+     (local.get $x)
+    )
+    (i32.const 2)
+   )
+  )
+ )
+
+ ;; CHECK:      [fuzz-exec] export float-tree
+ ;; CHECK-NEXT: [fuzz-exec] note result: float-tree => inf
+ ;; CHECK-NEXT: warning: no passes specified, not doing any work
+ (func $float-tree (export "float-tree") (result f64)
+  (f64.add
+   (f64.convert_i64_s
+    (i64.load
+     (i32.const 65528)
+    )
+   )
+   (f64.promote_f32
+    (f32.div
+     (f32.const 1)
+     (f32.const 0)
+    )
+   )
+  )
+ )
+)
+;; CHECK:      [fuzz-exec] export div-s-by-zero
+;; CHECK-NEXT: [trap i32.div_s by 0]
+
+;; CHECK:      [fuzz-exec] export div-u-by-zero-i64
+;; CHECK-NEXT: [trap i64.div_u by 0]
+
+;; CHECK:      [fuzz-exec] export rem-u-by-zero
+;; CHECK-NEXT: [trap i32.rem_u by 0]
+
+;; CHECK:      [fuzz-exec] export rem-s-by-zero-i64
+;; CHECK-NEXT: [trap i64.rem_s by 0]
+
+;; CHECK:      [fuzz-exec] export div-s-overflow
+;; CHECK-NEXT: [trap i32.div_s overflow]
+
+;; CHECK:      [fuzz-exec] export div-s-overflow-i64
+;; CHECK-NEXT: [trap i64.div_s overflow]
+
+;; CHECK:      [fuzz-exec] export rem-s-min
+;; CHECK-NEXT: [fuzz-exec] note result: rem-s-min => 0
+
+;; CHECK:      [fuzz-exec] export rem-s-min-i64
+;; CHECK-NEXT: [fuzz-exec] note result: rem-s-min-i64 => 0
+
+;; CHECK:      [fuzz-exec] export div-rem-signs
+;; CHECK-NEXT: [fuzz-exec] note result: div-rem-signs => -31
+
+;; CHECK:      [fuzz-exec] export div-u-large
+;; CHECK-NEXT: [fuzz-exec] note result: div-u-large => 9223372036854775807
+
+;; CHECK:      [fuzz-exec] export trunc-overflow
+;; CHECK-NEXT: [trap i32.truncSFloat overflow]
+
+;; CHECK:      [fuzz-exec] export trunc-overflow-u-i64
+;; CHECK-NEXT: [trap i64.truncUFloat overflow]
+
+;; CHECK:      [fuzz-exec] export trunc-nan
+;; CHECK-NEXT: [trap truncUFloat of nan]
+
+;; CHECK:      [fuzz-exec] export trunc-edge
+;; CHECK-NEXT: [fuzz-exec] note result: trunc-edge => -2147483648
+
+;; CHECK:      [fuzz-exec] export trunc-sat
+;; CHECK-NEXT: [fuzz-exec] note result: trunc-sat => 9223372036854775807
+
+;; CHECK:      [fuzz-exec] export shifts
+;; CHECK-NEXT: [fuzz-exec] note result: shifts => -2
+
+;; CHECK:      [fuzz-exec] export rotates
+;; CHECK-NEXT: [fuzz-exec] note result: rotates => -9223372036854775805
+
+;; CHECK:      [fuzz-exec] export bits
+;; CHECK-NEXT: [fuzz-exec] note result: bits => 97
+
+;; CHECK:      [fuzz-exec] export extends
+;; CHECK-NEXT: [fuzz-exec] note result: extends => 4294967167
+
+;; CHECK:      [fuzz-exec] export compare-unsigned
+;; CHECK-NEXT: [fuzz-exec] note result: compare-unsigned => 1
+
+;; CHECK:      [fuzz-exec] export load-last
+;; CHECK-NEXT: [fuzz-exec] note result: load-last => -2147023355
+
+;; CHECK:      [fuzz-exec] export load-signed
+;; CHECK-NEXT: [fuzz-exec] note result: load-signed => -128
+
+;; CHECK:      [fuzz-exec] export load-oob
+;; CHECK-NEXT: [trap highest > memory: 65535 > 65532]
+
+;; CHECK:      [fuzz-exec] export load-oob-offset
+;; CHECK-NEXT: [trap highest > memory: 65536 > 65532]
+
+;; CHECK:      [fuzz-exec] export load-oob-wrap
+;; CHECK-NEXT: [trap offset > memory: 4294967295 > 65536]
+
+;; CHECK:      [fuzz-exec] export load-oob-in-tree
+;; CHECK-NEXT: [trap highest > memory: 65536 > 65535]
+
+;; CHECK:      [fuzz-exec] export float-tree
+;; CHECK-NEXT: [fuzz-exec] note result: float-tree => inf
+;; CHECK-NEXT: [fuzz-exec] comparing bits
+;; CHECK-NEXT: [fuzz-exec] comparing compare-unsigned
+;; CHECK-NEXT: [fuzz-exec] comparing div-rem-signs
+;; CHECK-NEXT: [fuzz-exec] comparing div-s-by-zero
+;; CHECK-NEXT: [fuzz-exec] comparing div-s-overflow
+;; CHECK-NEXT: [fuzz-exec] comparing div-s-overflow-i64
+;; CHECK-NEXT: [fuzz-exec] comparing div-u-by-zero-i64
+;; CHECK-NEXT: [fuzz-exec] comparing div-u-large
+;; CHECK-NEXT: [fuzz-exec] comparing extends
+;; CHECK-NEXT: [fuzz-exec] comparing float-tree
+;; CHECK-NEXT: [fuzz-exec] comparing load-last
+;; CHECK-NEXT: [fuzz-exec] comparing load-oob
+;; CHECK-NEXT: [fuzz-exec] comparing load-oob-in-tree
+;; CHECK-NEXT: [fuzz-exec] comparing load-oob-offset
+;; CHECK-NEXT: [fuzz-exec] comparing load-oob-wrap
+;; CHECK-NEXT: [fuzz-exec] comparing load-signed
+;; CHECK-NEXT: [fuzz-exec] comparing rem-s-by-zero-i64
+;; CHECK-NEXT: [fuzz-exec] comparing rem-s-min
+;; CHECK-NEXT: [fuzz-exec] comparing rem-s-min-i64
+;; CHECK-NEXT: [fuzz-exec] comparing rem-u-by-zero
+;; CHECK-NEXT: [fuzz-exec] comparing rotates
+;; CHECK-NEXT: [fuzz-exec] comparing shifts
+;; CHECK-NEXT: [fuzz-exec] comparing trunc-edge
+;; CHECK-NEXT: [fuzz-exec] comparing trunc-nan
+;; CHECK-NEXT: [fuzz-exec] comparing trunc-overflow
+;; CHECK-NEXT: [fuzz-exec] comparing trunc-overflow-u-i64
+;; CHECK-NEXT: [fuzz-exec] comparing trunc-sat
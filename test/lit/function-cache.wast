@@ -0,0 +1,85 @@
+;; Test that --function-cache reuses the results of optimizing functions, and
+;; that the output is the same as without the cache.
+
+;; RUN: rm -rf %t.cache
+;; RUN: wasm-opt %s -O2 -S -o %t.uncached.wat
+;; RUN: env BINARYEN_PASS_STATS=1 wasm-opt %s -O2 --function-cache=%t.cache -S -o %t.first.wat 2>&1 | filecheck %s --check-prefix=FIRST
+;; RUN: env BINARYEN_PASS_STATS=1 wasm-opt %s -O2 --function-cache=%t.cache -S -o %t.second.wat 2>&1 | filecheck %s --check-prefix=SECOND
+;; RUN: wasm-opt %s -O2 --function-cache=%t.cache --function-cache-verify -S -o %t.verified.wat
+;; RUN: diff %t.uncached.wat %t.first.wat
+;; RUN: diff %t.uncached.wat %t.second.wat
+;; RUN: diff %t.uncached.wat %t.verified.wat
+
+;; The first run fills the cache, and the second one uses it for everything.
+;; FIRST:     function cache: 0 hits, {{[1-9][0-9]*}} misses
+;; FIRST-NOT: {{[1-9][0-9]*}} hits
+
+;; SECOND:     function cache: {{[1-9][0-9]*}} hits, 0 misses
+;; SECOND-NOT: {{[1-9][0-9]*}} misses
+
+;; A change to an immutable global that a function reads changes that
+;; function's key.
+;; RUN: sed -e 's/(i32.const 42)/(i32.const 43)/' %s > %t.changed.wast
+;; RUN: env BINARYEN_PASS_STATS=1 wasm-opt %t.changed.wast -O2 --function-cache=%t.cache -S -o %t.changed.wat 2>&1 | filecheck %s --check-prefix=CHANGED
+;; RUN: wasm-opt %t.changed.wast -O2 -S -o %t.changed.uncached.wat
+;; RUN: diff %t.changed.uncached.wat %t.changed.wat
+
+;; CHANGED: function cache: {{[1-9][0-9]*}} hits, {{[1-9][0-9]*}} misses
+
+(module
+  (import "env" "log" (func $log (param i32)))
+
+  (memory $memory 1 1)
+
+  (global $constant i32 (i32.const 42))
+
+  (global $counter (mut i32) (i32.const 0))
+
+  (func $add (export "add") (param $x i32) (param $y i32) (result i32)
+    (local $temp i32)
+    ;;@ src.c:10:3
+    (local.set $temp
+      (i32.add
+        (local.get $x)
+        (local.get $y)
+      )
+    )
+    ;;@ src.c:11:3
+    (call $log
+      (local.get $temp)
+    )
+    (local.get $temp)
+  )
+
+  (func $constant (export "constant") (result i32)
+    (local i32)
+    (local.set 0
+      (global.get $constant)
+    )
+    (i32.mul
+      (local.get 0)
+      (i32.const 2)
+    )
+  )
+
+  (func $count (export "count") (param $n i32)
+    (loop $loop
+      (global.set $counter
+        (i32.add
+          (global.get $counter)
+          (i32.load
+            (local.get $n)
+          )
+        )
+      )
+      (br_if $loop
+        (local.tee $n
+          (i32.sub
+            (local.get $n)
+            (i32.const 1)
+          )
+        )
+      )
+    )
+  )
+)
@@ -0,0 +1,308 @@
+;; The function bodies of a module are read, written and parsed in parallel when
+;; there are several cores. Check that the results are the same as on one core,
+;; on a module with many functions that have debug locations in several files.
+
+;; The binary reader.
+;; RUN: env BINARYEN_CORES=1 wasm-opt %s -g -o %t.wasm \
+;; RUN:   --output-source-map=%t.wasm.map
+;; RUN: env BINARYEN_CORES=1 wasm-opt %t.wasm --input-source-map=%t.wasm.map \
+;; RUN:   -S -o %t.read.serial.wat
+;; RUN: env BINARYEN_CORES=4 wasm-opt %t.wasm --input-source-map=%t.wasm.map \
+;; RUN:   -S -o %t.read.parallel.wat
+;; RUN: diff %t.read.serial.wat %t.read.parallel.wat
+
+;; The binary writer, with and without StackIR. The source maps must match too.
+;; RUN: env BINARYEN_CORES=1 wasm-opt %s -g -o %t.write.serial.wasm \
+;; RUN:   --output-source-map=%t.write.serial.map
+;; RUN: env BINARYEN_CORES=4 wasm-opt %s -g -o %t.write.parallel.wasm \
+;; RUN:   --output-source-map=%t.write.parallel.map
+;; RUN: cmp %t.write.serial.wasm %t.write.parallel.wasm
+;; RUN: cmp %t.write.serial.map %t.write.parallel.map
+;; RUN: env BINARYEN_CORES=1 wasm-opt %s --generate-stack-ir \
+;; RUN:   --optimize-stack-ir -o %t.stack.serial.wasm
+;; RUN: env BINARYEN_CORES=4 wasm-opt %s --generate-stack-ir \
+;; RUN:   --optimize-stack-ir -o %t.stack.parallel.wasm
+;; RUN: cmp %t.stack.serial.wasm %t.stack.parallel.wasm
+
+;; The text parser. The debug info file and symbol indices it assigns are
+;; covered by the source maps above.
+;; RUN: env BINARYEN_CORES=1 wasm-opt %s -S -o %t.parse.serial.wat
+;; RUN: env BINARYEN_CORES=4 wasm-opt %s -S -o %t.parse.parallel.wat
+;; RUN: diff %t.parse.serial.wat %t.parse.parallel.wat
+
+;; When several functions fail to parse, the first error in the file is
+;; reported either way.
+;; RUN: sed -e 's/(f64.const 2.5)/(f64.const x)/' \
+;; RUN:   -e 's/(f64.const 20.5)/(f64.const y)/' %s > %t.bad.wast
+;; RUN: env BINARYEN_CORES=1 not wasm-opt %t.bad.wast 2> %t.bad.serial.txt
+;; RUN: env BINARYEN_CORES=4 not wasm-opt %t.bad.wast 2> %t.bad.parallel.txt
+;; RUN: diff %t.bad.serial.txt %t.bad.parallel.txt
+
+(module
+  (memory 1 1)
+  (global $g (mut i32) (i32.const 0))
+  ;;@ a.c:1:1:f0
+  (func $f0 (param $x i32) (result i32)
+    (local $y i64)
+    ;;@ a.c:1:5
+    (local.set $y (i64.extend_i32_u (local.get $x)))
+    (block $out
+      (loop $l
+        ;;@ b.c:2:3
+        (br_if $out (i64.ge_u (local.get $y) (i64.const 10)))
+        (local.set $y (i64.add (local.get $y) (i64.const 1)))
+        (br $l)
+      )
+    )
+    (i32.wrap_i64 (local.get $y))
+  )
+  ;;@ b.c:2:1
+  (func $f1 (param $x i32) (result i32)
+    (local $y i64)
+    ;;@ b.c:2:7
+    (i32.store offset=4 (local.get $x) (i32.const 1))
+    (global.set $g (i32.add (global.get $g) (i32.const 1)))
+    (if (result i32) (i32.eqz (local.get $x))
+      (then (i32.load offset=4 (local.get $x)))
+      (else (call $f2 (i32.sub (local.get $x) (i32.const 1))))
+    )
+  )
+  ;;@ c.c:3:1
+  (func $f2 (param $x i32) (result i32)
+    (local $y i64)
+    (drop (f64.mul (f64.const 2.5) (f64.convert_i32_s (local.get $x))))
+    ;;@ c.c:3:9
+    (select (call $f3 (local.get $x)) (i32.const 2) (local.get $x))
+  )
+  ;;@ a.c:4:1
+  (func $f3 (param $x i32) (result i32)
+    (local $y i64)
+    ;;@ a.c:4:5
+    (local.set $y (i64.extend_i32_u (local.get $x)))
+    (block $out
+      (loop $l
+        ;;@ b.c:5:3
+        (br_if $out (i64.ge_u (local.get $y) (i64.const 13)))
+        (local.set $y (i64.add (local.get $y) (i64.const 1)))
+        (br $l)
+      )
+    )
+    (i32.wrap_i64 (local.get $y))
+  )
+  ;;@ b.c:5:1:f4
+  (func $f4 (param $x i32) (result i32)
+    (local $y i64)
+    ;;@ b.c:5:7
+    (i32.store offset=16 (local.get $x) (i32.const 4))
+    (global.set $g (i32.add (global.get $g) (i32.const 4)))
+    (if (result i32) (i32.eqz (local.get $x))
+      (then (i32.load offset=16 (local.get $x)))
+      (else (call $f5 (i32.sub (local.get $x) (i32.const 1))))
+    )
+  )
+  ;;@ c.c:6:1
+  (func $f5 (param $x i32) (result i32)
+    (local $y i64)
+    (drop (f64.mul (f64.const 5.5) (f64.convert_i32_s (local.get $x))))
+    ;;@ c.c:6:9
+    (select (call $f6 (local.get $x)) (i32.const 5) (local.get $x))
+  )
+  ;;@ a.c:7:1
+  (func $f6 (param $x i32) (result i32)
+    (local $y i64)
+    ;;@ a.c:7:5
+    (local.set $y (i64.extend_i32_u (local.get $x)))
+    (block $out
+      (loop $l
+        ;;@ b.c:8:3
+        (br_if $out (i64.ge_u (local.get $y) (i64.const 16)))
+        (local.set $y (i64.add (local.get $y) (i64.const 1)))
+        (br $l)
+      )
+    )
+    (i32.wrap_i64 (local.get $y))
+  )
+  ;;@ b.c:8:1
+  (func $f7 (param $x i32) (result i32)
+    (local $y i64)
+    ;;@ b.c:8:7
+    (i32.store offset=28 (local.get $x) (i32.const 7))
+    (global.set $g (i32.add (global.get $g) (i32.const 7)))
+    (if (result i32) (i32.eqz (local.get $x))
+      (then (i32.load offset=28 (local.get $x)))
+      (else (call $f8 (i32.sub (local.get $x) (i32.const 1))))
+    )
+  )
+  ;;@ c.c:9:1:f8
+  (func $f8 (param $x i32) (result i32)
+    (local $y i64)
+    (drop (f64.mul (f64.const 8.5) (f64.convert_i32_s (local.get $x))))
+    ;;@ c.c:9:9
+    (select (call $f9 (local.get $x)) (i32.const 8) (local.get $x))
+  )
+  ;;@ a.c:10:1
+  (func $f9 (param $x i32) (result i32)
+    (local $y i64)
+    ;;@ a.c:10:5
+    (local.set $y (i64.extend_i32_u (local.get $x)))
+    (block $out
+      (loop $l
+        ;;@ b.c:11:3
+        (br_if $out (i64.ge_u (local.get $y) (i64.const 19)))
+        (local.set $y (i64.add (local.get $y) (i64.const 1)))
+        (br $l)
+      )
+    )
+    (i32.wrap_i64 (local.get $y))
+  )
+  ;;@ b.c:11:1
+  (func $f10 (param $x i32) (result i32)
+    (local $y i64)
+    ;;@ b.c:11:7
+    (i32.store offset=40 (local.get $x) (i32.const 10))
+    (global.set $g (i32.add (global.get $g) (i32.const 10)))
+    (if (result i32) (i32.eqz (local.get $x))
+      (then (i32.load offset=40 (local.get $x)))
+      (else (call $f11 (i32.sub (local.get $x) (i32.const 1))))
+    )
+  )
+  ;;@ c.c:12:1
+  (func $f11 (param $x i32) (result i32)
+    (local $y i64)
+    (drop (f64.mul (f64.const 11.5) (f64.convert_i32_s (local.get $x))))
+    ;;@ c.c:12:9
+    (select (call $f12 (local.get $x)) (i32.const 11) (local.get $x))
+  )
+  ;;@ a.c:13:1:f12
+  (func $f12 (param $x i32) (result i32)
+    (local $y i64)
+    ;;@ a.c:13:5
+    (local.set $y (i64.extend_i32_u (local.get $x)))
+    (block $out
+      (loop $l
+        ;;@ b.c:14:3
+        (br_if $out (i64.ge_u (local.get $y) (i64.const 22)))
+        (local.set $y (i64.add (local.get $y) (i64.const 1)))
+        (br $l)
+      )
+    )
+    (i32.wrap_i64 (local.get $y))
+  )
+  ;;@ b.c:14:1
+  (func $f13 (param $x i32) (result i32)
+    (local $y i64)
+    ;;@ b.c:14:7
+    (i32.store offset=52 (local.get $x) (i32.const 13))
+    (global.set $g (i32.add (global.get $g) (i32.const 13)))
+    (if (result i32) (i32.eqz (local.get $x))
+      (then (i32.load offset=52 (local.get $x)))
+      (else (call $f14 (i32.sub (local.get $x) (i32.const 1))))
+    )
+  )
+  ;;@ c.c:15:1
+  (func $f14 (param $x i32) (result i32)
+    (local $y i64)
+    (drop (f64.mul (f64.const 14.5) (f64.convert_i32_s (local.get $x))))
+    ;;@ c.c:15:9
+    (select (call $f15 (local.get $x)) (i32.const 14) (local.get $x))
+  )
+  ;;@ a.c:16:1
+  (func $f15 (param $x i32) (result i32)
+    (local $y i64)
+    ;;@ a.c:16:5
+    (local.set $y (i64.extend_i32_u (local.get $x)))
+    (block $out
+      (loop $l
+        ;;@ b.c:17:3
+        (br_if $out (i64.ge_u (local.get $y) (i64.const 25)))
+        (local.set $y (i64.add (local.get $y) (i64.const 1)))
+        (br $l)
+      )
+    )
+    (i32.wrap_i64 (local.get $y))
+  )
+  ;;@ b.c:17:1:f16
+  (func $f16 (param $x i32) (result i32)
+    (local $y i64)
+    ;;@ b.c:17:7
+    (i32.store offset=64 (local.get $x) (i32.const 16))
+    (global.set $g (i32.add (global.get $g) (i32.const 16)))
+    (if (result i32) (i32.eqz (local.get $x))
+      (then (i32.load offset=64 (local.get $x)))
+      (else (call $f17 (i32.sub (local.get $x) (i32.const 1))))
+    )
+  )
+  ;;@ c.c:18:1
+  (func $f17 (param $x i32) (result i32)
+    (local $y i64)
+    (drop (f64.mul (f64.const 17.5) (f64.convert_i32_s (local.get $x))))
+    ;;@ c.c:18:9
+    (select (call $f18 (local.get $x)) (i32.const 17) (local.get $x))
+  )
+  ;;@ a.c:19:1
+  (func $f18 (param $x i32) (result i32)
+    (local $y i64)
+    ;;@ a.c:19:5
+    (local.set $y (i64.extend_i32_u (local.get $x)))
+    (block $out
+      (loop $l
+        ;;@ b.c:20:3
+        (br_if $out (i64.ge_u (local.get $y) (i64.const 28)))
+        (local.set $y (i64.add (local.get $y) (i64.const 1)))
+        (br $l)
+      )
+    )
+    (i32.wrap_i64 (local.get $y))
+  )
+  ;;@ b.c:20:1
+  (func $f19 (param $x i32) (result i32)
+    (local $y i64)
+    ;;@ b.c:20:7
+    (i32.store offset=76 (local.get $x) (i32.const 19))
+    (global.set $g (i32.add (global.get $g) (i32.const 19)))
+    (if (result i32) (i32.eqz (local.get $x))
+      (then (i32.load offset=76 (local.get $x)))
+      (else (call $f20 (i32.sub (local.get $x) (i32.const 1))))
+    )
+  )
+  ;;@ c.c:21:1:f20
+  (func $f20 (param $x i32) (result i32)
+    (local $y i64)
+    (drop (f64.mul (f64.const 20.5) (f64.convert_i32_s (local.get $x))))
+    ;;@ c.c:21:9
+    (select (call $f21 (local.get $x)) (i32.const 20) (local.get $x))
+  )
+  ;;@ a.c:22:1
+  (func $f21 (param $x i32) (result i32)
+    (local $y i64)
+    ;;@ a.c:22:5
+    (local.set $y (i64.extend_i32_u (local.get $x)))
+    (block $out
+      (loop $l
+        ;;@ b.c:23:3
+        (br_if $out (i64.ge_u (local.get $y) (i64.const 31)))
+        (local.set $y (i64.add (local.get $y) (i64.const 1)))
+        (br $l)
+      )
+    )
+    (i32.wrap_i64 (local.get $y))
+  )
+  ;;@ b.c:23:1
+  (func $f22 (param $x i32) (result i32)
+    (local $y i64)
+    ;;@ b.c:23:7
+    (i32.store offset=88 (local.get $x) (i32.const 22))
+    (global.set $g (i32.add (global.get $g) (i32.const 22)))
+    (if (result i32) (i32.eqz (local.get $x))
+      (then (i32.load offset=88 (local.get $x)))
+      (else (call $f23 (i32.sub (local.get $x) (i32.const 1))))
+    )
+  )
+  ;;@ c.c:24:1
+  (func $f23 (param $x i32) (result i32)
+    (local $y i64)
+    (drop (f64.mul (f64.const 23.5) (f64.convert_i32_s (local.get $x))))
+    ;;@ c.c:24:9
+    (select (call $f0 (local.get $x)) (i32.const 23) (local.get $x))
+  )
+)
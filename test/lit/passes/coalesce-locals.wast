@@ -3,6 +3,11 @@
 
 ;; RUN: foreach %s %t wasm-opt --coalesce-locals -S -o - | filecheck %s
 
+;; Coalescing using interference lists, which is done for functions with very
+;; many locals, must have the same results.
+;; RUN: foreach %s %t wasm-opt --coalesce-locals \
+;; RUN:   --pass-arg=coalesce-locals-list-threshold@0 -S -o - | filecheck %s
+
 (module
   ;; CHECK:      (type $2 (func))
 
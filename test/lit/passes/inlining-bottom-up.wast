@@ -0,0 +1,279 @@
+;; NOTE: Assertions have been generated by update_lit_checks.py and should not be edited.
+;; RUN: foreach %s %t wasm-opt --inlining --pass-arg=inlining-bottom-up -S -o - | filecheck %s
+;; RUN: foreach %s %t wasm-opt --inlining --pass-arg=inlining-bottom-up --optimize-level=3 --pass-arg=inlining-growth-budget@40 -S -o - | filecheck %s --check-prefix O3
+
+;; $leaf is only called from $mid, so it is inlined there first, and then $mid
+;; is inlined into its caller with $leaf already inside it.
+(module
+  (func $leaf (param $x i32) (result i32)
+    (i32.add
+      (i32.mul
+        (local.get $x)
+        (local.get $x)
+      )
+      (i32.const 1)
+    )
+  )
+
+  (func $mid (param $x i32) (result i32)
+    (i32.add
+      (call $leaf
+        (local.get $x)
+      )
+      (i32.const 2)
+    )
+  )
+
+  ;; CHECK:      (func $caller (param $x i32) (result i32)
+  ;; CHECK-NEXT:  (local $1 i32)
+  ;; CHECK-NEXT:  (local $2 i32)
+  ;; CHECK-NEXT:  (block $__inlined_func$mid$1 (result i32)
+  ;; CHECK-NEXT:   (local.set $1
+  ;; CHECK-NEXT:    (local.get $x)
+  ;; CHECK-NEXT:   )
+  ;; CHECK-NEXT:   (local.set $2
+  ;; CHECK-NEXT:    (i32.const 0)
+  ;; CHECK-NEXT:   )
+  ;; CHECK-NEXT:   (i32.add
+  ;; CHECK-NEXT:    (block $__inlined_func$leaf (result i32)
+  ;; CHECK-NEXT:     (local.set $2
+  ;; CHECK-NEXT:      (local.get $1)
+  ;; CHECK-NEXT:     )
+  ;; CHECK-NEXT:     (i32.add
+  ;; CHECK-NEXT:      (i32.mul
+  ;; CHECK-NEXT:       (local.get $2)
+  ;; CHECK-NEXT:       (local.get $2)
+  ;; CHECK-NEXT:      )
+  ;; CHECK-NEXT:      (i32.const 1)
+  ;; CHECK-NEXT:     )
+  ;; CHECK-NEXT:    )
+  ;; CHECK-NEXT:    (i32.const 2)
+  ;; CHECK-NEXT:   )
+  ;; CHECK-NEXT:  )
+  ;; CHECK-NEXT: )
+  ;; O3:      (func $caller (param $x i32) (result i32)
+  ;; O3-NEXT:  (local $1 i32)
+  ;; O3-NEXT:  (local $2 i32)
+  ;; O3-NEXT:  (block $__inlined_func$mid$1 (result i32)
+  ;; O3-NEXT:   (local.set $1
+  ;; O3-NEXT:    (local.get $x)
+  ;; O3-NEXT:   )
+  ;; O3-NEXT:   (local.set $2
+  ;; O3-NEXT:    (i32.const 0)
+  ;; O3-NEXT:   )
+  ;; O3-NEXT:   (i32.add
+  ;; O3-NEXT:    (block $__inlined_func$leaf (result i32)
+  ;; O3-NEXT:     (local.set $2
+  ;; O3-NEXT:      (local.get $1)
+  ;; O3-NEXT:     )
+  ;; O3-NEXT:     (i32.add
+  ;; O3-NEXT:      (i32.mul
+  ;; O3-NEXT:       (local.get $2)
+  ;; O3-NEXT:       (local.get $2)
+  ;; O3-NEXT:      )
+  ;; O3-NEXT:      (i32.const 1)
+  ;; O3-NEXT:     )
+  ;; O3-NEXT:    )
+  ;; O3-NEXT:    (i32.const 2)
+  ;; O3-NEXT:   )
+  ;; O3-NEXT:  )
+  ;; O3-NEXT: )
+  (func $caller (export "caller") (param $x i32) (result i32)
+    (call $mid
+      (local.get $x)
+    )
+  )
+
+)
+
+;; Calls between mutually recursive functions are not inlined, even though they
+;; are tiny, but calls into them from outside are.
+(module
+  ;; CHECK:      (func $a (param $x i32)
+  ;; CHECK-NEXT:  (call $b
+  ;; CHECK-NEXT:   (local.get $x)
+  ;; CHECK-NEXT:  )
+  ;; CHECK-NEXT: )
+  ;; O3:      (func $a (param $x i32)
+  ;; O3-NEXT:  (call $b
+  ;; O3-NEXT:   (local.get $x)
+  ;; O3-NEXT:  )
+  ;; O3-NEXT: )
+  (func $a (param $x i32)
+    (call $b
+      (local.get $x)
+    )
+  )
+
+  ;; CHECK:      (func $b (param $x i32)
+  ;; CHECK-NEXT:  (call $a
+  ;; CHECK-NEXT:   (local.get $x)
+  ;; CHECK-NEXT:  )
+  ;; CHECK-NEXT: )
+  ;; O3:      (func $b (param $x i32)
+  ;; O3-NEXT:  (call $a
+  ;; O3-NEXT:   (local.get $x)
+  ;; O3-NEXT:  )
+  ;; O3-NEXT: )
+  (func $b (param $x i32)
+    (call $a
+      (local.get $x)
+    )
+  )
+
+  ;; CHECK:      (func $main (param $x i32)
+  ;; CHECK-NEXT:  (local $1 i32)
+  ;; CHECK-NEXT:  (block $__inlined_func$a
+  ;; CHECK-NEXT:   (local.set $1
+  ;; CHECK-NEXT:    (local.get $x)
+  ;; CHECK-NEXT:   )
+  ;; CHECK-NEXT:   (call $b
+  ;; CHECK-NEXT:    (local.get $1)
+  ;; CHECK-NEXT:   )
+  ;; CHECK-NEXT:  )
+  ;; CHECK-NEXT: )
+  ;; O3:      (func $main (param $x i32)
+  ;; O3-NEXT:  (local $1 i32)
+  ;; O3-NEXT:  (block $__inlined_func$a
+  ;; O3-NEXT:   (local.set $1
+  ;; O3-NEXT:    (local.get $x)
+  ;; O3-NEXT:   )
+  ;; O3-NEXT:   (call $b
+  ;; O3-NEXT:    (local.get $1)
+  ;; O3-NEXT:   )
+  ;; O3-NEXT:  )
+  ;; O3-NEXT: )
+  (func $main (export "main") (param $x i32)
+    (call $a
+      (local.get $x)
+    )
+  )
+)
+
+;; With -O3, calls are prioritized by how much code they add per estimated
+;; execution, and we stop at the budget (which is 40% of the size of the module
+;; here). $helper is called three times, and only the call in the loop is
+;; inlined.
+(module
+  ;; CHECK:      (func $helper (param $x i32) (result i32)
+  ;; CHECK-NEXT:  (i32.add
+  ;; CHECK-NEXT:   (i32.mul
+  ;; CHECK-NEXT:    (local.get $x)
+  ;; CHECK-NEXT:    (i32.const 3)
+  ;; CHECK-NEXT:   )
+  ;; CHECK-NEXT:   (i32.xor
+  ;; CHECK-NEXT:    (local.get $x)
+  ;; CHECK-NEXT:    (i32.const 5)
+  ;; CHECK-NEXT:   )
+  ;; CHECK-NEXT:  )
+  ;; CHECK-NEXT: )
+  ;; O3:      (func $helper (param $x i32) (result i32)
+  ;; O3-NEXT:  (i32.add
+  ;; O3-NEXT:   (i32.mul
+  ;; O3-NEXT:    (local.get $x)
+  ;; O3-NEXT:    (i32.const 3)
+  ;; O3-NEXT:   )
+  ;; O3-NEXT:   (i32.xor
+  ;; O3-NEXT:    (local.get $x)
+  ;; O3-NEXT:    (i32.const 5)
+  ;; O3-NEXT:   )
+  ;; O3-NEXT:  )
+  ;; O3-NEXT: )
+  (func $helper (param $x i32) (result i32)
+    (i32.add
+      (i32.mul
+        (local.get $x)
+        (i32.const 3)
+      )
+      (i32.xor
+        (local.get $x)
+        (i32.const 5)
+      )
+    )
+  )
+
+  ;; CHECK:      (func $in-loop (param $x i32) (result i32)
+  ;; CHECK-NEXT:  (loop $l
+  ;; CHECK-NEXT:   (local.set $x
+  ;; CHECK-NEXT:    (call $helper
+  ;; CHECK-NEXT:     (local.get $x)
+  ;; CHECK-NEXT:    )
+  ;; CHECK-NEXT:   )
+  ;; CHECK-NEXT:   (br_if $l
+  ;; CHECK-NEXT:    (local.get $x)
+  ;; CHECK-NEXT:   )
+  ;; CHECK-NEXT:  )
+  ;; CHECK-NEXT:  (local.get $x)
+  ;; CHECK-NEXT: )
+  ;; O3:      (func $in-loop (param $x i32) (result i32)
+  ;; O3-NEXT:  (local $1 i32)
+  ;; O3-NEXT:  (loop $l
+  ;; O3-NEXT:   (local.set $x
+  ;; O3-NEXT:    (block $__inlined_func$helper (result i32)
+  ;; O3-NEXT:     (local.set $1
+  ;; O3-NEXT:      (local.get $x)
+  ;; O3-NEXT:     )
+  ;; O3-NEXT:     (i32.add
+  ;; O3-NEXT:      (i32.mul
+  ;; O3-NEXT:       (local.get $1)
+  ;; O3-NEXT:       (i32.const 3)
+  ;; O3-NEXT:      )
+  ;; O3-NEXT:      (i32.xor
+  ;; O3-NEXT:       (local.get $1)
+  ;; O3-NEXT:       (i32.const 5)
+  ;; O3-NEXT:      )
+  ;; O3-NEXT:     )
+  ;; O3-NEXT:    )
+  ;; O3-NEXT:   )
+  ;; O3-NEXT:   (br_if $l
+  ;; O3-NEXT:    (local.get $x)
+  ;; O3-NEXT:   )
+  ;; O3-NEXT:  )
+  ;; O3-NEXT:  (local.get $x)
+  ;; O3-NEXT: )
+  (func $in-loop (export "in-loop") (param $x i32) (result i32)
+    (loop $l
+      (local.set $x
+        (call $helper
+          (local.get $x)
+        )
+      )
+      (br_if $l
+        (local.get $x)
+      )
+    )
+    (local.get $x)
+  )
+
+  ;; CHECK:      (func $not-in-loop1 (param $x i32) (result i32)
+  ;; CHECK-NEXT:  (call $helper
+  ;; CHECK-NEXT:   (local.get $x)
+  ;; CHECK-NEXT:  )
+  ;; CHECK-NEXT: )
+  ;; O3:      (func $not-in-loop1 (param $x i32) (result i32)
+  ;; O3-NEXT:  (call $helper
+  ;; O3-NEXT:   (local.get $x)
+  ;; O3-NEXT:  )
+  ;; O3-NEXT: )
+  (func $not-in-loop1 (export "not-in-loop1") (param $x i32) (result i32)
+    (call $helper
+      (local.get $x)
+    )
+  )
+
+  ;; CHECK:      (func $not-in-loop2 (param $x i32) (result i32)
+  ;; CHECK-NEXT:  (call $helper
+  ;; CHECK-NEXT:   (local.get $x)
+  ;; CHECK-NEXT:  )
+  ;; CHECK-NEXT: )
+  ;; O3:      (func $not-in-loop2 (param $x i32) (result i32)
+  ;; O3-NEXT:  (call $helper
+  ;; O3-NEXT:   (local.get $x)
+  ;; O3-NEXT:  )
+  ;; O3-NEXT: )
+  (func $not-in-loop2 (export "not-in-loop2") (param $x i32) (result i32)
+    (call $helper
+      (local.get $x)
+    )
+  )
+)
@@ -0,0 +1,89 @@
+;; RUN: wasm-opt %s --merge-similar-functions \
+;; RUN:   --pass-arg=merge-similar-functions-stats -o /dev/null | filecheck %s
+
+;; $a, $b and $c differ only in a constant and are merged. $d and $e are too
+;; small for merging them to save anything, so they are not reported.
+
+;; CHECK:      merged 3 functions into byn$mgfn-shared$a: 75 -> 43 bytes (32 saved)
+;; CHECK-NEXT: merged 1 classes: 32 bytes saved
+
+(module
+  (func $a (result i32)
+    (i32.add
+      (i32.mul
+        (i32.add
+          (i32.const 1)
+          (i32.const 2)
+        )
+        (i32.add
+          (i32.const 3)
+          (i32.const 4)
+        )
+      )
+      (i32.mul
+        (i32.add
+          (i32.const 5)
+          (i32.const 6)
+        )
+        (i32.add
+          (i32.const 7)
+          (i32.const 10)
+        )
+      )
+    )
+  )
+  (func $b (result i32)
+    (i32.add
+      (i32.mul
+        (i32.add
+          (i32.const 1)
+          (i32.const 2)
+        )
+        (i32.add
+          (i32.const 3)
+          (i32.const 4)
+        )
+      )
+      (i32.mul
+        (i32.add
+          (i32.const 5)
+          (i32.const 6)
+        )
+        (i32.add
+          (i32.const 7)
+          (i32.const 20)
+        )
+      )
+    )
+  )
+  (func $c (result i32)
+    (i32.add
+      (i32.mul
+        (i32.add
+          (i32.const 1)
+          (i32.const 2)
+        )
+        (i32.add
+          (i32.const 3)
+          (i32.const 4)
+        )
+      )
+      (i32.mul
+        (i32.add
+          (i32.const 5)
+          (i32.const 6)
+        )
+        (i32.add
+          (i32.const 7)
+          (i32.const 30)
+        )
+      )
+    )
+  )
+  (func $d (result i32)
+    (i32.const 1)
+  )
+  (func $e (result i32)
+    (i32.const 2)
+  )
+)
@@ -0,0 +1,159 @@
+;; NOTE: Assertions have been generated by update_lit_checks.py --all-items and should not be edited.
+;; RUN: foreach %s %t wasm-opt --outlining --pass-arg=outlining-select-by-benefit -S -all -o - | filecheck %s
+
+;; A sequence that occurs three times, twice as part of a longer one, saves more
+;; than the longer one, so it is outlined on its own.
+(module
+  ;; CHECK:      (type $0 (func))
+
+  ;; CHECK:      (func $outline$ (type $0)
+  ;; CHECK-NEXT:  (drop
+  ;; CHECK-NEXT:   (i32.const 1)
+  ;; CHECK-NEXT:  )
+  ;; CHECK-NEXT:  (drop
+  ;; CHECK-NEXT:   (i32.const 2)
+  ;; CHECK-NEXT:  )
+  ;; CHECK-NEXT: )
+
+  ;; CHECK:      (func $a (type $0)
+  ;; CHECK-NEXT:  (call $outline$)
+  ;; CHECK-NEXT:  (drop
+  ;; CHECK-NEXT:   (i32.const 3)
+  ;; CHECK-NEXT:  )
+  ;; CHECK-NEXT: )
+  (func $a
+    (drop
+      (i32.const 1)
+    )
+    (drop
+      (i32.const 2)
+    )
+    (drop
+      (i32.const 3)
+    )
+  )
+  ;; CHECK:      (func $b (type $0)
+  ;; CHECK-NEXT:  (call $outline$)
+  ;; CHECK-NEXT:  (drop
+  ;; CHECK-NEXT:   (i32.const 3)
+  ;; CHECK-NEXT:  )
+  ;; CHECK-NEXT: )
+  (func $b
+    (drop
+      (i32.const 1)
+    )
+    (drop
+      (i32.const 2)
+    )
+    (drop
+      (i32.const 3)
+    )
+  )
+  ;; CHECK:      (func $c (type $0)
+  ;; CHECK-NEXT:  (call $outline$)
+  ;; CHECK-NEXT:  (drop
+  ;; CHECK-NEXT:   (i32.const 4)
+  ;; CHECK-NEXT:  )
+  ;; CHECK-NEXT: )
+  (func $c
+    (drop
+      (i32.const 1)
+    )
+    (drop
+      (i32.const 2)
+    )
+    (drop
+      (i32.const 4)
+    )
+  )
+)
+
+;; A repeated sequence that ends in a local.get is outlined without it.
+(module
+  ;; CHECK:      (type $0 (func (param i32)))
+
+  ;; CHECK:      (type $1 (func))
+
+  ;; CHECK:      (func $outline$ (type $1)
+  ;; CHECK-NEXT:  (drop
+  ;; CHECK-NEXT:   (i32.const 1)
+  ;; CHECK-NEXT:  )
+  ;; CHECK-NEXT:  (drop
+  ;; CHECK-NEXT:   (i32.const 2)
+  ;; CHECK-NEXT:  )
+  ;; CHECK-NEXT:  (drop
+  ;; CHECK-NEXT:   (i32.const 3)
+  ;; CHECK-NEXT:  )
+  ;; CHECK-NEXT: )
+
+  ;; CHECK:      (func $a (type $0) (param $x i32)
+  ;; CHECK-NEXT:  (call $outline$)
+  ;; CHECK-NEXT:  (drop
+  ;; CHECK-NEXT:   (local.get $x)
+  ;; CHECK-NEXT:  )
+  ;; CHECK-NEXT: )
+  (func $a (param $x i32)
+    (drop
+      (i32.const 1)
+    )
+    (drop
+      (i32.const 2)
+    )
+    (drop
+      (i32.const 3)
+    )
+    (drop
+      (local.get $x)
+    )
+  )
+  ;; CHECK:      (func $b (type $0) (param $x i32)
+  ;; CHECK-NEXT:  (call $outline$)
+  ;; CHECK-NEXT:  (drop
+  ;; CHECK-NEXT:   (local.get $x)
+  ;; CHECK-NEXT:  )
+  ;; CHECK-NEXT: )
+  (func $b (param $x i32)
+    (drop
+      (i32.const 1)
+    )
+    (drop
+      (i32.const 2)
+    )
+    (drop
+      (i32.const 3)
+    )
+    (drop
+      (local.get $x)
+    )
+  )
+)
+
+;; A sequence of two instructions that occurs twice saves nothing.
+(module
+  ;; CHECK:      (type $0 (func))
+
+  ;; CHECK:      (func $a (type $0)
+  ;; CHECK-NEXT:  (drop
+  ;; CHECK-NEXT:   (i32.const 1)
+  ;; CHECK-NEXT:  )
+  ;; CHECK-NEXT:  (nop)
+  ;; CHECK-NEXT: )
+  (func $a
+    (drop
+      (i32.const 1)
+    )
+    (nop)
+  )
+  ;; CHECK:      (func $b (type $0)
+  ;; CHECK-NEXT:  (drop
+  ;; CHECK-NEXT:   (i32.const 1)
+  ;; CHECK-NEXT:  )
+  ;; CHECK-NEXT:  (unreachable)
+  ;; CHECK-NEXT: )
+  (func $b
+    (drop
+      (i32.const 1)
+    )
+    (unreachable)
+  )
+)
@@ -0,0 +1,75 @@
+;; NOTE: Assertions have been generated by update_lit_checks.py and should not be edited.
+
+;; RUN: wasm-opt %s --precompute-propagate -S -o - | filecheck %s
+
+;; Precompute remembers which expressions are not constant, so that it does not
+;; evaluate them again. That must not stop us when they can be constant after
+;; all, because of the code evaluated before them, or of values we propagate.
+
+(module
+ ;; CHECK:      (import "a" "b" (func $import (result i32)))
+ (import "a" "b" (func $import (result i32)))
+
+ ;; CHECK:      (func $set-before (result i32)
+ ;; CHECK-NEXT:  (local $x i32)
+ ;; CHECK-NEXT:  (drop
+ ;; CHECK-NEXT:   (local.tee $x
+ ;; CHECK-NEXT:    (i32.const 1)
+ ;; CHECK-NEXT:   )
+ ;; CHECK-NEXT:  )
+ ;; CHECK-NEXT:  (i32.const 3)
+ ;; CHECK-NEXT: )
+ (func $set-before (result i32)
+  (local $x i32)
+  ;; The multiplication is not constant by itself, but it is after the tee.
+  (i32.add
+   (local.tee $x
+    (i32.const 1)
+   )
+   (i32.mul
+    (local.get $x)
+    (i32.const 2)
+   )
+  )
+ )
+
+ ;; CHECK:      (func $propagated (result i32)
+ ;; CHECK-NEXT:  (local $x i32)
+ ;; CHECK-NEXT:  (local.set $x
+ ;; CHECK-NEXT:   (i32.const 0)
+ ;; CHECK-NEXT:  )
+ ;; CHECK-NEXT:  (i32.const 1)
+ ;; CHECK-NEXT: )
+ (func $propagated (result i32)
+  (local $x i32)
+  (local.set $x
+   (i32.const 0)
+  )
+  ;; The comparison is not constant in the first walk, but it is after we
+  ;; propagate the value of $x.
+  (i32.eq
+   (local.get $x)
+   (i32.const 0)
+  )
+ )
+
+ ;; CHECK:      (func $nonconstant (result i32)
+ ;; CHECK-NEXT:  (i32.add
+ ;; CHECK-NEXT:   (i32.add
+ ;; CHECK-NEXT:    (call $import)
+ ;; CHECK-NEXT:    (i32.const 1)
+ ;; CHECK-NEXT:   )
+ ;; CHECK-NEXT:   (i32.const 2)
+ ;; CHECK-NEXT:  )
+ ;; CHECK-NEXT: )
+ (func $nonconstant (result i32)
+  ;; Not constant in any context.
+  (i32.add
+   (i32.add
+    (call $import)
+    (i32.const 1)
+   )
+   (i32.const 2)
+  )
+ )
+)
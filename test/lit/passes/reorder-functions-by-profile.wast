@@ -0,0 +1,89 @@
+;; Generate profiles with and without call edges by calling $main.
+;; RUN: wasm-split --instrument --call-counts --call-edges %s -o %t.edges.wasm -g
+;; RUN: node %S/../wasm-split/call_exports.mjs %t.edges.wasm %t.edges.prof main
+;; RUN: wasm-split --instrument %s -o %t.plain.wasm -g
+;; RUN: node %S/../wasm-split/call_exports.mjs %t.plain.wasm %t.plain.prof main
+
+;; RUN: wasm-opt %s --reorder-functions-by-profile=%t.edges.prof \
+;; RUN:   --pass-arg=reorder-functions-by-profile-report -S -o - \
+;; RUN:   | filecheck %s --check-prefix EDGES
+;; RUN: wasm-opt %s --reorder-functions-by-profile=%t.plain.prof -S -o - \
+;; RUN:   | filecheck %s --check-prefix PLAIN
+
+;; The profile must be for this module.
+;; RUN: not wasm-opt %s --remove-unused-module-elements \
+;; RUN:   --reorder-functions-by-profile=%t.plain.prof 2>&1 \
+;; RUN:   | filecheck %s --check-prefix MISMATCH
+
+;; The profile is checked against the file it was made for, which is the input
+;; by default, so a binary build of the same module does not match it, unless
+;; the original file is given instead.
+;; RUN: wasm-opt %s -g -o %t.binary.wasm
+;; RUN: not wasm-opt %t.binary.wasm \
+;; RUN:   --reorder-functions-by-profile=%t.plain.prof 2>&1 \
+;; RUN:   | filecheck %s --check-prefix CHECKSUM
+;; RUN: wasm-opt %t.binary.wasm --reorder-functions-by-profile=%t.plain.prof \
+;; RUN:   --pass-arg=reorder-functions-by-profile-module@%s -S -o - \
+;; RUN:   | filecheck %s --check-prefix PLAIN
+
+;; With call edges, $helper and $leaf follow $main, which calls $helper the most,
+;; and $init comes after them. Without them, the functions that ran are in the
+;; order in which they were first called. Either way the functions that did not
+;; run keep their order at the end.
+
+;; EDGES:      startup code before: 53 of 53 bytes
+;; EDGES-NEXT: startup code after: 22 of 53 bytes
+
+;; EDGES:      (func $main
+;; EDGES:      (func $helper
+;; EDGES:      (func $leaf
+;; EDGES:      (func $init
+;; EDGES:      (func $unused1
+;; EDGES:      (func $unused2
+;; EDGES:      (func $other
+
+;; PLAIN:      (func $main
+;; PLAIN:      (func $init
+;; PLAIN:      (func $helper
+;; PLAIN:      (func $leaf
+;; PLAIN:      (func $unused1
+;; PLAIN:      (func $unused2
+;; PLAIN:      (func $other
+
+;; MISMATCH: the profile has 7 functions but the module has 5 defined functions
+
+;; CHECKSUM: reorder-functions-by-profile: checksum in profile does not match the checksum of {{.*}}.binary.wasm
+
+(module
+  (memory $m 0 0)
+  (export "memory" (memory $m))
+  (export "main" (func $main))
+  (export "other" (func $other))
+  (func $unused1
+    (drop (i32.add (i32.const 1) (i32.const 2)))
+    (drop (i32.add (i32.const 1) (i32.const 2)))
+  )
+  (func $leaf
+    (nop)
+  )
+  (func $unused2
+    (drop (i32.add (i32.const 1) (i32.const 2)))
+    (drop (i32.add (i32.const 1) (i32.const 2)))
+  )
+  (func $helper
+    (call $leaf)
+    (call $leaf)
+  )
+  (func $other
+    (nop)
+  )
+  (func $init
+    (nop)
+  )
+  (func $main
+    (call $init)
+    (call $helper)
+    (call $helper)
+    (call $leaf)
+  )
+)
@@ -0,0 +1,21 @@
+;; Test that --profile-passes writes a Chrome trace of the passes that ran.
+
+;; RUN: wasm-opt %s --vacuum --remove-unused-module-elements --profile-passes=%t.json -o %t.wasm
+;; RUN: cat %t.json | filecheck %s
+
+;; The function-parallel vacuum reports its slowest functions on the threads
+;; that ran them, and then a summary of the whole pass. Vacuum shrinks $foo.
+;; CHECK:      {"traceEvents": [
+;; CHECK-NEXT: {"name": "vacuum", "cat": "pass", "ph": "X", "pid": 0, "tid": {{[1-9][0-9]*}}, "ts": {{.*}}, "dur": {{.*}}, "args": {"function": "foo", "ms": {{.*}}, "nodes_delta": -{{[1-9][0-9]*}}}},
+;; CHECK-NEXT: {"name": "vacuum", "cat": "pass", "ph": "X", "pid": 0, "tid": 0, "ts": {{.*}}, "dur": {{.*}}, "args": {"wall_ms": {{.*}}, "cpu_ms": {{.*}}, "arena_bytes": {{[0-9]+}}, "nodes_before": {{[0-9]+}}, "nodes_after": {{[0-9]+}}, "nodes_delta": -{{[1-9][0-9]*}}, "passes": [{"name": "vacuum", "thread_ms": {{.*}}, "nodes_delta": -{{[1-9][0-9]*}}, "hottest": [{"function": "foo", "ms": {{.*}}, "nodes_delta": -{{[1-9][0-9]*}}}]}]}},
+;; CHECK-NEXT: {"name": "remove-unused-module-elements", "cat": "pass", "ph": "X", "pid": 0, "tid": 0, "ts": {{.*}}, "dur": {{.*}}, "args": {"wall_ms": {{.*}}, "cpu_ms": {{.*}}, "arena_bytes": {{[0-9]+}}, "nodes_before": {{[0-9]+}}, "nodes_after": {{[0-9]+}}, "nodes_delta": 0}}
+;; CHECK-NEXT: ], "displayTimeUnit": "ms"}
+
+(module
+  (func $foo (export "foo")
+    (drop
+      (i32.const 1)
+    )
+    (nop)
+  )
+)
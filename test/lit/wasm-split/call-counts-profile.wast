@@ -0,0 +1,76 @@
+;; Instrument the module to count calls
+;; RUN: wasm-split --instrument --call-counts --call-edges %s -o %t.instrumented.wasm -g
+
+;; Generate profiles
+;; RUN: node %S/call_exports.mjs %t.instrumented.wasm %t.foo.prof foo foo
+;; RUN: node %S/call_exports.mjs %t.instrumented.wasm %t.bar.qux.prof bar qux
+
+;; Print a profile
+;; RUN: wasm-split %s --print-profile=%t.foo.prof | filecheck %s --check-prefix FOO
+
+;; Merge the profiles, which sums the counts, and print the result
+;; RUN: wasm-split --merge-profiles %t.foo.prof %t.bar.qux.prof -o %t.merged.prof
+;; RUN: wasm-split %s --print-profile=%t.merged.prof | filecheck %s --check-prefix MERGED
+
+;; Profiles with call counts can be used to split as usual
+;; RUN: wasm-split %s --profile %t.foo.prof -o1 %t.1.wasm -o2 %t.2.wasm -v \
+;; RUN:   | filecheck %s --check-prefix SPLIT
+
+;; Profiles with different contents cannot be merged
+;; RUN: wasm-split --instrument %s -o %t.plain.wasm -g
+;; RUN: node %S/call_exports.mjs %t.plain.wasm %t.plain.prof foo
+;; RUN: not wasm-split --merge-profiles %t.foo.prof %t.plain.prof -o %t.bad.prof 2>&1 \
+;; RUN:   | filecheck %s --check-prefix INCOMPATIBLE
+
+;; FOO:      Keeping functions:
+;; FOO-NEXT: + bar (calls: 4)
+;; FOO-NEXT: + baz (calls: 6)
+;; FOO-NEXT: + foo (calls: 2)
+;; FOO-EMPTY:
+;; FOO-NEXT: Splitting out functions:
+;; FOO-NEXT: - qux (calls: 0)
+;; FOO-EMPTY:
+;; FOO-NEXT: Call edges:
+;; FOO-NEXT:   foo -> bar (calls: 4)
+;; FOO-NEXT:   bar -> baz (calls: 4)
+;; FOO-NEXT:   foo -> baz (calls: 2)
+
+;; MERGED:      Keeping functions:
+;; MERGED-NEXT: + bar (calls: 5)
+;; MERGED-NEXT: + baz (calls: 7)
+;; MERGED-NEXT: + foo (calls: 2)
+;; MERGED-NEXT: + qux (calls: 1)
+;; MERGED-EMPTY:
+;; MERGED-NEXT: Splitting out functions:
+;; MERGED-EMPTY:
+;; MERGED-NEXT: Call edges:
+;; MERGED-NEXT:   bar -> baz (calls: 5)
+;; MERGED-NEXT:   foo -> bar (calls: 4)
+;; MERGED-NEXT:   foo -> baz (calls: 2)
+
+;; SPLIT: Keeping functions: bar, baz, foo{{$}}
+;; SPLIT-NEXT: Splitting out functions: qux{{$}}
+
+;; INCOMPATIBLE: incompatible with profile
+
+(module
+  (memory $m 0 0)
+  (export "memory" (memory $m))
+  (export "foo" (func $foo))
+  (export "bar" (func $bar))
+  (export "qux" (func $qux))
+  (func $foo
+    (call $bar)
+    (call $bar)
+    (call $baz)
+  )
+  (func $bar
+    (call $baz)
+  )
+  (func $baz
+    (nop)
+  )
+  (func $qux
+    (nop)
+  )
+)
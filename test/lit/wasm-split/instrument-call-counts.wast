@@ -0,0 +1,168 @@
+;; RUN: wasm-split %s --instrument --call-counts --call-edges -S -o - | filecheck %s
+;; RUN: wasm-split %s --instrument --call-counts --call-edges --in-secondary-memory --enable-threads --enable-multimemory -S -o - | filecheck %s --check-prefix MEM
+
+;; Check that the output round trips and validates as well
+;; RUN: wasm-split %s --instrument --call-counts --call-edges -g -o %t.wasm
+;; RUN: wasm-opt %t.wasm -S -o -
+;; RUN: wasm-split %s --instrument --call-counts --call-edges --in-secondary-memory --enable-threads --enable-multimemory -g -o %t.mem.wasm
+;; RUN: wasm-opt --enable-threads --enable-multimemory %t.mem.wasm -S -o -
+
+;; Call counts are not supported in the main memory.
+;; RUN: not wasm-split %s --instrument --call-counts --in-memory --enable-threads 2>&1 \
+;; RUN:   | filecheck %s --check-prefix IN-MEMORY
+
+(module
+  (import "env" "foo" (func $foo))
+  (export "bar" (func $bar))
+  (func $bar
+    (call $foo)
+    (drop
+      (call $baz
+        (i32.const 0)
+      )
+    )
+  )
+  (func $baz (param i32) (result i32)
+    (local.get 0)
+  )
+)
+
+;; Check that a 64-bit counter has been added for each function and for the
+;; only call edge between defined functions
+;; CHECK: (global $bar_calls (mut i64) (i64.const 0))
+;; CHECK: (global $baz_calls (mut i64) (i64.const 0))
+;; CHECK: (global $bar_to_baz (mut i64) (i64.const 0))
+
+;; Check that the calls to functions are counted after their timestamps are set,
+;; and that the call to the defined function is counted but not the call to the
+;; import
+
+;; CHECK:      (func $bar{{$}}
+;; CHECK-NEXT:  (if
+;; CHECK-NEXT:   (i32.eqz
+;; CHECK-NEXT:    (global.get $bar_timestamp)
+;; CHECK-NEXT:   )
+;; CHECK:       (global.set $bar_calls
+;; CHECK-NEXT:   (i64.add
+;; CHECK-NEXT:    (global.get $bar_calls)
+;; CHECK-NEXT:    (i64.const 1)
+;; CHECK-NEXT:   )
+;; CHECK-NEXT:  )
+;; CHECK-NEXT:  (block
+;; CHECK-NEXT:   (call $foo)
+;; CHECK-NEXT:   (drop
+;; CHECK-NEXT:    (block (result i32)
+;; CHECK-NEXT:     (global.set $bar_to_baz
+;; CHECK-NEXT:      (i64.add
+;; CHECK-NEXT:       (global.get $bar_to_baz)
+;; CHECK-NEXT:       (i64.const 1)
+;; CHECK-NEXT:      )
+;; CHECK-NEXT:     )
+;; CHECK-NEXT:     (call $baz
+;; CHECK-NEXT:      (i32.const 0)
+;; CHECK-NEXT:     )
+;; CHECK-NEXT:    )
+;; CHECK-NEXT:   )
+;; CHECK-NEXT:  )
+;; CHECK-NEXT: )
+
+;; Check that the profile is written in the extended format: the magic number,
+;; the flags and the number of functions follow the hash, and the call counts
+;; and the call edge follow the timestamps.
+
+;; CHECK:      (func $__write_profile (param $addr i32) (param $size i32) (result i32)
+;; CHECK-NEXT:  (if
+;; CHECK-NEXT:   (i32.ge_u
+;; CHECK-NEXT:    (local.get $size)
+;; CHECK-NEXT:    (i32.const 64)
+;; CHECK-NEXT:   )
+;; CHECK-NEXT:   (then
+;; CHECK-NEXT:    (i64.store align=1
+;; CHECK-NEXT:     (local.get $addr)
+;; CHECK-NEXT:     (i64.const {{.*}})
+;; CHECK-NEXT:    )
+;; CHECK-NEXT:    (i32.store offset=8 align=1
+;; CHECK-NEXT:     (local.get $addr)
+;; CHECK-NEXT:     (i32.const 829453175)
+;; CHECK-NEXT:    )
+;; CHECK-NEXT:    (i32.store offset=12 align=1
+;; CHECK-NEXT:     (local.get $addr)
+;; CHECK-NEXT:     (i32.const 3)
+;; CHECK-NEXT:    )
+;; CHECK-NEXT:    (i32.store offset=16 align=1
+;; CHECK-NEXT:     (local.get $addr)
+;; CHECK-NEXT:     (i32.const 2)
+;; CHECK-NEXT:    )
+;; CHECK-NEXT:    (i32.store offset=20 align=1
+;; CHECK-NEXT:     (local.get $addr)
+;; CHECK-NEXT:     (global.get $bar_timestamp)
+;; CHECK-NEXT:    )
+;; CHECK-NEXT:    (i32.store offset=24 align=1
+;; CHECK-NEXT:     (local.get $addr)
+;; CHECK-NEXT:     (global.get $baz_timestamp)
+;; CHECK-NEXT:    )
+;; CHECK-NEXT:    (i64.store offset=28 align=1
+;; CHECK-NEXT:     (local.get $addr)
+;; CHECK-NEXT:     (global.get $bar_calls)
+;; CHECK-NEXT:    )
+;; CHECK-NEXT:    (i64.store offset=36 align=1
+;; CHECK-NEXT:     (local.get $addr)
+;; CHECK-NEXT:     (global.get $baz_calls)
+;; CHECK-NEXT:    )
+;; CHECK-NEXT:    (i32.store offset=44 align=1
+;; CHECK-NEXT:     (local.get $addr)
+;; CHECK-NEXT:     (i32.const 1)
+;; CHECK-NEXT:    )
+;; CHECK-NEXT:    (i64.store offset=48 align=1
+;; CHECK-NEXT:     (local.get $addr)
+;; CHECK-NEXT:     (i64.const 4294967296)
+;; CHECK-NEXT:    )
+;; CHECK-NEXT:    (i64.store offset=56 align=1
+;; CHECK-NEXT:     (local.get $addr)
+;; CHECK-NEXT:     (global.get $bar_to_baz)
+;; CHECK-NEXT:    )
+;; CHECK-NEXT:   )
+;; CHECK-NEXT:  )
+;; CHECK-NEXT:  (i32.const 64)
+;; CHECK-NEXT: )
+
+;; In the secondary memory, the counters come after a byte for each function,
+;; aligned to 8 bytes, and are updated atomically.
+
+;; MEM:      (func $bar{{$}}
+;; MEM-NEXT:  (i32.atomic.store8
+;; MEM-NEXT:   (i32.const 0)
+;; MEM-NEXT:   (i32.const 1)
+;; MEM-NEXT:  )
+;; MEM-NEXT:  (drop
+;; MEM-NEXT:   (i64.atomic.rmw.add offset=8
+;; MEM-NEXT:    (i32.const 0)
+;; MEM-NEXT:    (i64.const 1)
+;; MEM-NEXT:   )
+;; MEM-NEXT:  )
+;; MEM-NEXT:  (block
+;; MEM-NEXT:   (call $foo)
+;; MEM-NEXT:   (drop
+;; MEM-NEXT:    (block (result i32)
+;; MEM-NEXT:     (drop
+;; MEM-NEXT:      (i64.atomic.rmw.add offset=24
+;; MEM-NEXT:       (i32.const 0)
+;; MEM-NEXT:       (i64.const 1)
+;; MEM-NEXT:      )
+;; MEM-NEXT:     )
+
+;; MEM:      (func $baz (param $0 i32) (result i32)
+;; MEM-NEXT:  (i32.atomic.store8 offset=1
+;; MEM-NEXT:   (i32.const 0)
+;; MEM-NEXT:   (i32.const 1)
+;; MEM-NEXT:  )
+;; MEM-NEXT:  (drop
+;; MEM-NEXT:   (i64.atomic.rmw.add offset=16
+;; MEM-NEXT:    (i32.const 0)
+;; MEM-NEXT:    (i64.const 1)
+;; MEM-NEXT:   )
+;; MEM-NEXT:  )
+;; MEM-NEXT:  (local.get $0)
+;; MEM-NEXT: )
+
+;; IN-MEMORY: error: --call-counts and --call-edges cannot be used with --in-memory
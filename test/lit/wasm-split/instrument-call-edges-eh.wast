@@ -0,0 +1,80 @@
+;; RUN: wasm-split %s --instrument --call-edges -all -S -o - | filecheck %s
+
+;; Check that the output validates.
+;; RUN: wasm-split %s --instrument --call-edges -all -S -o %t.wat
+;; RUN: wasm-opt %t.wat -all -o /dev/null
+
+;; Counting a call puts an increment before it. When the call's operands
+;; contain the pop of a catch, the pop must stay at the start of the catch, so
+;; it is moved to a local first.
+
+(module
+  (tag $tag (param i32))
+  (export "bar" (func $bar))
+  (func $bar
+    (try
+      (do
+        (call $baz
+          (i32.const 0)
+        )
+      )
+      (catch $tag
+        (call $baz
+          (pop i32)
+        )
+      )
+    )
+    (try
+      (do)
+      (catch $tag
+        (drop
+          (call $qux
+            (pop i32)
+          )
+        )
+      )
+    )
+  )
+  (func $baz (param i32)
+  )
+  (func $qux (param i32) (result i32)
+    (local.get 0)
+  )
+)
+
+;; CHECK:      (catch $tag
+;; CHECK-NEXT:  (local.set $0
+;; CHECK-NEXT:   (pop i32)
+;; CHECK-NEXT:  )
+;; CHECK-NEXT:  (global.set $bar_to_baz
+;; CHECK-NEXT:   (i64.add
+;; CHECK-NEXT:    (global.get $bar_to_baz)
+;; CHECK-NEXT:    (i64.const 1)
+;; CHECK-NEXT:   )
+;; CHECK-NEXT:  )
+;; CHECK-NEXT:  (call $baz
+;; CHECK-NEXT:   (local.get $0)
+;; CHECK-NEXT:  )
+;; CHECK-NEXT: )
+
+;; CHECK:      (catch $tag
+;; CHECK-NEXT:  (local.set $2
+;; CHECK-NEXT:   (pop i32)
+;; CHECK-NEXT:  )
+;; CHECK-NEXT:  (drop
+;; CHECK-NEXT:   (block (result i32)
+;; CHECK-NEXT:    (local.set $1
+;; CHECK-NEXT:     (local.get $2)
+;; CHECK-NEXT:    )
+;; CHECK-NEXT:    (global.set $bar_to_qux
+;; CHECK-NEXT:     (i64.add
+;; CHECK-NEXT:      (global.get $bar_to_qux)
+;; CHECK-NEXT:      (i64.const 1)
+;; CHECK-NEXT:     )
+;; CHECK-NEXT:    )
+;; CHECK-NEXT:    (call $qux
+;; CHECK-NEXT:     (local.get $1)
+;; CHECK-NEXT:    )
+;; CHECK-NEXT:   )
+;; CHECK-NEXT:  )
+;; CHECK-NEXT: )
@@ -0,0 +1,42 @@
+;; The in-process oracle runs -O1 and then extracts $kept, which fails if $kept
+;; was removed, so the reduction must keep $kept.
+(module
+  (global $g (mut i32) (i32.const 0))
+  (export "a" (func $a))
+  (export "kept" (func $kept))
+  (func $a (param $x i32) (result i32)
+    (global.set $g
+      (i32.add
+        (global.get $g)
+        (call $kept
+          (local.get $x)
+        )
+      )
+    )
+    (global.get $g)
+  )
+  (func $kept (param $x i32) (result i32)
+    (if
+      (local.get $x)
+      (then
+        (return
+          (call $b
+            (i32.sub
+              (local.get $x)
+              (i32.const 1)
+            )
+          )
+        )
+      )
+    )
+    (i32.const 42)
+  )
+  (func $b (param $x i32) (result i32)
+    (i32.mul
+      (call $kept
+        (local.get $x)
+      )
+      (i32.const 3)
+    )
+  )
+)